@@ -51,7 +51,8 @@
     fflush(stderr);\
 }
 
-#ifdef MPI_INCLUDED
+//MPICH defines MPI_INCLUDED, Open MPI does not, USE_MPI covers both.
+#if defined(MPI_INCLUDED) || defined(USE_MPI)
 
 #include <mpi.h>
 
@@ -34,6 +34,7 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 #include <GL/glew.h>
 #endif
 #include "GLVertexBufferObject.h"
+#include "GLVertexPacking.h"
 
 using namespace std;
 
@@ -81,6 +82,11 @@ public:
 				GLuint nComponets,  GLuint stride=0, GLuint offset=0,
 				bool normalized=false, bool warning=false, GLuint divsor = 0,
 				const GLVertexBufferObjectRef vbo=GLVertexBufferObjectRef((GLVertexBufferObject*)NULL));//GLenum bindingIndex,);
+	//Attribute stored in one of the compact GLVertexPacking formats, type,
+	//components, normalization and stride are derived from format.
+	GLAttribute(GLuint shaderProgId, const string& name, GLVertexPacking::Format format,
+				GLuint offset=0, bool warning=false, GLuint divsor = 0,
+				const GLVertexBufferObjectRef vbo=GLVertexBufferObjectRef((GLVertexBufferObject*)NULL));
 	~GLAttribute(void);
 
 	void attach(const GLVertexBufferObjectRef vbo){m_vbo = vbo;}
@@ -92,6 +98,14 @@ public:
 	//prior the usage of GLAttribute::bind().
 	void enable();
 	void disable();
+	//Immutable (Direct State Access) counterpart of enable(), requires GL 4.5.
+	//Record the attribute format into VAO vaoId and route it to the VAO-local
+	//binding index bindingIndex, without binding anything. The vertex buffer
+	//itself is attached by the VAO via glVertexArrayVertexBuffer().
+	//Return the attribute location in the shader program.
+	GLint enableImmutable(GLuint vaoId, GLuint bindingIndex);
+	GLuint getOffset() const { return m_offset; }
+	GLuint getDivisor() const { return m_divisor; }
 
     void setActive(bool v){ m_bActive = v; }
     bool isActive() const { return m_bActive; }
@@ -108,6 +122,12 @@ public:
 	void   setStride(GLuint val) { m_stride = val; }
 
 private:
+	//Look up the attribute location and verify the associated VBO has content.
+	GLint getValidatedLocation();
+	//Integer attributes go through glVertexAttribI*, normalized ones are
+	//converted to float like any other type.
+	bool isIntegerAttribute() const;
+
     bool m_bActive;//if attribute is active in the shader.
 	GLVertexBufferObjectRef m_vbo;//The array buffer associated with the attribute.
 	string m_name;//string representation of attribute name
@@ -0,0 +1,196 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_BUFFER_HEAP_H_
+#define _GL_BUFFER_HEAP_H_
+
+#include <stddef.h>
+#include <vector>
+#include <memory>
+#include <string>
+#include "GLBufferObject.h"
+
+namespace davinci{
+
+//Two-level segregated fit (TLSF) allocator of byte ranges inside one buffer.
+//Allocation and free are O(1): free ranges are binned by the position of
+//their highest bit and the next 4 bits, and neighbouring free ranges are
+//merged on free. It never touches GL, offsets are all it hands out.
+class GLBufferSubAllocator
+{
+public:
+	enum { GRANULARITY = 16 };//every range starts and ends on 16 bytes.
+
+	GLBufferSubAllocator(size_t capacity);
+
+	//Returns a range id, or -1 when no free range is big enough.
+	//alignment: power of two, rounded up to GRANULARITY.
+	int    allocate(size_t sizeInBytes, size_t alignment, size_t& offset);
+	void   free(int rangeId);
+	size_t getOffset(int rangeId) const { return m_ranges[rangeId].offset; }
+	size_t getSize(int rangeId) const { return m_ranges[rangeId].size; }
+
+	size_t getCapacity() const { return m_capacity; }
+	size_t getUsedBytes() const { return m_usedBytes; }
+	size_t getLargestFreeRange() const;
+
+private:
+	enum { SL_LOG = 4, SL_COUNT = 1 << SL_LOG, FL_COUNT = 48 };
+	struct Range{
+		size_t offset, size;
+		int prevPhys, nextPhys;//neighbours in address order, -1 at the ends.
+		int prevFree, nextFree;//links within the free list of its bin.
+		bool isFree;
+	};
+	static void mapping(size_t granules, int& fl, int& sl);
+	int  newRange();
+	void insertFree(int r);
+	void removeFree(int r);
+	//Split r so it keeps sizeInBytes, the tail becomes a free range.
+	void splitTail(int r, size_t sizeInBytes);
+
+	std::vector<Range> m_ranges;
+	std::vector<int>   m_unusedRanges;//recycled entries of m_ranges.
+	int                m_freeHeads[FL_COUNT][SL_COUNT];
+	unsigned long long m_flBitmap;
+	unsigned int       m_slBitmap[FL_COUNT];
+	size_t             m_capacity;
+	size_t             m_usedBytes;
+};
+
+class GLBufferHeap;
+
+//Handle of a range inside one of the heap's buffers. getBuffer()/getOffset()
+//may change when the heap is defragmented, so read them when binding
+//rather than caching them. The range is returned to the heap when the last
+//reference goes away, or earlier by GLBufferHeap::release().
+class GLBufferAllocation
+{
+public:
+	friend class GLBufferHeap;
+	~GLBufferAllocation();
+	GLBufferObjectRef getBuffer() const;
+	GLuint getBufferId() const;
+	size_t getOffset() const { return m_offset; }
+	size_t getSize() const { return m_size; }
+	int    getCategory() const { return m_category; }
+	bool   isValid() const { return m_rangeId >= 0; }
+	//glBindBufferRange(target, index, ...) for uniform/shader storage blocks.
+	void   bindRange(GLenum target, GLuint index) const;
+
+private:
+	GLBufferAllocation() :m_heap(NULL), m_block(-1), m_rangeId(-1), m_offset(0), m_size(0),
+						  m_alignment(0), m_category(0) {}
+	GLBufferHeap* m_heap;
+	int    m_block;
+	int    m_rangeId;
+	size_t m_offset;
+	size_t m_size;
+	size_t m_alignment;
+	int    m_category;
+};
+
+typedef std::shared_ptr<GLBufferAllocation> GLBufferAllocationRef;
+
+struct GLBufferHeapStats
+{
+	size_t blockCount;
+	size_t capacity;//bytes of GPU memory held by all blocks.
+	size_t usedBytes;
+	size_t largestFreeRange;
+	//per category, indexed by GLBufferHeap::Category.
+	std::vector<size_t> categoryBytes;
+	std::vector<size_t> categoryAllocations;
+};
+
+//Sub-allocates many small vertex/index/uniform ranges out of a few large
+//immutable buffers, so 100k small meshes cost a handful of GL buffer
+//objects instead of 100k. Buffers are bound by their id plus the
+//allocation's offset (glBindVertexBuffer, glBindBufferRange, or the
+//byte offset of glDrawElements).
+class GLBufferHeap
+{
+public:
+	friend class GLBufferAllocation;
+	enum Category{
+		HEAP_VERTEX,
+		HEAP_INDEX,
+		HEAP_UNIFORM,
+		HEAP_OTHER,
+		HEAP_CATEGORY_COUNT
+	};
+
+	//blockSize: bytes of each GL buffer, allocations bigger than that get a
+	//dedicated block of their own size.
+	GLBufferHeap(size_t blockSize=64 << 20, const std::string& name="GLBufferHeap");
+	~GLBufferHeap();
+
+	//alignment 0 picks the category default: 4 for vertex and index data,
+	//GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniform blocks.
+	//data, if given, is uploaded to the new range.
+	GLBufferAllocationRef allocate(size_t sizeInBytes, Category category,
+								   const GLvoid* data=NULL, size_t alignment=0);
+	void release(GLBufferAllocationRef allocation);
+	//Upload sizeInBytes starting offsetInAllocation bytes into the allocation.
+	void upload(const GLBufferAllocationRef& allocation, size_t sizeInBytes,
+				const GLvoid* data, size_t offsetInAllocation=0);
+
+	//Moves every allocation out of blocks filled below occupancyThreshold
+	//into the remaining ones with GLBufferObject::copy, updating the handles
+	//in place, and frees the emptied blocks. Blocks are only emptied while
+	//the others have room for their content. Returns the bytes moved.
+	size_t defragment(float occupancyThreshold=0.5f);
+
+	GLBufferHeapStats getStats() const;
+	size_t getBlockCount() const { return m_blocks.size(); }
+	GLBufferObjectRef getBlockBuffer(int block) const { return m_blocks[block].buffer; }
+
+private:
+	struct Block{
+		GLBufferObjectRef buffer;
+		std::shared_ptr<GLBufferSubAllocator> allocator;
+		std::vector<GLBufferAllocation*> owners;//per range id.
+		bool retiring;//being emptied by defragment().
+	};
+	//Place a range in any block that is not retiring, creating a block if needed.
+	bool place(GLBufferAllocation& a);
+	void freeRange(GLBufferAllocation& a);
+	int  createBlock(size_t sizeInBytes);
+	size_t defaultAlignment(Category category);
+
+	std::vector<Block> m_blocks;
+	size_t m_blockSize;
+	std::string m_name;
+	size_t m_uniformAlignment;
+	size_t m_categoryBytes[HEAP_CATEGORY_COUNT];
+	size_t m_categoryAllocations[HEAP_CATEGORY_COUNT];
+};
+
+typedef std::shared_ptr<GLBufferHeap> GLBufferHeapRef;
+
+}
+#endif
@@ -44,6 +44,11 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 #include <cuda_gl_interop.h>
 #endif
 
+//glBufferStorage() flag, missing from pre 4.4 headers.
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+
 namespace davinci{
 #define I_DONT_CARE -1
 
@@ -84,6 +89,14 @@ public:
 	// GL_STREAM_DRAW_ARB,GL_STREAM_READ_ARB,GL_STREAM_COPY_ARB
 	//************************************
 	void upload(size_t totalSizeInBytes,const GLvoid* data);
+	//Allocate immutable storage of sizeInBytes with glBufferStorage (GL 4.4),
+	//which lets the driver skip the reallocation bookkeeping of glBufferData.
+	//flags: GL_DYNAMIC_STORAGE_BIT is required for later uploads.
+	//The storage cannot grow afterwards.
+	void allocateStorage(size_t sizeInBytes, GLbitfield flags=GL_DYNAMIC_STORAGE_BIT, const GLvoid* data=NULL);
+	bool isImmutable() const { return m_immutable; }
+	//Overwrite [offset, offset+sizeInBytes) of the already allocated buffer.
+	void uploadSubData(size_t offset, size_t sizeInBytes, const GLvoid* data);
 	//copy data from current buffer object to 'dest' buffer object directly on GPU.
 	void copy(GLBufferObject &dest, size_t offsetRead, size_t offsetWrite, size_t size);
 	//GLuint getBindingIndex(){return m_bindingIndex;}
@@ -142,6 +155,7 @@ public:
 protected:
 	size_t m_reservedBytes;//size of the buffer in bytes.
 	bool   m_firstTime;
+	bool   m_immutable;//storage allocated by allocateStorage().
 	//GLsizei m_stride;
 	GLenum m_target;
 	GLenum m_usage;//GL_STATIC_DRAW_ARB,GL_STATIC_READ_ARB,GL_STATIC_COPY_ARB
@@ -170,5 +184,7 @@ protected:
 #endif
 
 };
+
+typedef std::shared_ptr<GLBufferObject> GLBufferObjectRef;
 }//end of namespace
 #endif
\ No newline at end of file
@@ -122,6 +122,7 @@ public:
 
 	mat4  getViewingMatrix()	const { return m_viewMtx;}
 	mat4  getProjectionMatrix() const { return m_projMtx;}
+	void  setProjectionMatrix(const mat4& projMtx) { m_projMtx = projMtx;}
 
 	//status for camera motion interpolation.
 	//Interpolation resolution, which determine how smooth the camera path will be.
@@ -23,10 +23,16 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 #ifndef _CLICKABLE_H_
 #define  _CLICKABLE_H_
 #include <string>
+#include <vector>
 #include "mat4.h"
+#include "vec2i.h"
 #include "GLShader.h"
 #include "GLTexture2D.h"
 #include "GLFrameBufferObject.h"
+#include "GLPixelBufferObject.h"
+#include "GLComputeShader.h"
+#include "GLShaderStorageBufferObject.h"
+#include "GLAtomicCounter.h"
 
 namespace davinci{
 class GLClickable
@@ -37,7 +43,25 @@ public:
     virtual void drawID()=0;
     virtual void resize(int w, int h);
     //return the element id under current mouse position in screen space.
+    //Blocks until drawID() has finished on the GPU.
     virtual int mouseClicked(int x, int y); 
+    //Non-blocking picking for hover highlighting, call once per frame after
+    //drawID(). Queues an asynchronous readback of the (2*radius+1)^2 pixels
+    //around (x,y) and returns the id nearest to (x,y) found by the most
+    //recent readback that has completed, usually the previous frame's.
+    int mouseHover(int x, int y, int radius=2);
+    int getHoveredId() const { return m_hoveredId; }
+    //Unique ids(ascending) of the elements visible inside the window
+    //rectangle spanned by the corners (x0,y0) and (x1,y1).
+    void selectRect(int x0, int y0, int x1, int y1, std::vector<int>& ids);
+    //Unique ids(ascending) of the elements visible inside the closed
+    //polygon given in window coordinates.
+    void selectLasso(const std::vector<vec2i>& polygon, std::vector<int>& ids);
+    //Number of pixels covered by each id of the last selection, in the
+    //same order as the ids returned.
+    const std::vector<GLuint>& getSelectionHistogram() const { return m_selectionHistogram; }
+    //Upper bound of unique ids a selection can return, more are dropped.
+    void setSelectionCapacity(GLuint maxUniqueIds){ m_selectionCapacity = maxUniqueIds; }
     void setClickableVtxShader(const std::string& vtxFile){ m_vtxShaderFile = vtxFile ;}
     void setClickableGeomShader(const std::string& geomFile){ m_geomShaderFile = geomFile ;}
     void setClickableFragShader(const std::string& fragFile){ m_fragShaderFile = fragFile ;}
@@ -52,6 +76,23 @@ public:
     davinci::GLTexture2DRef getIdTexture(){ return m_texID;}
     davinci::GLTexture2DRef getDepthTexture(){ return m_texDepth;}
 protected:
+    struct PickQuery
+    {
+        GLPixelBufferObjectRef pbo;
+        GLsync fence;
+        int width, height;//region actually read, clipped to the window.
+        int cx, cy;       //cursor position inside the region.
+        PickQuery() :fence(0), width(0), height(0), cx(0), cy(0){}
+    };
+    static const int kPickQueryCount = 3;
+
+    void issuePickQuery(PickQuery& q, int x, int y, int radius);
+    int  readPickQuery(PickQuery& q);
+    void createSelectionShaders();
+    //region in GL window coordinates(origin at lower left).
+    void runSelection(int x0, int y0, int x1, int y1, const std::vector<float>& lasso,
+                      std::vector<int>& ids);
+
 	bool m_enableClickable;
     std::string m_vtxShaderFile;
     std::string m_geomShaderFile;
@@ -64,6 +105,19 @@ protected:
     davinci::GLTexture2DRef         m_texID;
     davinci::GLTexture2DRef         m_texDepth;
     int m_clickedID;
+    //asynchronous hover picking, a ring of readbacks in flight.
+    PickQuery m_pickQueries[kPickQueryCount];
+    int m_nextPickQuery;
+    int m_hoveredId;
+    //rectangle/lasso selection.
+    davinci::GLComputeShaderRef             m_selectShader;
+    davinci::GLComputeShaderRef             m_gatherShader;
+    davinci::GLShaderStorageBufferObjectRef m_selectTable;
+    davinci::GLShaderStorageBufferObjectRef m_selectList;
+    davinci::GLShaderStorageBufferObjectRef m_selectLasso;
+    davinci::GLAtomicCounterRef             m_selectCounter;
+    GLuint m_selectionCapacity;
+    std::vector<GLuint> m_selectionHistogram;
 };
 }//end of namespace
 #endif
@@ -63,6 +63,8 @@ public:
     {
         m_rgba = rgba; m_res = resolution;
     }
+    const std::vector<unsigned char>& getColors() const { return m_rgba; }
+    size_t getResolution() const { return m_res; }
     void setTexture1D(const davinci::GLTexture1DRef& tex){ m_tex1d = tex;}
     void setBBox(const davinci::vec4i& dim){ m_dimension = dim; }
     davinci::vec4i getBBox() const { return m_dimension;}
@@ -41,6 +41,7 @@ class vec2f;
 class vec3f;
 class vec4f;
 class vec3d;
+class GLBufferObject;
 
 class GLComputeShader: public GLShader{
 public:
@@ -48,6 +49,9 @@ public:
 	void setComputeShaderStr(std::string& compShaderStr){m_computeShaderProg = compShaderStr;}
 
 	void UseShaders(int num_group_x, int num_group_y, int num_group_z);
+	//Dispatch with the group counts(3 GLuint) stored at byte offset of indirect,
+	//e.g. written by a previous compute pass.
+	void UseShadersIndirect(const GLBufferObject& indirect, GLintptr offset=0);
 	bool refresh();
 
 	bool loadComputeShaderFile(const string& fileName);
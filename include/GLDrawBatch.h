@@ -0,0 +1,153 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+#ifndef _GL_DRAW_BATCH_H_
+#define _GL_DRAW_BATCH_H_
+
+#include <vector>
+#include <string>
+#include <memory>
+#include "GLBufferObject.h"
+#include "GLVertexBufferObject.h"
+#include "GLIndexBufferObject.h"
+#include "GLShaderStorageBufferObject.h"
+#include "GLVertexArray.h"
+
+namespace davinci{
+
+//Location of one mesh sub-allocated in the shared arenas of a GLDrawBatch.
+struct GLDrawBatchMesh
+{
+	GLuint firstIndex; //offset into the index arena, in indices.
+	GLuint indexCount;
+	GLint  baseVertex; //offset into the vertex arena, in vertices.
+	GLuint vertexCount;
+};
+
+//Memory layout of one record consumed by glMultiDrawElementsIndirect().
+struct GLDrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint  baseVertex;
+	GLuint baseInstance;
+};
+
+class GLDrawBatch
+{
+public:
+	//GLDrawBatch collapses the draw calls of many meshes sharing one vertex format
+	//into a single glMultiDrawElementsIndirect() per frame.
+	//Vertices of all meshes are sub-allocated in one interleaved VBO arena and
+	//their indices in one IBO arena, both grow on demand. Every frame the user
+	//queues draws with addDraw() and submits them all with draw().
+	//
+	//Per-draw parameters(model matrix, material id, ...) go into an SSBO of
+	//perDrawStrideInBytes records, one record per drawn instance. The record of
+	//an instance is found at baseInstance+gl_InstanceID. Since gl_BaseInstance
+	//needs GL_ARB_shader_draw_parameters, the batch can also feed the index
+	//through an instanced uint attribute, see setDrawIdAttribute():
+	//	layout(std430) buffer PerDraw { mat4 model[]; };
+	//	in uint drawId;
+	//	... model[drawId] ...
+	//geotype: GL_TRIANGLES, GL_LINES, etc.
+	//vertexStrideInBytes: size of one interleaved vertex in the vertex arena.
+	//vertexCapacity/indexCapacity: initial arena sizes, in vertices/indices.
+	GLDrawBatch(GLenum geotype, GLsizei vertexStrideInBytes, GLsizei perDrawStrideInBytes=0,
+				size_t vertexCapacity=65536, size_t indexCapacity=262144);
+	~GLDrawBatch();
+
+	//Describe one attribute of the interleaved vertex at byte offset.
+	void addAttribute(GLuint shaderProgId, const std::string& name, GLenum type,
+					  GLuint nComponents, GLuint offset=0, bool normalized=false);
+	//Bind the uint vertex attribute name to the per-draw record index.
+	void setDrawIdAttribute(GLuint shaderProgId, const std::string& name);
+
+	//Copy vertexCount vertices and indexCount indices into the arenas. Indices
+	//are relative to the first vertex of the mesh. Return the mesh id.
+	int  addMesh(const GLvoid* vertices, size_t vertexCount,
+				 const GLuint* indices, size_t indexCount);
+	const GLDrawBatchMesh& getMesh(int meshId) const { return m_meshes[meshId]; }
+	size_t getMeshCount() const { return m_meshes.size(); }
+
+	//Forget the draws queued for the previous frame, meshes are kept.
+	void clearDraws();
+	//Queue instanceCount instances of mesh meshId. perDrawData, if not NULL,
+	//holds instanceCount records of perDrawStrideInBytes bytes each.
+	//Return the index of the first record, i.e. the baseInstance of the draw.
+	GLuint addDraw(int meshId, GLuint instanceCount=1, const GLvoid* perDrawData=NULL);
+	size_t getDrawCount() const { return m_commands.size(); }
+	const std::vector<GLDrawElementsIndirectCommand>& getCommands() const { return m_commands; }
+
+	//Upload the queued commands and per-draw records, then submit them with
+	//one glMultiDrawElementsIndirect(). The shader must be in use.
+	void draw();
+	//Upload the queued commands and per-draw records without drawing, so that
+	//a later stage(e.g. GPU culling) can consume the buffers.
+	void upload();
+
+	GLVertexArrayObjectRef getVAO() const { return m_vao; }
+	//The commands live in a shader storage buffer so that compute passes
+	//(see GLDrawCuller) can read them, it is bound as GL_DRAW_INDIRECT_BUFFER
+	//at draw time.
+	GLShaderStorageBufferObjectRef getIndirectBuffer() const { return m_indirect; }
+	//Pass to GLShader::SetShaderStorageBlockUniform() to expose the records.
+	GLShaderStorageBufferObjectRef getPerDrawBuffer() const { return m_perDraw; }
+
+protected:
+	void finalizeLayout();
+	void growVertexArena(size_t minVertices);
+	void growIndexArena(size_t minIndices);
+	void growDrawIdBuffer(size_t minRecords);
+
+private:
+	GLenum  m_geotype;
+	GLsizei m_vertexStride;
+	GLsizei m_perDrawStride;
+
+	GLVertexArrayObjectRef  m_vao;
+	GLVertexBufferObjectRef m_vertexArena;
+	GLIndexBufferObjectRef  m_indexArena;
+	GLVertexBufferObjectRef m_drawIdBuffer;//0,1,2,... sourced with divisor 1.
+	GLShaderStorageBufferObjectRef m_indirect;
+	GLShaderStorageBufferObjectRef m_perDraw;
+
+	size_t m_vertexCapacity, m_vertexUsed;
+	size_t m_indexCapacity,  m_indexUsed;
+
+	std::vector<GLDrawBatchMesh> m_meshes;
+	std::vector<GLDrawElementsIndirectCommand> m_commands;
+	std::vector<unsigned char> m_perDrawData;
+	GLuint m_recordCount;//# of per-draw records queued this frame.
+	bool   m_layoutDirty;
+	bool   m_uploaded;
+};
+
+typedef std::shared_ptr<GLDrawBatch> GLDrawBatchRef;
+
+}
+#endif
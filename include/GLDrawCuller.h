@@ -0,0 +1,119 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+#ifndef _GL_DRAW_CULLER_H_
+#define _GL_DRAW_CULLER_H_
+
+#include <vector>
+#include <memory>
+#include "mat4.h"
+#include "BBox.h"
+#include "GLCamera.h"
+#include "GLTexture2D.h"
+#include "GLComputeShader.h"
+#include "GLAtomicCounter.h"
+#include "GLShaderStorageBufferObject.h"
+#include "GLDrawBatch.h"
+
+namespace davinci{
+
+class GLDrawCuller
+{
+public:
+	//GPU driven culling of the draws queued in a GLDrawBatch.
+	//Object i is the i-th queued command of the batch and is bounded by the
+	//i-th world space BBox given to setBounds(). A compute pass tests each box
+	//against the view frustum and, optionally, against a hierarchical-Z(Hi-Z)
+	//pyramid of the previous frame's depth. Surviving commands are compacted
+	//into getCulledIndirectBuffer() through a GLAtomicCounter, so the CPU never
+	//touches the object list. Only GL 4.3 features(compute shader, SSBO, atomic
+	//counter, multi-draw-indirect) are used; GL_ARB_indirect_parameters is
+	//used when present, otherwise the unused tail of the compacted buffer
+	//is zero filled and drawn as empty commands.
+	//Typical frame:
+	//	culler.cull(batch, camera);
+	//	culler.draw(batch);
+	//	culler.buildHiZ(depthTex, viewProj);//feeds the next frame.
+	GLDrawCuller();
+	~GLDrawCuller();
+
+	//One world space bounding box per queued command.
+	void setBounds(const std::vector<BBox>& bounds);
+	size_t getBoundsCount() const { return m_boundsCount; }
+
+	//Build the Hi-Z pyramid, a max-depth mip chain stored in an SSBO, from
+	//depthTex(depth in [0,1], e.g. GL_DEPTH_COMPONENT32F or GL_R32F) that was
+	//rendered with view-projection viewProj.
+	void buildHiZ(const GLTexture2DRef& depthTex, const mat4& viewProj);
+	void setOcclusionCulling(bool v){ m_useOcclusion = v; }
+	bool getOcclusionCulling() const { return m_useOcclusion; }
+	//Forget the current Hi-Z pyramid, e.g. after a camera cut.
+	void invalidateHiZ(){ m_hizLevels = 0; }
+	//The pyramid for other GPU cullers, e.g. GLMeshletCuller.
+	GLShaderStorageBufferObjectRef getHiZBuffer() const { return m_hiz; }
+	const mat4& getHiZViewProj() const { return m_hizViewProj; }
+	int getHiZWidth() const { return m_hizWidth; }
+	int getHiZHeight() const { return m_hizHeight; }
+	int getHiZLevels() const { return m_hizLevels; }
+
+	//Cull the uploaded commands of batch against viewProj(projection*view).
+	void cull(GLDrawBatch& batch, const mat4& viewProj);
+	void cull(GLDrawBatch& batch, const GLCamera& camera);
+	//Draw the commands that survived the last cull() with the VAO of batch.
+	void draw(GLDrawBatch& batch);
+
+	//Number of visible commands of the last cull(). It reads the counter back
+	//and stalls the pipeline, meant for statistics and debugging only.
+	GLuint readVisibleCount();
+	GLShaderStorageBufferObjectRef getCulledIndirectBuffer() const { return m_culled; }
+	GLAtomicCounterRef getVisibleCounter() const { return m_visibleCounter; }
+
+protected:
+	void createShaders();
+
+private:
+	GLComputeShaderRef m_cullShader;
+	GLComputeShaderRef m_hizInitShader;
+	GLComputeShaderRef m_hizReduceShader;
+
+	GLShaderStorageBufferObjectRef m_bounds;
+	GLShaderStorageBufferObjectRef m_culled;
+	GLShaderStorageBufferObjectRef m_hiz;
+	GLAtomicCounterRef m_visibleCounter;
+
+	size_t m_boundsCount;
+	size_t m_culledCount;//# of commands of the last cull().
+	mat4   m_hizViewProj;
+	int    m_hizWidth, m_hizHeight;
+	int    m_hizLevels;//0: no pyramid available.
+	bool   m_useOcclusion;
+	bool   m_hasIndirectCount;
+};
+
+typedef std::shared_ptr<GLDrawCuller> GLDrawCullerRef;
+
+}
+#endif
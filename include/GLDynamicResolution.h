@@ -0,0 +1,116 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_DYNAMIC_RESOLUTION_H_
+#define _GL_DYNAMIC_RESOLUTION_H_
+
+#include <chrono>
+#include <memory>
+#if defined(__APPLE__) || defined(MACOSX)
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+#include "mat4.h"
+#include "GLCamera.h"
+#include "GLTexture2D.h"
+#include "GLFrameBufferObject.h"
+#include "GLRenderBufferObject.h"
+
+namespace davinci{
+
+//Keeps interaction responsive by rendering into a smaller viewport of an
+//offscreen target while the camera moves and stretching it over the
+//window. The scale follows the GPU time of the scene, measured with
+//GL_TIME_ELAPSED queries read back a few frames late so the CPU never
+//waits, assuming cost proportional to the pixel count. Once the camera
+//has been still for the idle delay the frame is rendered at full
+//resolution directly into the destination framebuffer.
+class GLDynamicResolution
+{
+public:
+	typedef void (*drawCallBack)(void* params);
+
+	GLDynamicResolution(float targetFrameMs=16.0f, int idleDelayMs=200);
+	~GLDynamicResolution();
+
+	void  setTargetFrameTime(float ms) { m_targetMs = ms; }
+	float getTargetFrameTime() const { return m_targetMs; }
+	//Linear scale bounds of the reduced resolution, 0 < minScale <= maxScale <= 1.
+	void  setScaleRange(float minScale, float maxScale);
+	void  setIdleDelay(int ms) { m_idleDelay = std::chrono::milliseconds(ms); }
+
+	//Count as interaction for changes the camera does not see, e.g. a
+	//transfer function edit. Camera motion is detected by render().
+	void  notifyInteraction();
+	//Draw one frame into the currently bound draw framebuffer and viewport.
+	//renderCallBack clears and draws the scene into the bound framebuffer
+	//and viewport. camera: its roaming flag and any change of its viewing
+	//or projection matrix count as interaction, may be NULL.
+	//Returns true if the frame was rendered at full resolution.
+	bool  render(drawCallBack renderCallBack, void* params, const GLCamera* camera=NULL);
+	//True once the idle delay has passed after a reduced frame, redraw
+	//(e.g. from the idle callback) to show the full resolution image.
+	bool  needsRefresh() const;
+
+	float getScale() const { return m_scale; }
+	//Smoothed GPU time of the scene extrapolated to full resolution, in ms,
+	//negative before the first measurement.
+	float getGpuTime() const { return m_gpuMs; }
+	//Scale that fits fullResMs*scale^2 into targetMs, reached halfway from
+	//scale, ignoring changes within 5%, clamped to [minScale,maxScale].
+	static float computeScale(float scale, float fullResMs, float targetMs, float minScale, float maxScale);
+
+private:
+	enum { N_QUERIES = 4 };
+	void beginQuery(float scale);
+	void endQuery();
+	void readQueries();
+	bool isInteracting(const GLCamera* camera);
+
+	float m_targetMs;
+	float m_minScale, m_maxScale;
+	float m_scale;
+	float m_gpuMs;//full resolution EMA, <0 until the first result.
+	bool  m_lastFull;
+	std::chrono::milliseconds m_idleDelay;
+	std::chrono::steady_clock::time_point m_lastInteraction;
+	mat4  m_lastView, m_lastProj;
+	GLuint m_queries[N_QUERIES];
+	float  m_queryScale[N_QUERIES];
+	int    m_queryHead, m_queryCount;
+	bool   m_measuring;//a query is open for the current frame.
+	GLTexture2DRef          m_colorTex;
+	GLRenderbufferObjectRef m_depth;
+	GLFrameBufferObjectRef  m_fbo;
+	int m_width, m_height;
+};
+
+typedef std::shared_ptr<GLDynamicResolution> GLDynamicResolutionRef;
+
+}
+#endif
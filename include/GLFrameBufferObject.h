@@ -70,12 +70,18 @@ namespace davinci{
             //that have images attached or must be GL_NONE. 
             void attachColorBuffer(GLuint attachId, GLuint tex2dId);
             void attachColorBuffer(GLuint attachId, const GLTexture2DRef& tex2dRef);
+            //Attach a (possibly multisampled) color renderbuffer.
+            void attachColorBuffer(GLuint attachId, const GLRenderbufferObjectRef& buffer);
             // Attach a 2D texture to the depth attachment point of FBO.
             void attachDepthBuffer(const GLTexture2DRef &tex2d);
             void attachDepthBuffer(const GLRenderbufferObjectRef &buffer);
             //Attach generic texture to FBO color attachment point
             //params: zLayer: only effective for 3D texture to specify texture layer id.
             void attachTextureND(GLuint attachId, const GLTextureAbstract& tex,int zLayer=0, int mipLevel=0 );
+            //Attach all layers of a GL_TEXTURE_3D or GL_TEXTURE_2D_ARRAY texture so that
+            //gl_Layer selects the layer drawn into. Use GL_DEPTH_ATTACHMENT for a layered
+            //depth buffer (GL_TEXTURE_2D_ARRAY only), otherwise GL_COLOR_ATTACHMENT0+i.
+            void attachLayeredTexture(GLenum attachment, const GLTextureAbstract& tex, int mipLevel=0);
         protected:
             //void attachColorBuffer(GLuint attachId, GLTexture2d &tex2d);
             void attachDepthBuffer(const GLTexture2d &tex2d);
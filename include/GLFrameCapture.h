@@ -0,0 +1,234 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_FRAME_CAPTURE_H_
+#define _GL_FRAME_CAPTURE_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cstdio>
+#include <condition_variable>
+#if defined(__APPLE__) || defined(MACOSX)
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+#include "GLPixelBufferObject.h"
+
+namespace davinci{
+
+struct GLFrameCaptureStats
+{
+	size_t captured;//frames whose readback was issued.
+	size_t dropped;//frames skipped because every frame buffer was busy.
+	size_t encoded;//frames written to disk.
+	size_t failed;//frames that could not be written.
+	int    pendingReadbacks;//readbacks the GPU has not handed over yet.
+	int    queueDepth;//frames waiting for an encoder.
+	int    maxQueueDepth;
+};
+
+//Fixed capacity multi producer multi consumer queue of pointers after
+//D. Vyukov's bounded queue: push and pop are a compare-and-swap on a
+//position counter plus a per cell sequence number, no locks.
+template<class T>
+class GLBoundedQueue
+{
+public:
+	GLBoundedQueue(size_t capacity)
+	{
+		size_t n = 2;
+		while (n < capacity) n <<= 1;
+		m_cells = std::vector<Cell>(n);
+		for (size_t i = 0; i < n; i++) m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		m_mask = n - 1;
+		m_head.store(0, std::memory_order_relaxed);
+		m_tail.store(0, std::memory_order_relaxed);
+	}
+	bool push(T* item)
+	{
+		size_t pos = m_tail.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = m_cells[pos & m_mask];
+			size_t seq = cell.sequence.load(std::memory_order_acquire);
+			ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+			if (diff == 0)
+			{
+				if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					cell.item = item;
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0) return false;//full
+			else pos = m_tail.load(std::memory_order_relaxed);
+		}
+	}
+	bool pop(T*& item)
+	{
+		size_t pos = m_head.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = m_cells[pos & m_mask];
+			size_t seq = cell.sequence.load(std::memory_order_acquire);
+			ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)(pos + 1);
+			if (diff == 0)
+			{
+				if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					item = cell.item;
+					cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0) return false;//empty
+			else pos = m_head.load(std::memory_order_relaxed);
+		}
+	}
+	//Approximate while other threads push or pop.
+	int size() const
+	{
+		return (int)(m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_relaxed));
+	}
+private:
+	struct Cell{
+		std::atomic<size_t> sequence;
+		T* item;
+		Cell() : item(NULL) {}
+		Cell(const Cell&) : item(NULL) {}
+	};
+	std::vector<Cell> m_cells;
+	size_t m_mask;
+	std::atomic<size_t> m_head, m_tail;
+};
+
+//Asynchronous frame capture for in situ movie making. capture() only
+//queues a glReadPixels into a pixel buffer object; later calls hand
+//finished readbacks, flipped top down, to a lock-free queue drained by a
+//pool of encoder threads writing PNG, raw or Y4M frames. When all frame
+//buffers are busy the new frame is dropped and counted instead of
+//stalling the render thread. All GL work happens in capture(), poll(),
+//flush() and the destructor, which need the capturing context current.
+class GLFrameCapture
+{
+public:
+	enum Format{
+		FORMAT_PNG,//one file per frame, uncompressed deflate.
+		FORMAT_RAW,//one file per frame, bare top down RGB(A) rows.
+		FORMAT_Y4M //frames appended to the stream of openY4M(), 4:2:0.
+	};
+
+	//queueCapacity bounds the frames held at once, read back or waiting
+	//for an encoder; readbackDepth is the number of PBOs in flight.
+	GLFrameCapture(int nEncoderThreads=2, int queueCapacity=8, int readbackDepth=3);
+	~GLFrameCapture();
+
+	//Starts a YUV4MPEG2 stream; its size is fixed by the first frame.
+	bool openY4M(const std::string& fileName, int fpsNum=30, int fpsDen=1);
+	//Writes the pending frames and closes the stream.
+	void closeY4M();
+
+	//Queues the capture of the (x,y,width,height) block of whichBuffer,
+	//lower left origin as glReadPixels. fileName is ignored for
+	//FORMAT_Y4M; alpha keeps the alpha channel of PNG/raw frames.
+	//Returns false if the frame was dropped.
+	bool capture(int x, int y, int width, int height, const std::string& fileName,
+				 Format format=FORMAT_PNG, bool alpha=false, GLenum whichBuffer=GL_BACK);
+	//Hands finished readbacks to the encoders without waiting on the GPU.
+	void poll();
+	//Waits until every captured frame is written.
+	void flush();
+
+	GLFrameCaptureStats getStats() const;
+
+	//Copies rows bottom up into top down order.
+	static void flipRows(unsigned char* dst, const unsigned char* src, size_t rowBytes, int rows);
+	//Full range BT.601 RGBA to planar 4:2:0; chroma planes are
+	//((width+1)/2) x ((height+1)/2).
+	static void rgbaToYuv420(const unsigned char* rgba, int width, int height,
+							 unsigned char* yPlane, unsigned char* uPlane, unsigned char* vPlane);
+	//8 bit RGB (channels 3) or RGBA (channels 4) top down rows.
+	static bool writePng(const std::string& fileName, const unsigned char* pixels,
+						 int width, int height, int channels);
+
+private:
+	struct Frame{
+		std::vector<unsigned char> pixels;
+		int width, height, channels;
+		Format format;
+		std::string fileName;
+		long long sequence;//position in the Y4M stream.
+	};
+	struct Readback{
+		GLPixelBufferObjectRef pbo;
+		GLsync fence;
+		Frame* frame;
+	};
+	void harvest(Readback& r);
+	void encoderLoop();
+	void encode(Frame* frame);
+	void release(Frame* frame);
+
+	std::vector<Frame>       m_frames;
+	GLBoundedQueue<Frame>    m_freeFrames;
+	GLBoundedQueue<Frame>    m_encodeQueue;
+	std::vector<Readback>    m_readbacks;//ring, harvested oldest first.
+	int m_nextReadback;
+	int m_pendingReadbacks;
+
+	std::vector<std::thread> m_encoders;
+	std::atomic<bool>   m_quit;
+	std::mutex          m_wakeMutex;
+	std::condition_variable m_wake;
+	std::atomic<int>    m_inFlight;//frames taken from m_freeFrames.
+	std::mutex          m_drainMutex;
+	std::condition_variable m_drained;//signalled by release() when m_inFlight hits 0.
+
+	std::atomic<size_t> m_captured, m_dropped, m_encoded, m_failed;
+	std::atomic<int>    m_maxQueueDepth;
+
+	//Y4M stream, frames are written in sequence order.
+	FILE*      m_y4m;
+	int        m_y4mFpsNum, m_y4mFpsDen;
+	int        m_y4mWidth, m_y4mHeight;
+	long long  m_y4mNextCapture;
+	long long  m_y4mNextWrite;
+	std::mutex m_y4mMutex;
+	std::condition_variable m_y4mTurn;
+};
+
+typedef std::shared_ptr<GLFrameCapture> GLFrameCaptureRef;
+
+}
+#endif
@@ -0,0 +1,97 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+#ifndef _GL_FRUSTUM_H_
+#define _GL_FRUSTUM_H_
+
+#include <vector>
+#include <memory>
+#include "vec4f.h"
+#include "mat4.h"
+#include "BBox.h"
+
+namespace davinci{
+
+class GLCamera;
+
+//Structure of arrays storage of axis aligned boxes, the layout consumed by
+//the SIMD kernels of GLFrustum. Box i is
+//[minX[i],maxX[i]]x[minY[i],maxY[i]]x[minZ[i],maxZ[i]].
+struct BBoxSoA
+{
+	std::vector<float> minX, minY, minZ;
+	std::vector<float> maxX, maxY, maxZ;
+
+	BBoxSoA(){}
+	explicit BBoxSoA(const std::vector<BBox>& boxes);
+	void   reserve(size_t n);
+	void   clear();
+	void   push_back(const BBox& box);
+	BBox   get(size_t i) const;
+	size_t size() const { return minX.size(); }
+};
+
+class GLFrustum
+{
+public:
+	enum Classification{ OUTSIDE = 0, INSIDE = 1, INTERSECT = 2 };
+	//The six planes(left,right,bottom,top,near,far) of the clip volume of
+	//the matrix viewProj=projection*view, pointing inwards and normalized.
+	//With viewProj=projection*view*model the planes are in model space.
+	GLFrustum();
+	explicit GLFrustum(const mat4& viewProj);
+	static GLFrustum fromCamera(const GLCamera& camera);
+	//Use GLContext::g_PjM * GLContext::g_MVM.
+	static GLFrustum fromContext();
+
+	void setMatrix(const mat4& viewProj);
+	//plane i as (a,b,c,d), a point p is on the inner side if a*x+b*y+c*z+d>=0.
+	vec4f getPlane(int i) const;
+
+	Classification classify(const BBox& box) const;
+	//result[i] receives the Classification of box i.
+	//nThreads: 0 means std::thread::hardware_concurrency(). Small arrays
+	//are always processed by the calling thread.
+	void classify(const BBoxSoA& boxes, std::vector<unsigned char>& result, int nThreads=0) const;
+	//Compact list of the indices, in ascending order, of the boxes that are
+	//not OUTSIDE. If includeIntersecting is false only INSIDE boxes are kept.
+	void cull(const BBoxSoA& boxes, std::vector<unsigned int>& visible,
+			  bool includeIntersecting=true, int nThreads=0) const;
+
+	//Name of the kernel chosen for this CPU: "avx512", "avx2", "sse" or "scalar".
+	static const char* getKernelName();
+
+private:
+	void run(const BBoxSoA& boxes, unsigned char* classes, std::vector<unsigned int>* visible,
+			 bool includeIntersecting, int nThreads) const;
+
+	float m_planes[6][4];
+};
+
+typedef std::shared_ptr<GLFrustum> GLFrustumRef;
+
+}
+#endif
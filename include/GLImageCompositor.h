@@ -0,0 +1,128 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_IMAGE_COMPOSITOR_H_
+#define _GL_IMAGE_COMPOSITOR_H_
+
+#include <vector>
+#include <memory>
+#include <mpi.h>
+#if defined(__APPLE__) || defined(MACOSX)
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+#include "vec3i.h"
+#include "vec3f.h"
+#include "GLFrameBufferObject.h"
+
+namespace davinci{
+
+//Sort-last parallel image compositing. Every rank of the communicator
+//renders its own brick of the domain into a full size image; composite()
+//merges them with radix-k, binary-swap being the special case of all
+//radices 2. In each round a group of k ranks splits its current image
+//span into k pieces and every member composites one piece from all k
+//images. All receives of a round are posted up front and pieces are
+//folded in as they arrive, so communication overlaps compositing. After
+//the last round every rank owns a 1/nRanks slice of the final image,
+//which gather() collects on one rank.
+//
+//COMPOSITE_DEPTH keeps the nearest fragment per pixel and needs color and
+//depth. COMPOSITE_ALPHA blends premultiplied RGBA front to back in the
+//order given by setVisibilityOrder().
+class GLImageCompositor
+{
+public:
+	enum CompositeMode{
+		COMPOSITE_DEPTH,
+		COMPOSITE_ALPHA
+	};
+
+	GLImageCompositor(MPI_Comm comm=MPI_COMM_WORLD);
+	~GLImageCompositor();
+
+	//Group sizes of the rounds; their product must equal the number of
+	//ranks. Defaults to radixKRadices(nRanks).
+	void setRadices(const std::vector<int>& radices);
+	const std::vector<int>& getRadices() const { return m_radices; }
+	//All 2 for power of two rank counts, the prime factors otherwise.
+	static std::vector<int> binarySwapRadices(int nRanks);
+	//Factors as close to k as the rank count allows, largest first.
+	static std::vector<int> radixKRadices(int nRanks, int k=4);
+
+	//Ranks front to back, required for COMPOSITE_ALPHA. Defaults to rank order.
+	void setVisibilityOrder(const std::vector<int>& frontToBack);
+	//Front to back order of the bricks of a procDim decomposition of
+	//domainDim (BLOCK_*_3D) seen from eye, given in domain coordinates.
+	//Brick (x,y,z) belongs to rank x + procDim.x*(y + procDim.y*z).
+	static std::vector<int> getVisibilityOrder(const vec3i& procDim, const vec3i& domainDim,
+											   const vec3f& eye);
+
+	//Local image: width*height RGBA (premultiplied for COMPOSITE_ALPHA)
+	//and, for COMPOSITE_DEPTH, width*height window space depths. Rows
+	//bottom up as glReadPixels returns them.
+	void setImage(const float* rgba, const float* depth, int width, int height, CompositeMode mode);
+	//Reads the local image from colorAttachId and the depth attachment
+	//of fbo through pixel buffer objects.
+	void readFramebuffer(GLFrameBufferObject& fbo, GLuint colorAttachId,
+						 int width, int height, CompositeMode mode);
+
+	void composite();
+	//Pixels [begin,end) of the final image owned by this rank.
+	void getOwnedSpan(size_t& begin, size_t& end) const { begin = m_begin; end = m_end; }
+	//The owned span's RGBA (and depth) after composite().
+	const float* getOwnedPixels() const { return m_pixels.empty() ? NULL : &m_pixels[m_begin * m_stride]; }
+	//Collects the final RGBA image on root, rgba is untouched elsewhere.
+	void gather(int root, std::vector<float>& rgba);
+
+	int  getWidth() const { return m_width; }
+	int  getHeight() const { return m_height; }
+	int  getRank() const { return m_rank; }
+	int  getSize() const { return m_nRanks; }
+
+private:
+	//composites src over/under dst for count pixels.
+	void blend(float* dst, const float* src, size_t count, bool srcInFront) const;
+
+	MPI_Comm m_comm;
+	int m_rank, m_nRanks;
+	std::vector<int> m_radices;
+	std::vector<int> m_order;//visibility position -> rank.
+	std::vector<int> m_position;//rank -> visibility position.
+	CompositeMode m_mode;
+	int m_width, m_height;
+	int m_stride;//floats per pixel: 4, or 5 with depth.
+	std::vector<float> m_pixels;
+	size_t m_begin, m_end;
+	MPI_Datatype m_pixelType[2];//RGBA, RGBA+depth.
+};
+
+typedef std::shared_ptr<GLImageCompositor> GLImageCompositorRef;
+
+}
+#endif
@@ -31,6 +31,7 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 #include "vec3i.h"
 #include "vec4i.h"
 #include "GLVertexArray.h"
+#include "GLVertexCacheOptimizer.h"
 
 namespace davinci{
 
@@ -43,6 +44,8 @@ public:
 
     ~GLIndexBufferObject(void);
 
+    //Indices are packed to GL_UNSIGNED_SHORT when every one of them(but the
+    //restart index) is below 0xFFFF and short indices are allowed.
     void upload();
     void enable();
     void disable();
@@ -53,6 +56,14 @@ public:
     void enableRestart(bool f){ m_bUseRestart = f; }
     bool isEnableRestart() { return m_bUseRestart;}
     void setRestartIndex(GLuint idx) { m_restartIndex = idx;}
+    void setAllowShortIndices(bool f) { m_bAllowShortIndices = f;}
+    //GL_UNSIGNED_INT or GL_UNSIGNED_SHORT, as chosen by the last upload().
+    GLenum getIndexType() const { return m_indexType;}
+    GLsizeiptr getIndexSize() const { return m_indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);}
+    //Reorders the pending GL_TRIANGLES indices for the post-transform cache
+    //and renumbers their vertices in first use order. Apply vertexRemap to
+    //the vertex attributes with GLVertexCacheOptimizer::remapVertices().
+    GLVertexCacheReport optimize(size_t vertexCount, std::vector<GLuint>& vertexRemap, int nThreads=0);
     std::vector<GLuint> getIndexData() const { return m_indexData; }
     void setIndexData(const std::vector<GLuint>& val) { m_indexData = val; }
     void clear();
@@ -67,6 +78,8 @@ public:
     GLenum m_type;//type of geometry the object represent. GL_TRIANGLES, GL_QUADS...
     bool m_bUseRestart;
     GLuint m_restartIndex;
+    bool m_bAllowShortIndices;
+    GLenum m_indexType;
     std::vector<GLuint> m_indexData;
     size_t m_indexDataSize;
 };
@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_ISOSURFACE_H_
+#define _GL_ISOSURFACE_H_
+
+#include <vector>
+#include <memory>
+#if defined(__APPLE__) || defined(MACOSX)
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+#include "vec3f.h"
+#include "vec3i.h"
+
+namespace davinci{
+
+//Indexed triangle mesh: indices can go straight to
+//GLIndexBufferObject::setIndexData(), three per triangle.
+struct GLIsosurfaceMesh
+{
+	std::vector<vec3f>  vertices;
+	std::vector<vec3f>  normals;//empty unless requested.
+	std::vector<GLuint> indices;
+
+	void clear(){ vertices.clear(); normals.clear(); indices.clear(); }
+	size_t getTriangleCount() const { return indices.size() / 3; }
+};
+
+//Brick parallel marching cubes. The cells of the volume are split into
+//bricks with BLOCK_LOW_3D/BLOCK_SIZE_3D, bricks whose value range does not
+//straddle the iso value are skipped. Every vertex is created once: a brick
+//owns the edges starting at its voxels and looks up the vertices on its
+//upper seams in the lower face tables of its neighbors.
+class GLIsosurface
+{
+public:
+	//brickSize: cells per brick along each axis.
+	explicit GLIsosurface(const vec3i& brickSize=vec3i(32, 32, 32));
+
+	//volume: dim.x()*dim.y()*dim.z() samples, x varying fastest, e.g. as
+	//loaded by readChunk(). The pointer is kept, not the data.
+	//Per brick min/max are computed here and reused by every extract().
+	void setVolume(const float* volume, const vec3i& dim, int nThreads=0);
+	void setVolume(const unsigned char* volume, const vec3i& dim, int nThreads=0);
+	void setVolume(const unsigned short* volume, const vec3i& dim, int nThreads=0);
+	//vertex position = origin + voxel coordinates * spacing.
+	void setGeometry(const vec3f& origin, const vec3f& spacing){ m_origin = origin; m_spacing = spacing; }
+
+	//Surface value==isoValue, oriented with front faces toward lower values.
+	//Normals are the normalized negative gradient(central differences).
+	//nThreads: 0 means std::thread::hardware_concurrency().
+	void extract(float isoValue, GLIsosurfaceMesh& mesh, bool computeNormals=true, int nThreads=0) const;
+
+	vec3i  getBrickGrid() const { return m_brickGrid; }
+	size_t getBrickCount() const { return m_brickMin.size(); }
+	//Bricks extract() would visit for isoValue.
+	size_t getActiveBrickCount(float isoValue) const;
+
+private:
+	enum VolumeType{ VOLUME_NONE, VOLUME_FLOAT, VOLUME_UBYTE, VOLUME_USHORT };
+	void setVolume(const void* volume, VolumeType type, const vec3i& dim, int nThreads);
+
+	vec3i m_brickSize;
+	vec3i m_brickGrid;
+	vec3i m_dim;
+	const void* m_volume;
+	VolumeType  m_type;
+	vec3f m_origin, m_spacing;
+	std::vector<float> m_brickMin, m_brickMax;
+};
+
+typedef std::shared_ptr<GLIsosurface> GLIsosurfaceRef;
+
+}
+#endif
@@ -0,0 +1,115 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_MACRO_CELL_GRID_H_
+#define _GL_MACRO_CELL_GRID_H_
+
+#include <vector>
+#include <memory>
+#if defined(__APPLE__) || defined(MACOSX)
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+#include "vec3i.h"
+#include "vec3f.h"
+#include "GLTexture1D.h"
+#include "GLTexture3D.h"
+#include "GLComputeShader.h"
+
+namespace davinci{
+
+//Coarse grid over a volume for empty space skipping. Every macro cell
+//keeps the value range of its cellSize^3 voxels plus the one voxel
+//border trilinear filtering reaches, in texture units ([0,1] for
+//normalized integer volumes). classify() marks the cells whose range maps
+//to a non zero opacity in the transfer function and uploads the result to
+//an R8 occupancy texture of the grid size, to be traversed by
+//macroCellDDA() in shader/common.glsl. After a transfer function edit only
+//cells whose range overlaps an entry that switched between transparent
+//and opaque are re-evaluated and uploaded.
+class GLMacroCellGrid
+{
+public:
+	explicit GLMacroCellGrid(int cellSize=8);
+	~GLMacroCellGrid();
+
+	//CPU build, volume holds dim.x()*dim.y()*dim.z() samples with x varying
+	//fastest, as uploaded to the GLTexture3d.
+	//nThreads: 0 means std::thread::hardware_concurrency().
+	void build(const unsigned char* volume, const vec3i& dim, int nThreads=0);
+	void build(const unsigned short* volume, const vec3i& dim, int nThreads=0);
+	void build(const float* volume, const vec3i& dim, int nThreads=0);
+	//GPU build from the red channel of a volume already on the GPU, only
+	//the grid sized range image is read back.
+	void build(const GLTexture3DRef& volume);
+
+	//rgba: resolution RGBA8 entries, e.g. GLColorMap::getColors().
+	//Returns the number of cells that changed state.
+	size_t classify(const std::vector<unsigned char>& rgba, size_t resolution);
+	//Reads the RGBA8 transfer function texture back.
+	size_t classify(const GLTexture1DRef& transferFunc);
+
+	//Occupancy per cell, 1 for cells that may be visible. Valid after classify().
+	GLTexture3DRef getTexture() const { return m_occupancyTex; }
+	vec3i  getGridSize() const { return m_grid; }
+	int    getCellSize() const { return m_cellSize; }
+	//Cells per unit of texture coordinate, the cellScale of macroCellDDA().
+	vec3f  getCellScale() const;
+	size_t getCellCount() const { return m_min.size(); }
+	size_t getOccupiedCellCount() const;
+	float  getMin(const vec3i& cell) const { return m_min[index(cell)]; }
+	float  getMax(const vec3i& cell) const { return m_max[index(cell)]; }
+	bool   isOccupied(const vec3i& cell) const { return m_occupied[index(cell)] != 0; }
+
+	//Min and max of n samples, SIMD where available.
+	static void rangeOf(const unsigned char* v, size_t n, unsigned char& lo, unsigned char& hi);
+	static void rangeOf(const unsigned short* v, size_t n, unsigned short& lo, unsigned short& hi);
+	static void rangeOf(const float* v, size_t n, float& lo, float& hi);
+
+private:
+	size_t index(const vec3i& c) const { return (size_t(c.z()) * m_grid.y() + c.y()) * m_grid.x() + c.x(); }
+	void resizeGrid(const vec3i& dim);
+	//Transfer function entries sampled by values in [lo,hi] with linear filtering.
+	void binRange(float lo, float hi, size_t& first, size_t& last) const;
+	void uploadSlabs(int zFirst, int zLast);
+
+	int   m_cellSize;
+	vec3i m_dim, m_grid;
+	std::vector<float> m_min, m_max;
+	std::vector<unsigned char> m_occupied;
+	std::vector<unsigned char> m_opaque;//per transfer function entry, alpha > 0.
+	std::vector<size_t> m_opaquePrefix;//opaque entries before each entry.
+	GLTexture3DRef     m_occupancyTex;
+	GLTexture3DRef     m_rangeTex;
+	GLComputeShaderRef m_rangeShader;
+};
+
+typedef std::shared_ptr<GLMacroCellGrid> GLMacroCellGridRef;
+
+}
+#endif
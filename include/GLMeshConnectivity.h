@@ -0,0 +1,117 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_MESH_CONNECTIVITY_H_
+#define _GL_MESH_CONNECTIVITY_H_
+
+#include <vector>
+#include <memory>
+#include "vec2i.h"
+#include "vec3f.h"
+#include "vec3i.h"
+#include "GLTriangle.h"
+
+namespace davinci{
+
+//Half-edge adjacency of an indexed triangle mesh. Half-edge h belongs to
+//triangle h/3 and runs from corner h%3 to corner (h+1)%3, so next, prev
+//and face are plain arithmetic and only the twins are stored. Edges are
+//found with a parallel radix sort of the undirected edge keys.
+class GLMeshConnectivity
+{
+public:
+	enum EdgeType{
+		EDGE_INTERIOR    = 0,//two triangles, consistently oriented.
+		EDGE_BOUNDARY    = 1,//one triangle.
+		EDGE_FLIPPED     = 2,//two triangles traversing it the same way.
+		EDGE_NONMANIFOLD = 3 //more than two triangles.
+	};
+	enum VertexFlag{
+		VERTEX_BOUNDARY    = 1,
+		VERTEX_NONMANIFOLD = 2
+	};
+	enum NormalWeighting{
+		WEIGHT_AREA,
+		WEIGHT_ANGLE
+	};
+
+	GLMeshConnectivity();
+
+	//nThreads: 0 means std::thread::hardware_concurrency().
+	void build(const std::vector<vec3i>& triangleMesh, size_t vertexCount, int nThreads=0);
+
+	static int next(int h) { return h % 3 == 2 ? h - 2 : h + 1; }
+	static int prev(int h) { return h % 3 == 0 ? h + 2 : h - 1; }
+	static int face(int h) { return h / 3; }
+	int origin(int h) const { return m_triangles[h / 3][h % 3]; }
+	int target(int h) const { return origin(next(h)); }
+	//Opposite half-edge, -1 unless the edge is EDGE_INTERIOR.
+	int twin(int h) const { return m_twin[h]; }
+	//Undirected edge of half-edge h.
+	int edgeOf(int h) const { return m_halfEdgeEdge[h]; }
+
+	size_t getEdgeCount() const { return m_edges.size(); }
+	//Vertices of each edge, smaller index first.
+	const std::vector<vec2i>& getEdges() const { return m_edges; }
+	const std::vector<unsigned char>& getEdgeTypes() const { return m_edgeTypes; }
+	const std::vector<unsigned char>& getVertexFlags() const { return m_vertexFlags; }
+	size_t getEdgeCount(EdgeType type) const { return m_typeCounts[type]; }
+	bool isClosedManifold() const
+	{ return m_typeCounts[EDGE_BOUNDARY] + m_typeCounts[EDGE_FLIPPED] + m_typeCounts[EDGE_NONMANIFOLD] == 0; }
+
+	//Corners(3*triangle+k) around vertex v are
+	//getVertexCorners()[getVertexCornerOffsets()[v] .. getVertexCornerOffsets()[v+1]).
+	const std::vector<unsigned>& getVertexCornerOffsets() const { return m_cornerOffsets; }
+	const std::vector<unsigned>& getVertexCorners() const { return m_corners; }
+
+	//Unit face and vertex normals as tightly packed vec3f arrays, ready for
+	//GLVertexBufferObject::upload(n*sizeof(vec3f), n, normals.data()).
+	void computeNormals(const std::vector<vec3f>& vertexArrayUnique, NormalWeighting weighting,
+						std::vector<vec3f>& faceNormals, std::vector<vec3f>& vertexNormals,
+						int nThreads=0) const;
+
+	//Expands the mesh into GLTriangle, filling v, vn and normal.
+	void toTriangles(const std::vector<vec3f>& vertexArrayUnique, const std::vector<vec3f>& faceNormals,
+					 const std::vector<vec3f>& vertexNormals, std::vector<GLTriangle>& triangles) const;
+
+private:
+	std::vector<vec3i>         m_triangles;
+	std::vector<int>           m_twin;
+	std::vector<int>           m_halfEdgeEdge;
+	std::vector<vec2i>         m_edges;
+	std::vector<unsigned char> m_edgeTypes;
+	std::vector<unsigned char> m_vertexFlags;
+	std::vector<unsigned>      m_cornerOffsets;
+	std::vector<unsigned>      m_corners;
+	size_t                     m_typeCounts[4];
+	int                        m_nThreads;
+};
+
+typedef std::shared_ptr<GLMeshConnectivity> GLMeshConnectivityRef;
+
+}
+#endif
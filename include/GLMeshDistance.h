@@ -0,0 +1,88 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_MESH_DISTANCE_H_
+#define _GL_MESH_DISTANCE_H_
+
+#include <vector>
+#include <memory>
+#include "vec3f.h"
+#include "vec3i.h"
+#include "BBox.h"
+#include "GLTriangleBVH.h"
+
+namespace davinci{
+
+//Closest point and signed distance queries against a triangle mesh,
+//accelerated by GLTriangleBVH. The sign comes from angle weighted
+//pseudo normals(Baerentzen and Aanaes), so it is exact for closed,
+//consistently oriented meshes: negative inside, positive outside.
+class GLMeshDistance
+{
+public:
+	GLMeshDistance();
+
+	//nThreads: 0 means std::thread::hardware_concurrency().
+	void build(const std::vector<vec3f>& vertexArrayUnique,
+			   const std::vector<vec3i>& triangleMesh, int nThreads=0);
+
+	bool closestPoint(const vec3f& p, GLClosestPoint& result, float maxDistance=1e30f) const
+	{ return m_bvh.closestPoint(p, result, maxDistance); }
+	void closestPoints(const std::vector<vec3f>& points, std::vector<GLClosestPoint>& results,
+					   float maxDistance=1e30f, int nThreads=0) const
+	{ m_bvh.closestPoints(points, results, maxDistance, nThreads); }
+
+	//Points without surface within maxDistance get +maxDistance.
+	float signedDistance(const vec3f& p, float maxDistance=1e30f) const;
+	void  signedDistances(const std::vector<vec3f>& points, std::vector<float>& distances,
+						  float maxDistance=1e30f, int nThreads=0) const;
+
+	//Signed distance sampled at the cell centers of box divided into
+	//nx*ny*nz cells, x varying fastest, ready for
+	//GLTexture3d(nx, ny, nz, GL_R32F, GL_RED, GL_FLOAT, grid.data()).
+	//A finite maxDistance bakes a narrow band, far cells are clamped to
+	//+maxDistance whichever side they are on.
+	void bakeSDF(const BBox& box, int nx, int ny, int nz, std::vector<float>& grid,
+				 float maxDistance=1e30f, int nThreads=0) const;
+
+	const GLTriangleBVH& getBVH() const { return m_bvh; }
+
+private:
+	//+1 or -1 for p relative to the surface feature holding its closest point.
+	float sideOf(const vec3f& p, const GLClosestPoint& cp) const;
+
+	GLTriangleBVH      m_bvh;
+	std::vector<vec3i> m_triangles;
+	std::vector<vec3f> m_faceNormals;
+	std::vector<vec3f> m_edgeNormals;//3 per triangle: v0v1, v1v2, v2v0.
+	std::vector<vec3f> m_vertexNormals;
+};
+
+typedef std::shared_ptr<GLMeshDistance> GLMeshDistanceRef;
+
+}
+#endif
@@ -0,0 +1,102 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_MESH_SIMPLIFIER_H_
+#define _GL_MESH_SIMPLIFIER_H_
+
+#include <vector>
+#include <memory>
+#include "vec3f.h"
+#include "vec3i.h"
+#include "BBox.h"
+
+namespace davinci{
+
+class GLCamera;
+
+//One level of detail. error is the largest quadric error(root mean
+//square distance to the planes of the original surface around a
+//collapsed vertex, in object units) of all collapses that led to it.
+struct GLMeshLOD
+{
+	std::vector<vec3f> vertexArrayUnique;
+	std::vector<vec3i> triangleMesh;
+	float              error;
+	GLMeshLOD() :error(0.0f){}
+};
+
+//Quadric error metric edge collapse(Garland and Heckbert) on the indexed
+//meshes produced by GLTriangleCleaner. Collapses run in parallel on a
+//grid of spatial partitions, vertices of triangles crossing partitions
+//are locked for that pass and the grid is shifted by half a cell on the
+//next one, so no two threads ever touch the same vertex or triangle.
+//Mesh borders are kept in place by boundary constraint quadrics.
+class GLMeshSimplifier
+{
+public:
+	GLMeshSimplifier();
+
+	//Level 0 is the input mesh, every next level has about ratio times the
+	//triangles of the previous one. Stops at maxLevels, below
+	//minTriangleCount or when no more edge can be collapsed.
+	//nThreads: 0 means std::thread::hardware_concurrency().
+	void buildLODChain(const std::vector<vec3f>& vertexArrayUnique,
+					   const std::vector<vec3i>& triangleMesh,
+					   int maxLevels=8, float ratio=0.5f,
+					   size_t minTriangleCount=256, int nThreads=0);
+
+	size_t getLODCount() const { return m_lods.size(); }
+	const GLMeshLOD& getLOD(size_t level) const { return m_lods[level]; }
+	const std::vector<GLMeshLOD>& getLODs() const { return m_lods; }
+	const BBox& getBounds() const { return m_bounds; }
+
+	//Coarsest level whose error projects to at most maxPixelError pixels
+	//for camera, assuming the mesh is given in the camera's world space.
+	int selectLOD(const GLCamera& camera, int viewportHeight, float maxPixelError=1.0f) const;
+
+	//Size in pixels of an object space error at the closest point of bounds.
+	static float projectedError(const GLCamera& camera, const BBox& bounds,
+								float error, int viewportHeight);
+
+	//One shot simplification down to targetTriangleCount triangles or until
+	//the next collapse would exceed maxError, whichever comes first.
+	//Returns the error of the result, see GLMeshLOD::error.
+	static float simplify(const std::vector<vec3f>& vertexArrayUnique,
+						  const std::vector<vec3i>& triangleMesh,
+						  size_t targetTriangleCount, float maxError,
+						  std::vector<vec3f>& vertexArrayOut,
+						  std::vector<vec3i>& triangleMeshOut, int nThreads=0);
+
+private:
+	std::vector<GLMeshLOD> m_lods;
+	BBox                   m_bounds;
+};
+
+typedef std::shared_ptr<GLMeshSimplifier> GLMeshSimplifierRef;
+
+}
+#endif
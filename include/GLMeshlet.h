@@ -0,0 +1,104 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_MESHLET_H_
+#define _GL_MESHLET_H_
+
+#if defined(__APPLE__) || defined(MACOSX)
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+#include <stddef.h>
+#include <vector>
+#include <memory>
+#include "vec3f.h"
+#include "vec3i.h"
+#include "BBox.h"
+
+namespace davinci{
+
+//One meshlet, laid out as six std430 vec4s so the array can be uploaded
+//to a GLShaderStorageBufferObject as is.
+//The meshlet is backfacing for every eye with
+//dot(normalize(coneApex - eye), coneAxis) >= coneCutoff, coneCutoff is 2
+//when the normals spread too much for the test to ever pass.
+struct GLMeshletData
+{
+	float  center[3];
+	float  radius;
+	float  bmin[3];
+	GLuint vertexOffset;//into getMeshletVertices().
+	float  bmax[3];
+	GLuint triangleOffset;//into getMeshletTriangles().
+	float  coneApex[3];
+	GLuint vertexCount;
+	float  coneAxis[3];
+	float  coneCutoff;
+	GLuint triangleCount;
+	GLuint padding[3];
+};
+
+//Splits an indexed triangle mesh into meshlets of at most MAX_VERTICES
+//vertices and MAX_TRIANGLES triangles. Triangles are sorted along a
+//Morton curve, cut into chunks built on separate threads, and meshlets
+//are grown greedily from triangles sharing the most vertices with them
+//while keeping their normal cone tight.
+class GLMeshletBuilder
+{
+public:
+	enum{ MAX_VERTICES = 64, MAX_TRIANGLES = 124 };
+
+	GLMeshletBuilder();
+
+	//coneWeight: 0 optimizes vertex reuse only, larger values favor
+	//tighter normal cones(better backface culling).
+	//nThreads: 0 means std::thread::hardware_concurrency().
+	void build(const std::vector<vec3f>& vertexArrayUnique,
+			   const std::vector<vec3i>& triangleMesh,
+			   float coneWeight=0.25f, int nThreads=0);
+
+	size_t getMeshletCount() const { return m_meshlets.size(); }
+	const std::vector<GLMeshletData>& getMeshlets() const { return m_meshlets; }
+	//Global vertex index of each meshlet vertex.
+	const std::vector<GLuint>& getMeshletVertices() const { return m_vertices; }
+	//One GLuint per triangle: meshlet local indices i0 | i1<<8 | i2<<16.
+	const std::vector<GLuint>& getMeshletTriangles() const { return m_triangles; }
+	size_t getTriangleCount() const { return m_triangles.size(); }
+
+	static bool isBackfacing(const GLMeshletData& meshlet, const vec3f& eye);
+
+private:
+	std::vector<GLMeshletData> m_meshlets;
+	std::vector<GLuint>        m_vertices;
+	std::vector<GLuint>        m_triangles;
+};
+
+typedef std::shared_ptr<GLMeshletBuilder> GLMeshletBuilderRef;
+
+}
+#endif
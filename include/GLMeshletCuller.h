@@ -0,0 +1,128 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+#ifndef _GL_MESHLET_CULLER_H_
+#define _GL_MESHLET_CULLER_H_
+
+#include <vector>
+#include <memory>
+#include "mat4.h"
+#include "vec3f.h"
+#include "GLCamera.h"
+#include "GLComputeShader.h"
+#include "GLShaderStorageBufferObject.h"
+#include "GLVertexArray.h"
+#include "GLMeshlet.h"
+
+namespace davinci{
+
+class GLDrawCuller;
+
+class GLMeshletCuller
+{
+public:
+	//GPU culling of the meshlets of a GLMeshletBuilder. A compute pass tests
+	//every meshlet's bounding sphere against the frustum, its normal cone
+	//against the eye and its BBox against the Hi-Z pyramid of a
+	//GLDrawCuller, and appends the survivors. A second pass, dispatched
+	//indirectly with one work group per visible meshlet, writes their
+	//triangles into a compacted GL_UNSIGNED_INT index stream that is drawn
+	//with glDrawElementsIndirect(). The CPU never sees which meshlets
+	//passed.
+	//Meshlets are processed in batches whose indices fit the index budget,
+	//so scenes far larger than one draw can be streamed through a fixed
+	//size index buffer.
+	//Typical frame:
+	//	meshletCuller.draw(vao, camera, &drawCuller);
+	//	drawCuller.buildHiZ(depthTex, viewProj);//feeds the next frame.
+	enum CullMode{
+		CULL_FRUSTUM   = 1,
+		CULL_BACKFACE  = 2,
+		CULL_OCCLUSION = 4,
+		CULL_ALL       = 7
+	};
+
+	GLMeshletCuller();
+	~GLMeshletCuller();
+
+	//Upload the meshlets of builder, built from the vertices that vao draws.
+	void setMeshlets(const GLMeshletBuilder& builder);
+	size_t getMeshletCount() const { return m_batchFirst.empty() ? 0 : m_batchFirst.back(); }
+
+	//Largest number of indices emitted per batch, 12M by default.
+	void   setIndexBudget(size_t maxIndices);
+	size_t getIndexBudget() const { return m_indexBudget; }
+	size_t getBatchCount() const { return m_batchFirst.empty() ? 0 : m_batchFirst.size() - 1; }
+
+	void setCullMode(int mode){ m_cullMode = mode; }
+	int  getCullMode() const { return m_cullMode; }
+
+	//Cull and draw every batch with the vertex attributes of vao, whose
+	//element buffer binding is replaced. viewProj and eye are in the space
+	//of the mesh vertices. hiz: source of the occlusion pyramid, may be NULL.
+	void draw(const GLVertexArrayObjectRef& vao, const mat4& viewProj, const vec3f& eye,
+			  const GLDrawCuller* hiz=NULL);
+	void draw(const GLVertexArrayObjectRef& vao, const GLCamera& camera,
+			  const GLDrawCuller* hiz=NULL);
+
+	//The two halves of draw() for one batch, e.g. to reuse the index stream.
+	void cull(size_t batch, const mat4& viewProj, const vec3f& eye, const GLDrawCuller* hiz=NULL);
+	void drawCulled(const GLVertexArrayObjectRef& vao);
+
+	//Visible meshlets and triangles of the last cull(). Reads the command
+	//buffer back and stalls the pipeline, for statistics only.
+	void readVisibleCounts(GLuint& meshlets, GLuint& triangles);
+	GLShaderStorageBufferObjectRef getIndexBuffer() const { return m_indices; }
+	//DrawElementsIndirectCommand followed by DispatchIndirectCommand.
+	GLShaderStorageBufferObjectRef getCommandBuffer() const { return m_commands; }
+
+protected:
+	void createShaders();
+	void reserveIndices(size_t count);
+
+private:
+	GLComputeShaderRef m_cullShader;
+	GLComputeShaderRef m_emitShader;
+
+	GLShaderStorageBufferObjectRef m_meshlets;
+	GLShaderStorageBufferObjectRef m_meshletVertices;
+	GLShaderStorageBufferObjectRef m_meshletTriangles;
+	GLShaderStorageBufferObjectRef m_visible;
+	GLShaderStorageBufferObjectRef m_indices;
+	GLShaderStorageBufferObjectRef m_commands;
+	GLShaderStorageBufferObjectRef m_noHiZ;
+
+	std::vector<GLuint> m_triangleCounts;//per meshlet, to cut batches.
+	std::vector<size_t> m_batchFirst;//first meshlet of each batch, plus the end.
+	size_t m_indexBudget;
+	size_t m_maxBatchIndices;
+	int    m_cullMode;
+};
+
+typedef std::shared_ptr<GLMeshletCuller> GLMeshletCullerRef;
+
+}
+#endif
@@ -0,0 +1,126 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_PROGRESSIVE_VOLUME_RENDERER_H_
+#define _GL_PROGRESSIVE_VOLUME_RENDERER_H_
+
+#include <vector>
+#include <memory>
+#if defined(__APPLE__) || defined(MACOSX)
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+#include "vec3f.h"
+#include "vec4f.h"
+#include "mat4.h"
+#include "GLCamera.h"
+#include "GLTexture1D.h"
+#include "GLTexture2D.h"
+#include "GLTexture3D.h"
+#include "GLFrameBufferObject.h"
+#include "GLComputeShader.h"
+
+namespace davinci{
+
+//Ray casts a scalar GLTexture3d through a 1D transfer function in passes
+//of increasing quality, one pass per render() call. While the view keeps
+//changing only the first pass runs: one ray per block of pixels with a
+//step as coarse as the block. Once the view holds still, later levels
+//halve block and step until the last level renders every pixel at the
+//full quality step, split into 2x2 interleaved passes. The result of each
+//pass overwrites its pixels in an RGBA32F refinement image, so the
+//converged image is identical to renderFullQuality().
+class GLProgressiveVolumeRenderer
+{
+public:
+	//nLevels: number of quality levels, the coarsest uses blocks of
+	//2^(nLevels-1) pixels.
+	GLProgressiveVolumeRenderer(int nLevels=3);
+	~GLProgressiveVolumeRenderer();
+
+	//volume: scalar field in the red channel, spanning [bottomLeft,topRight]
+	//in world space. The step defaults to the smallest voxel extent.
+	void setVolume(const GLTexture3DRef& volume, const vec3f& bottomLeft, const vec3f& topRight);
+	void setTransferFunction(const GLTexture1DRef& transferFunc);
+	//Full quality sampling distance in world units.
+	void setStepSize(float step);
+	float getStepSize() const { return m_stepSize; }
+	void setBackground(const vec4f& rgba) { m_background = rgba; reset(); }
+	void setLevels(int nLevels);
+	//Restart refinement, e.g. after editing the transfer function.
+	void reset() { m_pass = 0; }
+
+	//Run the next pass for this view and blit the refinement image into the
+	//bound draw framebuffer's viewport. A changed view, viewport or volume
+	//restarts at the coarsest level. Returns true once converged.
+	bool render(const mat4& viewMtx, const mat4& projMtx);
+	bool render(const GLCamera& camera);
+	//Every pixel at the full quality step in one go.
+	void renderFullQuality(const mat4& viewMtx, const mat4& projMtx);
+
+	bool isConverged() const { return m_pass >= (int)m_passes.size(); }
+	int  getPass() const { return m_pass; }
+	int  getPassCount() const { return (int)m_passes.size(); }
+
+private:
+	//One ray per footprint x footprint block, blocks placed every spacing
+	//pixels starting at offset.
+	struct Pass{
+		int spacing, footprint;
+		int offsetX, offsetY;
+		int stepScale;
+	};
+	void buildPasses();
+	void createShaders();
+	bool prepare(const mat4& viewMtx, const mat4& projMtx);
+	void runPass(const Pass& pass);
+	//state image over the background into m_resolvedTex.
+	void resolve();
+	void blit();
+
+	int m_nLevels;
+	std::vector<Pass> m_passes;
+	int m_pass;
+	GLTexture3DRef m_volume;
+	GLTexture1DRef m_transferFunc;
+	vec3f m_bottomLeft, m_topRight;
+	float m_stepSize;
+	vec4f m_background;
+	mat4  m_viewMtx, m_projMtx;
+	int   m_viewport[4];
+	GLTexture2DRef         m_stateTex;//RGBA32F refinement image.
+	GLTexture2DRef         m_resolvedTex;
+	GLFrameBufferObjectRef m_resolveFbo;
+	GLComputeShaderRef     m_marchShader;
+	GLComputeShaderRef     m_resolveShader;
+};
+
+typedef std::shared_ptr<GLProgressiveVolumeRenderer> GLProgressiveVolumeRendererRef;
+
+}
+#endif
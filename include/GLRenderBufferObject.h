@@ -37,6 +37,9 @@ namespace davinci{
         public:
             GLRenderbufferObject(void);
             GLRenderbufferObject(GLsizei width, GLsizei height);
+            //internalformat: any color/depth renderable format, e.g. GL_RGBA8, GL_DEPTH24_STENCIL8.
+            //samples: 0 for a single sampled buffer.
+            GLRenderbufferObject(GLsizei width, GLsizei height, GLenum internalformat, GLsizei samples=0);
             ~GLRenderbufferObject(void);
             void    resize(GLsizei width, GLsizei height);
             void    bind();
@@ -44,10 +47,15 @@ namespace davinci{
             GLuint  getBufferId() const;
             GLsizei getWidth() const;
             GLsizei getHeight() const;
+            GLenum  getInternalFormat() const { return m_internalformat; }
+            GLsizei getSamples() const { return m_samples; }
         private:
             void deleteBuffer();
+            void allocateStorage();
             GLuint m_rboId;
             GLsizei m_width, m_height;
+            GLenum  m_internalformat;
+            GLsizei m_samples;
     };
 
     #ifdef BOOST_REFERENCE_COUNT
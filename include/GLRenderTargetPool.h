@@ -0,0 +1,127 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_RENDER_TARGET_POOL_H_
+#define _GL_RENDER_TARGET_POOL_H_
+
+#include <stddef.h>
+#include <vector>
+#include <memory>
+#include "GLTexture2D.h"
+#include "GLRenderBufferObject.h"
+#include "GLFrameBufferObject.h"
+
+namespace davinci{
+
+struct GLRenderTargetPoolStats
+{
+	size_t hits;
+	size_t misses;
+	double hitRate;//hits/(hits+misses), 0 before the first request.
+	size_t residentBytes;//estimated GPU memory of everything pooled.
+	size_t inUseBytes;//part of residentBytes currently handed out.
+	size_t textureCount;
+	size_t renderbufferCount;
+	size_t framebufferCount;
+};
+
+//Recycles render target textures, renderbuffers and framebuffer objects
+//across passes and frames. A resource is handed out again once the caller
+//drops its last reference, so transient attachments of the same size,
+//format and sample count whose lifetimes do not overlap within a frame
+//share one allocation. Idle resources are freed by beginFrame() after
+//maxIdleFrames frames, and least recently used first whenever the
+//resident size exceeds the byte budget.
+class GLRenderTargetPool
+{
+public:
+	GLRenderTargetPool(int maxIdleFrames=2, size_t byteBudget=size_t(512) << 20);
+	~GLRenderTargetPool();
+
+	//Mipmap-less 2D texture, filters are part of the key.
+	GLTexture2DRef acquireTexture(int width, int height, GLint internalformat,
+								  GLint minFilter=GL_NEAREST, GLint magFilter=GL_NEAREST);
+	//samples: 0 for a single sampled buffer.
+	GLRenderbufferObjectRef acquireRenderbuffer(int width, int height, GLenum internalformat, int samples=0);
+	//The framebuffer may still reference attachments of its previous user,
+	//attach every slot you draw to.
+	GLFrameBufferObjectRef acquireFramebuffer(GLenum target=GL_FRAMEBUFFER);
+
+	//Advances the frame counter and frees resources idle for maxIdleFrames.
+	void beginFrame();
+	//Frees every resource that is not in use.
+	void trim();
+	//Drops the caller's reference and frees the resource right away unless
+	//someone else still holds it. For targets that will not be asked for
+	//again, like the old size on a resize, which would otherwise stay
+	//resident until beginFrame() or the byte budget evicts them.
+	void release(GLTexture2DRef& texture);
+	void release(GLRenderbufferObjectRef& renderbuffer);
+
+	GLRenderTargetPoolStats getStats() const;
+	void resetStats() { m_hits = m_misses = 0; }
+
+	//Estimated bytes per pixel (per sample) of a sized internal format.
+	static size_t getBytesPerPixel(GLint internalformat);
+	//Pixel transfer format/type compatible with internalformat, for glTexImage2D.
+	static void getTransferFormat(GLint internalformat, GLint& format, GLint& type);
+
+	//Pool shared by the library's own passes (GLClickable, GLSupersampler).
+	//The library does not call beginFrame() on it; its passes release()
+	//their targets when they resize instead.
+	static std::shared_ptr<GLRenderTargetPool> getDefault();
+	//Free the shared pool while the GL context is still current.
+	static void releaseDefault();
+
+private:
+	template<class Ref>
+	struct Entry{
+		Ref    resource;
+		int    width, height;
+		GLint  format;
+		int    samples;//or packed filters for textures.
+		size_t bytes;
+		unsigned long long lastUsed;//m_clock of the last acquisition.
+		unsigned long long lastFrame;//last frame it was acquired or held in.
+	};
+	void enforceBudget();
+	unsigned long long tick() { return ++m_clock; }
+
+	std::vector<Entry<GLTexture2DRef> >          m_textures;
+	std::vector<Entry<GLRenderbufferObjectRef> > m_renderbuffers;
+	std::vector<Entry<GLFrameBufferObjectRef> >  m_framebuffers;
+	int    m_maxIdleFrames;
+	size_t m_byteBudget;
+	unsigned long long m_frame;
+	unsigned long long m_clock;//advanced by every acquisition, orders LRU eviction.
+	size_t m_hits, m_misses;
+};
+
+typedef std::shared_ptr<GLRenderTargetPool> GLRenderTargetPoolRef;
+
+}
+#endif
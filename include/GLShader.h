@@ -60,16 +60,16 @@ public:
 	void UseShaders();
 	void ReleaseShader();
 
-	void SetFloatUniform( char* name, GLfloat val);
-	void SetFloat2Uniform( char* name, const vec2f& val);
-	void SetFloat3Uniform( char* name, const vec3f& val);
-	void SetFloat4Uniform( char* name, const vec4f& val);
+	void SetFloatUniform( const char* name, GLfloat val);
+	void SetFloat2Uniform( const char* name, const vec2f& val);
+	void SetFloat3Uniform( const char* name, const vec3f& val);
+	void SetFloat4Uniform( const char* name, const vec4f& val);
 
-	void SetDoubleUniform( char* name, GLdouble val);
+	void SetDoubleUniform( const char* name, GLdouble val);
 
-	void SetMatrixUniform( char* name, GLfloat mat[16], bool isRowMajor = true);
-	void SetMatrixUniform( char* name, const mat4& mat, bool isRowMajor = true);
-	void SetMatrixUniform( char* name, const mat3& mat, bool isRowMajor = true);
+	void SetMatrixUniform( const char* name, GLfloat mat[16], bool isRowMajor = true);
+	void SetMatrixUniform( const char* name, const mat4& mat, bool isRowMajor = true);
+	void SetMatrixUniform( const char* name, const mat3& mat, bool isRowMajor = true);
 	//textUnitId: By default it is zero, which corresponds to
 	// glActiveTexture(GL_TEXTURE0).
 	//If you need multiple texture accessed in your fragment shader
@@ -88,27 +88,27 @@ public:
 	// the texture id returned by glGenTextures(1, &m_texId);
 	//user is responsible to call glActiveTexture() and GLTextureAbstract::bind()
 	//before draw call. It is recommended to call the variation:
-	//void SetSamplerUniform( char* name, GLTextureAbstract* tex) instead.
-	void SetSamplerUniform( char* name, GLuint textUnitId=0);
+	//void SetSamplerUniform( const char* name, GLTextureAbstract* tex) instead.
+	void SetSamplerUniform( const char* name, GLuint textUnitId=0);
 	//A recommended call to set sampler uniform.
-	void SetSamplerUniform( char* name, GLTextureAbstract* tex);
+	void SetSamplerUniform( const char* name, GLTextureAbstract* tex);
 	//Attach GLTexture1D/2D/3D and GLTextureBufferObject to image unit
 	//For GLTexture1D/2D/3D, you use imageLoad/Store to read/write texel from/to image1D/2D/3D
 	//For GLTextureBufferObject, you use texelFetch() to read from samplerBuffer
-	void SetImageUniform(char* name, GLTextureAbstract* tex);
-	void SetUintUniform( char* name, GLuint val);
-	void SetIntUniform( char* name, GLint val);
-	void SetInt2Uniform( char* name, const vec2i& val);
-	void SetInt3Uniform( char* name, const vec3i& val);
-	void SetBoolUniform( char* name, bool val);
+	void SetImageUniform( const char* name, GLTextureAbstract* tex);
+	void SetUintUniform( const char* name, GLuint val);
+	void SetIntUniform( const char* name, GLint val);
+	void SetInt2Uniform( const char* name, const vec2i& val);
+	void SetInt3Uniform( const char* name, const vec3i& val);
+	void SetBoolUniform( const char* name, bool val);
 	/*TODO: will be available once vec4d is ready.
-	void SetDouble2Uniform( char* name,const vec2f& val );
-	void SetDouble4Uniform( char* name, const vec4f& val );
+	void SetDouble2Uniform( const char* name,const vec2f& val );
+	void SetDouble4Uniform( const char* name, const vec4f& val );
 	*/
-	void SetDouble3Uniform(char* name, const vec3d& val);
-	void SetBlockUniform(char* name, GLUniformBlockBufferObjectRef bbo);
-	void SetAtomicCounterUniform(char* name, GLAtomicCounterRef aco);
-	void SetShaderStorageBlockUniform(char* name, GLShaderStorageBufferObjectRef ssbo);
+	void SetDouble3Uniform( const char* name, const vec3d& val);
+	void SetBlockUniform( const char* name, GLUniformBlockBufferObjectRef bbo);
+	void SetAtomicCounterUniform( const char* name, GLAtomicCounterRef aco);
+	void SetShaderStorageBlockUniform( const char* name, GLShaderStorageBufferObjectRef ssbo);
 
 	GLuint getProgramId(){ return m_programId;}
 	std::string getShaderName() const { return m_shaderName; }
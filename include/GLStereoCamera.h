@@ -22,10 +22,11 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 
 //AUTHOR: Jinrong Xie (stonexjr at gmail.com)
 //CREATED: 2015-05-09
-//UPDATED: 2017-10-15
+//UPDATED: 2026-10-19
 #ifndef _GL_STEREO_CAMERA_H_
 #define _GL_STEREO_CAMERA_H_
 #include "GLCamera.h"
+#include "GLUniformBlockBufferObject.h"
 
 namespace davinci{
 //Stereo Camera is just aggregation of two 
@@ -35,11 +36,19 @@ namespace davinci{
 //http://paulbourke.net/exhibition/vpac/theory.html
 //http://www.binocularity.org/page26.php
 //
+//Single pass stereo: draw every object with twice the instance count and
+//transform vertices with stereoTransform() from shader/stereo.glsl, which
+//picks the eye from gl_InstanceID&1 and the matrices from the uniform
+//block returned by updateStereoBlock().
 class GLStereoCamera : public GLCamera
 {
 public:
 	typedef enum{MIDDLE_EYE, LEFT_EYE, RIGHT_EYE} EyeMode;
 	typedef enum{OFFAXIS, TOEIN} FrustumMode;
+	//LAYERED: eye i goes to layer i of a layered FBO (GL_TEXTURE_2D_ARRAY).
+	//SIDE_BY_SIDE: left eye to the left half, right eye to the right half
+	//of a viewport twice as wide as one eye.
+	typedef enum{LAYERED, SIDE_BY_SIDE} SinglePassMode;
 
 	GLStereoCamera(void);
 	//set interpupillary distance.
@@ -57,6 +66,24 @@ public:
 
 	//Depending on eyemode(LEFT_EYE or RIGHT_EYE), return viewing matrix of left/right eye.
 	mat4 getViewingMatrix(EyeMode eyemode);
+	using GLCamera::getProjectionMatrix;
+	//OFFAXIS shifts the frustum of each eye so that both meet at the focal
+	//distance, TOEIN returns the shared projection.
+	mat4 getProjectionMatrix(EyeMode eyemode) const;
+	mat4 getViewProjectionMatrix(EyeMode eyemode);
+
+	void  setSinglePassMode(SinglePassMode mode){ m_singlePassMode = mode; }
+	SinglePassMode getSinglePassMode() const{ return m_singlePassMode; }
+	//Writing gl_Layer from the vertex shader needs
+	//GL_ARB_shader_viewport_layer_array or GL_AMD_vertex_shader_layer.
+	static bool isLayeredSupported();
+	//Upload both eyes' view-projection and viewing matrices to the
+	//StereoMatrices block, pass it to GLShader::SetBlockUniform.
+	GLUniformBlockBufferObjectRef updateStereoBlock();
+	//Set the viewport (x,y, eye size), update the uniform block and, for
+	//SIDE_BY_SIDE, enable GL_CLIP_DISTANCE0 to keep each eye in its half.
+	void beginSinglePass(int x, int y, int eyeWidth, int eyeHeight);
+	void endSinglePass();
 
 protected:
 	float m_IPD;//interpupillary distance.
@@ -67,6 +94,8 @@ protected:
 	//
 	GLCamera m_leftCamera;
 	GLCamera m_rightCamera;
+	SinglePassMode m_singlePassMode;
+	GLUniformBlockBufferObjectRef m_stereoBlock;
 };
 
 typedef std::shared_ptr<GLStereoCamera> GLStereoCameraRef;
@@ -0,0 +1,109 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_SUPERSAMPLER_H_
+#define _GL_SUPERSAMPLER_H_
+
+#include <memory>
+#if defined(__APPLE__) || defined(MACOSX)
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+#include "vec2f.h"
+#include "mat4.h"
+#include "GLTexture2D.h"
+#include "GLFrameBufferObject.h"
+#include "GLRenderBufferObject.h"
+#include "GLComputeShader.h"
+
+namespace davinci{
+
+//Jittered supersampling without the legacy accumulation buffer. Every
+//sub-frame is rendered into a float FBO with its projection shifted by a
+//sub-pixel Halton(2,3) offset and added into an RGBA32F image by a compute
+//pass; resolve() normalizes the sum into an RGBA8 texture. Accumulation is
+//progressive: resolve/present after any number of samples to show the
+//partial result, and reset() when the view changes.
+class GLSupersampler
+{
+public:
+	typedef void (*drawCallBack)(void* params);
+	enum FilterType{
+		FILTER_BOX,      //jitter within the pixel, equal weights.
+		FILTER_GAUSSIAN  //jitter within +-1 pixel, sigma 0.5 pixel weights.
+	};
+
+	GLSupersampler(FilterType filter=FILTER_BOX);
+	~GLSupersampler();
+
+	//(Re)allocates the render targets and restarts the accumulation.
+	//Does nothing if the size is unchanged.
+	void resize(int width, int height);
+	void reset();
+	void setFilter(FilterType filter) { m_filter = filter; reset(); }
+
+	//Renders nSamples more sub-frames. renderCallBack draws the scene with
+	//GLContext::g_PjM into the bound framebuffer, clearing it first. The
+	//previous framebuffer, viewport and projection are restored afterwards.
+	//Returns the number of samples accumulated so far.
+	int  accumulate(drawCallBack renderCallBack, void* params, int nSamples=1);
+	//Average of the samples so far.
+	GLTexture2DRef resolve();
+	//Blit the last resolve() into drawFramebuffer with its lower left corner at (x,y).
+	void present(GLuint drawFramebuffer, int x=0, int y=0);
+
+	int  getSampleCount() const { return m_sampleCount; }
+	int  getWidth() const { return m_width; }
+	int  getHeight() const { return m_height; }
+
+	//Sub-pixel offset of sample i in [-0.5,0.5)^2 pixel units.
+	static vec2f getJitter(int sampleIndex);
+	//proj shifted by jitterPixels for a width x height viewport.
+	static mat4  jitterProjection(const mat4& proj, const vec2f& jitterPixels, int width, int height);
+
+private:
+	void createShaders();
+
+	FilterType m_filter;
+	int   m_width, m_height;
+	int   m_sampleCount;
+	float m_weightSum;
+	GLTexture2DRef         m_sceneTex;//RGBA16F target of each sub-frame.
+	GLRenderbufferObjectRef m_sceneDepth;
+	GLFrameBufferObjectRef m_sceneFbo;
+	GLTexture2DRef         m_accumTex;//RGBA32F weighted sum.
+	GLTexture2DRef         m_resolvedTex;//RGBA8 average.
+	GLFrameBufferObjectRef m_resolveFbo;
+	GLComputeShaderRef     m_accumShader;
+	GLComputeShaderRef     m_resolveShader;
+};
+
+typedef std::shared_ptr<GLSupersampler> GLSupersamplerRef;
+
+}
+#endif
@@ -52,9 +52,12 @@ namespace davinci{
 			//param type:
 			//the data type of each color components. eg. GL_UNSIGNED_BYTE(default) GL_FLOAT
 			//Used for performing a Pixel Transfer operation.
+			//param target: GL_TEXTURE_3D(default) or GL_TEXTURE_2D_ARRAY, whose d
+			//layers can hold depth formats and be rendered to as an FBO layer.
 			GLTexture3d(int w=16, int h=16, int d=16,// GLenum texUnitId=0,
 						GLint internalformat=GL_RGBA8, GLint format=GL_RGBA,
-						GLint type=GL_UNSIGNED_BYTE,const GLvoid* pixelData=NULL);
+						GLint type=GL_UNSIGNED_BYTE,const GLvoid* pixelData=NULL,
+						GLenum target=GL_TEXTURE_3D);
 
 			~GLTexture3d(void);
 			//param mode:
@@ -0,0 +1,153 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_TILED_RENDERER_H_
+#define _GL_TILED_RENDERER_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#if defined(__APPLE__) || defined(MACOSX)
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+#include "mat4.h"
+#include "GLCamera.h"
+#include "GLPixelBufferObject.h"
+
+namespace davinci{
+
+//Uncompressed 8 bit RGB(A) tiled BigTIFF written one tile at a time.
+//Tile offsets are fixed when the file is opened, so tiles may arrive in
+//any order and only the tile being written is held in memory. BigTIFF
+//keeps 64 bit offsets so posters beyond 4GB stay readable.
+class GLTiledImageWriter
+{
+public:
+	GLTiledImageWriter();
+	~GLTiledImageWriter();
+
+	//tileWidth and tileHeight must be multiples of 16; channels is 3 or 4.
+	bool open(const std::string& fileName, int width, int height,
+			  int tileWidth, int tileHeight, int channels);
+	//pixels: tileWidth*tileHeight*channels bytes, top row first. Parts
+	//of edge tiles beyond the image are padding.
+	bool writeTile(int tileX, int tileY, const unsigned char* pixels);
+	bool close();
+	bool isOpen() const { return m_file.is_open(); }
+
+	int  getTilesAcross() const { return (m_width + m_tileWidth - 1) / m_tileWidth; }
+	int  getTilesDown() const { return (m_height + m_tileHeight - 1) / m_tileHeight; }
+	size_t getTileBytes() const { return size_t(m_tileWidth) * m_tileHeight * m_channels; }
+
+private:
+	std::ofstream m_file;
+	int m_width, m_height;
+	int m_tileWidth, m_tileHeight;
+	int m_channels;
+	unsigned long long m_dataOffset;//file offset of tile 0.
+};
+
+//Renders images larger than GL_MAX_RENDERBUFFER_SIZE, e.g. 32k x 32k
+//posters, tile by tile. Each tile is drawn into a pooled FBO with an
+//off-axis sub-frustum of the full view, read back asynchronously through
+//a ring of pixel buffer objects and handed to a writer thread that streams
+//it into a GLTiledImageWriter. Host memory stays bounded by the readback
+//ring plus maxQueuedTiles tiles regardless of the poster size.
+class GLTiledRenderer
+{
+public:
+	typedef void (*drawCallBack)(void* params);
+
+	GLTiledRenderer(int tileWidth=2048, int tileHeight=2048, int maxQueuedTiles=4);
+	~GLTiledRenderer();
+
+	//Frustum of the whole poster, as GLCamera::setFrustum().
+	void setFrustum(float l, float r, float b, float t, float n, float f);
+	//aspect is the poster's width/height.
+	void setFrustum(float fovY, float aspect, float n, float f);
+
+	//Renders a width x height poster into fileName (tiled BigTIFF, RGBA
+	//if alpha is set). renderCallBack draws the scene into the bound
+	//framebuffer, which is already cleared, using camera's projection
+	//matrix (also mirrored in GLContext::g_PjM). The camera projection,
+	//framebuffer and viewport are restored afterwards. Returns false if
+	//the file could not be written.
+	bool render(GLCamera& camera, int width, int height, const std::string& fileName,
+				drawCallBack renderCallBack, void* params, bool alpha=false);
+
+	//Tile size actually used, clamped to the GL limits and rounded down to
+	//the multiple of 16 required by TIFF.
+	int  getTileWidth() const { return m_tileWidth; }
+	int  getTileHeight() const { return m_tileHeight; }
+	int  getTilesRendered() const { return m_tilesRendered; }
+
+	//Sub-frustum (l,r,b,t) of the tile whose top left pixel is (x0,y0),
+	//counted from the poster's top left corner.
+	static void getTileFrustum(float l, float r, float b, float t, int width, int height,
+							   int x0, int y0, int tileWidth, int tileHeight,
+							   float& tl, float& tr, float& tb, float& tt);
+
+private:
+	struct Tile{
+		int tileX, tileY;
+		std::vector<unsigned char> rgba;//bottom row first, as read back.
+	};
+	void clampTileSize();
+	void readback(int slot);
+	void writerLoop();
+
+	int   m_tileWidth, m_tileHeight;
+	int   m_maxQueuedTiles;
+	float m_left, m_right, m_bottom, m_top, m_near, m_far;
+	int   m_tilesRendered;
+
+	std::vector<GLPixelBufferObjectRef> m_pbos;//readback ring.
+	std::vector<int> m_pending;//tile index read into each PBO, -1 if none.
+	int m_tilesAcross;
+
+	GLTiledImageWriter m_writer;
+	std::thread        m_writerThread;
+	std::mutex         m_mutex;
+	std::condition_variable m_cond;
+	std::deque<Tile>   m_queue;
+	std::vector<std::vector<unsigned char> > m_spare;//recycled tile buffers.
+	bool m_done;
+	bool m_writeFailed;
+};
+
+typedef std::shared_ptr<GLTiledRenderer> GLTiledRendererRef;
+
+}
+#endif
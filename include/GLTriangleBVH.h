@@ -0,0 +1,145 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+#ifndef _GL_TRIANGLE_BVH_H_
+#define _GL_TRIANGLE_BVH_H_
+
+#include <vector>
+#include <memory>
+#include "vec3f.h"
+#include "vec3i.h"
+#include "mat4.h"
+#include "BBox.h"
+
+namespace davinci{
+
+class GLCamera;
+
+struct GLRay
+{
+	vec3f origin;
+	vec3f direction;//need not be normalized, t is measured in its length.
+	float tMin, tMax;
+
+	GLRay() :tMin(0.0f), tMax(1e30f){}
+	GLRay(const vec3f& o, const vec3f& d, float t0=0.0f, float t1=1e30f)
+		:origin(o), direction(d), tMin(t0), tMax(t1){}
+};
+
+struct GLRayHit
+{
+	int   triangle;//index into triangleMesh, -1 if the ray hits nothing.
+	float t;
+	//barycentric coordinates of the hit point p=(1-u-v)*v0+u*v1+v*v2
+	//where (v0,v1,v2) are the vertices of triangleMesh[triangle].
+	float u, v;
+
+	GLRayHit() :triangle(-1), t(1e30f), u(0.0f), v(0.0f){}
+	bool isHit() const { return triangle >= 0; }
+};
+
+struct GLClosestPoint
+{
+	int   triangle;//index into triangleMesh, -1 if nothing is within range.
+	float distance;
+	//barycentric coordinates of point=(1-u-v)*v0+u*v1+v*v2.
+	float u, v;
+	vec3f point;
+
+	GLClosestPoint() :triangle(-1), distance(1e30f), u(0.0f), v(0.0f){}
+	bool isValid() const { return triangle >= 0; }
+};
+
+//32 bytes, two nodes per 64 byte cache line. Children of an inner node
+//are stored next to each other.
+struct GLBVHNode
+{
+	float bmin[3];
+	unsigned int leftFirst;//inner node: index of left child, right child is leftFirst+1.
+						   //leaf: first entry in the BVH ordered triangle list.
+	float bmax[3];
+	unsigned int count;//number of triangles of a leaf, 0 for inner nodes.
+
+	bool isLeaf() const { return count > 0; }
+};
+
+//Bounding volume hierarchy over an indexed triangle mesh such as the
+//vertexArrayUnique/triangleMesh pair produced by GLTriangleCleaner.
+//Built top-down with binned SAH, rays are traced in SIMD packets.
+class GLTriangleBVH
+{
+public:
+	GLTriangleBVH();
+
+	//maxLeafSize: leaves are created once a node has no more triangles than
+	//this, bigger leaves are only created when SAH says splitting does not pay.
+	//nThreads: 0 means std::thread::hardware_concurrency().
+	void build(const std::vector<vec3f>& vertexArrayUnique,
+			   const std::vector<vec3i>& triangleMesh,
+			   int maxLeafSize=4, int nThreads=0);
+	void clear();
+
+	//Closest hit along ray within [tMin,tMax].
+	bool intersect(const GLRay& ray, GLRayHit& hit) const;
+	//Closest hit for every ray. Consecutive rays are traced as one packet,
+	//so keep coherent rays(e.g. a screen tile) next to each other.
+	void intersect(const std::vector<GLRay>& rays, std::vector<GLRayHit>& hits, int nThreads=0) const;
+
+	//Closest point on the mesh to p no farther than maxDistance.
+	bool closestPoint(const vec3f& p, GLClosestPoint& result, float maxDistance=1e30f) const;
+	//Closest point for every query point, consecutive points form one SIMD
+	//packet so spatially coherent orderings(e.g. grid rows) are fastest.
+	void closestPoints(const std::vector<vec3f>& points, std::vector<GLClosestPoint>& results,
+					   float maxDistance=1e30f, int nThreads=0) const;
+
+	//Ray through normalized device coordinate (ndcX,ndcY) from the near to
+	//the far plane of viewProj=projection*view(*model for object space rays).
+	static GLRay createPickRay(const mat4& viewProj, float ndcX, float ndcY);
+	//Ray through window pixel (x,y), origin at the upper left corner like
+	//mouse coordinates.
+	static GLRay createPickRay(const GLCamera& camera, int x, int y, int width, int height);
+
+	const std::vector<GLBVHNode>& getNodes() const { return m_nodes; }
+	//BVH ordered triangle list, entries are indices into triangleMesh.
+	const std::vector<unsigned int>& getTriangleIndices() const { return m_triIndices; }
+	BBox   getBounds() const;
+	size_t getTriangleCount() const { return m_triIndices.size(); }
+	int    getDepth() const { return m_depth; }
+	//SIMD lanes per ray packet.
+	static int getPacketWidth();
+
+private:
+	std::vector<GLBVHNode>    m_nodes;
+	std::vector<unsigned int> m_triIndices;
+	//Per BVH ordered triangle: v0, v1-v0, v2-v0 as 9 floats.
+	std::vector<float>        m_triangles;
+	int m_depth;
+};
+
+typedef std::shared_ptr<GLTriangleBVH> GLTriangleBVHRef;
+
+}
+#endif
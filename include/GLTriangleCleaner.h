@@ -67,6 +67,25 @@ namespace davinci{
         return a.coord < b.coord;
     }
 
+    enum TriangleDedupFlag{
+        //(a,b,c) and (c,a,b) are always the same triangle. With this flag
+        //(a,c,b) is one as well, i.e. winding is ignored.
+        TRIANGLE_DEDUP_IGNORE_WINDING = 1,
+        //Drop triangles referencing the same vertex more than once.
+        TRIANGLE_DEDUP_REMOVE_DEGENERATE = 2,
+        TRIANGLE_DEDUP_DEFAULT = TRIANGLE_DEDUP_REMOVE_DEGENERATE
+    };
+
+    //Removes duplicated triangles in parallel, keeping the first occurrence of
+    //each in its original vertex order and the relative order of survivors.
+    //remap (optional) receives, for every input triangle, the index of the
+    //triangle that represents it in the output, or -1 if it was dropped as
+    //degenerate, so per-triangle attributes can follow: attr[remap[i]] = oldAttr[i].
+    //nThreads: 0 means std::thread::hardware_concurrency().
+    //Returns the number of triangles removed.
+    size_t removeDuplicateTriangles(std::vector<vec3i> &triangleMesh, std::vector<int>* remap,
+        unsigned flags = TRIANGLE_DEDUP_DEFAULT, int nThreads = 0);
+
     template<class T>
     class GLTriangleCleaner{
          GLTriangleCleaner(void){};
@@ -80,29 +99,19 @@ namespace davinci{
             std::vector<T> &vertexArrayUnique,
             std::vector<vec3i>& triangleMesh);
 
-        //Remove overlapping triangle from triangleMesh list.
-        static void removeOverlappingTriangle(std::vector<vec3i> &triangleMesh);
-    };
-
-    template<class T>
-    void davinci::GLTriangleCleaner<T>::removeOverlappingTriangle(std::vector<vec3i> &triangleMesh)
-    {
-        size_t nTriangleCount = triangleMesh.size();
-
-        std::sort(triangleMesh.begin(), triangleMesh.end());
-
-        int lastUniqueIndex = 0;
-        for (int i = 1; i < nTriangleCount; i++)
+        //Remove overlapping triangle from triangleMesh list, see removeDuplicateTriangles().
+        //Returns the number of triangles removed.
+        static size_t removeOverlappingTriangle(std::vector<vec3i> &triangleMesh,
+            unsigned flags = TRIANGLE_DEDUP_DEFAULT, int nThreads = 0)
         {
-            vec3i curTriaVtxIdx = triangleMesh[i];
-            if (curTriaVtxIdx != triangleMesh[lastUniqueIndex])
-            {
-                triangleMesh[++lastUniqueIndex] = curTriaVtxIdx;
-            }
+            return removeDuplicateTriangles(triangleMesh, NULL, flags, nThreads);
         }
-        triangleMesh.resize(lastUniqueIndex + 1);
-        cout << "Removed " << nTriangleCount - triangleMesh.size() << " overlapping triangles.\n";
-    }
+        static size_t removeOverlappingTriangle(std::vector<vec3i> &triangleMesh, std::vector<int>& remap,
+            unsigned flags = TRIANGLE_DEDUP_DEFAULT, int nThreads = 0)
+        {
+            return removeDuplicateTriangles(triangleMesh, &remap, flags, nThreads);
+        }
+    };
 
     template<class T>
     void GLTriangleCleaner<T>::createTriangleMeshFromTriangleSoup(const std::vector<std::vector<T> >& vertexArray,
@@ -89,6 +89,17 @@ namespace davinci{
 									GLenum pixelFormat=GL_BGRA,
 									GLenum pixelType=GL_UNSIGNED_BYTE);
 #endif
+		//Non-blocking variant of grabFrameBuffer: the read back goes through
+		//a PBO and the PNG is encoded by GLFrameCapture's worker threads.
+		//Returns false if the frame was dropped because encoders fell behind.
+		static bool grabFrameBufferAsync(int x, int y, int width, int height,
+									const std::string& fileName,
+									GLenum whichBuffer=GL_BACK);
+		//Captures are handed to the encoders by the next grabFrameBufferAsync().
+		//Call poll once per frame so the last ones do not wait for it, or
+		//flush to block until every capture is written.
+		static void pollFrameBufferAsync();
+		static void flushFrameBufferAsync();
 		static void glGetViewPort(vec4i& viewport);
 
 		//Same as gluUnProject() to get the object coordinates that correspond to those window coordinates
@@ -99,9 +110,10 @@ namespace davinci{
 		static vec3f unProject(const vec3i& srcXYZ, const mat4&  modelViewMtx, const mat4&  projMtx);
 
 		typedef void (*drawCallBack)(void* params);
-		//Apply supersampling to the renderCallBack.
+		//Apply supersampling to the renderCallBack, see GLSupersampler for
+		//progressive accumulation. renderCallBack must clear what it draws into.
 		//qualityLevel: int value ranges from 1(equivalent to no supersampling) 
-		//to 8 (highest quality).
+		//to 8 (highest quality), rendering qualityLevel^2 jittered sub-frames.
 		static void glSupersampling(drawCallBack renderCallBack, void* params, int qualityLevel=1);
 
 		static std::unordered_map<GLint, std::string>  m_openglInt2TypeName;
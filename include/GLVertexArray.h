@@ -36,6 +36,8 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 
 namespace davinci{
 
+class GLIndexBufferObject;
+
 class GLVertexArrayObject
 {
 public:
@@ -123,6 +125,9 @@ public:
     //toggle attribute 'name'.
     void activateAttribute(const std::string& name, bool flag);
 	GLAttributeRef getAttribute(const std::string& name);
+	//Make every attribute sourced from oldVbo source from newVbo instead,
+	//e.g. after a buffer has been reallocated and copied.
+	void retargetAttributes(const GLVertexBufferObjectRef& oldVbo, const GLVertexBufferObjectRef& newVbo);
 	//Return the id of the associated shader program if set, since GLVertexBufferObject
 	//can work w/o shader. Can only be set via AddAttribute().
 	GLint getShaderProgId() const { return m_shaderProgId; }
@@ -151,6 +156,45 @@ public:
 	void drawInstanced(size_t primcount, GLuint first=0, size_t count=0);
 	void drawInstancedBaseInstance(size_t primcount, size_t baseInst, GLuint first=0, size_t count=0);
 
+	//Immutable(Direct State Access) mode, requires GL 4.5.
+	//Bake the attribute layout into the VAO once with glVertexArrayAttribFormat()
+	//and glVertexArrayVertexBuffer(). Every distinct VBO among the attributes gets
+	//its own VAO-local binding index, see getImmutableBindingIndex().
+	//From then on draw*()/drawElements*() is a bind plus a draw call: no format
+	//re-specification, stride computation or enable check per draw.
+	//Only generic attributes added via addAttribute() are supported, not the
+	//compatibility client states(enableVertex/Color/Normal/Texture).
+	//Call disable() to leave immutable mode.
+	void enableImmutable();
+	bool isImmutable() const { return m_immutable; }
+	//VAO-local binding index assigned to vbo by enableImmutable(), -1 if none.
+	GLint getImmutableBindingIndex(const GLVertexBufferObjectRef& vbo) const;
+	//Rebind the buffer feeding VAO-local binding index bindingIndex while keeping
+	//the baked attribute format, so switching between meshes sharing the same
+	//layout is a single buffer rebind. stride 0 keeps the baked stride.
+	void setVertexBuffer(GLuint bindingIndex, const GLVertexBufferObjectRef& vbo,
+						 GLintptr offset=0, GLsizei stride=0);
+	//Attach the element buffer of an immutable VAO. Pending CPU indices of ibo
+	//are uploaded first, its index count becomes the default of drawElements().
+	void setElementBuffer(const std::shared_ptr<GLIndexBufferObject>& ibo);
+	//Indexed draw of an immutable VAO, in the index type of its element buffer.
+	//if count is 0, draw all indices of the attached element buffer.
+	void drawElements(size_t count=0, size_t firstIndex=0, GLint baseVertex=0);
+	void drawElementsInstanced(size_t primcount, size_t count=0, size_t firstIndex=0,
+							   GLint baseVertex=0, GLuint baseInst=0);
+	//Submit drawCount DrawElementsIndirectCommand records stored in the
+	//GL_DRAW_INDIRECT_BUFFER indirect, starting at byte offset, with a single
+	//glMultiDrawElementsIndirect() call. Requires an immutable VAO with an
+	//element buffer. stride 0 means tightly packed.
+	void multiDrawElementsIndirect(const GLBufferObject& indirect, GLsizei drawCount,
+								   GLintptr offset=0, GLsizei stride=0);
+	//Same as multiDrawElementsIndirect() but the actual number of draws is read
+	//by the GPU from the GLuint at byte drawCountOffset of parameter, clamped to
+	//maxDrawCount. Requires GL_ARB_indirect_parameters.
+	void multiDrawElementsIndirectCount(const GLBufferObject& indirect, const GLBufferObject& parameter,
+										GLsizei maxDrawCount, GLintptr offset=0,
+										GLintptr drawCountOffset=0, GLsizei stride=0);
+
 	std::shared_ptr<GLenum> getArrayId() const { return m_arrayId; }
 protected:
 	void checkEnable(size_t &count);
@@ -169,6 +213,9 @@ private:
 	void disableGLClientState();
 	GLuint computeStride();
 	void sanityCheckVBO();
+	void disableImmutable();
+	void checkImmutable(const char* caller);
+	void updateImmutableVertexCount();
 
 	GLVertexBufferObjectRef m_vboDefault;
 
@@ -206,6 +253,16 @@ private:
 	GLint	m_shaderProgId;
 	bool    m_enableWarning;
 
+	//Immutable(DSA) mode states, see enableImmutable().
+	bool   m_immutable;
+	size_t m_immutableVertexCount;
+	size_t m_immutableIndexCount;
+	std::vector<GLVertexBufferObjectRef> m_immutableBindings;//VAO-local binding index->VBO
+	std::vector<GLsizei> m_immutableStrides;
+	std::vector<GLuint>  m_immutableDivisors;
+	std::vector<GLint>   m_immutableLocations;//enabled attribute locations.
+	std::shared_ptr<GLIndexBufferObject> m_immutableIBO;
+
 //public:
 	std::unordered_map<GLenum, GLuint> g_GLTypeSizeInBytes;
 	float m_GLVersion;
@@ -0,0 +1,100 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_VERTEX_CACHE_OPTIMIZER_H_
+#define _GL_VERTEX_CACHE_OPTIMIZER_H_
+
+#if defined(__APPLE__) || defined(MACOSX)
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+#include <stddef.h>
+#include <vector>
+
+namespace davinci{
+
+//Cache statistics of an index list, simulated with a FIFO
+//post-transform cache of cacheSize entries.
+//acmr: vertex shader invocations per triangle(0.5 best, 3 worst).
+//atvr: vertex shader invocations per referenced vertex(1 best).
+struct GLVertexCacheReport
+{
+	float  acmrBefore, acmrAfter;
+	float  atvrBefore, atvrAfter;
+	size_t vertexCount;//referenced vertices after optimization.
+	bool   shortIndices;//true if the result fits GL_UNSIGNED_SHORT.
+	GLVertexCacheReport() :acmrBefore(0), acmrAfter(0), atvrBefore(0), atvrAfter(0),
+		vertexCount(0), shortIndices(false){}
+};
+
+//Reorders GL_TRIANGLES index lists for the post-transform vertex cache
+//(Tipsify, Sander et al. 2007) and renumbers vertices in first use order
+//for vertex fetch locality.
+class GLVertexCacheOptimizer
+{
+	GLVertexCacheOptimizer(void){};
+	~GLVertexCacheOptimizer(){};
+public:
+	static void analyze(const std::vector<GLuint>& indices, size_t vertexCount,
+						float& acmr, float& atvr, int cacheSize=16);
+
+	//Large meshes with coherent vertex ids(like the coordinate sorted output
+	//of GLTriangleCleaner) are cut into slabs of vertex ids, each ordered on
+	//its own thread. nThreads: 0 means std::thread::hardware_concurrency().
+	//Every index must be below vertexCount.
+	static void optimizeTriangleOrder(std::vector<GLuint>& indices, size_t vertexCount,
+									  int cacheSize=16, int nThreads=0);
+
+	//Renumbers vertices in the order indices first reference them and
+	//rewrites indices. remap[old] is the new index, or GL_INVALID_INDEX for
+	//unreferenced vertices, which are dropped. Returns the new vertex count.
+	static size_t optimizeVertexFetch(std::vector<GLuint>& indices, size_t vertexCount,
+									  std::vector<GLuint>& remap);
+
+	//Applies a remap of optimizeVertexFetch() to one vertex attribute array.
+	template<class T>
+	static void remapVertices(std::vector<T>& vertices, const std::vector<GLuint>& remap, size_t newCount)
+	{
+		std::vector<T> out(newCount);
+		for (size_t i = 0; i < remap.size() && i < vertices.size(); i++)
+			if (remap[i] != GL_INVALID_INDEX) out[remap[i]] = vertices[i];
+		vertices.swap(out);
+	}
+
+	//Both passes above, with the cache statistics before and after.
+	static GLVertexCacheReport optimize(std::vector<GLuint>& indices, size_t vertexCount,
+										std::vector<GLuint>& remap, int cacheSize=16, int nThreads=0);
+
+	//true if every index but restartIndex(when restart is used) is below
+	//0xFFFF, which is kept for the 16 bit restart index.
+	static bool fitsShortIndices(const std::vector<GLuint>& indices,
+								 bool useRestart=false, GLuint restartIndex=0);
+};
+
+}
+#endif
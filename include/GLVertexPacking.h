@@ -0,0 +1,93 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_VERTEX_PACKING_H_
+#define _GL_VERTEX_PACKING_H_
+
+#include <stddef.h>
+#include <vector>
+#if defined(__APPLE__) || defined(MACOSX)
+#include <OpenGL/gl3.h>
+#else
+#include <GL/glew.h>
+#endif
+#include "vec2f.h"
+#include "vec3f.h"
+#include "vec4f.h"
+#include "BBox.h"
+
+namespace davinci{
+
+//Converts float vertex streams (one std::vector per attribute) into
+//compact GPU formats. Conversion is done in parallel chunks with SSE2 where
+//available. Describe the result with GLAttribute(progId, name, format).
+class GLVertexPacking
+{
+public:
+	enum Format{
+		PACK_FLOAT3,              //12 bytes, unchanged vec3f.
+		PACK_POSITION_HALF,       //8 bytes, 3 half floats + pad, (p-center)/halfExtent of a BBox.
+		PACK_POSITION_UNORM16,    //8 bytes, 3 normalized ushorts + pad, (p-pMin)/dimension of a BBox.
+		PACK_NORMAL_2_10_10_10,   //4 bytes, GL_INT_2_10_10_10_REV signed normalized, w=0.
+		PACK_NORMAL_OCT16,        //4 bytes, octahedral map in 2 normalized shorts, see getDecodeGLSL().
+		PACK_COLOR_UNORM8,        //4 bytes, rgba normalized ubytes.
+		PACK_COLOR_UNORM16,       //8 bytes, rgba normalized ushorts.
+		PACK_TEXCOORD_UNORM16,    //4 bytes, 2 normalized ushorts, uv must lie in [0,1].
+		PACK_TEXCOORD_HALF        //4 bytes, 2 half floats, any range.
+	};
+
+	static GLuint getStride(Format format);
+	static GLenum getType(Format format);
+	static GLuint getComponents(Format format);
+	static bool   isNormalized(Format format);
+
+	//dst is resized to src.size()*getStride(format) bytes, ready for
+	//GLVertexBufferObject::upload(dst.size(), src.size(), dst.data()).
+	//nThreads: 0 means std::thread::hardware_concurrency().
+	static void packPositions(const std::vector<vec3f>& src, const BBox& box, Format format,
+							  std::vector<unsigned char>& dst, int nThreads=0);
+	//Normals are expected to be unit length.
+	static void packNormals(const std::vector<vec3f>& src, Format format,
+							std::vector<unsigned char>& dst, int nThreads=0);
+	static void packColors(const std::vector<vec4f>& src, Format format,
+						   std::vector<unsigned char>& dst, int nThreads=0);
+	static void packTexCoords(const std::vector<vec2f>& src, Format format,
+							  std::vector<unsigned char>& dst, int nThreads=0);
+
+	//The vertex shader restores positions with p = attrib.xyz*scale + bias.
+	static void getPositionDecode(const BBox& box, Format format, vec3f& scale, vec3f& bias);
+	//GLSL source of vec3 decodeOctahedral(vec2 e) for PACK_NORMAL_OCT16,
+	//to be pasted into the vertex shader after the #version line.
+	static const char* getDecodeGLSL();
+
+	//Round to nearest even, overflow goes to infinity.
+	static GLushort floatToHalf(float f);
+	static float    halfToFloat(GLushort h);
+};
+
+}
+#endif
@@ -77,6 +77,29 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 #include <GLStereoCamera.h>
 #include <GLContext.h>
 #include <GLAttribute.h>
+#include <GLDrawBatch.h>
+#include <GLDrawCuller.h>
+#include <GLFrustum.h>
+#include <GLTriangleBVH.h>
+#include <GLMeshDistance.h>
+#include <GLIsosurface.h>
+#include <GLMeshSimplifier.h>
+#include <GLVertexCacheOptimizer.h>
+#include <GLMeshlet.h>
+#include <GLMeshletCuller.h>
+#include <GLMeshConnectivity.h>
+#include <GLVertexPacking.h>
+#include <GLBufferHeap.h>
+#include <GLSupersampler.h>
+#include <GLRenderTargetPool.h>
+#include <GLTiledRenderer.h>
+#include <GLFrameCapture.h>
+#include <GLDynamicResolution.h>
+#include <GLProgressiveVolumeRenderer.h>
+#include <GLMacroCellGrid.h>
+#ifdef USE_MPI
+#include <GLImageCompositor.h>
+#endif
 
 #define ENABLE_TEXT_RENDERING
 #include <GLFont.h>
@@ -38,21 +38,19 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 #include <iostream>
 #include <assert.h>
 #include <cstring>
+#include <climits>
+#include <vector>
+#include <algorithm>
 
 namespace davinci{
 
 template <typename T>
 inline void swapxor(T &left, T &right)
 {
-    if (&left != &right){
-        (int&)left  ^= (int&)right;
-        (int&)right ^= (int&)left;
-        (int&)left  ^= (int&)right;
-    }
-
-//     T tmp = left;
-//     left = right;
-//     right = tmp;
+    //xor through int& only swapped the low 32 bits of pointers and size_t.
+    T tmp = left;
+    left = right;
+    right = tmp;
 }
 
 template<typename T>
@@ -95,41 +93,80 @@ public:
     void remove_duplicates(int (*comp)(const void *, const void *));
     void substract(const svector<T>& vec1, const svector<T>& vec2, int (*comp)(const void*, const void*) );//remove the elements appear in vec from *this
 
-#ifndef MPI_INCLUDED
-#define MPI_COMM_WORLD ((int)0x44000000)
+#ifdef USE_MPI
+    //MPI collectives. The element datatype comes from svector_mpi_datatype<T>,
+    //counts are size_t and vectors beyond the int range of MPI counts, or
+    //beyond svector_mpi_chunk_bytes(), are moved as pipelined chunks of
+    //non-blocking operations with svector_mpi_pipeline_depth() in flight.
+    //Reductions need T to map onto a predefined MPI datatype.
+
     //************************************
-    // Method:    mpi_allreduce
+    // Method:    mpi_reduce
     // Description: Reduce the svector<T> from all the PEs that belongs to the communicator.
-    // The svector<T> which invoke the method is both send and receive buffer.
+    // The svector<T> which invoke the method is both send and receive buffer,
+    // all PEs must hold the same number of elements.
     // Parameter: int root: Specify the PE id, which will obtain the reduced results.
-    // Parameter: int mpi_datatype
-    // Parameter: int communicator
+    // Parameter: MPI_Op op
+    // Parameter: MPI_Comm communicator
     //************************************
-    void mpi_reduce(int root, int mpi_datatype, int op, int communicator = MPI_COMM_WORLD);
+    void mpi_reduce(int root, MPI_Op op, MPI_Comm communicator = MPI_COMM_WORLD);
     //************************************
     // Method:    mpi_reduce
-    // Description: Reduce the svector<T> from all the PEs that belongs to the communicator.
-    // The svector<T> which invoke the method is the receive buffer. Make sure the it is initialized
-    // with the size at least a big as the one of send_vector, and initialized with appropriated initial value.
+    // Description: Reduce send_vector from all the PEs that belongs to the communicator
+    // into the svector<T> which invoke the method on root, which is resized to
+    // the size of send_vector.
     // Parameter: int root
-    // Parameter: svector<T> & send_vector
-    // Parameter: int mpi_datatype
-    // Parameter: int op
-    // Parameter: int communicator
+    // Parameter: const svector<T> & send_vector
+    // Parameter: MPI_Op op
+    // Parameter: MPI_Comm communicator
     //************************************
-    void mpi_reduce(int root, svector<T>& send_vector, int mpi_datatype, int op, int communicator = MPI_COMM_WORLD);
+    void mpi_reduce(int root, const svector<T>& send_vector, MPI_Op op, MPI_Comm communicator = MPI_COMM_WORLD);
+    //************************************
+    // Method:    mpi_allreduce
+    // Description: In place reduction whose result is left on every PE.
+    // Parameter: MPI_Op op
+    // Parameter: MPI_Comm communicator
+    //************************************
+    void mpi_allreduce(MPI_Op op, MPI_Comm communicator = MPI_COMM_WORLD);
     //************************************
     // Method:    mpi_allgatherv
     // Description: Gather svector<T> with different length from all PE within the communicator.
     // Parameter: const svector<T> & input_array
-    // Parameter: svector<int> & count_array
-    // Parameter: svector<int> & displace_array
-    // Parameter: int mpi_datatype
-    // Parameter: int communicator
+    // Parameter: svector<size_t> & count_array: receives the element count of every PE.
+    // Parameter: svector<size_t> & displace_array: receives where each PE's elements start.
+    // Parameter: MPI_Comm communicator
+    //************************************
+    void mpi_allgatherv(const svector<T>& input_array, svector<size_t>& count_array,
+                        svector<size_t>& displace_array, MPI_Comm communicator = MPI_COMM_WORLD);
+    //************************************
+    // Method:    mpi_alltoallv
+    // Description: Personalized all-to-all exchange. send_vector holds the elements
+    // for PE 0, then PE 1 and so on, send_counts[i] of them for PE i. The svector<T>
+    // which invoke the method receives the elements from all PEs in PE order.
+    // Parameter: const svector<T> & send_vector
+    // Parameter: const svector<size_t> & send_counts
+    // Parameter: svector<size_t> & recv_counts: receives how many elements came from each PE.
+    // Parameter: MPI_Comm communicator
+    //************************************
+    void mpi_alltoallv(const svector<T>& send_vector, const svector<size_t>& send_counts,
+                       svector<size_t>& recv_counts, MPI_Comm communicator = MPI_COMM_WORLD);
+    //************************************
+    // Method:    mpi_scatterv
+    // Description: root sends counts[i] consecutive elements of send_vector to PE i,
+    // the svector<T> which invoke the method receives them. send_vector and
+    // counts are only read on root.
+    // Parameter: int root
+    // Parameter: const svector<T> & send_vector
+    // Parameter: const svector<size_t> & counts
+    // Parameter: MPI_Comm communicator
+    //************************************
+    void mpi_scatterv(int root, const svector<T>& send_vector, const svector<size_t>& counts,
+                      MPI_Comm communicator = MPI_COMM_WORLD);
+    //************************************
+    // Method:    mpi_scatter
+    // Description: mpi_scatterv() with send_vector split into near equal blocks.
     //************************************
-    void mpi_allgatherv(const svector<T>& input_array, svector<int>& count_array,
-                       svector<int>& displace_array, int mpi_datatype,
-                       int communicator=MPI_COMM_WORLD);
+    void mpi_scatter(int root, const svector<T>& send_vector, MPI_Comm communicator = MPI_COMM_WORLD);
 #endif
 
     T&	operator [](size_t i);
@@ -144,7 +181,6 @@ public:
     friend std::istream& operator >> ( std::istream& in, svector<T2> &t);
 };
 
-#ifdef USE_MPI
 template<typename T>
 void svector<T>::substract(const svector<T>& vec1, const svector<T>& vec2, int (*comp)(const void*, const void*) )
 {
@@ -169,13 +205,6 @@ void svector<T>::substract(const svector<T>& vec1, const svector<T>& vec2, int (
         push_back(vec1[i++]);
     }
 }
-#else
-template<typename T>
-void svector<T>::substract(const svector<T>& vec1, const svector<T>& vec2, int (*comp)(const void*, const void*) )
-{
-    D_ASSERT(0, "Method:svector<T>::mpi_allgatherv not implemented!\n",DERROR_ERR_MEM);
-}
-#endif
 
 template<typename T>
 void svector<T>::clone( const svector<T>& vec, bool is_profiling/*=false*/ )
@@ -201,96 +230,394 @@ void svector<T>::clone( const svector<T>& vec, bool is_profiling/*=false*/ )
 }
 
 #ifdef USE_MPI
+//MPI datatype of the elements of svector<T> collectives. Types without a
+//predefined datatype travel as opaque bytes; specialize it to give them a
+//real one, with predefined = true if MPI reductions apply to it.
 template<typename T>
-void svector<T>::mpi_allgatherv( const svector<T>& input_array, svector<int>& count_array,
-                                svector<int>& displace_array, int mpi_datatype,
-                                int communicator/*=MPI_COMM_WORLD*/ )
+struct svector_mpi_datatype
 {
-    //svector<int> count_array;//send size array
-    //svector<int> displace_array;//displacement array.
-    //svector<int> send_gather;//array for all gathered leaf node indices.
-    int  local_count = input_array.size();
-    int groupsize = 0, myid = -1;
-    MPI_Comm_rank(communicator, &myid);
-    MPI_Comm_size(communicator, &groupsize);
+    static const bool predefined = false;
+    static MPI_Datatype get()
+    {
+        static MPI_Datatype type = MPI_DATATYPE_NULL;
+        if (type == MPI_DATATYPE_NULL){
+            MPI_Type_contiguous((int)sizeof(T), MPI_BYTE, &type);
+            MPI_Type_commit(&type);
+        }
+        return type;
+    }
+};
 
-    count_array.resize(groupsize, 0);
-    //1. gather how many ints each processor is going to send in step 2.
-    MPI_Allgather(&local_count, 1, mpi_datatype, count_array.data_ptr(), 1, mpi_datatype, communicator);
+#define SVECTOR_MPI_PREDEFINED(ctype, mpitype) \
+template<> struct svector_mpi_datatype<ctype> {\
+    static const bool predefined = true;\
+    static MPI_Datatype get() { return mpitype; }\
+};
+SVECTOR_MPI_PREDEFINED(char, MPI_CHAR)
+SVECTOR_MPI_PREDEFINED(signed char, MPI_SIGNED_CHAR)
+SVECTOR_MPI_PREDEFINED(unsigned char, MPI_UNSIGNED_CHAR)
+SVECTOR_MPI_PREDEFINED(short, MPI_SHORT)
+SVECTOR_MPI_PREDEFINED(unsigned short, MPI_UNSIGNED_SHORT)
+SVECTOR_MPI_PREDEFINED(int, MPI_INT)
+SVECTOR_MPI_PREDEFINED(unsigned int, MPI_UNSIGNED)
+SVECTOR_MPI_PREDEFINED(long, MPI_LONG)
+SVECTOR_MPI_PREDEFINED(unsigned long, MPI_UNSIGNED_LONG)
+SVECTOR_MPI_PREDEFINED(long long, MPI_LONG_LONG)
+SVECTOR_MPI_PREDEFINED(unsigned long long, MPI_UNSIGNED_LONG_LONG)
+SVECTOR_MPI_PREDEFINED(float, MPI_FLOAT)
+SVECTOR_MPI_PREDEFINED(double, MPI_DOUBLE)
+SVECTOR_MPI_PREDEFINED(long double, MPI_LONG_DOUBLE)
+#undef SVECTOR_MPI_PREDEFINED
+
+//Largest single message of the svector collectives in bytes.
+inline size_t& svector_mpi_chunk_bytes()
+{
+    static size_t bytes = size_t(64) << 20;
+    return bytes;
+}
 
-    displace_array.resize(groupsize, 0);
-    displace_array[0] = 0;
-    for (int iPE = 1; iPE < groupsize ; iPE++){
-        displace_array[iPE] = displace_array[iPE-1] + count_array[iPE-1];
-    }
-    this->resize(displace_array[groupsize-1]+count_array[groupsize-1], -1);//
-    //2.Gather leaf node assignment from all processor, so that every processor
-    //has a copy of this gathered information.
-    MPI_Allgatherv( input_array.data_ptr(),//assigned local leaf node array of current PE
-                    local_count,//send element count for current PE
-                    mpi_datatype,//send element type
-                    this->data_ptr(),//receive buffer address
-                    count_array.data_ptr(),//receive element counts from each PE.
-                    displace_array.data_ptr(),//displacement in receive buffer for each PE.
-                    mpi_datatype,
-                    communicator);
+//Chunks in flight per direction when a message is split.
+inline int& svector_mpi_pipeline_depth()
+{
+    static int depth = 4;
+    return depth;
 }
 
+namespace svector_mpi{
+
+const int TAG = 7717;
+
 template<typename T>
-void svector<T>::mpi_reduce( int root, int mpi_datatype, int op, int communicator /*= MPI_COMM_WORLD*/ )
+size_t chunk_elements()
 {
-    int rank=-1;
-    MPI_Comm_rank(communicator, &rank);
-    int err;
-    if (rank == root)
-    {
-        err = MPI_Reduce(MPI_IN_PLACE, data_ptr(), size(), mpi_datatype, op, root, communicator);
-    }else
-    {
-        err = MPI_Reduce(data_ptr(), NULL, size(), mpi_datatype, op, root, communicator);
-    }
+    size_t n = svector_mpi_chunk_bytes() / sizeof(T);
+    return std::max<size_t>(1, std::min<size_t>(n, INT_MAX));
+}
 
-    if (err != MPI_SUCCESS)
-    {
+inline void check(int err, MPI_Comm communicator, const char* method)
+{
+    if (err != MPI_SUCCESS){
+        int rank = -1;
+        MPI_Comm_rank(communicator, &rank);
         char msg[128];
-        sprintf(msg, "svector<T>::mpi_reduce failed!");
+        sprintf(msg, "svector<T>::%s failed!\n", method);
         D_P_MSG(rank, rank, msg);
     }
 }
 
+//Ring of request slots, a slot is completed before it is reused.
+class request_window
+{
+public:
+    request_window() : m_reqs(std::max(svector_mpi_pipeline_depth(), 1), MPI_REQUEST_NULL), m_next(0) {}
+    ~request_window() { wait_all(); }
+    MPI_Request* next()
+    {
+        MPI_Request* req = &m_reqs[m_next];
+        m_next = (m_next + 1) % m_reqs.size();
+        MPI_Wait(req, MPI_STATUS_IGNORE);
+        return req;
+    }
+    void wait_all() { MPI_Waitall((int)m_reqs.size(), &m_reqs[0], MPI_STATUSES_IGNORE); }
+private:
+    std::vector<MPI_Request> m_reqs;
+    size_t m_next;
+};
+
+//Sends send_count elements to dest while receiving recv_count from source,
+//both split into chunks. Receives and sends are interleaved so two PEs
+//exchanging with each other never wait on a chunk the other has not posted.
+template<typename T>
+void exchange(const T* send_ptr, size_t send_count, int dest,
+              T* recv_ptr, size_t recv_count, int source, MPI_Comm communicator)
+{
+    MPI_Datatype type = svector_mpi_datatype<T>::get();
+    size_t chunk = chunk_elements<T>();
+    size_t n_send = (send_count + chunk - 1) / chunk;
+    size_t n_recv = (recv_count + chunk - 1) / chunk;
+    request_window sends, recvs;
+    for (size_t i = 0; i < std::max(n_send, n_recv); i++){
+        size_t offset = i * chunk;
+        if (i < n_recv){
+            int count = (int)std::min(chunk, recv_count - offset);
+            check(MPI_Irecv(recv_ptr + offset, count, type, source, TAG, communicator, recvs.next()),
+                  communicator, "mpi_exchange");
+        }
+        if (i < n_send){
+            int count = (int)std::min(chunk, send_count - offset);
+            check(MPI_Isend(const_cast<T*>(send_ptr + offset), count, type, dest, TAG, communicator, sends.next()),
+                  communicator, "mpi_exchange");
+        }
+    }
+    recvs.wait_all();
+    sends.wait_all();
+}
+
+//Exclusive prefix sum of counts, false if any count or the total exceeds
+//what one collective call should carry.
+inline bool prefix_sum(const std::vector<unsigned long long>& counts, std::vector<size_t>& displs,
+                       size_t& total, size_t chunk)
+{
+    bool fits = true;
+    displs.resize(counts.size());
+    total = 0;
+    for (size_t i = 0; i < counts.size(); i++){
+        displs[i] = total;
+        total += size_t(counts[i]);
+        if (counts[i] > chunk || total > INT_MAX)
+            fits = false;
+    }
+    return fits;
+}
+
+}//end of namespace svector_mpi
+
 template<typename T>
-void svector<T>::mpi_reduce( int root, svector<T>& send_vector, int mpi_datatype, int op, int communicator /*= MPI_COMM_WORLD*/ )
+void svector<T>::mpi_reduce( int root, MPI_Op op, MPI_Comm communicator /*= MPI_COMM_WORLD*/ )
 {
-    int err = MPI_Reduce(send_vector.data_ptr(), data_ptr(), size(), mpi_datatype, op, root, communicator);
+    D_ASSERT(svector_mpi_datatype<T>::predefined,
+             "svector<T>::mpi_reduce: T has no predefined MPI datatype!\n", DERROR_ERR_COMM);
     int rank = -1;
     MPI_Comm_rank(communicator, &rank);
-    if (err != MPI_SUCCESS)
-    {
-        char msg[128];
-        sprintf(msg, "svector<T>::mpi_reduce failed!");
-        D_P_MSG(rank, rank, msg);
+    MPI_Datatype type = svector_mpi_datatype<T>::get();
+    size_t chunk = svector_mpi::chunk_elements<T>();
+    svector_mpi::request_window window;
+    for (size_t offset = 0; offset < size(); offset += chunk){
+        int count = (int)std::min(chunk, size() - offset);
+        T* ptr = data_ptr() + offset;
+        int err = rank == root ?
+            MPI_Ireduce(MPI_IN_PLACE, ptr, count, type, op, root, communicator, window.next()) :
+            MPI_Ireduce(ptr, NULL, count, type, op, root, communicator, window.next());
+        svector_mpi::check(err, communicator, "mpi_reduce");
     }
+    window.wait_all();
 }
-#else
+
 template<typename T>
-void svector<T>::mpi_allgatherv( const svector<T>& input_array, svector<int>& count_array,
-    svector<int>& displace_array, int mpi_datatype,
-    int communicator/*=MPI_COMM_WORLD*/ )
+void svector<T>::mpi_reduce( int root, const svector<T>& send_vector, MPI_Op op, MPI_Comm communicator /*= MPI_COMM_WORLD*/ )
 {
-    fprintf(stderr, "svector<T>::mpi_allgatherv not implemented in none MPI program, use #define USE_MPI to enable its implementation!\n");
-    fflush(stderr);
+    D_ASSERT(svector_mpi_datatype<T>::predefined,
+             "svector<T>::mpi_reduce: T has no predefined MPI datatype!\n", DERROR_ERR_COMM);
+    int rank = -1;
+    MPI_Comm_rank(communicator, &rank);
+    if (rank == root){
+        resize(send_vector.size());
+    }
+    MPI_Datatype type = svector_mpi_datatype<T>::get();
+    size_t chunk = svector_mpi::chunk_elements<T>();
+    svector_mpi::request_window window;
+    for (size_t offset = 0; offset < send_vector.size(); offset += chunk){
+        int count = (int)std::min(chunk, send_vector.size() - offset);
+        T* recv_ptr = rank == root ? data_ptr() + offset : NULL;
+        svector_mpi::check(MPI_Ireduce(send_vector.data_ptr() + offset, recv_ptr, count, type, op, root,
+                                       communicator, window.next()),
+                           communicator, "mpi_reduce");
+    }
+    window.wait_all();
 }
+
 template<typename T>
-void svector<T>::mpi_reduce( int root, svector<T>& send_vector, int mpi_datatype, int op, int communicator /*= MPI_COMM_WORLD*/ )
+void svector<T>::mpi_allreduce( MPI_Op op, MPI_Comm communicator /*= MPI_COMM_WORLD*/ )
 {
-    fprintf(stderr, "svector<T>::mpi_reduce not implemented in none MPI program, use #define USE_MPI to enable its implementation!\n");
-    fflush(stderr);
+    D_ASSERT(svector_mpi_datatype<T>::predefined,
+             "svector<T>::mpi_allreduce: T has no predefined MPI datatype!\n", DERROR_ERR_COMM);
+    MPI_Datatype type = svector_mpi_datatype<T>::get();
+    size_t chunk = svector_mpi::chunk_elements<T>();
+    svector_mpi::request_window window;
+    for (size_t offset = 0; offset < size(); offset += chunk){
+        int count = (int)std::min(chunk, size() - offset);
+        svector_mpi::check(MPI_Iallreduce(MPI_IN_PLACE, data_ptr() + offset, count, type, op,
+                                          communicator, window.next()),
+                           communicator, "mpi_allreduce");
+    }
+    window.wait_all();
 }
+
 template<typename T>
-void svector<T>::mpi_reduce( int root, int mpi_datatype, int op, int communicator /*= MPI_COMM_WORLD*/ )
+void svector<T>::mpi_allgatherv( const svector<T>& input_array, svector<size_t>& count_array,
+                                 svector<size_t>& displace_array, MPI_Comm communicator /*= MPI_COMM_WORLD*/ )
 {
-    fprintf(stderr, "svector<T>::mpi_reduce not implemented in none MPI program, use #define USE_MPI to enable its implementation!\n");
-    fflush(stderr);
+    if (&input_array == this){
+        svector<T> input;
+        input.clone(input_array);
+        mpi_allgatherv(input, count_array, displace_array, communicator);
+        return;
+    }
+    int groupsize = 0, myid = -1;
+    MPI_Comm_rank(communicator, &myid);
+    MPI_Comm_size(communicator, &groupsize);
+    //1. gather how many elements each PE is going to send in step 2.
+    unsigned long long local_count = input_array.size();
+    std::vector<unsigned long long> counts(groupsize);
+    svector_mpi::check(MPI_Allgather(&local_count, 1, MPI_UNSIGNED_LONG_LONG, &counts[0], 1,
+                                     MPI_UNSIGNED_LONG_LONG, communicator),
+                       communicator, "mpi_allgatherv");
+    std::vector<size_t> displs;
+    size_t total = 0;
+    bool fits = svector_mpi::prefix_sum(counts, displs, total, svector_mpi::chunk_elements<T>());
+    count_array.resize(groupsize);
+    displace_array.resize(groupsize);
+    for (int iPE = 0; iPE < groupsize; iPE++){
+        count_array[iPE] = size_t(counts[iPE]);
+        displace_array[iPE] = displs[iPE];
+    }
+    this->resize(total);
+
+    MPI_Datatype type = svector_mpi_datatype<T>::get();
+    if (fits){
+        std::vector<int> icounts(counts.begin(), counts.end()), idispls(displs.begin(), displs.end());
+        svector_mpi::check(MPI_Allgatherv(input_array.data_ptr(), (int)local_count, type, data_ptr(),
+                                          &icounts[0], &idispls[0], type, communicator),
+                           communicator, "mpi_allgatherv");
+        return;
+    }
+    //2. ring: in step s every PE forwards the block it got in step s-1 to
+    //its right neighbor, chunked and pipelined.
+    if (local_count){
+        memcpy(data_ptr() + displs[myid], input_array.data_ptr(), size_t(local_count) * sizeof(T));
+    }
+    int right = (myid + 1) % groupsize, left = (myid - 1 + groupsize) % groupsize;
+    for (int step = 0; step < groupsize - 1; step++){
+        int send_block = (myid - step + groupsize) % groupsize;
+        int recv_block = (myid - step - 1 + groupsize) % groupsize;
+        svector_mpi::exchange(data_ptr() + displs[send_block], size_t(counts[send_block]), right,
+                              data_ptr() + displs[recv_block], size_t(counts[recv_block]), left,
+                              communicator);
+    }
+}
+
+template<typename T>
+void svector<T>::mpi_alltoallv( const svector<T>& send_vector, const svector<size_t>& send_counts,
+                                svector<size_t>& recv_counts, MPI_Comm communicator /*= MPI_COMM_WORLD*/ )
+{
+    if (&send_vector == this){
+        svector<T> input;
+        input.clone(send_vector);
+        mpi_alltoallv(input, send_counts, recv_counts, communicator);
+        return;
+    }
+    int groupsize = 0, myid = -1;
+    MPI_Comm_rank(communicator, &myid);
+    MPI_Comm_size(communicator, &groupsize);
+    D_ASSERT((int)send_counts.size() == groupsize,
+             "svector<T>::mpi_alltoallv: send_counts needs one entry per PE!\n", DERROR_ERR_COMM);
+    std::vector<unsigned long long> scounts(groupsize), rcounts(groupsize);
+    for (int iPE = 0; iPE < groupsize; iPE++){
+        scounts[iPE] = send_counts[iPE];
+    }
+    svector_mpi::check(MPI_Alltoall(&scounts[0], 1, MPI_UNSIGNED_LONG_LONG, &rcounts[0], 1,
+                                    MPI_UNSIGNED_LONG_LONG, communicator),
+                       communicator, "mpi_alltoallv");
+    size_t chunk = svector_mpi::chunk_elements<T>();
+    std::vector<size_t> sdispls, rdispls;
+    size_t send_total = 0, recv_total = 0;
+    bool fits = svector_mpi::prefix_sum(scounts, sdispls, send_total, chunk);
+    fits = svector_mpi::prefix_sum(rcounts, rdispls, recv_total, chunk) && fits;
+    D_ASSERT(send_total <= send_vector.size(),
+             "svector<T>::mpi_alltoallv: send_counts exceed send_vector!\n", DERROR_ERR_COMM);
+    //every PE has to take the same path.
+    int local_fits = fits ? 1 : 0, all_fit = 0;
+    svector_mpi::check(MPI_Allreduce(&local_fits, &all_fit, 1, MPI_INT, MPI_MIN, communicator),
+                       communicator, "mpi_alltoallv");
+    recv_counts.resize(groupsize);
+    for (int iPE = 0; iPE < groupsize; iPE++){
+        recv_counts[iPE] = size_t(rcounts[iPE]);
+    }
+    this->resize(recv_total);
+
+    MPI_Datatype type = svector_mpi_datatype<T>::get();
+    if (all_fit){
+        std::vector<int> isc(scounts.begin(), scounts.end()), isd(sdispls.begin(), sdispls.end());
+        std::vector<int> irc(rcounts.begin(), rcounts.end()), ird(rdispls.begin(), rdispls.end());
+        svector_mpi::check(MPI_Alltoallv(send_vector.data_ptr(), &isc[0], &isd[0], type,
+                                         data_ptr(), &irc[0], &ird[0], type, communicator),
+                           communicator, "mpi_alltoallv");
+        return;
+    }
+    //pairwise exchange, in step s PE i sends to i+s and receives from i-s.
+    if (scounts[myid]){
+        memcpy(data_ptr() + rdispls[myid], send_vector.data_ptr() + sdispls[myid], size_t(scounts[myid]) * sizeof(T));
+    }
+    for (int step = 1; step < groupsize; step++){
+        int dest = (myid + step) % groupsize, source = (myid - step + groupsize) % groupsize;
+        svector_mpi::exchange(send_vector.data_ptr() + sdispls[dest], size_t(scounts[dest]), dest,
+                              data_ptr() + rdispls[source], size_t(rcounts[source]), source,
+                              communicator);
+    }
+}
+
+template<typename T>
+void svector<T>::mpi_scatterv( int root, const svector<T>& send_vector, const svector<size_t>& counts,
+                               MPI_Comm communicator /*= MPI_COMM_WORLD*/ )
+{
+    int groupsize = 0, myid = -1;
+    MPI_Comm_rank(communicator, &myid);
+    MPI_Comm_size(communicator, &groupsize);
+    if (myid == root && &send_vector == this){
+        svector<T> input;
+        input.clone(send_vector);
+        mpi_scatterv(root, input, counts, communicator);
+        return;
+    }
+    //every PE learns all counts so all take the same path.
+    std::vector<unsigned long long> all_counts(groupsize, 0);
+    if (myid == root){
+        D_ASSERT((int)counts.size() == groupsize,
+                 "svector<T>::mpi_scatterv: counts needs one entry per PE!\n", DERROR_ERR_COMM);
+        for (int iPE = 0; iPE < groupsize; iPE++){
+            all_counts[iPE] = counts[iPE];
+        }
+    }
+    svector_mpi::check(MPI_Bcast(&all_counts[0], groupsize, MPI_UNSIGNED_LONG_LONG, root, communicator),
+                       communicator, "mpi_scatterv");
+    std::vector<size_t> displs;
+    size_t total = 0;
+    bool fits = svector_mpi::prefix_sum(all_counts, displs, total, svector_mpi::chunk_elements<T>());
+    if (myid == root){
+        D_ASSERT(total <= send_vector.size(),
+                 "svector<T>::mpi_scatterv: counts exceed send_vector!\n", DERROR_ERR_COMM);
+    }
+    this->resize(size_t(all_counts[myid]));
+
+    MPI_Datatype type = svector_mpi_datatype<T>::get();
+    if (fits){
+        std::vector<int> icounts(all_counts.begin(), all_counts.end()), idispls(displs.begin(), displs.end());
+        svector_mpi::check(MPI_Scatterv(myid == root ? send_vector.data_ptr() : NULL, &icounts[0], &idispls[0], type,
+                                        data_ptr(), icounts[myid], type, root, communicator),
+                           communicator, "mpi_scatterv");
+        return;
+    }
+    if (myid == root){
+        if (all_counts[myid]){
+            memcpy(data_ptr(), send_vector.data_ptr() + displs[myid], size_t(all_counts[myid]) * sizeof(T));
+        }
+        for (int step = 1; step < groupsize; step++){
+            int dest = (root + step) % groupsize;
+            svector_mpi::exchange(send_vector.data_ptr() + displs[dest], size_t(all_counts[dest]), dest,
+                                  (T*)NULL, 0, MPI_PROC_NULL, communicator);
+        }
+    }else{
+        svector_mpi::exchange((const T*)NULL, 0, MPI_PROC_NULL,
+                              data_ptr(), size_t(all_counts[myid]), root, communicator);
+    }
+}
+
+template<typename T>
+void svector<T>::mpi_scatter( int root, const svector<T>& send_vector, MPI_Comm communicator /*= MPI_COMM_WORLD*/ )
+{
+    int groupsize = 0, myid = -1;
+    MPI_Comm_rank(communicator, &myid);
+    MPI_Comm_size(communicator, &groupsize);
+    svector<size_t> counts;
+    if (myid == root){
+        //near equal blocks as BLOCK_LOW, in integer arithmetic.
+        unsigned long long n = send_vector.size();
+        counts.resize(groupsize);
+        for (int iPE = 0; iPE < groupsize; iPE++){
+            counts[iPE] = size_t(n * (iPE + 1) / groupsize - n * iPE / groupsize);
+        }
+    }
+    mpi_scatterv(root, send_vector, counts, communicator);
 }
 #endif
 
@@ -610,17 +937,15 @@ void svector<T>::resize( size_t newSize, bool is_profiling/*=false*/  )
 template<typename T>
 void svector<T>::resize( size_t newSize,const T& val )
 {
-    //if newSize == m_size, do nothing.
-    if (newSize < m_size){
+    //capacity follows newSize; new elements are set to val, including
+    //when reserve() already provided the capacity.
+    if (newSize != m_size){
         reserve(newSize);
-    }else if (newSize > m_size){
-        reserve(newSize);
-        T* tmp = &m_data[m_count];
-        for (int i = 0; i < newSize-m_count ; i++){
-            tmp[i] = val;
-        }
-        m_count = newSize;
     }
+    for (size_t i = m_count; i < newSize; i++){
+        m_data[i] = val;
+    }
+    m_count = newSize;
 }
 
 template<typename T>
@@ -45,8 +45,8 @@ vec3 raySphareIntersection(vec3 center, float radius2, vec3 ray_o, vec3 ray_dir)
 vec3 rayBoxIntersection(vec3 rayStart, vec3 rayDir, vec3 bottomLeft, vec3 topRight)
 {
 	//more compact version
-	vec3 txyzMin = (b.pMin - eye_o) / dir;
-	vec3 txyzMax = (b.pMax - eye_o) / dir;
+	vec3 txyzMin = (bottomLeft - rayStart) / rayDir;
+	vec3 txyzMax = (topRight - rayStart) / rayDir;
 	vec3 txyzEntry = min(txyzMin, txyzMax);
 	vec3 txyzExit = max(txyzMin, txyzMax);
 	float tentry = max(max(txyzEntry.x, txyzEntry.y), txyzEntry.z);
@@ -148,4 +148,38 @@ float scale(float fCos)
 {
 	float x = 1.0 - fCos;
 	return fScaleDepth * exp(-0.00287 + x*(0.459 + x*(3.83 + x*(-6.80 + x*5.25))));
-}
\ No newline at end of file
+}
+
+//Empty space skipping over a GLMacroCellGrid occupancy texture.
+//ro, rd: ray in volume texture coordinates, t..tEnd: the interval to march.
+//cellScale: GLMacroCellGrid::getCellScale(), texture coordinates to cell units.
+//return: (entry, exit) distance of the first occupied cell, or vec2(tEnd)
+//if the rest of the ray is empty. Snap the entry to your step grid so skipping
+//does not shift the samples.
+vec2 macroCellDDA(sampler3D macroCells, vec3 cellScale, vec3 ro, vec3 rd, float t, float tEnd)
+{
+	ivec3 grid = textureSize(macroCells, 0);
+	vec3 p = (ro + rd * t) * cellScale;
+	vec3 d = rd * cellScale;
+	ivec3 cell = clamp(ivec3(floor(p)), ivec3(0), grid - 1);
+	ivec3 stp = ivec3(sign(d));
+	vec3 invD = 1.0 / max(abs(d), vec3(1e-30));
+	//distance along the ray to the next cell boundary on each axis.
+	vec3 tMax = t + (step(0.0, d) * (vec3(cell) + 1.0 - p) + step(d, vec3(0.0)) * (p - vec3(cell))) * invD;
+	tMax = mix(vec3(1e30), tMax, notEqual(stp, ivec3(0)));
+	vec3 tDelta = invD;
+	for (int i = 0; i < 512 && t < tEnd; i++)
+	{
+		float tNext = min(min(tMax.x, tMax.y), tMax.z);
+		if (texelFetch(macroCells, cell, 0).r > 0.0)
+			return vec2(t, min(tNext, tEnd));
+		t = tNext;
+		if (tMax.x <= tNext) { cell.x += stp.x; tMax.x += tDelta.x; }
+		if (tMax.y <= tNext) { cell.y += stp.y; tMax.y += tDelta.y; }
+		if (tMax.z <= tNext) { cell.z += stp.z; tMax.z += tDelta.z; }
+		if (any(lessThan(cell, ivec3(0))) || any(greaterThanEqual(cell, grid)))
+			return vec2(tEnd);
+	}
+	//out of iterations: march the remainder normally.
+	return t < tEnd ? vec2(t, tEnd) : vec2(tEnd);
+}
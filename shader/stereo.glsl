@@ -0,0 +1,41 @@
+//Single pass stereo, see GLStereoCamera::updateStereoBlock().
+//Include right after #version (GLSL 1.50+) since it enables extensions.
+//Draw with twice the instance count; stereoInstance() is the instance id
+//the application would have seen in a mono pass.
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
+
+layout(std140, row_major) uniform StereoMatrices
+{
+	mat4  stereoViewProjection[2];//left, right
+	mat4  stereoView[2];
+	ivec4 stereoParams;//x: GLStereoCamera::SinglePassMode, 0 layered, 1 side by side.
+};
+
+int stereoEye()
+{
+	return gl_InstanceID & 1;
+}
+
+int stereoInstance()
+{
+	return gl_InstanceID >> 1;
+}
+
+//Return clip space position of world space position pos for the current eye.
+vec4 stereoTransform(vec4 pos)
+{
+	int eye = stereoEye();
+	vec4 clip = stereoViewProjection[eye] * pos;
+	if (stereoParams.x == 1)
+	{//squeeze into the eye's half of the double wide viewport and clip
+	 //against its center line (GL_CLIP_DISTANCE0).
+		clip.x = clip.x * 0.5 + (eye == 0 ? -0.5 : 0.5) * clip.w;
+		gl_ClipDistance[0] = eye == 0 ? -clip.x : clip.x;
+	}else{
+#if defined(GL_ARB_shader_viewport_layer_array) || defined(GL_AMD_vertex_shader_layer)
+		gl_Layer = eye;
+#endif
+	}
+	return clip;
+}
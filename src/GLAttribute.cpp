@@ -49,9 +49,54 @@ GLAttribute::GLAttribute(GLuint shaderProgId,  const string& name,
 {
 }
 
+GLAttribute::GLAttribute(GLuint shaderProgId, const string& name,
+	 GLVertexPacking::Format format, GLuint offset/*=0*/, bool warning/*=false*/,
+	 GLuint divisor/*=0*/, const GLVertexBufferObjectRef vbo/*=NULL*/)
+     :m_bActive(true), m_vbo(vbo), m_name(name),
+	  m_type(GLVertexPacking::getType(format)), m_nComponents(GLVertexPacking::getComponents(format)),
+	  m_stride(GLVertexPacking::getStride(format)), m_shaderProgId(shaderProgId), m_offset(offset),
+      m_divisor(divisor), m_normalized(GLVertexPacking::isNormalized(format)), m_enableWarning(warning)
+{
+}
+
 GLAttribute::~GLAttribute(void)
 {
 }
+
+bool GLAttribute::isIntegerAttribute() const
+{
+	return !m_normalized && (m_type == GL_INT || m_type == GL_UNSIGNED_BYTE
+							 || m_type == GL_UNSIGNED_INT);
+}
+GLint GLAttribute::getValidatedLocation()
+{
+	GLint attrbIndex = glGetAttribLocation( m_shaderProgId, m_name.data());
+
+	if (attrbIndex==-1)
+	{
+		std::stringstream ss;
+		ss <<__func__<<": index==-1, cannot find "<<m_name<<"\n";
+		std::string msg=ss.str();
+		GLError::ErrorMessage(msg);
+
+	}else if (!m_vbo)
+	{
+		std::stringstream ss;
+		ss <<__func__<<": m_vbo==NULL, there is no associated VBO with the attribute "
+		   <<m_name<<".\nCall attach() or specify a VBO at the constructor.";
+		std::string msg=ss.str();
+		GLError::ErrorMessage(msg);
+	}else if (m_vbo->getVertexCount()<=0)
+	{
+		std::stringstream ss;
+		ss <<__func__<<": m_vbo->getVertexCount()<=0, No vertex attribute content in the associated VBO with the attribute "
+		   <<m_name<<".\nCall GLVertexBufferObject::upload() to upload vertex attribute content to GPU";
+		std::string msg=ss.str();
+		GLError::ErrorMessage(msg);
+	}
+	return attrbIndex;
+}
+
 //for GL 3.3 core version.
 #if defined(__APPLE__) || defined(MACOSX)
 void GLAttribute::enable()
@@ -73,8 +118,7 @@ void GLAttribute::enable()
     //For floating-point attributes, you must use glVertexAttribPointer.
     //For integer (both signed and unsigned), you must use glVertexAttribIPointer.
     //And for double-precision attributes, where available, you must use glVertexAttribLPointer.
-    if(m_type == GL_INT || m_type == GL_UNSIGNED_BYTE
-                    || m_type == GL_UNSIGNED_INT){
+    if(isIntegerAttribute()){
         //We need glVertexAttribIPointer( with I) to match your shader
         //int/uint attribute.
         glVertexAttribIPointer(index, m_nComponents, m_type,m_stride,\
@@ -101,40 +145,16 @@ void GLAttribute::enable()
 //For GL version 4.4
 void GLAttribute::enable()
 {
-	GLint attrbIndex=-1;
 	GLError::glCheckError(__func__);
-	attrbIndex = glGetAttribLocation( m_shaderProgId, m_name.data());
-
-	if (attrbIndex==-1)
-	{
-		std::stringstream ss;
-		ss <<__func__<<": index==-1, cannot find "<<m_name<<"\n";
-		std::string msg=ss.str();
-		GLError::ErrorMessage(msg);
+	GLint attrbIndex = getValidatedLocation();
 
-	}else if (!m_vbo)
-	{
-		std::stringstream ss;
-		ss <<__func__<<": m_vbo==NULL, there is no associated VBO with the attribute "
-		   <<m_name<<".\nCall attach() or specify a VBO at the constructor.";
-		std::string msg=ss.str();
-		GLError::ErrorMessage(msg);
-	}else if (m_vbo->getVertexCount()<=0)
-	{
-		std::stringstream ss;
-		ss <<__func__<<": m_vbo->getVertexCount()<=0, No vertex attribute content in the associated VBO with the attribute "
-		   <<m_name<<".\nCall GLVertexBufferObject::upload() to upload vertex attribute content to GPU";
-		std::string msg=ss.str();
-		GLError::ErrorMessage(msg);
-	}
 	//glBindVertexBuffer(0, buff, baseOffset, sizeof(Vertex));
 	//http://www.opengl.org/wiki/Vertex_Buffer_Object#Vertex_format/
 	//http://www.sinanc.org/blog/?p=450
 	//if there is any GLArrayBufferObject associate with the attribute,
 	//associate it with the attribute. It assumes that one attribute
 	//is associated with one array buffer object. Structure of Array is assumed.
-	if(m_type == GL_INT || m_type == GL_UNSIGNED_BYTE
-       || m_type == GL_UNSIGNED_INT){
+	if(isIntegerAttribute()){
         //We need glVertexAttribIFormat( with I) to match your shader 
         //int/uint attribute.
 		glVertexAttribIFormat(attrbIndex, m_nComponents, m_type, m_offset);
@@ -160,6 +180,33 @@ void GLAttribute::enable()
 }
 #endif
 
+GLint GLAttribute::enableImmutable(GLuint vaoId, GLuint bindingIndex)
+{
+#if defined(__APPLE__) || defined(MACOSX)
+	//sorry, mac user don't have Direct State Access(GL 4.5).
+	GLError::ErrorMessage(string(__func__)+": Direct State Access requires OpenGL 4.5, which is not available on Mac OS.");
+	return -1;
+#else
+	GLint attrbIndex = getValidatedLocation();
+	//Same I/L/float dispatch as enable(), only addressed to vaoId directly
+	//instead of the currently bound VAO.
+	if(isIntegerAttribute()){
+		glVertexArrayAttribIFormat(vaoId, attrbIndex, m_nComponents, m_type, m_offset);
+	}
+	else if (m_type == GL_DOUBLE)
+	{
+		glVertexArrayAttribLFormat(vaoId, attrbIndex, m_nComponents, m_type, m_offset);
+	}
+	else{
+		glVertexArrayAttribFormat(vaoId, attrbIndex, m_nComponents, m_type, m_normalized, m_offset);
+	}
+	glVertexArrayAttribBinding(vaoId, attrbIndex, bindingIndex);
+	glEnableVertexArrayAttrib(vaoId, attrbIndex);
+	GLError::glCheckError(__func__);
+	return attrbIndex;
+#endif
+}
+
 void GLAttribute::disable()
 {
 	GLint index=-1;
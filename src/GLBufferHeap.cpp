@@ -0,0 +1,473 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <sstream>
+#include <algorithm>
+#include "GLError.h"
+#include "GLBufferHeap.h"
+
+namespace davinci{
+
+namespace{
+	int highestBit(unsigned long long x)
+	{
+		int b = -1;
+		while (x) { x >>= 1; b++; }
+		return b;
+	}
+
+	size_t roundUp(size_t x, size_t a)
+	{
+		return (x + a - 1) / a * a;
+	}
+
+	size_t nextPowerOfTwo(size_t x)
+	{
+		size_t p = 1;
+		while (p < x) p <<= 1;
+		return p;
+	}
+}
+
+GLBufferSubAllocator::GLBufferSubAllocator(size_t capacity)
+	:m_flBitmap(0), m_capacity(capacity / GRANULARITY * GRANULARITY), m_usedBytes(0)
+{
+	for (int f = 0; f < FL_COUNT; f++)
+	{
+		m_slBitmap[f] = 0;
+		for (int s = 0; s < SL_COUNT; s++)
+			m_freeHeads[f][s] = -1;
+	}
+	if (m_capacity == 0) return;
+	int r = newRange();
+	Range& range = m_ranges[r];
+	range.offset = 0;
+	range.size = m_capacity;
+	range.prevPhys = range.nextPhys = -1;
+	range.isFree = true;
+	insertFree(r);
+}
+
+void GLBufferSubAllocator::mapping(size_t granules, int& fl, int& sl)
+{
+	if (granules < SL_COUNT)
+	{
+		fl = 0;
+		sl = (int)granules;
+		return;
+	}
+	int t = highestBit(granules);
+	fl = t - SL_LOG + 1;
+	sl = (int)(granules >> (t - SL_LOG)) - SL_COUNT;
+}
+
+int GLBufferSubAllocator::newRange()
+{
+	if (!m_unusedRanges.empty())
+	{
+		int r = m_unusedRanges.back();
+		m_unusedRanges.pop_back();
+		return r;
+	}
+	m_ranges.push_back(Range());
+	return (int)m_ranges.size() - 1;
+}
+
+void GLBufferSubAllocator::insertFree(int r)
+{
+	int fl, sl;
+	mapping(m_ranges[r].size / GRANULARITY, fl, sl);
+	Range& range = m_ranges[r];
+	range.prevFree = -1;
+	range.nextFree = m_freeHeads[fl][sl];
+	if (range.nextFree >= 0)
+		m_ranges[range.nextFree].prevFree = r;
+	m_freeHeads[fl][sl] = r;
+	m_flBitmap |= 1ULL << fl;
+	m_slBitmap[fl] |= 1u << sl;
+}
+
+void GLBufferSubAllocator::removeFree(int r)
+{
+	int fl, sl;
+	mapping(m_ranges[r].size / GRANULARITY, fl, sl);
+	Range& range = m_ranges[r];
+	if (range.prevFree >= 0)
+		m_ranges[range.prevFree].nextFree = range.nextFree;
+	else
+		m_freeHeads[fl][sl] = range.nextFree;
+	if (range.nextFree >= 0)
+		m_ranges[range.nextFree].prevFree = range.prevFree;
+	if (m_freeHeads[fl][sl] < 0)
+	{
+		m_slBitmap[fl] &= ~(1u << sl);
+		if (!m_slBitmap[fl])
+			m_flBitmap &= ~(1ULL << fl);
+	}
+}
+
+void GLBufferSubAllocator::splitTail(int r, size_t sizeInBytes)
+{
+	int t = newRange();//may reallocate m_ranges, take references after it.
+	Range& range = m_ranges[r];
+	Range& tail = m_ranges[t];
+	tail.offset = range.offset + sizeInBytes;
+	tail.size = range.size - sizeInBytes;
+	tail.prevPhys = r;
+	tail.nextPhys = range.nextPhys;
+	tail.isFree = true;
+	if (range.nextPhys >= 0)
+		m_ranges[range.nextPhys].prevPhys = t;
+	range.nextPhys = t;
+	range.size = sizeInBytes;
+	insertFree(t);
+}
+
+int GLBufferSubAllocator::allocate(size_t sizeInBytes, size_t alignment, size_t& offset)
+{
+	size_t size = roundUp(std::max<size_t>(sizeInBytes, 1), GRANULARITY);
+	alignment = std::max<size_t>(nextPowerOfTwo(alignment), GRANULARITY);
+	//worst case padding to reach an aligned start.
+	size_t granules = (size + alignment - GRANULARITY) / GRANULARITY;
+	if (granules * GRANULARITY > m_capacity) return -1;
+	//round up to the next bin so any range found there is big enough.
+	if (granules >= SL_COUNT)
+		granules += ((size_t)1 << (highestBit(granules) - SL_LOG)) - 1;
+	int fl, sl;
+	mapping(granules, fl, sl);
+	if (fl >= FL_COUNT) return -1;
+	unsigned int slMap = m_slBitmap[fl] & (~0u << sl);
+	if (!slMap)
+	{
+		unsigned long long flMap = fl + 1 < FL_COUNT ? m_flBitmap & (~0ULL << (fl + 1)) : 0;
+		if (!flMap) return -1;
+		fl = highestBit(flMap & (~flMap + 1));
+		slMap = m_slBitmap[fl];
+	}
+	sl = highestBit(slMap & (~slMap + 1));
+	int r = m_freeHeads[fl][sl];
+	removeFree(r);
+
+	size_t pad = roundUp(m_ranges[r].offset, alignment) - m_ranges[r].offset;
+	if (pad > 0)
+	{//the front padding stays free.
+		splitTail(r, pad);
+		int t = m_ranges[r].nextPhys;
+		removeFree(t);
+		insertFree(r);
+		r = t;
+	}
+	if (m_ranges[r].size > size)
+		splitTail(r, size);
+	m_ranges[r].isFree = false;
+	m_usedBytes += m_ranges[r].size;
+	offset = m_ranges[r].offset;
+	return r;
+}
+
+void GLBufferSubAllocator::free(int r)
+{
+	if (r < 0 || r >= (int)m_ranges.size() || m_ranges[r].isFree)
+	{
+		GLError::ErrorMessage(std::string(__func__) + ": range is not allocated.");
+		return;
+	}
+	m_usedBytes -= m_ranges[r].size;
+	m_ranges[r].isFree = true;
+	int prev = m_ranges[r].prevPhys;
+	if (prev >= 0 && m_ranges[prev].isFree)
+	{
+		removeFree(prev);
+		m_ranges[prev].size += m_ranges[r].size;
+		m_ranges[prev].nextPhys = m_ranges[r].nextPhys;
+		if (m_ranges[r].nextPhys >= 0)
+			m_ranges[m_ranges[r].nextPhys].prevPhys = prev;
+		m_unusedRanges.push_back(r);
+		r = prev;
+	}
+	int next = m_ranges[r].nextPhys;
+	if (next >= 0 && m_ranges[next].isFree)
+	{
+		removeFree(next);
+		m_ranges[r].size += m_ranges[next].size;
+		m_ranges[r].nextPhys = m_ranges[next].nextPhys;
+		if (m_ranges[next].nextPhys >= 0)
+			m_ranges[m_ranges[next].nextPhys].prevPhys = r;
+		m_unusedRanges.push_back(next);
+	}
+	insertFree(r);
+}
+
+size_t GLBufferSubAllocator::getLargestFreeRange() const
+{
+	if (!m_flBitmap) return 0;
+	int fl = highestBit(m_flBitmap);
+	int sl = highestBit(m_slBitmap[fl]);
+	size_t largest = 0;
+	for (int r = m_freeHeads[fl][sl]; r >= 0; r = m_ranges[r].nextFree)
+		largest = std::max(largest, m_ranges[r].size);
+	return largest;
+}
+
+GLBufferAllocation::~GLBufferAllocation()
+{
+	if (m_heap && isValid())
+		m_heap->freeRange(*this);
+}
+
+GLBufferObjectRef GLBufferAllocation::getBuffer() const
+{
+	return isValid() ? m_heap->getBlockBuffer(m_block) : GLBufferObjectRef();
+}
+
+GLuint GLBufferAllocation::getBufferId() const
+{
+	return isValid() ? m_heap->getBlockBuffer(m_block)->getId() : 0;
+}
+
+void GLBufferAllocation::bindRange(GLenum target, GLuint index) const
+{
+	if (!isValid())
+	{
+		GLError::ErrorMessage(std::string(__func__) + ": allocation has been released.");
+		return;
+	}
+	glBindBufferRange(target, index, getBufferId(), m_offset, m_size);
+	GLError::glCheckError(__func__);
+}
+
+GLBufferHeap::GLBufferHeap(size_t blockSize/*=64<<20*/, const std::string& name/*="GLBufferHeap"*/)
+	:m_blockSize(blockSize), m_name(name), m_uniformAlignment(0)
+{
+	std::fill(m_categoryBytes, m_categoryBytes + HEAP_CATEGORY_COUNT, 0);
+	std::fill(m_categoryAllocations, m_categoryAllocations + HEAP_CATEGORY_COUNT, 0);
+}
+
+GLBufferHeap::~GLBufferHeap()
+{
+	//outstanding handles stay readable but no longer point into the heap.
+	for (size_t b = 0; b < m_blocks.size(); b++)
+	{
+		for (size_t r = 0; r < m_blocks[b].owners.size(); r++)
+		{
+			GLBufferAllocation* a = m_blocks[b].owners[r];
+			if (!a) continue;
+			a->m_heap = NULL;
+			a->m_block = a->m_rangeId = -1;
+		}
+	}
+}
+
+size_t GLBufferHeap::defaultAlignment(Category category)
+{
+	if (category != HEAP_UNIFORM)
+		return 4;
+	if (!m_uniformAlignment)
+	{
+		GLint a = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &a);
+		m_uniformAlignment = (size_t)std::max(a, 1);
+	}
+	return m_uniformAlignment;
+}
+
+int GLBufferHeap::createBlock(size_t sizeInBytes)
+{
+	std::stringstream ss;
+	ss << m_name << "[" << m_blocks.size() << "]";
+	Block block;
+	block.buffer = GLBufferObjectRef(new GLBufferObject(GL_COPY_WRITE_BUFFER, GL_STATIC_DRAW, ss.str()));
+	block.buffer->allocateStorage(sizeInBytes, GL_DYNAMIC_STORAGE_BIT);
+	block.allocator = std::shared_ptr<GLBufferSubAllocator>(new GLBufferSubAllocator(sizeInBytes));
+	block.retiring = false;
+	m_blocks.push_back(block);
+	return (int)m_blocks.size() - 1;
+}
+
+bool GLBufferHeap::place(GLBufferAllocation& a)
+{
+	size_t offset = 0;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (size_t b = 0; b < m_blocks.size(); b++)
+		{
+			Block& block = m_blocks[b];
+			if (block.retiring) continue;
+			int r = block.allocator->allocate(a.m_size, a.m_alignment, offset);
+			if (r < 0) continue;
+			if (block.owners.size() <= (size_t)r)
+				block.owners.resize(r + 1, NULL);
+			block.owners[r] = &a;
+			a.m_block = (int)b;
+			a.m_rangeId = r;
+			a.m_offset = offset;
+			return true;
+		}
+		if (pass == 0)
+		{
+			size_t need = roundUp(a.m_size, GLBufferSubAllocator::GRANULARITY) + a.m_alignment;
+			createBlock(std::max(m_blockSize, roundUp(need, 1 << 16)));
+		}
+	}
+	return false;
+}
+
+GLBufferAllocationRef GLBufferHeap::allocate(size_t sizeInBytes, Category category,
+											 const GLvoid* data/*=NULL*/, size_t alignment/*=0*/)
+{
+	GLBufferAllocationRef a(new GLBufferAllocation());
+	a->m_heap = this;
+	a->m_size = sizeInBytes;
+	a->m_category = category;
+	a->m_alignment = alignment ? alignment : defaultAlignment(category);
+	if (!place(*a))
+	{
+		std::stringstream ss;
+		ss << __func__ << ": " << m_name << " cannot allocate " << sizeInBytes << " bytes.";
+		GLError::ErrorMessage(ss.str());
+		a->m_heap = NULL;
+		return GLBufferAllocationRef();
+	}
+	m_categoryBytes[category] += sizeInBytes;
+	m_categoryAllocations[category]++;
+	if (data)
+		m_blocks[a->m_block].buffer->uploadSubData(a->m_offset, sizeInBytes, data);
+	return a;
+}
+
+void GLBufferHeap::freeRange(GLBufferAllocation& a)
+{
+	Block& block = m_blocks[a.m_block];
+	block.allocator->free(a.m_rangeId);
+	block.owners[a.m_rangeId] = NULL;
+	m_categoryBytes[a.m_category] -= a.m_size;
+	m_categoryAllocations[a.m_category]--;
+	a.m_block = a.m_rangeId = -1;
+}
+
+void GLBufferHeap::release(GLBufferAllocationRef allocation)
+{
+	if (!allocation || !allocation->isValid()) return;
+	if (allocation->m_heap != this)
+	{
+		GLError::ErrorMessage(std::string(__func__) + ": allocation belongs to another heap.");
+		return;
+	}
+	freeRange(*allocation);
+}
+
+void GLBufferHeap::upload(const GLBufferAllocationRef& allocation, size_t sizeInBytes,
+						  const GLvoid* data, size_t offsetInAllocation/*=0*/)
+{
+	if (!allocation || !allocation->isValid() || offsetInAllocation + sizeInBytes > allocation->m_size)
+	{
+		std::stringstream ss;
+		ss << __func__ << ": " << sizeInBytes << " bytes at " << offsetInAllocation
+		   << " do not fit the allocation.";
+		GLError::ErrorMessage(ss.str());
+		return;
+	}
+	m_blocks[allocation->m_block].buffer->uploadSubData(allocation->m_offset + offsetInAllocation,
+														sizeInBytes, data);
+}
+
+size_t GLBufferHeap::defragment(float occupancyThreshold/*=0.5f*/)
+{
+	//emptiest blocks first, as long as the others can take their content.
+	std::vector<int> order;
+	size_t freeBytes = 0;
+	for (size_t b = 0; b < m_blocks.size(); b++)
+	{
+		order.push_back((int)b);
+		freeBytes += m_blocks[b].allocator->getCapacity() - m_blocks[b].allocator->getUsedBytes();
+	}
+	std::sort(order.begin(), order.end(), [&](int a, int b)
+	{
+		const GLBufferSubAllocator& A = *m_blocks[a].allocator;
+		const GLBufferSubAllocator& B = *m_blocks[b].allocator;
+		return (double)A.getUsedBytes() / A.getCapacity() < (double)B.getUsedBytes() / B.getCapacity();
+	});
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const GLBufferSubAllocator& A = *m_blocks[order[i]].allocator;
+		if (A.getUsedBytes() >= occupancyThreshold * A.getCapacity()) break;
+		size_t othersFree = freeBytes - (A.getCapacity() - A.getUsedBytes());
+		if (A.getUsedBytes() > othersFree) break;
+		m_blocks[order[i]].retiring = true;
+		//the survivors give up the room they absorb this block with.
+		freeBytes = othersFree - A.getUsedBytes();
+	}
+
+	size_t moved = 0;
+	for (size_t b = 0; b < m_blocks.size(); b++)
+	{
+		if (!m_blocks[b].retiring) continue;
+		//copy the owner list, place() may grow m_blocks.
+		std::vector<GLBufferAllocation*> owners = m_blocks[b].owners;
+		GLBufferObjectRef source = m_blocks[b].buffer;
+		for (size_t r = 0; r < owners.size(); r++)
+		{
+			GLBufferAllocation* a = owners[r];
+			if (!a) continue;
+			size_t oldOffset = a->m_offset;
+			if (!place(*a))
+			{
+				GLError::ErrorMessage(std::string(__func__) + ": out of memory while moving an allocation.");
+				continue;
+			}
+			source->copy(*m_blocks[a->m_block].buffer, oldOffset, a->m_offset, a->m_size);
+			moved += a->m_size;
+		}
+	}
+	//drop the emptied blocks and renumber the survivors' handles.
+	std::vector<Block> kept;
+	for (size_t b = 0; b < m_blocks.size(); b++)
+	{
+		if (m_blocks[b].retiring) continue;
+		for (size_t r = 0; r < m_blocks[b].owners.size(); r++)
+			if (m_blocks[b].owners[r])
+				m_blocks[b].owners[r]->m_block = (int)kept.size();
+		kept.push_back(m_blocks[b]);
+	}
+	m_blocks.swap(kept);
+	GLError::glCheckError(__func__);
+	return moved;
+}
+
+GLBufferHeapStats GLBufferHeap::getStats() const
+{
+	GLBufferHeapStats stats;
+	stats.blockCount = m_blocks.size();
+	stats.capacity = stats.usedBytes = stats.largestFreeRange = 0;
+	for (size_t b = 0; b < m_blocks.size(); b++)
+	{
+		const GLBufferSubAllocator& A = *m_blocks[b].allocator;
+		stats.capacity += A.getCapacity();
+		stats.usedBytes += A.getUsedBytes();
+		stats.largestFreeRange = std::max(stats.largestFreeRange, A.getLargestFreeRange());
+	}
+	stats.categoryBytes.assign(m_categoryBytes, m_categoryBytes + HEAP_CATEGORY_COUNT);
+	stats.categoryAllocations.assign(m_categoryAllocations, m_categoryAllocations + HEAP_CATEGORY_COUNT);
+	return stats;
+}
+
+}
@@ -40,7 +40,7 @@ GLBufferObject::GLBufferObject(
 	GLenum target, GLenum usage,
 	const std::string &name /*= "Untitled GLBufferObject"*/)
     :m_target(target),m_usage(usage), m_reservedBytes(0),
-	m_firstTime(true), m_name(name), m_bindingIndex(-1)
+	m_firstTime(true), m_immutable(false), m_name(name), m_bindingIndex(-1)
 #ifdef ENABLE_CUDA_GL_INTEROP
     ,m_cudaResource(NULL),m_cudaAccessHint(cudaGraphicsMapFlagsNone)//
     ,m_cudaMappedPtr(NULL)
@@ -81,7 +81,13 @@ void GLBufferObject::upload(size_t totalSizeInBytes, const GLvoid* data )
         glBufferData(m_target, m_reservedBytes, data, m_usage);
         m_firstTime = false;
     }else{
-        if (m_reservedBytes < totalSizeInBytes)
+        if (m_reservedBytes < totalSizeInBytes && m_immutable)
+        {
+            std::stringstream ss;
+            ss << __func__ << ": " << m_name << " has immutable storage of " << m_reservedBytes
+               << " bytes, cannot upload " << totalSizeInBytes << " bytes.";
+            GLError::ErrorMessage(ss.str());
+        }else if (m_reservedBytes < totalSizeInBytes)
         {
             cout << "*************************\n";
             cout << "original GLBufferObject size="<<m_reservedBytes
@@ -104,6 +110,45 @@ void GLBufferObject::upload( size_t offset, size_t totalSizeInBytes,
     glBufferSubData(m_target, offset, totalSizeInBytes, data );
 }
 
+void GLBufferObject::allocateStorage(size_t sizeInBytes, GLbitfield flags/*=GL_DYNAMIC_STORAGE_BIT*/,
+									 const GLvoid* data/*=NULL*/)
+{
+	if (m_immutable || !m_firstTime)
+	{
+		//immutable storage cannot be respecified, start over with a new name.
+		deleteBuffer();
+		glGenBuffers(1, &m_id);
+	}
+	bindBufferObject();
+#if defined(__APPLE__) || defined(MACOSX)
+	//sorry, mac user don't have glBufferStorage (GL 4.4).
+	glBufferData(m_target, sizeInBytes, data, m_usage);
+#else
+	glBufferStorage(m_target, sizeInBytes, data, flags);
+#endif
+	unbindBufferObject();
+	m_reservedBytes = sizeInBytes;
+	m_firstTime = false;
+	m_immutable = true;
+	GLError::glCheckError(__func__);
+}
+
+void GLBufferObject::uploadSubData(size_t offset, size_t sizeInBytes, const GLvoid* data)
+{
+	if (m_reservedBytes < offset + sizeInBytes)
+	{
+		std::stringstream ss;
+		ss << __func__ << ": " << m_name << " range [" << offset << ", " << offset + sizeInBytes
+		   << ") exceeds the buffer size " << m_reservedBytes << ".";
+		GLError::ErrorMessage(ss.str());
+		return;
+	}
+	bindBufferObject();
+	upload(offset, sizeInBytes, data);
+	unbindBufferObject();
+	GLError::glCheckError(__func__);
+}
+
 void GLBufferObject::copy(GLBufferObject &dest, size_t offsetRead, size_t offsetWrite, size_t size)
 {
 	if (size <= 0)
@@ -20,17 +20,97 @@ OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
 OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
+#include <sstream>
+#include <climits>
+#include <algorithm>
+#include <GL/glew.h>
+#include "GLError.h"
 #include "GLClickable.h"
+#include "GLRenderTargetPool.h"
 using namespace davinci;
 
+//Rectangle/lasso selection: every covered pixel inserts its id into an
+//open addressing hash table of (id,count) entries. The first insertion of
+//an id appends its slot to the selected list.
+static const char* g_selectShaderSrc =
+"#version 430\n"
+"layout(local_size_x = 16, local_size_y = 16) in;\n"
+"struct Entry { uint id; uint count; };\n"
+"layout(std430) buffer Table { Entry table[]; };\n"
+"layout(std430) writeonly buffer Selected { uvec2 selected[]; };\n"
+"layout(std430) readonly buffer Lasso { vec2 lasso[]; };\n"
+"layout(binding = 0, offset = 0) uniform atomic_uint selectedCount;\n"
+"uniform isampler2D idTex;\n"
+"uniform ivec2 regionMin;\n"
+"uniform ivec2 regionSize;\n"
+"uniform int   lassoCount;\n"
+"uniform uint  tableMask;\n"
+"bool insideLasso(vec2 p)\n"
+"{//even-odd rule.\n"
+"	bool inside = false;\n"
+"	for (int i = 0, j = lassoCount - 1; i < lassoCount; j = i++)\n"
+"	{\n"
+"		vec2 a = lasso[i], b = lasso[j];\n"
+"		if ((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x)*(p.y - a.y)/(b.y - a.y) + a.x)\n"
+"			inside = !inside;\n"
+"	}\n"
+"	return inside;\n"
+"}\n"
+"void main()\n"
+"{\n"
+"	ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+"	if (any(greaterThanEqual(p, regionSize))) return;\n"
+"	p += regionMin;\n"
+"	if (lassoCount >= 3 && !insideLasso(vec2(p) + 0.5)) return;\n"
+"	uint id = uint(texelFetch(idTex, p, 0).r);\n"
+"	if (id == 0u) return;//background.\n"
+"	uint h = (id * 2654435761u) & tableMask;\n"
+"	for (uint probe = 0u; probe <= tableMask; probe++)\n"
+"	{\n"
+"		uint prev = atomicCompSwap(table[h].id, 0u, id);\n"
+"		if (prev == 0u || prev == id)\n"
+"		{\n"
+"			atomicAdd(table[h].count, 1u);\n"
+"			if (prev == 0u)\n"
+"				selected[atomicCounterIncrement(selectedCount)] = uvec2(h, 0u);\n"
+"			return;\n"
+"		}\n"
+"		h = (h + 1u) & tableMask;\n"
+"	}\n"
+"}\n";
+
+//Replaces the table slots in the selected list by their (id,count).
+static const char* g_gatherShaderSrc =
+"#version 430\n"
+"layout(local_size_x = 64) in;\n"
+"struct Entry { uint id; uint count; };\n"
+"layout(std430) readonly buffer Table { Entry table[]; };\n"
+"layout(std430) buffer Selected { uvec2 selected[]; };\n"
+"uniform uint selectedCount;\n"
+"void main()\n"
+"{\n"
+"	uint i = gl_GlobalInvocationID.x;\n"
+"	if (i >= selectedCount) return;\n"
+"	Entry e = table[selected[i].x];\n"
+"	selected[i] = uvec2(e.id, e.count);\n"
+"}\n";
+
 GLClickable::GLClickable(void)
     :m_clickedID(-1),m_enableClickable(false)
+    ,m_nextPickQuery(0),m_hoveredId(-1),m_selectionCapacity(1<<16)
 {
 }
 
 
 GLClickable::~GLClickable(void)
 {
+    for (int i = 0; i < kPickQueryCount; i++)
+    {
+        if (m_pickQueries[i].fence)
+        {
+            glDeleteSync(m_pickQueries[i].fence);
+        }
+    }
 }
 
 void GLClickable::initClickableShaders()
@@ -70,13 +150,247 @@ int GLClickable::mouseClicked( int x, int y )
     m_fboClickable->unbind();
 
     glReadBuffer(GL_BACK);
-    //cout <<"viewport["<<viewport[0]<<","<<viewport[1]<<","<<viewport[2]<<","<<viewport[3]<<"]\n";
-    cout <<"Clickable::mouseClicked():mouseposition["<<x<<","<<viewport[3]-y<<"]\n";
-    cout << "Clickable::mouseClicked(): id="<<id<<", clicked cell id="<<m_clickedID<<"(base-0 index)."<<endl;
 
     return m_clickedID;
 }
 
+int GLClickable::mouseHover(int x, int y, int radius/*=2*/)
+{
+    if (!m_fboClickable || !m_texID)
+    {
+        return m_hoveredId;
+    }
+    //Collect finished readbacks oldest first, so the last one read is the
+    //most recent. Stop at the first one still in flight.
+    for (int k = 0; k < kPickQueryCount; k++)
+    {
+        PickQuery& q = m_pickQueries[(m_nextPickQuery + k) % kPickQueryCount];
+        if (!q.fence) continue;
+        GLenum status = glClientWaitSync(q.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) break;
+        glDeleteSync(q.fence);
+        q.fence = 0;
+        if (status == GL_WAIT_FAILED)
+        {
+            std::stringstream ss;
+            ss << __func__ << ": glClientWaitSync failed.\n";
+            GLError::ErrorMessage(ss.str());
+            continue;
+        }
+        m_hoveredId = readPickQuery(q);
+    }
+    //All slots busy means the GPU is more than kPickQueryCount frames
+    //behind, skip this frame rather than stall.
+    PickQuery& q = m_pickQueries[m_nextPickQuery];
+    if (!q.fence)
+    {
+        issuePickQuery(q, x, y, std::max(radius, 0));
+        m_nextPickQuery = (m_nextPickQuery + 1) % kPickQueryCount;
+    }
+    return m_hoveredId;
+}
+
+void GLClickable::issuePickQuery(PickQuery& q, int x, int y, int radius)
+{
+    int w = m_texID->getWidth(), h = m_texID->getHeight();
+    int gy = h - 1 - y;//window to GL coordinates.
+    int x0 = std::max(0, x - radius), x1 = std::min(w - 1, x + radius);
+    int y0 = std::max(0, gy - radius), y1 = std::min(h - 1, gy + radius);
+    if (x0 > x1 || y0 > y1)
+    {//cursor left the window.
+        m_hoveredId = -1;
+        return;
+    }
+    q.width  = x1 - x0 + 1;
+    q.height = y1 - y0 + 1;
+    q.cx = x - x0;
+    q.cy = gy - y0;
+    int side = 2 * radius + 1;
+    if (!q.pbo)
+    {
+        q.pbo = GLPixelBufferObjectRef(new GLPixelBufferObject(side, side, GL_RED_INTEGER, GL_INT, GL_STREAM_READ));
+    }
+    else if (q.pbo->getWidth() < side)
+    {
+        q.pbo->resize(side, side);
+    }
+
+    GLError::purgePreviousGLError();
+    m_fboClickable->bind();
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, q.pbo->getId());
+    glReadPixels(x0, y0, q.width, q.height, GL_RED_INTEGER, GL_INT, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    q.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_fboClickable->unbind();
+    glReadBuffer(GL_BACK);
+    GLError::glCheckError(__func__);
+}
+
+int GLClickable::readPickQuery(PickQuery& q)
+{
+    int picked = -1;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, q.pbo->getId());
+    const GLint* ids = (const GLint*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+        q.width * q.height * sizeof(GLint), GL_MAP_READ_BIT);
+    if (ids)
+    {//the non background pixel closest to the cursor wins.
+        int best = INT_MAX;
+        for (int j = 0; j < q.height; j++)
+        {
+            for (int i = 0; i < q.width; i++)
+            {
+                GLint id = ids[j * q.width + i];
+                int d = (i - q.cx) * (i - q.cx) + (j - q.cy) * (j - q.cy);
+                if (id != 0 && d < best)
+                {
+                    best = d;
+                    picked = id - 1;//id 0 is reserved for background.
+                }
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    GLError::glCheckError(__func__);
+    return picked;
+}
+
+void GLClickable::selectRect(int x0, int y0, int x1, int y1, std::vector<int>& ids)
+{
+    ids.clear();
+    m_selectionHistogram.clear();
+    if (!m_texID) return;
+    int h = m_texID->getHeight();
+    std::vector<float> noLasso;
+    runSelection(std::min(x0, x1), h - 1 - std::max(y0, y1),
+                 std::max(x0, x1), h - 1 - std::min(y0, y1), noLasso, ids);
+}
+
+void GLClickable::selectLasso(const std::vector<vec2i>& polygon, std::vector<int>& ids)
+{
+    ids.clear();
+    m_selectionHistogram.clear();
+    if (!m_texID || polygon.size() < 3) return;
+    int h = m_texID->getHeight();
+    std::vector<float> lasso(polygon.size() * 2);
+    int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+    for (size_t i = 0; i < polygon.size(); i++)
+    {//pixel (x,y) spans [x,x+1]x[y,y+1] in window coordinates.
+        lasso[2 * i]     = (float)polygon[i].x() + 0.5f;
+        lasso[2 * i + 1] = (float)(h - 1 - polygon[i].y()) + 0.5f;
+        x0 = std::min(x0, polygon[i].x());
+        x1 = std::max(x1, polygon[i].x());
+        y0 = std::min(y0, h - 1 - polygon[i].y());
+        y1 = std::max(y1, h - 1 - polygon[i].y());
+    }
+    runSelection(x0, y0, x1, y1, lasso, ids);
+}
+
+void GLClickable::createSelectionShaders()
+{
+    std::string src(g_selectShaderSrc);
+    m_selectShader = GLComputeShaderRef(new GLComputeShader("GLClickable select"));
+    m_selectShader->setComputeShaderStr(src);
+    m_selectShader->CreateShaders();
+
+    src = g_gatherShaderSrc;
+    m_gatherShader = GLComputeShaderRef(new GLComputeShader("GLClickable gather"));
+    m_gatherShader->setComputeShaderStr(src);
+    m_gatherShader->CreateShaders();
+
+    m_selectTable = GLShaderStorageBufferObjectRef(
+        new GLShaderStorageBufferObject("GLClickable id table", GL_DYNAMIC_COPY));
+    m_selectList = GLShaderStorageBufferObjectRef(
+        new GLShaderStorageBufferObject("GLClickable selected ids", GL_DYNAMIC_READ));
+    m_selectLasso = GLShaderStorageBufferObjectRef(
+        new GLShaderStorageBufferObject("GLClickable lasso", GL_DYNAMIC_DRAW));
+    m_selectCounter = GLAtomicCounterRef(new GLAtomicCounter("GLClickable selected count"));
+    m_selectCounter->alloc(1);
+    //a valid, if unused, lasso store for rectangle selections.
+    float dummy[2] = { 0.0f, 0.0f };
+    m_selectLasso->upload(sizeof(dummy), dummy);
+}
+
+void GLClickable::runSelection(int x0, int y0, int x1, int y1, const std::vector<float>& lasso,
+                               std::vector<int>& ids)
+{
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, (int)m_texID->getWidth() - 1);
+    y1 = std::min(y1, (int)m_texID->getHeight() - 1);
+    if (x0 > x1 || y0 > y1) return;
+    if (!m_selectShader)
+    {
+        createSelectionShaders();
+    }
+    int w = x1 - x0 + 1, h = y1 - y0 + 1;
+    //at most half full so linear probing stays short.
+    GLuint maxUnique = (GLuint)std::min<size_t>(size_t(w) * h, std::max(m_selectionCapacity, 1u));
+    GLuint tableSize = 1;
+    while (tableSize < 2 * maxUnique) tableSize <<= 1;
+    size_t tableBytes = size_t(tableSize) * 2 * sizeof(GLuint);
+    if (m_selectTable->getSizeInBytes() < tableBytes)
+    {
+        m_selectTable->upload(tableBytes, NULL);
+        m_selectList->upload(tableBytes, NULL);
+    }
+    m_selectTable->bindBufferObject();
+    glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, tableBytes,
+                         GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+    m_selectTable->unbindBufferObject();
+    if (!lasso.empty())
+    {
+        m_selectLasso->upload(lasso.size() * sizeof(float), lasso.data());
+    }
+    m_selectCounter->reset(0);
+
+    m_selectShader->SetSamplerUniform("idTex", m_texID.get());
+    m_selectShader->SetInt2Uniform("regionMin", vec2i(x0, y0));
+    m_selectShader->SetInt2Uniform("regionSize", vec2i(w, h));
+    m_selectShader->SetIntUniform("lassoCount", (int)(lasso.size() / 2));
+    m_selectShader->SetUintUniform("tableMask", tableSize - 1);
+    m_selectShader->SetShaderStorageBlockUniform("Table", m_selectTable);
+    m_selectShader->SetShaderStorageBlockUniform("Selected", m_selectList);
+    m_selectShader->SetShaderStorageBlockUniform("Lasso", m_selectLasso);
+    m_selectShader->SetAtomicCounterUniform("selectedCount", m_selectCounter);
+    m_selectShader->UseShaders((w + 15) / 16, (h + 15) / 16, 1);
+    m_selectShader->ReleaseShader();
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_ATOMIC_COUNTER_BARRIER_BIT);
+
+    GLuint count = 0;
+    m_selectCounter->readCounters(&count);
+    count = std::min(count, tableSize);
+    if (count == 0) return;
+
+    m_gatherShader->SetShaderStorageBlockUniform("Table", m_selectTable);
+    m_gatherShader->SetShaderStorageBlockUniform("Selected", m_selectList);
+    m_gatherShader->SetUintUniform("selectedCount", count);
+    m_gatherShader->UseShaders((count + 63) / 64, 1, 1);
+    m_gatherShader->ReleaseShader();
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    std::vector<GLuint> pairs(count * 2);
+    m_selectList->bindBufferObject();
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, pairs.size() * sizeof(GLuint), pairs.data());
+    m_selectList->unbindBufferObject();
+    GLError::glCheckError(__func__);
+
+    std::vector<std::pair<int, GLuint> > sorted(count);
+    for (GLuint i = 0; i < count; i++)
+    {
+        sorted[i] = std::make_pair((int)pairs[2 * i] - 1, pairs[2 * i + 1]);//id 0 is background.
+    }
+    std::sort(sorted.begin(), sorted.end());
+    ids.resize(count);
+    m_selectionHistogram.resize(count);
+    for (GLuint i = 0; i < count; i++)
+    {
+        ids[i] = sorted[i].first;
+        m_selectionHistogram[i] = sorted[i].second;
+    }
+}
+
 void GLClickable::resize( int w, int h )
 {
     //Create FBO for drawID.
@@ -86,14 +400,16 @@ void GLClickable::resize( int w, int h )
                                              //,GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE));//method 1.
                                             ,GL_R32I, GL_RED_INTEGER, GL_INT));//method 2.
 	*/
-    m_texID = GLTexture2DRef(new GLTexture2d(w, h //,GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE));//method 1.
-                                            ,GL_R32I, GL_RED_INTEGER, GL_INT));//method 2.
+    //integer textures are incomplete with linear filtering, which the
+    //selection shader would see as all background.
+    //the previous size's targets are freed, not parked in the pool.
+    GLRenderTargetPoolRef pool = GLRenderTargetPool::getDefault();
+    pool->release(m_texID);
+    pool->release(m_texDepth);
+    m_texID = pool->acquireTexture(w, h, GL_R32I, GL_NEAREST, GL_NEAREST);//method 2.
     m_texID->setName("Clickable::m_texID");
 
-    m_texDepth = GLTexture2DRef(new GLTexture2d(w,h,// GLTextureAbstract::getNextAvailabeTexUnitId(),
-                                GL_DEPTH_COMPONENT,
-                                GL_DEPTH_COMPONENT,GL_FLOAT));
-
+    m_texDepth = pool->acquireTexture(w, h, GL_DEPTH_COMPONENT, GL_LINEAR, GL_LINEAR);
     m_texDepth->setName("Clickable::m_texDepth");
 
     if(!m_fboClickable)
@@ -107,5 +423,4 @@ void GLClickable::resize( int w, int h )
         m_fboClickable->unbind();
     }
     m_fboClickable->checkFramebufferStatus();
-    m_fboClickable->printFramebufferInfo();
 }
\ No newline at end of file
@@ -32,6 +32,7 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 #include "GLError.h"
 #include "GLUtilities.h"
 #include "GLComputeShader.h"
+#include "GLBufferObject.h"
 
 using namespace std;
 
@@ -49,6 +50,14 @@ void GLComputeShader::UseShaders(int num_group_x, int num_group_y, int num_group
 	glDispatchCompute(num_group_x, num_group_y, num_group_z);
 }
 
+void GLComputeShader::UseShadersIndirect(const GLBufferObject& indirect, GLintptr offset/*=0*/)
+{
+	GLShader::UseShaders();
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, indirect.getId());
+	glDispatchComputeIndirect(offset);
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+}
+
 GLuint GLComputeShader::CreateShaders(void)
 {
 	if (m_computeShaderProg.empty())
@@ -0,0 +1,256 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+#include <GL/glew.h>
+#include "GLError.h"
+#include "GLDrawBatch.h"
+
+namespace davinci{
+
+GLDrawBatch::GLDrawBatch(GLenum geotype, GLsizei vertexStrideInBytes,
+						 GLsizei perDrawStrideInBytes/*=0*/,
+						 size_t vertexCapacity/*=65536*/, size_t indexCapacity/*=262144*/)
+	:m_geotype(geotype), m_vertexStride(vertexStrideInBytes),
+	 m_perDrawStride(perDrawStrideInBytes),
+	 m_vertexCapacity(0), m_vertexUsed(0), m_indexCapacity(0), m_indexUsed(0),
+	 m_recordCount(0), m_layoutDirty(true), m_uploaded(false)
+{
+	if (m_vertexStride <= 0)
+	{
+		GLError::ErrorMessage(string(__func__)+": vertexStrideInBytes must be positive.");
+	}
+	m_vao = GLVertexArrayObjectRef(new GLVertexArrayObject(geotype));
+	m_indirect = GLShaderStorageBufferObjectRef(
+		new GLShaderStorageBufferObject("GLDrawBatch indirect commands", GL_DYNAMIC_DRAW));
+	m_perDraw = GLShaderStorageBufferObjectRef(
+		new GLShaderStorageBufferObject("GLDrawBatch per-draw records", GL_DYNAMIC_DRAW));
+
+	growVertexArena(std::max<size_t>(vertexCapacity, 1));
+	growIndexArena(std::max<size_t>(indexCapacity, 1));
+}
+
+GLDrawBatch::~GLDrawBatch()
+{
+}
+
+void GLDrawBatch::addAttribute(GLuint shaderProgId, const std::string& name, GLenum type,
+							   GLuint nComponents, GLuint offset/*=0*/, bool normalized/*=false*/)
+{
+	if (m_vao->isImmutable())
+	{//layout changes, bake it again at next draw().
+		m_vao->disable();
+	}
+	m_vao->addAttribute(shaderProgId, name, type, nComponents, m_vertexStride,
+						offset, normalized, 0, m_vertexArena);
+	m_layoutDirty = true;
+}
+
+void GLDrawBatch::setDrawIdAttribute(GLuint shaderProgId, const std::string& name)
+{
+	if (m_vao->isImmutable())
+	{
+		m_vao->disable();
+	}
+	if (!m_drawIdBuffer)
+	{
+		m_drawIdBuffer = GLVertexBufferObjectRef(new GLVertexBufferObject(GL_STATIC_DRAW));
+		growDrawIdBuffer(std::max<size_t>(m_recordCount, 1024));
+	}
+	//divisor 1: the attribute advances once per instance, starting at baseInstance.
+	m_vao->addAttribute(shaderProgId, name, GL_UNSIGNED_INT, 1, sizeof(GLuint),
+						0, false, 1, m_drawIdBuffer);
+	m_layoutDirty = true;
+}
+
+int GLDrawBatch::addMesh(const GLvoid* vertices, size_t vertexCount,
+						 const GLuint* indices, size_t indexCount)
+{
+	if (vertexCount == 0 || indexCount == 0 || !vertices || !indices)
+	{
+		GLError::ErrorMessage(string(__func__)+": empty mesh.");
+	}
+	if (m_vertexUsed + vertexCount > m_vertexCapacity)
+	{
+		growVertexArena(m_vertexUsed + vertexCount);
+	}
+	if (m_indexUsed + indexCount > m_indexCapacity)
+	{
+		growIndexArena(m_indexUsed + indexCount);
+	}
+
+	m_vertexArena->bindBufferObject();
+	glBufferSubData(GL_ARRAY_BUFFER, m_vertexUsed*m_vertexStride,
+					vertexCount*m_vertexStride, vertices);
+	m_vertexArena->unbindBufferObject();
+
+	m_indexArena->bindBufferObject();
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, m_indexUsed*sizeof(GLuint),
+					indexCount*sizeof(GLuint), indices);
+	m_indexArena->unbindBufferObject();
+	GLError::glCheckError(__func__);
+
+	GLDrawBatchMesh mesh;
+	mesh.firstIndex  = (GLuint)m_indexUsed;
+	mesh.indexCount  = (GLuint)indexCount;
+	mesh.baseVertex  = (GLint)m_vertexUsed;
+	mesh.vertexCount = (GLuint)vertexCount;
+	m_meshes.push_back(mesh);
+
+	m_vertexUsed += vertexCount;
+	m_indexUsed  += indexCount;
+	return (int)m_meshes.size() - 1;
+}
+
+void GLDrawBatch::clearDraws()
+{
+	m_commands.clear();
+	m_perDrawData.clear();
+	m_recordCount = 0;
+	m_uploaded = false;
+}
+
+GLuint GLDrawBatch::addDraw(int meshId, GLuint instanceCount/*=1*/, const GLvoid* perDrawData/*=NULL*/)
+{
+	if (meshId < 0 || meshId >= (int)m_meshes.size())
+	{
+		std::stringstream ss;
+		ss << __func__ << ": invalid mesh id " << meshId << ", the batch holds "
+		   << m_meshes.size() << " meshes.";
+		GLError::ErrorMessage(ss.str());
+	}
+	const GLDrawBatchMesh& mesh = m_meshes[meshId];
+	GLDrawElementsIndirectCommand cmd;
+	cmd.count         = mesh.indexCount;
+	cmd.instanceCount = instanceCount;
+	cmd.firstIndex    = mesh.firstIndex;
+	cmd.baseVertex    = mesh.baseVertex;
+	cmd.baseInstance  = m_recordCount;
+	m_commands.push_back(cmd);
+
+	if (m_perDrawStride > 0)
+	{
+		size_t bytes = size_t(instanceCount) * m_perDrawStride;
+		size_t pos   = m_perDrawData.size();
+		m_perDrawData.resize(pos + bytes, 0);
+		if (perDrawData)
+			memcpy(&m_perDrawData[pos], perDrawData, bytes);
+	}
+	m_recordCount += instanceCount;
+	if (m_drawIdBuffer && m_recordCount > m_drawIdBuffer->getVertexCount())
+	{
+		growDrawIdBuffer(m_recordCount);
+	}
+	m_uploaded = false;
+	return cmd.baseInstance;
+}
+
+void GLDrawBatch::upload()
+{
+	if (!m_commands.empty())
+	{
+		m_indirect->upload(m_commands.size()*sizeof(GLDrawElementsIndirectCommand),
+						   m_commands.data());
+	}
+	if (!m_perDrawData.empty())
+	{
+		m_perDraw->upload(m_perDrawData.size(), m_perDrawData.data());
+	}
+	m_uploaded = true;
+}
+
+void GLDrawBatch::draw()
+{
+	if (m_commands.empty()) return;
+
+	if (m_layoutDirty)
+	{
+		finalizeLayout();
+	}
+	if (!m_uploaded)
+	{
+		upload();
+	}
+	m_vao->multiDrawElementsIndirect(*m_indirect, (GLsizei)m_commands.size());
+	GLError::glCheckError(__func__);
+}
+
+void GLDrawBatch::finalizeLayout()
+{
+	m_vao->enableImmutable();
+	m_vao->setElementBuffer(m_indexArena);
+	m_layoutDirty = false;
+}
+
+void GLDrawBatch::growVertexArena(size_t minVertices)
+{
+	size_t capacity = std::max(minVertices, m_vertexCapacity * 2);
+	GLVertexBufferObjectRef arena(new GLVertexBufferObject(GL_STATIC_DRAW));
+	arena->upload(capacity*m_vertexStride, capacity, NULL);
+
+	GLVertexBufferObjectRef old = m_vertexArena;
+	if (old)
+	{
+		if (m_vertexUsed > 0)
+			old->copy(*arena, 0, 0, m_vertexUsed*m_vertexStride);
+		if (m_vao->isImmutable())
+			m_vao->setVertexBuffer(m_vao->getImmutableBindingIndex(old), arena);
+		//keep the attributes pointing at the live arena for the next bake.
+		m_vao->retargetAttributes(old, arena);
+	}
+	m_vertexArena = arena;
+	m_vertexCapacity = capacity;
+	GLError::glCheckError(__func__);
+}
+
+void GLDrawBatch::growIndexArena(size_t minIndices)
+{
+	size_t capacity = std::max(minIndices, m_indexCapacity * 2);
+	GLIndexBufferObjectRef arena(new GLIndexBufferObject(m_geotype));
+	arena->GLBufferObject::upload(capacity*sizeof(GLuint), NULL);
+
+	if (m_indexArena && m_indexUsed > 0)
+	{
+		m_indexArena->copy(*arena, 0, 0, m_indexUsed*sizeof(GLuint));
+	}
+	m_indexArena = arena;
+	m_indexCapacity = capacity;
+	if (m_vao->isImmutable())
+	{
+		m_vao->setElementBuffer(m_indexArena);
+	}
+	GLError::glCheckError(__func__);
+}
+
+void GLDrawBatch::growDrawIdBuffer(size_t minRecords)
+{
+	size_t capacity = std::max(minRecords, m_drawIdBuffer->getVertexCount() * 2);
+	std::vector<GLuint> ids(capacity);
+	for (size_t i = 0; i < capacity; i++)
+		ids[i] = (GLuint)i;
+	//same buffer name is kept, so the VAO binding stays valid.
+	m_drawIdBuffer->upload(capacity*sizeof(GLuint), capacity, ids.data());
+}
+
+}
@@ -0,0 +1,294 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <sstream>
+#include <algorithm>
+#include <GL/glew.h>
+#include "GLError.h"
+#include "GLDrawCuller.h"
+#include "GLHiZShader.h"
+
+namespace davinci{
+
+//Hi-Z level l is stored right after level l-1 in one float SSBO.
+//Level sizes are halved rounding up, so every texel of level l-1 is
+//covered by a texel of level l.
+static const char* g_hizInitShaderSrc =
+"#version 430\n"
+"layout(local_size_x = 8, local_size_y = 8) in;\n"
+"layout(std430) writeonly buffer HiZ { float hiz[]; };\n"
+"uniform sampler2D depthTex;\n"
+"uniform ivec2 dstSize;\n"
+"void main()\n"
+"{\n"
+"	ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+"	if (any(greaterThanEqual(p, dstSize))) return;\n"
+"	hiz[p.y*dstSize.x + p.x] = texelFetch(depthTex, p, 0).r;\n"
+"}\n";
+
+static const char* g_hizReduceShaderSrc =
+"#version 430\n"
+"layout(local_size_x = 8, local_size_y = 8) in;\n"
+"layout(std430) buffer HiZ { float hiz[]; };\n"
+"uniform int   srcOffset;\n"
+"uniform ivec2 srcSize;\n"
+"uniform int   dstOffset;\n"
+"uniform ivec2 dstSize;\n"
+"void main()\n"
+"{\n"
+"	ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+"	if (any(greaterThanEqual(p, dstSize))) return;\n"
+"	//the last row/column of an odd sized level folds in one more texel.\n"
+"	int xEnd = (p.x == dstSize.x-1 && (srcSize.x & 1) == 1) ? 2 : 1;\n"
+"	int yEnd = (p.y == dstSize.y-1 && (srcSize.y & 1) == 1) ? 2 : 1;\n"
+"	float z = 0.0;\n"
+"	for (int dy = 0; dy <= yEnd; dy++)\n"
+"	for (int dx = 0; dx <= xEnd; dx++)\n"
+"	{\n"
+"		ivec2 q = min(p*2 + ivec2(dx, dy), srcSize - 1);\n"
+"		z = max(z, hiz[srcOffset + q.y*srcSize.x + q.x]);\n"
+"	}\n"
+"	hiz[dstOffset + p.y*dstSize.x + p.x] = z;\n"
+"}\n";
+
+static const char* g_cullShaderSrc =
+"#version 430\n"
+"layout(local_size_x = 64) in;\n"
+"struct DrawCommand { uint count; uint instanceCount; uint firstIndex; int baseVertex; uint baseInstance; };\n"
+"layout(std430) readonly  buffer SrcCommands { DrawCommand srcCommands[]; };\n"
+"layout(std430) writeonly buffer DstCommands { DrawCommand dstCommands[]; };\n"
+"layout(std430) readonly  buffer Bounds { vec4 bounds[]; };\n"
+"layout(binding = 0, offset = 0) uniform atomic_uint visibleCount;\n"
+"uniform mat4  viewProj;\n"
+"uniform uint  objectCount;\n"
+HIZ_TEST_SHADER_SRC
+"//culled only if all 8 corners are outside of the same clip plane.\n"
+"bool insideFrustum(vec3 bmin, vec3 bmax)\n"
+"{\n"
+"	ivec3 below = ivec3(0), above = ivec3(0);\n"
+"	for (int i = 0; i < 8; i++)\n"
+"	{\n"
+"		vec4 c = viewProj * vec4(corner(bmin, bmax, i), 1.0);\n"
+"		below += ivec3(lessThan(c.xyz, vec3(-c.w)));\n"
+"		above += ivec3(greaterThan(c.xyz, vec3(c.w)));\n"
+"	}\n"
+"	return !(any(equal(below, ivec3(8))) || any(equal(above, ivec3(8))));\n"
+"}\n"
+"void main()\n"
+"{\n"
+"	uint i = gl_GlobalInvocationID.x;\n"
+"	if (i >= objectCount) return;\n"
+"	DrawCommand cmd = srcCommands[i];\n"
+"	if (cmd.instanceCount == 0u) return;\n"
+"	vec3 bmin = bounds[2u*i].xyz;\n"
+"	vec3 bmax = bounds[2u*i + 1u].xyz;\n"
+"	if (insideFrustum(bmin, bmax) && (hizLevels == 0 || notOccluded(bmin, bmax)))\n"
+"	{\n"
+"		dstCommands[atomicCounterIncrement(visibleCount)] = cmd;\n"
+"	}\n"
+"}\n";
+
+GLDrawCuller::GLDrawCuller()
+	:m_boundsCount(0), m_culledCount(0), m_hizWidth(0), m_hizHeight(0),
+	 m_hizLevels(0), m_useOcclusion(true), m_hasIndirectCount(false)
+{
+	m_bounds = GLShaderStorageBufferObjectRef(
+		new GLShaderStorageBufferObject("GLDrawCuller bounds", GL_STATIC_DRAW));
+	m_culled = GLShaderStorageBufferObjectRef(
+		new GLShaderStorageBufferObject("GLDrawCuller culled commands", GL_DYNAMIC_COPY));
+	m_hiz = GLShaderStorageBufferObjectRef(
+		new GLShaderStorageBufferObject("GLDrawCuller Hi-Z pyramid", GL_DYNAMIC_COPY));
+	m_visibleCounter = GLAtomicCounterRef(new GLAtomicCounter("GLDrawCuller visible count"));
+	m_visibleCounter->alloc(1);
+	//a valid, if meaningless, store until the first buildHiZ().
+	float farDepth = 1.0f;
+	m_hiz->upload(sizeof(farDepth), &farDepth);
+#if !defined(__APPLE__) && !defined(MACOSX)
+	m_hasIndirectCount = glewIsSupported("GL_ARB_indirect_parameters") != 0;
+#endif
+}
+
+GLDrawCuller::~GLDrawCuller()
+{
+}
+
+void GLDrawCuller::createShaders()
+{
+	std::string src(g_cullShaderSrc);
+	m_cullShader = GLComputeShaderRef(new GLComputeShader("GLDrawCuller cull"));
+	m_cullShader->setComputeShaderStr(src);
+	m_cullShader->CreateShaders();
+
+	src = g_hizInitShaderSrc;
+	m_hizInitShader = GLComputeShaderRef(new GLComputeShader("GLDrawCuller Hi-Z init"));
+	m_hizInitShader->setComputeShaderStr(src);
+	m_hizInitShader->CreateShaders();
+
+	src = g_hizReduceShaderSrc;
+	m_hizReduceShader = GLComputeShaderRef(new GLComputeShader("GLDrawCuller Hi-Z reduce"));
+	m_hizReduceShader->setComputeShaderStr(src);
+	m_hizReduceShader->CreateShaders();
+}
+
+void GLDrawCuller::setBounds(const std::vector<BBox>& bounds)
+{
+	//std430 vec4 pairs: (pMin,1),(pMax,1).
+	std::vector<float> packed(bounds.size() * 8);
+	for (size_t i = 0; i < bounds.size(); i++)
+	{
+		float* p = &packed[i * 8];
+		p[0] = bounds[i].pMin.x(); p[1] = bounds[i].pMin.y(); p[2] = bounds[i].pMin.z(); p[3] = 1.0f;
+		p[4] = bounds[i].pMax.x(); p[5] = bounds[i].pMax.y(); p[6] = bounds[i].pMax.z(); p[7] = 1.0f;
+	}
+	m_boundsCount = bounds.size();
+	if (!packed.empty())
+	{
+		m_bounds->upload(packed.size()*sizeof(float), packed.data());
+	}
+}
+
+void GLDrawCuller::buildHiZ(const GLTexture2DRef& depthTex, const mat4& viewProj)
+{
+	if (!m_cullShader)
+	{
+		createShaders();
+	}
+	int w = depthTex->getWidth(), h = depthTex->getHeight();
+	std::vector<int> offsets, widths, heights;
+	size_t total = 0;
+	for (int lw = w, lh = h; ; lw = std::max((lw + 1) / 2, 1), lh = std::max((lh + 1) / 2, 1))
+	{
+		offsets.push_back((int)total);
+		widths.push_back(lw);
+		heights.push_back(lh);
+		total += size_t(lw) * lh;
+		if (lw == 1 && lh == 1) break;
+	}
+	if (m_hiz->getSizeInBytes() < total * sizeof(float))
+	{
+		m_hiz->upload(total * sizeof(float), NULL);
+	}
+
+	m_hizInitShader->SetSamplerUniform("depthTex", depthTex.get());
+	m_hizInitShader->SetInt2Uniform("dstSize", vec2i(w, h));
+	m_hizInitShader->SetShaderStorageBlockUniform("HiZ", m_hiz);
+	m_hizInitShader->UseShaders((w + 7) / 8, (h + 7) / 8, 1);
+	m_hizInitShader->ReleaseShader();
+
+	m_hizReduceShader->SetShaderStorageBlockUniform("HiZ", m_hiz);
+	for (size_t l = 1; l < offsets.size(); l++)
+	{
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		m_hizReduceShader->SetIntUniform("srcOffset", offsets[l - 1]);
+		m_hizReduceShader->SetInt2Uniform("srcSize", vec2i(widths[l - 1], heights[l - 1]));
+		m_hizReduceShader->SetIntUniform("dstOffset", offsets[l]);
+		m_hizReduceShader->SetInt2Uniform("dstSize", vec2i(widths[l], heights[l]));
+		m_hizReduceShader->UseShaders((widths[l] + 7) / 8, (heights[l] + 7) / 8, 1);
+	}
+	m_hizReduceShader->ReleaseShader();
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	GLError::glCheckError(__func__);
+
+	m_hizViewProj = viewProj;
+	m_hizWidth  = w;
+	m_hizHeight = h;
+	m_hizLevels = (int)offsets.size();
+}
+
+void GLDrawCuller::cull(GLDrawBatch& batch, const GLCamera& camera)
+{
+	cull(batch, camera.getProjectionMatrix() * camera.getViewingMatrix());
+}
+
+void GLDrawCuller::cull(GLDrawBatch& batch, const mat4& viewProj)
+{
+	size_t count = batch.getDrawCount();
+	m_culledCount = count;
+	if (count == 0) return;
+	if (count != m_boundsCount)
+	{
+		std::stringstream ss;
+		ss << __func__ << ": the batch queues " << count << " draws but "
+		   << m_boundsCount << " bounds are set.";
+		GLError::ErrorMessage(ss.str());
+	}
+	if (!m_cullShader)
+	{
+		createShaders();
+	}
+	batch.upload();
+
+	size_t bytes = count * sizeof(GLDrawElementsIndirectCommand);
+	if (m_culled->getSizeInBytes() < bytes)
+	{
+		m_culled->upload(bytes, NULL);
+	}
+	if (!m_hasIndirectCount)
+	{//commands past the visible count must draw nothing.
+		m_culled->bindBufferObject();
+		glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, bytes,
+							 GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+		m_culled->unbindBufferObject();
+	}
+	m_visibleCounter->reset(0);
+
+	int hizLevels = (m_useOcclusion && m_hizLevels > 0) ? m_hizLevels : 0;
+	m_cullShader->SetShaderStorageBlockUniform("SrcCommands", batch.getIndirectBuffer());
+	m_cullShader->SetShaderStorageBlockUniform("DstCommands", m_culled);
+	m_cullShader->SetShaderStorageBlockUniform("Bounds", m_bounds);
+	m_cullShader->SetShaderStorageBlockUniform("HiZ", m_hiz);
+	m_cullShader->SetAtomicCounterUniform("visibleCount", m_visibleCounter);
+	m_cullShader->SetMatrixUniform("viewProj", viewProj);
+	m_cullShader->SetMatrixUniform("hizViewProj", m_hizViewProj);
+	m_cullShader->SetUintUniform("objectCount", (GLuint)count);
+	m_cullShader->SetInt2Uniform("hizSize", vec2i(std::max(m_hizWidth, 1), std::max(m_hizHeight, 1)));
+	m_cullShader->SetIntUniform("hizLevels", hizLevels);
+	m_cullShader->UseShaders((GLuint)((count + 63) / 64), 1, 1);
+	m_cullShader->ReleaseShader();
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT |
+					GL_ATOMIC_COUNTER_BARRIER_BIT);
+	GLError::glCheckError(__func__);
+}
+
+void GLDrawCuller::draw(GLDrawBatch& batch)
+{
+	if (m_culledCount == 0) return;
+	if (m_hasIndirectCount)
+	{
+		batch.getVAO()->multiDrawElementsIndirectCount(*m_culled, *m_visibleCounter,
+													   (GLsizei)m_culledCount);
+	}
+	else
+	{
+		batch.getVAO()->multiDrawElementsIndirect(*m_culled, (GLsizei)m_culledCount);
+	}
+	GLError::glCheckError(__func__);
+}
+
+GLuint GLDrawCuller::readVisibleCount()
+{
+	GLuint visible = 0;
+	m_visibleCounter->readCounters(&visible);
+	return visible;
+}
+
+}
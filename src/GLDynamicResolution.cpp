@@ -0,0 +1,197 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cmath>
+#include <algorithm>
+#include <GL/glew.h>
+#include "GLError.h"
+#include "GLDynamicResolution.h"
+#include "GLRenderTargetPool.h"
+
+namespace davinci{
+
+GLDynamicResolution::GLDynamicResolution(float targetFrameMs/*=16.0f*/, int idleDelayMs/*=200*/)
+	:m_targetMs(targetFrameMs), m_minScale(0.25f), m_maxScale(1.0f), m_scale(1.0f),
+	 m_gpuMs(-1.0f), m_lastFull(true), m_idleDelay(idleDelayMs),
+	 m_queryHead(0), m_queryCount(0), m_measuring(false), m_width(0), m_height(0)
+{
+	for (int i = 0; i < N_QUERIES; i++)
+	{
+		m_queries[i] = 0;
+		m_queryScale[i] = 1.0f;
+	}
+}
+
+GLDynamicResolution::~GLDynamicResolution()
+{
+	if (m_queries[0])
+	{
+		glDeleteQueries(N_QUERIES, m_queries);
+	}
+}
+
+void GLDynamicResolution::setScaleRange(float minScale, float maxScale)
+{
+	m_maxScale = std::min(std::max(maxScale, 0.01f), 1.0f);
+	m_minScale = std::min(std::max(minScale, 0.01f), m_maxScale);
+	m_scale = std::min(std::max(m_scale, m_minScale), 1.0f);
+}
+
+void GLDynamicResolution::notifyInteraction()
+{
+	m_lastInteraction = std::chrono::steady_clock::now();
+}
+
+bool GLDynamicResolution::needsRefresh() const
+{
+	return !m_lastFull && std::chrono::steady_clock::now() - m_lastInteraction >= m_idleDelay;
+}
+
+float GLDynamicResolution::computeScale(float scale, float fullResMs, float targetMs, float minScale, float maxScale)
+{
+	if (fullResMs > 0.0f && targetMs > 0.0f)
+	{
+		float ideal = sqrtf(targetMs / fullResMs);
+		//the dead band keeps timer noise from resizing every frame.
+		if (fabsf(ideal - scale) > 0.05f * scale)
+			scale += 0.5f * (ideal - scale);
+	}
+	return std::min(std::max(scale, minScale), maxScale);
+}
+
+bool GLDynamicResolution::isInteracting(const GLCamera* camera)
+{
+	if (camera)
+	{
+		mat4 view = camera->getViewingMatrix();
+		mat4 proj = camera->getProjectionMatrix();
+		if (camera->IsRoaming() || view != m_lastView || proj != m_lastProj)
+		{
+			notifyInteraction();
+		}
+		m_lastView = view;
+		m_lastProj = proj;
+	}
+	return std::chrono::steady_clock::now() - m_lastInteraction < m_idleDelay;
+}
+
+void GLDynamicResolution::beginQuery(float scale)
+{
+	if (!m_queries[0])
+	{
+		glGenQueries(N_QUERIES, m_queries);
+	}
+	//skip measuring this frame if every query is still in flight.
+	m_measuring = m_queryCount < N_QUERIES;
+	if (!m_measuring)
+		return;
+	int slot = (m_queryHead + m_queryCount) % N_QUERIES;
+	m_queryScale[slot] = scale;
+	glBeginQuery(GL_TIME_ELAPSED, m_queries[slot]);
+}
+
+void GLDynamicResolution::endQuery()
+{
+	if (!m_measuring)
+		return;
+	glEndQuery(GL_TIME_ELAPSED);
+	m_queryCount++;
+}
+
+void GLDynamicResolution::readQueries()
+{
+	while (m_queryCount > 0)
+	{
+		GLuint id = m_queries[m_queryHead];
+		GLint available = 0;
+		glGetQueryObjectiv(id, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+		GLuint64 ns = 0;
+		glGetQueryObjectui64v(id, GL_QUERY_RESULT, &ns);
+		float s = m_queryScale[m_queryHead];
+		float fullMs = float(ns) * 1e-6f / (s * s);
+		m_gpuMs = m_gpuMs < 0.0f ? fullMs : 0.7f * m_gpuMs + 0.3f * fullMs;
+		m_queryHead = (m_queryHead + 1) % N_QUERIES;
+		m_queryCount--;
+	}
+}
+
+bool GLDynamicResolution::render(drawCallBack renderCallBack, void* params, const GLCamera* camera/*=NULL*/)
+{
+	readQueries();
+	if (isInteracting(camera))
+	{
+		m_scale = computeScale(m_scale, m_gpuMs, m_targetMs, m_minScale, m_maxScale);
+	}else{
+		m_scale = 1.0f;
+	}
+
+	GLint viewport[4], targetFbo = 0;
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFbo);
+	int w = std::max(1, int(viewport[2] * m_scale + 0.5f));
+	int h = std::max(1, int(viewport[3] * m_scale + 0.5f));
+	if (m_scale >= 1.0f || (w == viewport[2] && h == viewport[3]))
+	{
+		beginQuery(1.0f);
+		renderCallBack(params);
+		endQuery();
+		m_lastFull = true;
+		return true;
+	}
+
+	if (!m_fbo || m_width < viewport[2] || m_height < viewport[3])
+	{//sized for the full viewport, smaller frames use its lower left corner.
+		m_width = viewport[2];
+		m_height = viewport[3];
+		GLRenderTargetPoolRef pool = GLRenderTargetPool::getDefault();
+		pool->release(m_colorTex);
+		pool->release(m_depth);
+		m_colorTex = pool->acquireTexture(m_width, m_height, GL_RGBA8);
+		m_colorTex->setName("GLDynamicResolution::m_colorTex");
+		m_depth = pool->acquireRenderbuffer(m_width, m_height, GL_DEPTH_COMPONENT24);
+		m_fbo = GLFrameBufferObjectRef(new GLFrameBufferObject(GL_FRAMEBUFFER));
+		m_fbo->bind();
+		m_fbo->attachColorBuffer(0, m_colorTex);
+		m_fbo->attachDepthBuffer(m_depth);
+		m_fbo->unbind();
+	}
+	GLint prevRead = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prevRead);
+	m_fbo->bind();
+	glViewport(0, 0, w, h);
+	beginQuery(float(w) / viewport[2]);
+	renderCallBack(params);
+	endQuery();
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFbo);
+	glBlitFramebuffer(0, 0, w, h, viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3],
+					  GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, prevRead);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	GLError::glCheckError(__func__);
+	m_lastFull = false;
+	return false;
+}
+
+}
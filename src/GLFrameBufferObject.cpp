@@ -96,6 +96,21 @@ void GLFrameBufferObject::attachColorBuffer( GLuint attachId, const GLTexture2DR
     m_attachedTextureND[attachId] = &*tex2dRef;
 }
 
+void GLFrameBufferObject::attachColorBuffer( GLuint attachId, const GLRenderbufferObjectRef& buffer )
+{
+	if (!buffer)
+	{
+		cerr << __func__<< ": attached renderbuffer is NULL!\n";
+		exit(1);
+	}
+    if(!m_isBinded) 
+        GLError::ErrorMessage(string(__func__)+string(": Please bind the GLFrameBufferObject before attaching color buffer."));
+    glFramebufferRenderbuffer(m_target, GL_COLOR_ATTACHMENT0+attachId,
+                              GL_RENDERBUFFER, buffer->getBufferId());
+    m_attachedTextureND[attachId] = NULL;
+	GLError::glCheckError(string(__func__)+": attachColorBuffer() failed!");
+}
+
 void GLFrameBufferObject::attachDepthBuffer( const GLRenderbufferObjectRef &buffer )
 {
 	if (!buffer)
@@ -139,13 +154,34 @@ void GLFrameBufferObject::attachTextureND( GLuint attachId, const GLTextureAbstr
     }else if (tex.getTarget() == GL_TEXTURE_3D)
     {
 		glFramebufferTexture3D(m_target,GLAttachmentID,GL_TEXTURE_3D,tex.getTextureId(),mipLevel,zLayer);
+    }else if (tex.getTarget() == GL_TEXTURE_2D_ARRAY)
+    {
+		glFramebufferTextureLayer(m_target, GLAttachmentID, tex.getTextureId(), mipLevel, zLayer);
     }else{
-		GLError::ErrorMessage(string(__func__)+"Unrecognized texture target, make sure it is one of GL_TEXTURE_1D, GL_TEXTURE_2D and GL_TEXTURE_3D.");
+		GLError::ErrorMessage(string(__func__)+"Unrecognized texture target, make sure it is one of GL_TEXTURE_1D, GL_TEXTURE_2D, GL_TEXTURE_3D and GL_TEXTURE_2D_ARRAY.");
 	}
 	m_attachedTextureND[attachId] = const_cast<GLTextureAbstract*>(&tex);
 	GLError::glCheckError(string(__func__)+": failed!");
 }
 
+void GLFrameBufferObject::attachLayeredTexture(GLenum attachment, const GLTextureAbstract& tex, int mipLevel/*=0*/)
+{
+	if (!m_isBinded)
+	{
+		GLError::ErrorMessage(string(__func__)+string(": Please bind the GLFrameBufferObject before attaching layered texture."));
+	}
+	if (tex.getTarget() != GL_TEXTURE_3D && tex.getTarget() != GL_TEXTURE_2D_ARRAY)
+	{
+		GLError::ErrorMessage(string(__func__)+": layered attachment requires GL_TEXTURE_3D or GL_TEXTURE_2D_ARRAY.");
+	}
+	glFramebufferTexture(m_target, attachment, tex.getTextureId(), mipLevel);
+	if (attachment >= GL_COLOR_ATTACHMENT0 && attachment - GL_COLOR_ATTACHMENT0 < m_attachedTextureND.size())
+	{
+		m_attachedTextureND[attachment - GL_COLOR_ATTACHMENT0] = const_cast<GLTextureAbstract*>(&tex);
+	}
+	GLError::glCheckError(string(__func__)+": failed!");
+}
+
 vec3f GLFrameBufferObject::getTextureDimension(int attachId/*=-1*/) const
 {
     GLTextureAbstract* attachedImage=NULL;
@@ -0,0 +1,497 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <GL/glew.h>
+#include "GLError.h"
+#include "GLFrameCapture.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GLCAPTURE_SSE
+#endif
+
+namespace davinci{
+
+namespace{
+	//BT.601 full range in 1.15 fixed point.
+	const int Y_R = 9798, Y_G = 19235, Y_B = 3736;
+	const int U_R = -5529, U_G = -10855, U_B = 16384;
+	const int V_R = 16384, V_G = -13720, V_B = -2664;
+
+	inline unsigned char clampByte(int v)
+	{
+		return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+	}
+
+	struct CrcTable
+	{
+		unsigned int entry[256];
+		CrcTable()
+		{
+			for (unsigned int n = 0; n < 256; n++)
+			{
+				unsigned int c = n;
+				for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				entry[n] = c;
+			}
+		}
+	};
+
+	const unsigned int* crcTable()
+	{
+		static const CrcTable table;//thread safe initialization in C++11
+		return table.entry;
+	}
+
+	unsigned int crc32(unsigned int crc, const unsigned char* data, size_t n)
+	{
+		const unsigned int* table = crcTable();
+		crc = ~crc;
+		for (size_t i = 0; i < n; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	void putBE32(unsigned char* p, unsigned int v)
+	{
+		p[0] = (unsigned char)(v >> 24); p[1] = (unsigned char)(v >> 16);
+		p[2] = (unsigned char)(v >> 8);  p[3] = (unsigned char)v;
+	}
+
+	bool writeChunk(FILE* fp, const char* type, const unsigned char* data, size_t n)
+	{
+		unsigned char head[8];
+		putBE32(head, (unsigned int)n);
+		memcpy(head + 4, type, 4);
+		unsigned int crc = crc32(crc32(0, head + 4, 4), data, n);
+		unsigned char tail[4];
+		putBE32(tail, crc);
+		return fwrite(head, 1, 8, fp) == 8 && (n == 0 || fwrite(data, 1, n, fp) == n) &&
+			   fwrite(tail, 1, 4, fp) == 4;
+	}
+}
+
+void GLFrameCapture::flipRows(unsigned char* dst, const unsigned char* src, size_t rowBytes, int rows)
+{
+	//memcpy is vectorized by every C runtime, one call per row.
+	for (int y = 0; y < rows; y++)
+		memcpy(dst + size_t(y) * rowBytes, src + size_t(rows - 1 - y) * rowBytes, rowBytes);
+}
+
+void GLFrameCapture::rgbaToYuv420(const unsigned char* rgba, int width, int height,
+								  unsigned char* yPlane, unsigned char* uPlane, unsigned char* vPlane)
+{
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned char* src = rgba + size_t(y) * width * 4;
+		unsigned char* dst = yPlane + size_t(y) * width;
+		int x = 0;
+#ifdef GLCAPTURE_SSE
+		//4 pixels per step: madd gives R*cR+G*cG and B*cB per pixel.
+		const __m128i coeff = _mm_setr_epi16(Y_R, Y_G, Y_B, 0, Y_R, Y_G, Y_B, 0);
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i round = _mm_set1_epi32(1 << 14);
+		for (; x + 4 <= width; x += 4)
+		{
+			__m128i px = _mm_loadu_si128((const __m128i*)(src + x * 4));
+			__m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(px, zero), coeff);
+			__m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(px, zero), coeff);
+			lo = _mm_add_epi32(lo, _mm_srli_epi64(lo, 32));//sums in lanes 0 and 2
+			hi = _mm_add_epi32(hi, _mm_srli_epi64(hi, 32));
+			lo = _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 1, 2, 0));
+			hi = _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 1, 2, 0));
+			__m128i sum = _mm_unpacklo_epi64(lo, hi);
+			sum = _mm_srai_epi32(_mm_add_epi32(sum, round), 15);
+			sum = _mm_packs_epi32(sum, sum);
+			sum = _mm_packus_epi16(sum, sum);
+			int packed = _mm_cvtsi128_si32(sum);
+			memcpy(dst + x, &packed, 4);
+		}
+#endif
+		for (; x < width; x++)
+		{
+			const unsigned char* p = src + x * 4;
+			dst[x] = clampByte((Y_R * p[0] + Y_G * p[1] + Y_B * p[2] + (1 << 14)) >> 15);
+		}
+	}
+	//chroma from the average of each 2x2 block, clamped at odd edges.
+	int cw = (width + 1) / 2, ch = (height + 1) / 2;
+	for (int cy = 0; cy < ch; cy++)
+	{
+		const unsigned char* row0 = rgba + size_t(2 * cy) * width * 4;
+		const unsigned char* row1 = rgba + size_t(std::min(2 * cy + 1, height - 1)) * width * 4;
+		for (int cx = 0; cx < cw; cx++)
+		{
+			int x0 = 2 * cx * 4, x1 = std::min(2 * cx + 1, width - 1) * 4;
+			int r = (row0[x0] + row0[x1] + row1[x0] + row1[x1] + 2) >> 2;
+			int g = (row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1] + 2) >> 2;
+			int b = (row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2] + 2) >> 2;
+			uPlane[size_t(cy) * cw + cx] = clampByte(((U_R * r + U_G * g + U_B * b + (1 << 14)) >> 15) + 128);
+			vPlane[size_t(cy) * cw + cx] = clampByte(((V_R * r + V_G * g + V_B * b + (1 << 14)) >> 15) + 128);
+		}
+	}
+}
+
+bool GLFrameCapture::writePng(const std::string& fileName, const unsigned char* pixels,
+							  int width, int height, int channels)
+{
+	if (width <= 0 || height <= 0 || (channels != 3 && channels != 4))
+		return false;
+	FILE* fp = fopen(fileName.c_str(), "wb");
+	if (!fp)
+		return false;
+	static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	unsigned char ihdr[13];
+	putBE32(ihdr, width);
+	putBE32(ihdr + 4, height);
+	ihdr[8] = 8;//bit depth
+	ihdr[9] = channels == 4 ? 6 : 2;//RGBA : RGB
+	ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+	//zlib stream of stored deflate blocks over filter type 0 rows, which
+	//keeps encoding at memory speed; recompress offline if size matters.
+	size_t rowBytes = size_t(width) * channels;
+	size_t rawBytes = (rowBytes + 1) * height;
+	size_t nBlocks = (rawBytes + 65534) / 65535;
+	std::vector<unsigned char> idat(2 + nBlocks * 5 + rawBytes + 4);
+	unsigned char* out = &idat[0];
+	*out++ = 0x78; *out++ = 0x01;
+	unsigned int s1 = 1, s2 = 0;//adler32
+	size_t row = 0, col = 0;//next raw byte: col 0 is the filter byte.
+	for (size_t block = 0; block < nBlocks; block++)
+	{
+		size_t n = std::min<size_t>(65535, rawBytes - block * 65535);
+		*out++ = block + 1 == nBlocks ? 1 : 0;
+		*out++ = (unsigned char)n; *out++ = (unsigned char)(n >> 8);
+		*out++ = (unsigned char)~n; *out++ = (unsigned char)(~n >> 8);
+		unsigned char* begin = out;
+		while (n)
+		{
+			if (col == 0)
+			{
+				*out++ = 0;
+				col = 1;
+				n--;
+				continue;
+			}
+			size_t take = std::min(n, rowBytes + 1 - col);
+			memcpy(out, pixels + row * rowBytes + (col - 1), take);
+			out += take;
+			n -= take;
+			col += take;
+			if (col == rowBytes + 1) { col = 0; row++; }
+		}
+		for (unsigned char* p = begin; p < out; )
+		{
+			//5552 bytes keep s2 below 2^32 between reductions.
+			unsigned char* end = std::min(out, p + 5552);
+			for (; p < end; p++) { s1 += *p; s2 += s1; }
+			s1 %= 65521; s2 %= 65521;
+		}
+	}
+	putBE32(out, (s2 << 16) | s1);
+
+	bool ok = fwrite(signature, 1, 8, fp) == 8 &&
+			  writeChunk(fp, "IHDR", ihdr, 13) &&
+			  writeChunk(fp, "IDAT", &idat[0], idat.size()) &&
+			  writeChunk(fp, "IEND", NULL, 0);
+	ok = fclose(fp) == 0 && ok;
+	return ok;
+}
+
+GLFrameCapture::GLFrameCapture(int nEncoderThreads/*=2*/, int queueCapacity/*=8*/, int readbackDepth/*=3*/)
+	:m_frames(std::max(queueCapacity, 1)),
+	 m_freeFrames(std::max(queueCapacity, 1)), m_encodeQueue(std::max(queueCapacity, 1)),
+	 m_readbacks(std::max(readbackDepth, 1)), m_nextReadback(0), m_pendingReadbacks(0),
+	 m_quit(false), m_inFlight(0), m_captured(0), m_dropped(0), m_encoded(0), m_failed(0),
+	 m_maxQueueDepth(0), m_y4m(NULL), m_y4mFpsNum(30), m_y4mFpsDen(1), m_y4mWidth(0), m_y4mHeight(0),
+	 m_y4mNextCapture(0), m_y4mNextWrite(0)
+{
+	for (size_t i = 0; i < m_frames.size(); i++)
+		m_freeFrames.push(&m_frames[i]);
+	for (size_t i = 0; i < m_readbacks.size(); i++)
+	{
+		m_readbacks[i].fence = 0;
+		m_readbacks[i].frame = NULL;
+	}
+	for (int i = 0; i < std::max(nEncoderThreads, 1); i++)
+		m_encoders.push_back(std::thread(&GLFrameCapture::encoderLoop, this));
+}
+
+GLFrameCapture::~GLFrameCapture()
+{
+	flush();
+	m_quit = true;
+	m_wake.notify_all();
+	for (size_t i = 0; i < m_encoders.size(); i++)
+		m_encoders[i].join();
+	closeY4M();
+}
+
+bool GLFrameCapture::openY4M(const std::string& fileName, int fpsNum/*=30*/, int fpsDen/*=1*/)
+{
+	closeY4M();
+	std::lock_guard<std::mutex> lock(m_y4mMutex);
+	m_y4m = fopen(fileName.c_str(), "wb");
+	if (!m_y4m)
+	{
+		GLError::ErrorMessage(std::string(__func__) + ": cannot open " + fileName);
+		return false;
+	}
+	m_y4mFpsNum = fpsNum;
+	m_y4mFpsDen = fpsDen;
+	m_y4mWidth = m_y4mHeight = 0;
+	m_y4mNextCapture = m_y4mNextWrite = 0;
+	return true;
+}
+
+void GLFrameCapture::closeY4M()
+{
+	if (!m_y4m)
+		return;
+	flush();
+	std::lock_guard<std::mutex> lock(m_y4mMutex);
+	fclose(m_y4m);
+	m_y4m = NULL;
+}
+
+bool GLFrameCapture::capture(int x, int y, int width, int height, const std::string& fileName,
+							 Format format/*=FORMAT_PNG*/, bool alpha/*=false*/, GLenum whichBuffer/*=GL_BACK*/)
+{
+	if (width <= 0 || height <= 0)
+		return false;
+	poll();
+	Readback& r = m_readbacks[m_nextReadback];
+	if (r.frame)
+	{//every PBO is in flight: wait for the GPU, never for an encoder.
+		glClientWaitSync(r.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+		harvest(r);
+	}
+	Frame* frame = NULL;
+	if (!m_freeFrames.pop(frame))
+	{
+		m_dropped++;
+		return false;
+	}
+	m_inFlight++;
+	frame->width = width;
+	frame->height = height;
+	frame->channels = (format == FORMAT_Y4M || alpha) ? 4 : 3;
+	frame->format = format;
+	frame->fileName = fileName;
+	frame->sequence = -1;
+	if (format == FORMAT_Y4M)
+	{
+		std::lock_guard<std::mutex> lock(m_y4mMutex);
+		if (m_y4m && m_y4mNextCapture == 0)
+		{
+			m_y4mWidth = width;
+			m_y4mHeight = height;
+			fprintf(m_y4m, "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C420jpeg XCOLORRANGE=FULL\n",
+					width, height, m_y4mFpsNum, m_y4mFpsDen);
+		}
+		if (!m_y4m || width != m_y4mWidth || height != m_y4mHeight)
+		{
+			m_failed++;
+			release(frame);
+			return false;
+		}
+		frame->sequence = m_y4mNextCapture++;
+	}
+
+	GLenum pixelFormat = frame->channels == 4 ? GL_RGBA : GL_RGB;
+	if (!r.pbo || (GLenum)r.pbo->getFormat() != pixelFormat)
+	{
+		r.pbo = GLPixelBufferObjectRef(new GLPixelBufferObject(width, height, pixelFormat,
+															   GL_UNSIGNED_BYTE, GL_STREAM_READ));
+	}
+	else if (r.pbo->getWidth() != width || r.pbo->getHeight() != height)
+	{
+		r.pbo->resize(width, height);
+	}
+	GLint packAlignment = 4;
+	glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadBuffer(whichBuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo->getId());
+	glReadPixels(x, y, width, height, pixelFormat, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+	r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	r.frame = frame;
+	m_pendingReadbacks++;
+	m_nextReadback = (m_nextReadback + 1) % (int)m_readbacks.size();
+	m_captured++;
+	GLError::glCheckError(__func__);
+	return true;
+}
+
+void GLFrameCapture::poll()
+{
+	int n = (int)m_readbacks.size();
+	while (m_pendingReadbacks > 0)
+	{
+		Readback& r = m_readbacks[(m_nextReadback - m_pendingReadbacks + n) % n];
+		GLenum status = glClientWaitSync(r.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		harvest(r);
+	}
+}
+
+void GLFrameCapture::harvest(Readback& r)
+{
+	Frame* frame = r.frame;
+	size_t rowBytes = size_t(frame->width) * frame->channels;
+	frame->pixels.resize(rowBytes * frame->height);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, r.pbo->getId());
+	const unsigned char* src = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+		rowBytes * frame->height, GL_MAP_READ_BIT);
+	if (src)
+	{
+		flipRows(&frame->pixels[0], src, rowBytes, frame->height);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glDeleteSync(r.fence);
+	r.fence = 0;
+	r.frame = NULL;
+	m_pendingReadbacks--;
+	if (!src)
+	{
+		GLError::glCheckError(__func__);
+		//encode() counts it as failed, a Y4M frame still passes its turn.
+		frame->pixels.clear();
+	}
+	//holds every frame buffer, so it never fills up.
+	m_encodeQueue.push(frame);
+	int depth = m_encodeQueue.size();
+	int maxDepth = m_maxQueueDepth.load();
+	while (depth > maxDepth && !m_maxQueueDepth.compare_exchange_weak(maxDepth, depth)) {}
+	m_wake.notify_one();
+}
+
+void GLFrameCapture::flush()
+{
+	while (m_pendingReadbacks > 0)
+	{
+		int n = (int)m_readbacks.size();
+		Readback& r = m_readbacks[(m_nextReadback - m_pendingReadbacks + n) % n];
+		glClientWaitSync(r.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1000000000));
+		harvest(r);
+	}
+	m_wake.notify_all();
+	{
+		std::unique_lock<std::mutex> lock(m_drainMutex);
+		m_drained.wait(lock, [this] { return m_inFlight.load() == 0; });
+	}
+	std::lock_guard<std::mutex> lock(m_y4mMutex);
+	if (m_y4m) fflush(m_y4m);
+}
+
+GLFrameCaptureStats GLFrameCapture::getStats() const
+{
+	GLFrameCaptureStats stats;
+	stats.captured = m_captured.load();
+	stats.dropped = m_dropped.load();
+	stats.encoded = m_encoded.load();
+	stats.failed = m_failed.load();
+	stats.pendingReadbacks = m_pendingReadbacks;
+	stats.queueDepth = std::max(m_encodeQueue.size(), 0);
+	stats.maxQueueDepth = m_maxQueueDepth.load();
+	return stats;
+}
+
+void GLFrameCapture::release(Frame* frame)
+{
+	m_freeFrames.push(frame);
+	if (--m_inFlight == 0)
+	{
+		std::lock_guard<std::mutex> lock(m_drainMutex);
+		m_drained.notify_all();
+	}
+}
+
+void GLFrameCapture::encoderLoop()
+{
+	for (;;)
+	{
+		Frame* frame = NULL;
+		if (m_encodeQueue.pop(frame))
+		{
+			encode(frame);
+			release(frame);
+			continue;
+		}
+		if (m_quit)
+			break;
+		//the render thread notifies without locking, the timeout covers a
+		//wake up that slips in before this wait.
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_wake.wait_for(lock, std::chrono::milliseconds(2));
+	}
+}
+
+void GLFrameCapture::encode(Frame* frame)
+{
+	bool ok = false;
+	bool mapped = !frame->pixels.empty();
+	if (frame->format == FORMAT_PNG)
+	{
+		ok = mapped && writePng(frame->fileName, &frame->pixels[0], frame->width, frame->height, frame->channels);
+	}
+	else if (frame->format == FORMAT_RAW)
+	{
+		FILE* fp = mapped ? fopen(frame->fileName.c_str(), "wb") : NULL;
+		if (fp)
+		{
+			ok = fwrite(&frame->pixels[0], 1, frame->pixels.size(), fp) == frame->pixels.size();
+			ok = fclose(fp) == 0 && ok;
+		}
+	}
+	else
+	{
+		//convert in parallel, append in capture order.
+		int w = frame->width, h = frame->height;
+		size_t lumaBytes = size_t(w) * h, chromaBytes = size_t((w + 1) / 2) * ((h + 1) / 2);
+		std::vector<unsigned char> yuv;
+		if (mapped)
+		{
+			yuv.resize(lumaBytes + 2 * chromaBytes);
+			rgbaToYuv420(&frame->pixels[0], w, h, &yuv[0], &yuv[lumaBytes], &yuv[lumaBytes + chromaBytes]);
+		}
+		std::unique_lock<std::mutex> lock(m_y4mMutex);
+		m_y4mTurn.wait(lock, [&]{ return m_y4mNextWrite == frame->sequence; });
+		if (m_y4m && mapped)
+		{
+			ok = fwrite("FRAME\n", 1, 6, m_y4m) == 6 && fwrite(&yuv[0], 1, yuv.size(), m_y4m) == yuv.size();
+		}
+		m_y4mNextWrite++;
+		m_y4mTurn.notify_all();
+	}
+	if (ok) m_encoded++;
+	else m_failed++;
+}
+
+}
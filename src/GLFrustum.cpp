@@ -0,0 +1,433 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cmath>
+#include <thread>
+#include <algorithm>
+#include "GLCamera.h"
+#include "GLContext.h"
+#include "GLFrustum.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define GLFRUSTUM_X86
+#endif
+
+//GCC/Clang compile the AVX2/AVX-512 kernels with target attributes and pick
+//one at runtime, MSVC only gets them when built with /arch:AVX2 or higher.
+#if defined(GLFRUSTUM_X86) && (defined(__GNUC__) || defined(__clang__))
+#define GLFRUSTUM_TARGET(isa) __attribute__((target(isa)))
+#define GLFRUSTUM_HAS_AVX2
+#define GLFRUSTUM_HAS_AVX512
+#elif defined(GLFRUSTUM_X86)
+#define GLFRUSTUM_TARGET(isa)
+#if defined(__AVX2__)
+#define GLFRUSTUM_HAS_AVX2
+#endif
+#if defined(__AVX512F__)
+#define GLFRUSTUM_HAS_AVX512
+#endif
+#endif
+
+namespace davinci{
+
+BBoxSoA::BBoxSoA(const std::vector<BBox>& boxes)
+{
+	reserve(boxes.size());
+	for (size_t i = 0; i < boxes.size(); i++)
+		push_back(boxes[i]);
+}
+
+void BBoxSoA::reserve(size_t n)
+{
+	minX.reserve(n); minY.reserve(n); minZ.reserve(n);
+	maxX.reserve(n); maxY.reserve(n); maxZ.reserve(n);
+}
+
+void BBoxSoA::clear()
+{
+	minX.clear(); minY.clear(); minZ.clear();
+	maxX.clear(); maxY.clear(); maxZ.clear();
+}
+
+void BBoxSoA::push_back(const BBox& box)
+{
+	minX.push_back(box.pMin.x()); minY.push_back(box.pMin.y()); minZ.push_back(box.pMin.z());
+	maxX.push_back(box.pMax.x()); maxY.push_back(box.pMax.y()); maxZ.push_back(box.pMax.z());
+}
+
+BBox BBoxSoA::get(size_t i) const
+{
+	return BBox(vec3f(minX[i], minY[i], minZ[i]), vec3f(maxX[i], maxY[i], maxZ[i]));
+}
+
+namespace{
+	//Per plane, the corner of a box farthest along the plane normal(p-vertex)
+	//and the nearest one(n-vertex) only depend on the signs of the normal,
+	//so the SoA columns feeding them are chosen once per plane, not per box.
+	struct PlaneColumns
+	{
+		float a, b, c, d;
+		const float *px, *py, *pz;
+		const float *nx, *ny, *nz;
+	};
+
+	void setupColumns(const float planes[6][4], const BBoxSoA& boxes, PlaneColumns cols[6])
+	{
+		for (int p = 0; p < 6; p++)
+		{
+			cols[p].a = planes[p][0]; cols[p].b = planes[p][1];
+			cols[p].c = planes[p][2]; cols[p].d = planes[p][3];
+			cols[p].px = cols[p].a >= 0 ? boxes.maxX.data() : boxes.minX.data();
+			cols[p].nx = cols[p].a >= 0 ? boxes.minX.data() : boxes.maxX.data();
+			cols[p].py = cols[p].b >= 0 ? boxes.maxY.data() : boxes.minY.data();
+			cols[p].ny = cols[p].b >= 0 ? boxes.minY.data() : boxes.maxY.data();
+			cols[p].pz = cols[p].c >= 0 ? boxes.maxZ.data() : boxes.minZ.data();
+			cols[p].nz = cols[p].c >= 0 ? boxes.minZ.data() : boxes.maxZ.data();
+		}
+	}
+
+	inline int lowestBit(unsigned int v)
+	{
+#if defined(_MSC_VER)
+		unsigned long idx;
+		_BitScanForward(&idx, v);
+		return (int)idx;
+#else
+		return __builtin_ctz(v);
+#endif
+	}
+
+	//Receives the outside/intersect lane masks of a group of boxes.
+	struct CullOutput
+	{
+		unsigned char* classes;//may be NULL.
+		unsigned int*  visible;//may be NULL.
+		size_t nVisible;
+		bool   includeIntersecting;
+
+		inline void emit(size_t base, unsigned int outside, unsigned int intersect, int lanes)
+		{
+			if (classes)
+			{
+				for (int l = 0; l < lanes; l++)
+				{
+					unsigned int bit = 1u << l;
+					classes[base + l] = (outside & bit) ? GLFrustum::OUTSIDE :
+						((intersect & bit) ? GLFrustum::INTERSECT : GLFrustum::INSIDE);
+				}
+			}
+			if (visible)
+			{
+				unsigned int keep = ~outside & ((lanes == 32) ? 0xFFFFFFFFu : ((1u << lanes) - 1));
+				if (!includeIntersecting)
+					keep &= ~intersect;
+				while (keep)
+				{
+					visible[nVisible++] = (unsigned int)(base + lowestBit(keep));
+					keep &= keep - 1;
+				}
+			}
+		}
+	};
+
+	void classifyScalar(const PlaneColumns cols[6], size_t begin, size_t end, CullOutput& out)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			unsigned int outside = 0, intersect = 0;
+			for (int p = 0; p < 6; p++)
+			{
+				const PlaneColumns& c = cols[p];
+				float dp = c.a*c.px[i] + c.b*c.py[i] + c.c*c.pz[i] + c.d;
+				float dn = c.a*c.nx[i] + c.b*c.ny[i] + c.c*c.nz[i] + c.d;
+				outside   |= (dp < 0.0f);
+				intersect |= (dn < 0.0f);
+			}
+			out.emit(i, outside, intersect, 1);
+		}
+	}
+
+#if defined(GLFRUSTUM_X86)
+	void classifySSE(const PlaneColumns cols[6], size_t begin, size_t end, CullOutput& out)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		size_t i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 outside = zero, intersect = zero;
+			for (int p = 0; p < 6; p++)
+			{
+				const PlaneColumns& c = cols[p];
+				__m128 a = _mm_set1_ps(c.a), b = _mm_set1_ps(c.b);
+				__m128 cc = _mm_set1_ps(c.c), d = _mm_set1_ps(c.d);
+				__m128 dp = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(c.px + i)),
+					_mm_mul_ps(b, _mm_loadu_ps(c.py + i))),
+					_mm_add_ps(_mm_mul_ps(cc, _mm_loadu_ps(c.pz + i)), d));
+				__m128 dn = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(c.nx + i)),
+					_mm_mul_ps(b, _mm_loadu_ps(c.ny + i))),
+					_mm_add_ps(_mm_mul_ps(cc, _mm_loadu_ps(c.nz + i)), d));
+				outside   = _mm_or_ps(outside, _mm_cmplt_ps(dp, zero));
+				intersect = _mm_or_ps(intersect, _mm_cmplt_ps(dn, zero));
+			}
+			out.emit(i, _mm_movemask_ps(outside), _mm_movemask_ps(intersect), 4);
+		}
+		classifyScalar(cols, i, end, out);
+	}
+#endif
+
+#if defined(GLFRUSTUM_HAS_AVX2)
+	GLFRUSTUM_TARGET("avx2,fma")
+	void classifyAVX2(const PlaneColumns cols[6], size_t begin, size_t end, CullOutput& out)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		size_t i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 outside = zero, intersect = zero;
+			for (int p = 0; p < 6; p++)
+			{
+				const PlaneColumns& c = cols[p];
+				__m256 a = _mm256_set1_ps(c.a), b = _mm256_set1_ps(c.b);
+				__m256 cc = _mm256_set1_ps(c.c), d = _mm256_set1_ps(c.d);
+				__m256 dp = _mm256_fmadd_ps(a, _mm256_loadu_ps(c.px + i),
+							_mm256_fmadd_ps(b, _mm256_loadu_ps(c.py + i),
+							_mm256_fmadd_ps(cc, _mm256_loadu_ps(c.pz + i), d)));
+				__m256 dn = _mm256_fmadd_ps(a, _mm256_loadu_ps(c.nx + i),
+							_mm256_fmadd_ps(b, _mm256_loadu_ps(c.ny + i),
+							_mm256_fmadd_ps(cc, _mm256_loadu_ps(c.nz + i), d)));
+				outside   = _mm256_or_ps(outside, _mm256_cmp_ps(dp, zero, _CMP_LT_OQ));
+				intersect = _mm256_or_ps(intersect, _mm256_cmp_ps(dn, zero, _CMP_LT_OQ));
+			}
+			out.emit(i, _mm256_movemask_ps(outside), _mm256_movemask_ps(intersect), 8);
+		}
+		classifyScalar(cols, i, end, out);
+	}
+#endif
+
+#if defined(GLFRUSTUM_HAS_AVX512)
+	GLFRUSTUM_TARGET("avx512f")
+	void classifyAVX512(const PlaneColumns cols[6], size_t begin, size_t end, CullOutput& out)
+	{
+		const __m512 zero = _mm512_setzero_ps();
+		size_t i = begin;
+		for (; i + 16 <= end; i += 16)
+		{
+			__mmask16 outside = 0, intersect = 0;
+			for (int p = 0; p < 6; p++)
+			{
+				const PlaneColumns& c = cols[p];
+				__m512 a = _mm512_set1_ps(c.a), b = _mm512_set1_ps(c.b);
+				__m512 cc = _mm512_set1_ps(c.c), d = _mm512_set1_ps(c.d);
+				__m512 dp = _mm512_fmadd_ps(a, _mm512_loadu_ps(c.px + i),
+							_mm512_fmadd_ps(b, _mm512_loadu_ps(c.py + i),
+							_mm512_fmadd_ps(cc, _mm512_loadu_ps(c.pz + i), d)));
+				__m512 dn = _mm512_fmadd_ps(a, _mm512_loadu_ps(c.nx + i),
+							_mm512_fmadd_ps(b, _mm512_loadu_ps(c.ny + i),
+							_mm512_fmadd_ps(cc, _mm512_loadu_ps(c.nz + i), d)));
+				outside   |= _mm512_cmp_ps_mask(dp, zero, _CMP_LT_OQ);
+				intersect |= _mm512_cmp_ps_mask(dn, zero, _CMP_LT_OQ);
+			}
+			if (out.visible && !out.classes)
+			{//compress the surviving indices straight into the output.
+				__mmask16 keep = ~outside;
+				if (!out.includeIntersecting) keep &= ~intersect;
+				__m512i idx = _mm512_add_epi32(_mm512_set1_epi32((int)i),
+					_mm512_set_epi32(15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0));
+				_mm512_mask_compressstoreu_epi32(out.visible + out.nVisible, keep, idx);
+				out.nVisible += __builtin_popcount((unsigned int)keep);
+			}
+			else
+			{
+				out.emit(i, outside, intersect, 16);
+			}
+		}
+		classifyScalar(cols, i, end, out);
+	}
+#endif
+
+	typedef void (*ClassifyKernel)(const PlaneColumns cols[6], size_t begin, size_t end, CullOutput& out);
+
+	ClassifyKernel selectKernel(const char** name)
+	{
+#if defined(GLFRUSTUM_HAS_AVX512) && (defined(__GNUC__) || defined(__clang__))
+		if (__builtin_cpu_supports("avx512f")) { *name = "avx512"; return classifyAVX512; }
+#elif defined(GLFRUSTUM_HAS_AVX512)
+		*name = "avx512"; return classifyAVX512;
+#endif
+#if defined(GLFRUSTUM_HAS_AVX2) && (defined(__GNUC__) || defined(__clang__))
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) { *name = "avx2"; return classifyAVX2; }
+#elif defined(GLFRUSTUM_HAS_AVX2)
+		*name = "avx2"; return classifyAVX2;
+#endif
+#if defined(GLFRUSTUM_X86)
+		*name = "sse"; return classifySSE;
+#else
+		*name = "scalar"; return classifyScalar;
+#endif
+	}
+
+	const char*   g_kernelName = NULL;
+	ClassifyKernel g_kernel = selectKernel(&g_kernelName);
+
+	//Below this many boxes spawning threads costs more than it saves.
+	const size_t g_minBoxesPerThread = 1 << 15;
+}
+
+GLFrustum::GLFrustum()
+{
+	for (int p = 0; p < 6; p++)
+	{//everything is inside.
+		m_planes[p][0] = m_planes[p][1] = m_planes[p][2] = 0.0f;
+		m_planes[p][3] = 1.0f;
+	}
+}
+
+GLFrustum::GLFrustum(const mat4& viewProj)
+{
+	setMatrix(viewProj);
+}
+
+GLFrustum GLFrustum::fromCamera(const GLCamera& camera)
+{
+	return GLFrustum(camera.getProjectionMatrix() * camera.getViewingMatrix());
+}
+
+GLFrustum GLFrustum::fromContext()
+{
+	return GLFrustum(GLContext::g_PjM * GLContext::g_MVM);
+}
+
+void GLFrustum::setMatrix(const mat4& M)
+{
+	//Gribb-Hartmann: with clip=M*p, -w<=x<=w gives row3+row0>=0 and
+	//row3-row0>=0, likewise for y and z.
+	for (int i = 0; i < 3; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			m_planes[2*i][c]     = M.get(3, c) + M.get(i, c);
+			m_planes[2*i + 1][c] = M.get(3, c) - M.get(i, c);
+		}
+	}
+	for (int p = 0; p < 6; p++)
+	{
+		float len = sqrtf(m_planes[p][0]*m_planes[p][0] + m_planes[p][1]*m_planes[p][1] +
+						  m_planes[p][2]*m_planes[p][2]);
+		if (len > 0.0f)
+		{
+			for (int c = 0; c < 4; c++)
+				m_planes[p][c] /= len;
+		}
+	}
+}
+
+vec4f GLFrustum::getPlane(int i) const
+{
+	return vec4f(m_planes[i]);
+}
+
+GLFrustum::Classification GLFrustum::classify(const BBox& box) const
+{
+	BBoxSoA one;
+	one.push_back(box);
+	PlaneColumns cols[6];
+	setupColumns(m_planes, one, cols);
+	unsigned char cls = OUTSIDE;
+	CullOutput out = { &cls, NULL, 0, true };
+	classifyScalar(cols, 0, 1, out);
+	return (Classification)cls;
+}
+
+void GLFrustum::classify(const BBoxSoA& boxes, std::vector<unsigned char>& result, int nThreads/*=0*/) const
+{
+	result.resize(boxes.size());
+	if (boxes.size() == 0) return;
+	run(boxes, result.data(), NULL, true, nThreads);
+}
+
+void GLFrustum::cull(const BBoxSoA& boxes, std::vector<unsigned int>& visible,
+					 bool includeIntersecting/*=true*/, int nThreads/*=0*/) const
+{
+	visible.clear();
+	if (boxes.size() == 0) return;
+	run(boxes, NULL, &visible, includeIntersecting, nThreads);
+}
+
+const char* GLFrustum::getKernelName()
+{
+	return g_kernelName;
+}
+
+void GLFrustum::run(const BBoxSoA& boxes, unsigned char* classes, std::vector<unsigned int>* visible,
+					bool includeIntersecting, int nThreads) const
+{
+	size_t n = boxes.size();
+	PlaneColumns cols[6];
+	setupColumns(m_planes, boxes, cols);
+
+	if (nThreads <= 0)
+		nThreads = std::max(1u, std::thread::hardware_concurrency());
+	nThreads = (int)std::min<size_t>(nThreads, std::max<size_t>(1, n / g_minBoxesPerThread));
+
+	//chunks are multiple of 16 boxes so only the last one has a scalar tail.
+	size_t chunk = ((n + nThreads - 1) / nThreads + 15) & ~size_t(15);
+	std::vector<std::vector<unsigned int> > partial(nThreads);
+	std::vector<size_t> counts(nThreads, 0);
+
+	auto work = [&](int t)
+	{
+		size_t begin = std::min(n, t * chunk), end = std::min(n, begin + chunk);
+		unsigned int* dst = NULL;
+		if (visible)
+		{
+			partial[t].resize(end - begin);
+			dst = partial[t].data();
+		}
+		CullOutput out = { classes, dst, 0, includeIntersecting };
+		g_kernel(cols, begin, end, out);
+		counts[t] = out.nVisible;
+	};
+
+	std::vector<std::thread> threads;
+	for (int t = 1; t < nThreads; t++)
+		threads.push_back(std::thread(work, t));
+	work(0);
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+
+	if (visible)
+	{
+		size_t total = 0;
+		for (int t = 0; t < nThreads; t++)
+			total += counts[t];
+		visible->resize(total);
+		size_t pos = 0;
+		for (int t = 0; t < nThreads; t++)
+		{
+			std::copy(partial[t].begin(), partial[t].begin() + counts[t], visible->begin() + pos);
+			pos += counts[t];
+		}
+	}
+}
+
+}
@@ -0,0 +1,84 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_HIZ_SHADER_H_
+#define _GL_HIZ_SHADER_H_
+
+//Hi-Z occlusion test shared by the GLDrawCuller and GLMeshletCuller cull
+//shaders, against the max-depth pyramid built by GLDrawCuller::buildHiZ().
+//Texel p of level l reduces level 0 pixels [p*2^l, (p+1)*2^l), so a
+//footprint is mapped to level 0 pixels first and shifted down. Scaling the
+//uv by the rounded up level size drifts off that texel on odd sizes.
+#define HIZ_TEST_SHADER_SRC \
+"layout(std430) readonly buffer HiZ { float hiz[]; };\n" \
+"uniform mat4  hizViewProj;\n" \
+"uniform ivec2 hizSize;\n" \
+"uniform int   hizLevels;\n" \
+"vec3 corner(vec3 bmin, vec3 bmax, int i)\n" \
+"{\n" \
+"	return vec3((i & 1) != 0 ? bmax.x : bmin.x,\n" \
+"				(i & 2) != 0 ? bmax.y : bmin.y,\n" \
+"				(i & 4) != 0 ? bmax.z : bmin.z);\n" \
+"}\n" \
+"float hizFetch(int level, ivec2 p)\n" \
+"{\n" \
+"	int offset = 0;\n" \
+"	ivec2 size = hizSize;\n" \
+"	for (int l = 0; l < level; l++)\n" \
+"	{\n" \
+"		offset += size.x*size.y;\n" \
+"		size = max((size + 1)/2, ivec2(1));\n" \
+"	}\n" \
+"	p = clamp(p, ivec2(0), size - 1);\n" \
+"	return hiz[offset + p.y*size.x + p.x];\n" \
+"}\n" \
+"bool notOccluded(vec3 bmin, vec3 bmax)\n" \
+"{\n" \
+"	vec3 ndcMin = vec3(1.0), ndcMax = vec3(-1.0);\n" \
+"	for (int i = 0; i < 8; i++)\n" \
+"	{\n" \
+"		vec4 c = hizViewProj * vec4(corner(bmin, bmax, i), 1.0);\n" \
+"		//box crosses the near plane of the Hi-Z view, keep it.\n" \
+"		if (c.w <= 0.0) return true;\n" \
+"		vec3 ndc = c.xyz / c.w;\n" \
+"		ndcMin = min(ndcMin, ndc);\n" \
+"		ndcMax = max(ndcMax, ndc);\n" \
+"	}\n" \
+"	vec2 uvMin = clamp(ndcMin.xy*0.5 + 0.5, 0.0, 1.0);\n" \
+"	vec2 uvMax = clamp(ndcMax.xy*0.5 + 0.5, 0.0, 1.0);\n" \
+"	vec2 extent = (uvMax - uvMin) * vec2(hizSize);\n" \
+"	//pick the level where the footprint spans at most 2x2 texels.\n" \
+"	int level = int(ceil(log2(max(max(extent.x, extent.y), 1.0))));\n" \
+"	level = clamp(level, 0, hizLevels - 1);\n" \
+"	ivec2 pMin = min(ivec2(floor(uvMin * vec2(hizSize))), hizSize - 1) >> level;\n" \
+"	ivec2 pMax = min(ivec2(floor(uvMax * vec2(hizSize))), hizSize - 1) >> level;\n" \
+"	float zMax = max(max(hizFetch(level, pMin), hizFetch(level, ivec2(pMax.x, pMin.y))),\n" \
+"					 max(hizFetch(level, ivec2(pMin.x, pMax.y)), hizFetch(level, pMax)));\n" \
+"	return ndcMin.z*0.5 + 0.5 <= zMax;\n" \
+"}\n"
+
+#endif
@@ -0,0 +1,346 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <GL/glew.h>
+#include "mathtool.h"
+#include "GLError.h"
+#include "GLPixelBufferObject.h"
+#include "GLImageCompositor.h"
+
+namespace davinci{
+
+namespace{
+	std::vector<int> primeFactors(int n)
+	{
+		std::vector<int> primes;
+		for (int p = 2; p * p <= n; p++)
+		{
+			while (n % p == 0) { primes.push_back(p); n /= p; }
+		}
+		if (n > 1) primes.push_back(n);
+		return primes;
+	}
+
+	//start of piece m when [0,n) is split k ways. Unlike BLOCK_LOW it stays
+	//exact beyond 2^24 pixels.
+	size_t pieceLow(int m, int k, size_t n)
+	{
+		return size_t((unsigned long long)n * m / k);
+	}
+}
+
+GLImageCompositor::GLImageCompositor(MPI_Comm comm/*=MPI_COMM_WORLD*/)
+	:m_comm(comm), m_mode(COMPOSITE_DEPTH), m_width(0), m_height(0), m_stride(5), m_begin(0), m_end(0)
+{
+	MPI_Comm_rank(m_comm, &m_rank);
+	MPI_Comm_size(m_comm, &m_nRanks);
+	m_radices = radixKRadices(m_nRanks);
+	std::vector<int> order(m_nRanks);
+	for (int i = 0; i < m_nRanks; i++) order[i] = i;
+	setVisibilityOrder(order);
+	MPI_Type_contiguous(4, MPI_FLOAT, &m_pixelType[0]);
+	MPI_Type_commit(&m_pixelType[0]);
+	MPI_Type_contiguous(5, MPI_FLOAT, &m_pixelType[1]);
+	MPI_Type_commit(&m_pixelType[1]);
+}
+
+GLImageCompositor::~GLImageCompositor()
+{
+	int finalized = 0;
+	MPI_Finalized(&finalized);
+	if (!finalized)
+	{
+		MPI_Type_free(&m_pixelType[0]);
+		MPI_Type_free(&m_pixelType[1]);
+	}
+}
+
+std::vector<int> GLImageCompositor::binarySwapRadices(int nRanks)
+{
+	std::vector<int> radices = primeFactors(nRanks);
+	if (radices.empty()) radices.push_back(1);
+	return radices;
+}
+
+std::vector<int> GLImageCompositor::radixKRadices(int nRanks, int k/*=4*/)
+{
+	//first fit decreasing of the prime factors into groups of at most k.
+	std::vector<int> primes = primeFactors(nRanks);
+	std::sort(primes.begin(), primes.end(), std::greater<int>());
+	std::vector<int> radices;
+	for (size_t i = 0; i < primes.size(); i++)
+	{
+		size_t j = 0;
+		while (j < radices.size() && radices[j] * primes[i] > k) j++;
+		if (j < radices.size()) radices[j] *= primes[i];
+		else radices.push_back(primes[i]);
+	}
+	if (radices.empty()) radices.push_back(1);
+	std::sort(radices.begin(), radices.end(), std::greater<int>());
+	return radices;
+}
+
+void GLImageCompositor::setRadices(const std::vector<int>& radices)
+{
+	long long product = 1;
+	for (size_t i = 0; i < radices.size(); i++)
+	{
+		if (radices[i] < 1)
+			GLError::ErrorMessage(std::string(__func__) + ": radices must be positive.");
+		product *= radices[i];
+	}
+	if (product != m_nRanks)
+		GLError::ErrorMessage(std::string(__func__) + ": the product of the radices must equal the number of ranks.");
+	m_radices = radices;
+}
+
+void GLImageCompositor::setVisibilityOrder(const std::vector<int>& frontToBack)
+{
+	std::vector<int> position(m_nRanks, -1);
+	for (size_t i = 0; i < frontToBack.size(); i++)
+	{
+		int rank = frontToBack[i];
+		if (rank >= 0 && rank < m_nRanks && position[rank] < 0)
+			position[rank] = (int)i;
+	}
+	if ((int)frontToBack.size() != m_nRanks || std::count(position.begin(), position.end(), -1))
+		GLError::ErrorMessage(std::string(__func__) + ": the order must list every rank exactly once.");
+	m_order = frontToBack;
+	m_position = position;
+}
+
+std::vector<int> GLImageCompositor::getVisibilityOrder(const vec3i& procDim, const vec3i& domainDim,
+													   const vec3f& eye)
+{
+	//a ray from the eye crosses bricks with non-decreasing brick distance
+	//from the eye's brick on every axis, so sorting on these distances,
+	//z then y then x, never puts an occluded brick first.
+	int procs[3] = { procDim.x(), procDim.y(), procDim.z() };
+	int domain[3] = { domainDim.x(), domainDim.y(), domainDim.z() };
+	float eyePos[3] = { eye.x(), eye.y(), eye.z() };
+	int eyeBrick[3];
+	for (int a = 0; a < 3; a++)
+	{
+		int b = 0;
+		while (b < procs[a] - 1 && eyePos[a] >= (float)BLOCK_LOW(b + 1, procs[a], domain[a])) b++;
+		eyeBrick[a] = b;
+	}
+	int n = procDim.x() * procDim.y() * procDim.z();
+	std::vector<std::pair<long long, int> > keys(n);
+	for (int z = 0; z < procDim.z(); z++)
+	for (int y = 0; y < procDim.y(); y++)
+	for (int x = 0; x < procDim.x(); x++)
+	{
+		int rank = x + procDim.x() * (y + procDim.y() * z);
+		long long dx = std::abs(x - eyeBrick[0]), dy = std::abs(y - eyeBrick[1]), dz = std::abs(z - eyeBrick[2]);
+		keys[rank] = std::make_pair((dz << 42) | (dy << 21) | dx, rank);
+	}
+	std::sort(keys.begin(), keys.end());
+	std::vector<int> order(n);
+	for (int i = 0; i < n; i++) order[i] = keys[i].second;
+	return order;
+}
+
+void GLImageCompositor::setImage(const float* rgba, const float* depth, int width, int height, CompositeMode mode)
+{
+	m_mode = mode;
+	m_width = width;
+	m_height = height;
+	m_stride = mode == COMPOSITE_DEPTH ? 5 : 4;
+	size_t n = size_t(width) * height;
+	m_pixels.resize(n * m_stride);
+	if (mode == COMPOSITE_ALPHA)
+	{
+		memcpy(&m_pixels[0], rgba, n * 4 * sizeof(float));
+	}
+	else
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			memcpy(&m_pixels[i * 5], rgba + i * 4, 4 * sizeof(float));
+			m_pixels[i * 5 + 4] = depth[i];
+		}
+	}
+	m_begin = 0;
+	m_end = n;
+}
+
+void GLImageCompositor::readFramebuffer(GLFrameBufferObject& fbo, GLuint colorAttachId,
+										int width, int height, CompositeMode mode)
+{
+	//both transfers are queued before either is mapped.
+	GLPixelBufferObject colorPbo(width, height, GL_RGBA, GL_FLOAT, GL_STREAM_READ);
+	colorPbo.copyFrom(fbo, colorAttachId);
+	GLPixelBufferObjectRef depthPbo;
+	if (mode == COMPOSITE_DEPTH)
+	{
+		depthPbo = GLPixelBufferObjectRef(new GLPixelBufferObject(width, height, GL_DEPTH_COMPONENT,
+																  GL_FLOAT, GL_STREAM_READ));
+		depthPbo->copyFrom(fbo, colorAttachId);
+	}
+	std::vector<float> rgba(size_t(width) * height * 4), depth;
+	colorPbo.copyTo(&rgba[0]);
+	if (depthPbo)
+	{
+		depth.resize(size_t(width) * height);
+		depthPbo->copyTo(&depth[0]);
+	}
+	setImage(&rgba[0], depth.empty() ? NULL : &depth[0], width, height, mode);
+}
+
+void GLImageCompositor::blend(float* dst, const float* src, size_t count, bool srcInFront) const
+{
+	if (m_mode == COMPOSITE_DEPTH)
+	{
+		for (size_t i = 0; i < count; i++, dst += 5, src += 5)
+		{
+			//ties go to the brick in front so every rank agrees.
+			if (src[4] < dst[4] || (src[4] == dst[4] && srcInFront))
+				memcpy(dst, src, 5 * sizeof(float));
+		}
+		return;
+	}
+	for (size_t i = 0; i < count; i++, dst += 4, src += 4)
+	{
+		const float* front = srcInFront ? src : dst;
+		const float* back = srcInFront ? dst : src;
+		float t = 1.0f - front[3];
+		dst[0] = front[0] + t * back[0];
+		dst[1] = front[1] + t * back[1];
+		dst[2] = front[2] + t * back[2];
+		dst[3] = front[3] + t * back[3];
+	}
+}
+
+void GLImageCompositor::composite()
+{
+	if (m_pixels.empty())
+	{
+		GLError::ErrorMessage(std::string(__func__) + ": set the local image first.");
+		return;
+	}
+	MPI_Datatype pixelType = m_pixelType[m_mode == COMPOSITE_DEPTH ? 1 : 0];
+	int position = m_position[m_rank];
+	int groupStride = 1;
+	size_t begin = 0, end = size_t(m_width) * m_height;
+	std::vector<float> incoming;
+	std::vector<MPI_Request> recvs, sends;
+	std::vector<int> recvPiece;
+
+	for (size_t round = 0; round < m_radices.size(); round++)
+	{
+		int k = m_radices[round];
+		int digit = (position / groupStride) % k;
+		int base = position - digit * groupStride;
+		size_t n = end - begin;
+		size_t myLow = begin + pieceLow(digit, k, n), myHigh = begin + pieceLow(digit + 1, k, n);
+		size_t myCount = myHigh - myLow;
+		if (k > 1)
+		{
+			//member m's copy of my piece lands in slot m.
+			incoming.resize(myCount * m_stride * k);
+			recvs.assign(k, MPI_REQUEST_NULL);
+			sends.assign(k, MPI_REQUEST_NULL);
+			for (int m = 0; m < k; m++)
+			{
+				if (m == digit) continue;
+				int peer = m_order[base + m * groupStride];
+				MPI_Irecv(myCount ? &incoming[myCount * m_stride * m] : NULL, (int)myCount, pixelType,
+						  peer, (int)round, m_comm, &recvs[m]);
+			}
+			for (int m = 0; m < k; m++)
+			{
+				if (m == digit) continue;
+				int peer = m_order[base + m * groupStride];
+				size_t low = begin + pieceLow(m, k, n), high = begin + pieceLow(m + 1, k, n);
+				MPI_Isend(high > low ? &m_pixels[low * m_stride] : NULL, (int)(high - low), pixelType,
+						  peer, (int)round, m_comm, &sends[m]);
+			}
+			//fold pieces in as they arrive while the blended run [lo,hi] of
+			//members stays contiguous in visibility order.
+			std::vector<char> arrived(k, 0);
+			arrived[digit] = 1;
+			int lo = digit, hi = digit;
+			float* acc = myCount ? &m_pixels[myLow * m_stride] : NULL;
+			for (int received = 0; received < k - 1; received++)
+			{
+				int m = MPI_UNDEFINED;
+				MPI_Waitany(k, &recvs[0], &m, MPI_STATUS_IGNORE);
+				if (m == MPI_UNDEFINED) break;
+				arrived[m] = 1;
+				while (lo > 0 && arrived[lo - 1])
+				{
+					lo--;
+					if (myCount) blend(acc, &incoming[myCount * m_stride * lo], myCount, true);
+				}
+				while (hi < k - 1 && arrived[hi + 1])
+				{
+					hi++;
+					if (myCount) blend(acc, &incoming[myCount * m_stride * hi], myCount, false);
+				}
+			}
+			MPI_Waitall(k, &sends[0], MPI_STATUSES_IGNORE);
+		}
+		begin = myLow;
+		end = myHigh;
+		groupStride *= k;
+	}
+	m_begin = begin;
+	m_end = end;
+}
+
+void GLImageCompositor::gather(int root, std::vector<float>& rgba)
+{
+	//every rank's final span follows from its visibility position alone.
+	std::vector<int> counts(m_nRanks), displs(m_nRanks);
+	size_t total = size_t(m_width) * m_height;
+	for (int r = 0; r < m_nRanks; r++)
+	{
+		int position = m_position[r], groupStride = 1;
+		size_t begin = 0, end = total;
+		for (size_t round = 0; round < m_radices.size(); round++)
+		{
+			int k = m_radices[round];
+			int digit = (position / groupStride) % k;
+			size_t n = end - begin;
+			end = begin + pieceLow(digit + 1, k, n);
+			begin = begin + pieceLow(digit, k, n);
+			groupStride *= k;
+		}
+		counts[r] = (int)(end - begin);
+		displs[r] = (int)begin;
+	}
+	std::vector<float> owned((m_end - m_begin) * 4);
+	for (size_t i = m_begin; i < m_end; i++)
+		memcpy(&owned[(i - m_begin) * 4], &m_pixels[i * m_stride], 4 * sizeof(float));
+	if (m_rank == root)
+		rgba.resize(total * 4);
+	MPI_Gatherv(owned.empty() ? NULL : &owned[0], (int)owned.size() / 4, m_pixelType[0],
+				m_rank == root ? &rgba[0] : NULL, &counts[0], &displs[0], m_pixelType[0], root, m_comm);
+}
+
+}
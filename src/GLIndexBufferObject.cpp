@@ -28,7 +28,8 @@ GLIndexBufferObject::GLIndexBufferObject(GLenum geotype,
         std::shared_ptr<GLenum> arrayid/*=NULL*/, GLenum usage/*=GL_STATIC_DRAW*/)
         :GLBufferObject(GL_ELEMENT_ARRAY_BUFFER, usage),
           m_arrayId(arrayid), m_type(geotype),m_indexDataSize(0),
-          m_bUseRestart(false),m_restartIndex(0), m_enabled(false)
+          m_bUseRestart(false),m_restartIndex(0), m_enabled(false),
+          m_bAllowShortIndices(true), m_indexType(GL_UNSIGNED_INT)
 {
 }
 
@@ -50,8 +51,24 @@ void GLIndexBufferObject::upload()
     if (!m_indexData.empty())
     {//CPU data upload only once.
         m_indexDataSize = m_indexData.size();
-        //glBufferData(m_target, m_indexDataSize*sizeof(GLuint), m_indexData.data(), m_usage);
-        GLBufferObject::upload(m_indexDataSize*sizeof(GLuint), m_indexData.data());
+        if (m_bAllowShortIndices &&
+            GLVertexCacheOptimizer::fitsShortIndices(m_indexData, m_bUseRestart, m_restartIndex))
+        {//half the bandwidth and memory of 32 bit indices.
+            std::vector<GLushort> shortIndices(m_indexDataSize);
+            for (size_t i = 0; i < m_indexDataSize; i++)
+            {
+                shortIndices[i] = (m_bUseRestart && m_indexData[i] == m_restartIndex) ?
+                                  0xFFFF : (GLushort)m_indexData[i];
+            }
+            m_indexType = GL_UNSIGNED_SHORT;
+            GLBufferObject::upload(m_indexDataSize*sizeof(GLushort), shortIndices.data());
+        }
+        else
+        {
+            m_indexType = GL_UNSIGNED_INT;
+            //glBufferData(m_target, m_indexDataSize*sizeof(GLuint), m_indexData.data(), m_usage);
+            GLBufferObject::upload(m_indexDataSize*sizeof(GLuint), m_indexData.data());
+        }
         m_indexData.clear();//data uploaded to GPU, no need to keep the CPU counter part.
     }
     GLError::glCheckError(__func__);
@@ -65,7 +82,7 @@ void GLIndexBufferObject::enable()
     if (m_bUseRestart)
     {
         glEnable(GL_PRIMITIVE_RESTART);
-        glPrimitiveRestartIndex(m_restartIndex);
+        glPrimitiveRestartIndex(m_indexType == GL_UNSIGNED_SHORT ? 0xFFFF : m_restartIndex);
     }
     GLBufferObject::unbindBufferObject();
     //glBindVertexArray(0);
@@ -114,13 +131,13 @@ void GLIndexBufferObject::draw(GLsizeiptr count/*=0*/ )
     count = count > 0 ? count : m_indexDataSize;
     GLIndexBufferObject::bindBufferObject();
 
-    glDrawElements(m_type, count, GL_UNSIGNED_INT, NULL);
+    glDrawElements(m_type, count, m_indexType, NULL);
 
     GLIndexBufferObject::unbindBufferObject();
     GLError::glCheckError("GLIndexBufferObject::draw(): glDrawArrays() failed!");
     glBindVertexArray(0);
 
-	if(m_attachedVAO->isEnabled())
+	if(m_attachedVAO->isEnabled() && !m_attachedVAO->isImmutable())
 		m_attachedVAO->disable();
 }
 
@@ -143,13 +160,13 @@ void davinci::GLIndexBufferObject::drawInstanced(GLsizei primcount, GLsizeiptr c
     count = count > 0 ? count : m_indexDataSize;
     GLIndexBufferObject::bindBufferObject();
 
-    glDrawElementsInstanced(m_type, count, GL_UNSIGNED_INT, NULL, primcount);
+    glDrawElementsInstanced(m_type, count, m_indexType, NULL, primcount);
 
     GLIndexBufferObject::unbindBufferObject();
     GLError::glCheckError("GLIndexBufferObject::draw(): glDrawArrays() failed!");
     glBindVertexArray(0);
 
-	if(m_attachedVAO->isEnabled())
+	if(m_attachedVAO->isEnabled() && !m_attachedVAO->isImmutable())
 		m_attachedVAO->disable();
 }
 
@@ -178,3 +195,15 @@ GLIndexBufferObject& GLIndexBufferObject::operator<<( const vec4i& i )
     m_enabled = false;
     return *this;
 }
+
+GLVertexCacheReport GLIndexBufferObject::optimize(size_t vertexCount, std::vector<GLuint>& vertexRemap,
+                                                  int nThreads/*=0*/)
+{
+    if (m_type != GL_TRIANGLES)
+    {
+        GLError::ErrorMessage(string(__func__)+" only GL_TRIANGLES index data can be optimized!");
+        return GLVertexCacheReport();
+    }
+    m_enabled = false;
+    return GLVertexCacheOptimizer::optimize(m_indexData, vertexCount, vertexRemap, 16, nThreads);
+}
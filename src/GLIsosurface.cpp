@@ -0,0 +1,474 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cmath>
+#include <cfloat>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "mathtool.h"
+#include "GLIsosurface.h"
+#include "GLParallel.h"
+
+namespace davinci{
+
+namespace{
+	//Marching cubes case table, generated instead of typed in. Corner i of
+	//a cell sits at (i&1, (i>>1)&1, (i>>2)&1), a corner is inside when its
+	//value >= iso. For every case the contour segments of the six faces are
+	//chained into loops and each loop is triangulated as a fan. Faces with
+	//two diagonal inside corners always separate them, the decision only
+	//depends on the face so neighboring cells agree and the surface is
+	//crack free.
+	struct MarchingCubesTable
+	{
+		int edgeCorner[12][2];
+		int edgeAxis[12];
+		int triCount[256];
+		signed char tris[256][15];
+
+		MarchingCubesTable()
+		{
+			int edgeOf[8][8];
+			int nEdges = 0;
+			for (int a = 0; a < 8; a++)
+			{
+				for (int bit = 0; bit < 3; bit++)
+				{
+					if (a & (1 << bit)) continue;
+					int b = a | (1 << bit);
+					edgeCorner[nEdges][0] = a;
+					edgeCorner[nEdges][1] = b;
+					edgeAxis[nEdges] = bit;
+					edgeOf[a][b] = edgeOf[b][a] = nEdges++;
+				}
+			}
+			//corners of each face, counter clockwise seen from outside.
+			int faces[6][4];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				int u = (axis + 1) % 3, v = (axis + 2) % 3;
+				const int du[4] = { 0, 1, 1, 0 }, dv[4] = { 0, 0, 1, 1 };
+				for (int side = 0; side < 2; side++)
+				{
+					for (int k = 0; k < 4; k++)
+					{
+						int kk = side ? k : 3 - k;
+						faces[2 * axis + side][k] = (side << axis) | (du[kk] << u) | (dv[kk] << v);
+					}
+				}
+			}
+
+			for (int mask = 0; mask < 256; mask++)
+			{
+				int next[12];
+				for (int e = 0; e < 12; e++) next[e] = -1;
+				for (int f = 0; f < 6; f++)
+				{
+					int crossEdge[4], crossOut[4], n = 0;
+					for (int k = 0; k < 4; k++)
+					{
+						int a = faces[f][k], b = faces[f][(k + 1) % 4];
+						int ia = (mask >> a) & 1, ib = (mask >> b) & 1;
+						if (ia == ib) continue;
+						crossEdge[n] = edgeOf[a][b];
+						crossOut[n++] = ia;//leaving the inside region.
+					}
+					//a segment runs from each in->out crossing back to the
+					//previous out->in crossing, keeping inside on its left.
+					for (int j = 0; j < n; j++)
+						if (crossOut[j]) next[crossEdge[j]] = crossEdge[(j + n - 1) % n];
+				}
+
+				triCount[mask] = 0;
+				bool visited[12] = { false };
+				for (int e0 = 0; e0 < 12; e0++)
+				{
+					if (next[e0] < 0 || visited[e0]) continue;
+					int loop[12], len = 0;
+					for (int e = e0; !visited[e]; e = next[e])
+					{
+						visited[e] = true;
+						loop[len++] = e;
+					}
+					//fans are wound so front faces point away from the inside.
+					for (int k = 1; k + 1 < len; k++)
+					{
+						signed char* t = &tris[mask][3 * triCount[mask]++];
+						t[0] = (signed char)loop[0];
+						t[1] = (signed char)loop[k + 1];
+						t[2] = (signed char)loop[k];
+					}
+				}
+			}
+		}
+	};
+
+	const MarchingCubesTable& mcTable()
+	{
+		static const MarchingCubesTable table;
+		return table;
+	}
+
+	//Everything extract() knows about one brick. Cells of the brick are
+	//[low, low+size), its vertices are the crossings of the edges starting
+	//at the voxels [low, low+owned), owned=size plus the last voxel layer
+	//for the last brick along an axis.
+	struct Brick
+	{
+		vec3i id, low, size, owned;
+		size_t vertexCount, triangleCount;
+		size_t vertexOffset, triangleOffset;
+		//local vertex index(or -1) of the 3 edges of each voxel on the low
+		//face along axis a, looked up by the brick below along a.
+		std::vector<int> lowFace[3];
+	};
+
+	template<class T>
+	class Extractor
+	{
+	public:
+		Extractor(const T* volume, const vec3i& dim, const vec3i& grid, float iso)
+			:m_volume(volume), m_dim(dim), m_grid(grid), m_iso(iso){}
+
+		float value(int x, int y, int z) const
+		{
+			return (float)m_volume[(size_t(z) * m_dim.y() + y) * m_dim.x() + x];
+		}
+		bool inside(int x, int y, int z) const { return value(x, y, z) >= m_iso; }
+
+		//Visits the crossing edges owned by b in a fixed order, fn(voxel, axis, localIndex).
+		template<class Fn>
+		size_t forEachOwnedVertex(const Brick& b, Fn fn) const
+		{
+			size_t count = 0;
+			for (int z = b.low.z(); z < b.low.z() + b.owned.z(); z++)
+			for (int y = b.low.y(); y < b.low.y() + b.owned.y(); y++)
+			for (int x = b.low.x(); x < b.low.x() + b.owned.x(); x++)
+			{
+				bool in0 = inside(x, y, z);
+				const int p[3] = { x, y, z };
+				for (int a = 0; a < 3; a++)
+				{
+					if (p[a] + 1 >= m_dim[a]) continue;
+					bool in1 = inside(x + (a == 0), y + (a == 1), z + (a == 2));
+					if (in0 != in1)
+						fn(vec3i(x, y, z), a, (int)count++);
+				}
+			}
+			return count;
+		}
+
+		//Pass 1: vertex/triangle counts and the low face tables.
+		void count(Brick& b) const
+		{
+			const MarchingCubesTable& mc = mcTable();
+			vec3i o = b.owned;
+			for (int a = 0; a < 3; a++)
+			{
+				if (b.id[a] == 0) continue;//nobody below.
+				int u = (a + 1) % 3, v = (a + 2) % 3;
+				b.lowFace[a].assign(size_t(o[u]) * o[v] * 3, -1);
+			}
+			b.vertexCount = forEachOwnedVertex(b, [&](const vec3i& p, int axis, int local)
+			{
+				for (int a = 0; a < 3; a++)
+				{
+					if (b.lowFace[a].empty() || p[a] != b.low[a]) continue;
+					int u = (a + 1) % 3, v = (a + 2) % 3;
+					b.lowFace[a][(size_t(p[v] - b.low[v]) * o[u] + (p[u] - b.low[u])) * 3 + axis] = local;
+				}
+			});
+			size_t tris = 0;
+			for (int z = b.low.z(); z < b.low.z() + b.size.z(); z++)
+			for (int y = b.low.y(); y < b.low.y() + b.size.y(); y++)
+			for (int x = b.low.x(); x < b.low.x() + b.size.x(); x++)
+				tris += mc.triCount[cellCase(x, y, z)];
+			b.triangleCount = tris;
+		}
+
+		//Pass 2: vertices, normals and indices at the brick's offsets.
+		void emit(const Brick& b, const std::vector<Brick>& bricks, std::vector<int>& localMap,
+				  const vec3f& origin, const vec3f& spacing, GLIsosurfaceMesh& mesh) const
+		{
+			const MarchingCubesTable& mc = mcTable();
+			vec3i o = b.owned;
+			localMap.assign(size_t(o.x()) * o.y() * o.z() * 3, -1);
+			bool normals = !mesh.normals.empty();
+			forEachOwnedVertex(b, [&](const vec3i& p, int axis, int local)
+			{
+				localMap[((size_t(p.z() - b.low.z()) * o.y() + (p.y() - b.low.y())) * o.x() + (p.x() - b.low.x())) * 3 + axis] = local;
+				vec3i q(p.x() + (axis == 0), p.y() + (axis == 1), p.z() + (axis == 2));
+				float v0 = value(p.x(), p.y(), p.z()), v1 = value(q.x(), q.y(), q.z());
+				float t = (m_iso - v0) / (v1 - v0);
+				vec3f pos(p);
+				pos[axis] += t;
+				size_t dst = b.vertexOffset + local;
+				mesh.vertices[dst] = origin + pos * spacing;
+				if (normals)
+				{
+					vec3f g = gradient(p) * (1.0f - t) + gradient(q) * t;
+					float len = g.length();
+					mesh.normals[dst] = len > 0.0f ? g / (-len) : vec3f(0.0f);
+				}
+			});
+
+			GLuint* out = mesh.indices.empty() ? NULL : &mesh.indices[3 * b.triangleOffset];
+			for (int z = b.low.z(); z < b.low.z() + b.size.z(); z++)
+			for (int y = b.low.y(); y < b.low.y() + b.size.y(); y++)
+			for (int x = b.low.x(); x < b.low.x() + b.size.x(); x++)
+			{
+				int c = cellCase(x, y, z);
+				for (int k = 0; k < 3 * mc.triCount[c]; k++)
+				{
+					int e = mc.tris[c][k];
+					int corner = mc.edgeCorner[e][0];
+					vec3i p(x + (corner & 1), y + ((corner >> 1) & 1), z + ((corner >> 2) & 1));
+					*out++ = vertexIndex(b, bricks, localMap, p, mc.edgeAxis[e]);
+				}
+			}
+		}
+
+	private:
+		int cellCase(int x, int y, int z) const
+		{
+			int c = 0;
+			for (int i = 0; i < 8; i++)
+				c |= (int)inside(x + (i & 1), y + ((i >> 1) & 1), z + ((i >> 2) & 1)) << i;
+			return c;
+		}
+
+		vec3f gradient(const vec3i& p) const
+		{
+			vec3f g;
+			for (int a = 0; a < 3; a++)
+			{
+				vec3i lo = p, hi = p;
+				lo[a] = std::max(p[a] - 1, 0);
+				hi[a] = std::min(p[a] + 1, m_dim[a] - 1);
+				float d = (float)std::max(hi[a] - lo[a], 1);
+				g[a] = (value(hi.x(), hi.y(), hi.z()) - value(lo.x(), lo.y(), lo.z())) / d;
+			}
+			return g;
+		}
+
+		//Global index of the vertex on the edge starting at voxel p. Edges
+		//on the upper seams belong to the neighbor whose low face holds p.
+		GLuint vertexIndex(const Brick& b, const std::vector<Brick>& bricks, const std::vector<int>& localMap,
+						   const vec3i& p, int axis) const
+		{
+			vec3i rel = p - b.low;
+			int seam = -1;
+			vec3i nid = b.id;
+			for (int a = 2; a >= 0; a--)
+			{
+				if (rel[a] >= b.owned[a])
+				{
+					nid[a]++;
+					seam = a;
+				}
+			}
+			if (seam < 0)
+			{
+				int local = localMap[((size_t(rel.z()) * b.owned.y() + rel.y()) * b.owned.x() + rel.x()) * 3 + axis];
+				return (GLuint)(b.vertexOffset + local);
+			}
+			const Brick& n = bricks[(size_t(nid.z()) * m_grid.y() + nid.y()) * m_grid.x() + nid.x()];
+			int u = (seam + 1) % 3, v = (seam + 2) % 3;
+			int local = n.lowFace[seam][(size_t(p[v] - n.low[v]) * n.owned[u] + (p[u] - n.low[u])) * 3 + axis];
+			return (GLuint)(n.vertexOffset + local);
+		}
+
+		const T* m_volume;
+		vec3i m_dim, m_grid;
+		float m_iso;
+	};
+
+	template<class T>
+	void brickRanges(const T* volume, const vec3i& dim, const vec3i& grid,
+					 std::vector<float>& bmin, std::vector<float>& bmax, int nThreads)
+	{
+		vec3i cells = dim - 1;
+		size_t n = size_t(grid.x()) * grid.y() * grid.z();
+		bmin.assign(n, FLT_MAX);
+		bmax.assign(n, -FLT_MAX);
+		parallelForEach(n, nThreads, [&](size_t i)
+		{
+			vec3i id((int)(i % grid.x()), (int)(i / grid.x() % grid.y()), (int)(i / grid.x() / grid.y()));
+			vec3i low = BLOCK_LOW_3D(id, grid, cells);
+			vec3i size = BLOCK_SIZE_3D(id, grid, cells);
+			float mn = FLT_MAX, mx = -FLT_MAX;
+			//cells [low,low+size) touch voxels [low,low+size].
+			for (int z = low.z(); z <= low.z() + size.z(); z++)
+			for (int y = low.y(); y <= low.y() + size.y(); y++)
+			{
+				const T* row = volume + (size_t(z) * dim.y() + y) * dim.x();
+				for (int x = low.x(); x <= low.x() + size.x(); x++)
+				{
+					mn = std::min(mn, (float)row[x]);
+					mx = std::max(mx, (float)row[x]);
+				}
+			}
+			bmin[i] = mn;
+			bmax[i] = mx;
+		});
+	}
+
+	template<class T>
+	void extractSurface(const T* volume, const vec3i& dim, const vec3i& grid,
+						const std::vector<float>& bmin, const std::vector<float>& bmax,
+						float iso, const vec3f& origin, const vec3f& spacing,
+						GLIsosurfaceMesh& mesh, bool computeNormals, int nThreads)
+	{
+		vec3i cells = dim - 1;
+		std::vector<Brick> bricks(bmin.size());
+		std::vector<size_t> active;
+		for (size_t i = 0; i < bricks.size(); i++)
+		{
+			Brick& b = bricks[i];
+			b.id = vec3i((int)(i % grid.x()), (int)(i / grid.x() % grid.y()), (int)(i / grid.x() / grid.y()));
+			b.low = BLOCK_LOW_3D(b.id, grid, cells);
+			b.size = BLOCK_SIZE_3D(b.id, grid, cells);
+			b.owned = b.size;
+			for (int a = 0; a < 3; a++)
+				if (b.id[a] == grid[a] - 1) b.owned[a]++;
+			b.vertexCount = b.triangleCount = 0;
+			//an edge crosses only between a value >= iso and one below.
+			if (bmax[i] >= iso && bmin[i] < iso)
+				active.push_back(i);
+		}
+
+		Extractor<T> ex(volume, dim, grid, iso);
+		parallelForEach(active.size(), nThreads, [&](size_t k)
+		{
+			ex.count(bricks[active[k]]);
+		});
+
+		size_t nVertices = 0, nTriangles = 0;
+		for (size_t k = 0; k < active.size(); k++)
+		{
+			Brick& b = bricks[active[k]];
+			b.vertexOffset = nVertices;
+			b.triangleOffset = nTriangles;
+			nVertices += b.vertexCount;
+			nTriangles += b.triangleCount;
+		}
+		mesh.vertices.resize(nVertices);
+		mesh.normals.resize(computeNormals ? nVertices : 0);
+		mesh.indices.resize(3 * nTriangles);
+
+		std::vector<std::vector<int> > localMaps(active.size());
+		parallelForEach(active.size(), nThreads, [&](size_t k)
+		{
+			ex.emit(bricks[active[k]], bricks, localMaps[k], origin, spacing, mesh);
+			std::vector<int>().swap(localMaps[k]);
+		});
+	}
+}
+
+GLIsosurface::GLIsosurface(const vec3i& brickSize/*=vec3i(32,32,32)*/)
+	:m_brickSize(brickSize), m_volume(NULL), m_type(VOLUME_NONE),
+	 m_origin(0.0f), m_spacing(1.0f)
+{
+	for (int a = 0; a < 3; a++)
+		m_brickSize[a] = std::max(m_brickSize[a], 1);
+}
+
+void GLIsosurface::setVolume(const float* volume, const vec3i& dim, int nThreads/*=0*/)
+{
+	setVolume(volume, VOLUME_FLOAT, dim, nThreads);
+}
+
+void GLIsosurface::setVolume(const unsigned char* volume, const vec3i& dim, int nThreads/*=0*/)
+{
+	setVolume(volume, VOLUME_UBYTE, dim, nThreads);
+}
+
+void GLIsosurface::setVolume(const unsigned short* volume, const vec3i& dim, int nThreads/*=0*/)
+{
+	setVolume(volume, VOLUME_USHORT, dim, nThreads);
+}
+
+void GLIsosurface::setVolume(const void* volume, VolumeType type, const vec3i& dim, int nThreads)
+{
+	m_volume = volume;
+	m_type = type;
+	m_dim = dim;
+	m_brickMin.clear();
+	m_brickMax.clear();
+	if (!volume || dim.x() < 2 || dim.y() < 2 || dim.z() < 2)
+	{
+		m_type = VOLUME_NONE;
+		m_brickGrid = vec3i(0, 0, 0);
+		return;
+	}
+	for (int a = 0; a < 3; a++)
+		m_brickGrid[a] = (dim[a] - 1 + m_brickSize[a] - 1) / m_brickSize[a];
+	nThreads = resolveThreadCount(nThreads);
+	switch (m_type)
+	{
+	case VOLUME_FLOAT:
+		brickRanges((const float*)volume, dim, m_brickGrid, m_brickMin, m_brickMax, nThreads);
+		break;
+	case VOLUME_UBYTE:
+		brickRanges((const unsigned char*)volume, dim, m_brickGrid, m_brickMin, m_brickMax, nThreads);
+		break;
+	case VOLUME_USHORT:
+		brickRanges((const unsigned short*)volume, dim, m_brickGrid, m_brickMin, m_brickMax, nThreads);
+		break;
+	default:
+		break;
+	}
+}
+
+void GLIsosurface::extract(float isoValue, GLIsosurfaceMesh& mesh, bool computeNormals/*=true*/, int nThreads/*=0*/) const
+{
+	mesh.clear();
+	nThreads = resolveThreadCount(nThreads);
+	switch (m_type)
+	{
+	case VOLUME_FLOAT:
+		extractSurface((const float*)m_volume, m_dim, m_brickGrid, m_brickMin, m_brickMax,
+					   isoValue, m_origin, m_spacing, mesh, computeNormals, nThreads);
+		break;
+	case VOLUME_UBYTE:
+		extractSurface((const unsigned char*)m_volume, m_dim, m_brickGrid, m_brickMin, m_brickMax,
+					   isoValue, m_origin, m_spacing, mesh, computeNormals, nThreads);
+		break;
+	case VOLUME_USHORT:
+		extractSurface((const unsigned short*)m_volume, m_dim, m_brickGrid, m_brickMin, m_brickMax,
+					   isoValue, m_origin, m_spacing, mesh, computeNormals, nThreads);
+		break;
+	default:
+		break;
+	}
+}
+
+size_t GLIsosurface::getActiveBrickCount(float isoValue) const
+{
+	size_t n = 0;
+	for (size_t i = 0; i < m_brickMin.size(); i++)
+		if (m_brickMax[i] >= isoValue && m_brickMin[i] < isoValue) n++;
+	return n;
+}
+
+}
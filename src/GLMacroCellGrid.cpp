@@ -0,0 +1,384 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cfloat>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <GL/glew.h>
+#include "GLError.h"
+#include "GLMacroCellGrid.h"
+#include "GLParallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GLMACROCELL_SSE
+#endif
+
+namespace davinci{
+
+static const char* g_rangeShaderSrc =
+"#version 430\n"
+"layout(local_size_x = 4, local_size_y = 4, local_size_z = 4) in;\n"
+"uniform sampler3D volumeTex;\n"
+"layout(rg32f) writeonly uniform image3D rangeImg;\n"
+"uniform ivec3 gridSize;\n"
+"uniform int   cellSize;\n"
+"void main()\n"
+"{\n"
+"	ivec3 c = ivec3(gl_GlobalInvocationID);\n"
+"	if (any(greaterThanEqual(c, gridSize))) return;\n"
+"	ivec3 dim = textureSize(volumeTex, 0);\n"
+"	ivec3 lo = max(c * cellSize - 1, ivec3(0));\n"
+"	ivec3 hi = min((c + 1) * cellSize, dim - 1);\n"
+"	float vmin = 1e38, vmax = -1e38;\n"
+"	for (int z = lo.z; z <= hi.z; z++)\n"
+"	for (int y = lo.y; y <= hi.y; y++)\n"
+"	for (int x = lo.x; x <= hi.x; x++)\n"
+"	{\n"
+"		float v = texelFetch(volumeTex, ivec3(x, y, z), 0).r;\n"
+"		vmin = min(vmin, v);\n"
+"		vmax = max(vmax, v);\n"
+"	}\n"
+"	imageStore(rangeImg, c, vec4(vmin, vmax, 0.0, 0.0));\n"
+"}\n";
+
+namespace{
+	//Cell ranges, scale maps samples to the values texture() returns.
+	template<class T>
+	void cellRanges(const T* volume, const vec3i& dim, const vec3i& grid, int cellSize, float scale,
+					std::vector<float>& cmin, std::vector<float>& cmax, int nThreads)
+	{
+		size_t n = size_t(grid.x()) * grid.y() * grid.z();
+		parallelForEach(n, resolveThreadCount(nThreads), [&](size_t i)
+		{
+			vec3i c((int)(i % grid.x()), (int)(i / grid.x() % grid.y()), (int)(i / grid.x() / grid.y()));
+			vec3i lo, hi;
+			for (int a = 0; a < 3; a++)
+			{//trilinear samples inside the cell also read the voxel before it.
+				lo[a] = std::max(c[a] * cellSize - 1, 0);
+				hi[a] = std::min((c[a] + 1) * cellSize, dim[a] - 1);
+			}
+			T vmin = volume[(size_t(lo.z()) * dim.y() + lo.y()) * dim.x() + lo.x()], vmax = vmin;
+			for (int z = lo.z(); z <= hi.z(); z++)
+			for (int y = lo.y(); y <= hi.y(); y++)
+			{
+				T rmin, rmax;
+				GLMacroCellGrid::rangeOf(volume + (size_t(z) * dim.y() + y) * dim.x() + lo.x(),
+										 size_t(hi.x() - lo.x() + 1), rmin, rmax);
+				vmin = std::min(vmin, rmin);
+				vmax = std::max(vmax, rmax);
+			}
+			cmin[i] = vmin * scale;
+			cmax[i] = vmax * scale;
+		});
+	}
+}
+
+void GLMacroCellGrid::rangeOf(const unsigned char* v, size_t n, unsigned char& lo, unsigned char& hi)
+{
+	lo = 255; hi = 0;
+	size_t i = 0;
+#ifdef GLMACROCELL_SSE
+	if (n >= 16)
+	{
+		__m128i vmin = _mm_set1_epi8((char)0xFF), vmax = _mm_setzero_si128();
+		for (; i + 16 <= n; i += 16)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i*)(v + i));
+			vmin = _mm_min_epu8(vmin, x);
+			vmax = _mm_max_epu8(vmax, x);
+		}
+		unsigned char a[16], b[16];
+		_mm_storeu_si128((__m128i*)a, vmin);
+		_mm_storeu_si128((__m128i*)b, vmax);
+		for (int k = 0; k < 16; k++)
+		{
+			lo = std::min(lo, a[k]);
+			hi = std::max(hi, b[k]);
+		}
+	}
+#endif
+	for (; i < n; i++)
+	{
+		lo = std::min(lo, v[i]);
+		hi = std::max(hi, v[i]);
+	}
+}
+
+void GLMacroCellGrid::rangeOf(const unsigned short* v, size_t n, unsigned short& lo, unsigned short& hi)
+{
+	lo = 0xFFFF; hi = 0;
+	size_t i = 0;
+#ifdef GLMACROCELL_SSE
+	if (n >= 8)
+	{//SSE2 only compares signed words, flip the sign bit around it.
+		const __m128i bias = _mm_set1_epi16((short)0x8000);
+		__m128i vmin = _mm_set1_epi16(0x7FFF), vmax = _mm_set1_epi16((short)0x8000);
+		for (; i + 8 <= n; i += 8)
+		{
+			__m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(v + i)), bias);
+			vmin = _mm_min_epi16(vmin, x);
+			vmax = _mm_max_epi16(vmax, x);
+		}
+		unsigned short a[8], b[8];
+		_mm_storeu_si128((__m128i*)a, _mm_xor_si128(vmin, bias));
+		_mm_storeu_si128((__m128i*)b, _mm_xor_si128(vmax, bias));
+		for (int k = 0; k < 8; k++)
+		{
+			lo = std::min(lo, a[k]);
+			hi = std::max(hi, b[k]);
+		}
+	}
+#endif
+	for (; i < n; i++)
+	{
+		lo = std::min(lo, v[i]);
+		hi = std::max(hi, v[i]);
+	}
+}
+
+void GLMacroCellGrid::rangeOf(const float* v, size_t n, float& lo, float& hi)
+{
+	lo = FLT_MAX; hi = -FLT_MAX;
+	size_t i = 0;
+#ifdef GLMACROCELL_SSE
+	if (n >= 4)
+	{
+		__m128 vmin = _mm_set1_ps(FLT_MAX), vmax = _mm_set1_ps(-FLT_MAX);
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(v + i);
+			vmin = _mm_min_ps(vmin, x);
+			vmax = _mm_max_ps(vmax, x);
+		}
+		float a[4], b[4];
+		_mm_storeu_ps(a, vmin);
+		_mm_storeu_ps(b, vmax);
+		for (int k = 0; k < 4; k++)
+		{
+			lo = std::min(lo, a[k]);
+			hi = std::max(hi, b[k]);
+		}
+	}
+#endif
+	for (; i < n; i++)
+	{
+		lo = std::min(lo, v[i]);
+		hi = std::max(hi, v[i]);
+	}
+}
+
+GLMacroCellGrid::GLMacroCellGrid(int cellSize/*=8*/)
+	:m_cellSize(std::max(cellSize, 1)), m_dim(0, 0, 0), m_grid(0, 0, 0)
+{
+}
+
+GLMacroCellGrid::~GLMacroCellGrid()
+{
+}
+
+vec3f GLMacroCellGrid::getCellScale() const
+{
+	return vec3f(float(m_dim.x()) / m_cellSize, float(m_dim.y()) / m_cellSize, float(m_dim.z()) / m_cellSize);
+}
+
+size_t GLMacroCellGrid::getOccupiedCellCount() const
+{
+	return (size_t)std::count(m_occupied.begin(), m_occupied.end(), (unsigned char)1);
+}
+
+void GLMacroCellGrid::resizeGrid(const vec3i& dim)
+{
+	m_dim = dim;
+	for (int a = 0; a < 3; a++)
+		m_grid[a] = (std::max(dim[a], 1) + m_cellSize - 1) / m_cellSize;
+	size_t n = size_t(m_grid.x()) * m_grid.y() * m_grid.z();
+	m_min.assign(n, 0.0f);
+	m_max.assign(n, 0.0f);
+	m_occupied.assign(n, 0);
+	m_opaque.clear();//the next classify() evaluates every cell.
+}
+
+void GLMacroCellGrid::build(const unsigned char* volume, const vec3i& dim, int nThreads/*=0*/)
+{
+	resizeGrid(dim);
+	cellRanges(volume, dim, m_grid, m_cellSize, 1.0f / 255.0f, m_min, m_max, nThreads);
+}
+
+void GLMacroCellGrid::build(const unsigned short* volume, const vec3i& dim, int nThreads/*=0*/)
+{
+	resizeGrid(dim);
+	cellRanges(volume, dim, m_grid, m_cellSize, 1.0f / 65535.0f, m_min, m_max, nThreads);
+}
+
+void GLMacroCellGrid::build(const float* volume, const vec3i& dim, int nThreads/*=0*/)
+{
+	resizeGrid(dim);
+	cellRanges(volume, dim, m_grid, m_cellSize, 1.0f, m_min, m_max, nThreads);
+}
+
+void GLMacroCellGrid::build(const GLTexture3DRef& volume)
+{
+	if (!volume)
+	{
+		GLError::ErrorMessage(string(__func__) + ": volume texture is NULL!");
+		return;
+	}
+	vec3i oldGrid = m_grid;
+	resizeGrid(vec3i(volume->getWidth(), volume->getHeight(), volume->getDepth()));
+	if (!m_rangeShader)
+	{
+		std::string src = g_rangeShaderSrc;
+		m_rangeShader = GLComputeShaderRef(new GLComputeShader("GLMacroCellGrid range"));
+		m_rangeShader->setComputeShaderStr(src);
+		m_rangeShader->CreateShaders();
+	}
+	if (!m_rangeTex || oldGrid != m_grid)
+	{
+		m_rangeTex = GLTexture3DRef(new GLTexture3d(m_grid.x(), m_grid.y(), m_grid.z(), GL_RG32F, GL_RG, GL_FLOAT));
+		m_rangeTex->setName("GLMacroCellGrid::m_rangeTex");
+	}
+	m_rangeTex->setImageAccess(GL_WRITE_ONLY);
+	m_rangeTex->setImageIsLayered(true);//the whole 3D image.
+	m_rangeShader->SetSamplerUniform("volumeTex", volume.get());
+	m_rangeShader->SetImageUniform("rangeImg", m_rangeTex.get());
+	m_rangeShader->SetInt3Uniform("gridSize", m_grid);
+	m_rangeShader->SetIntUniform("cellSize", m_cellSize);
+	m_rangeShader->UseShaders((m_grid.x() + 3) / 4, (m_grid.y() + 3) / 4, (m_grid.z() + 3) / 4);
+	m_rangeShader->ReleaseShader();
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+	std::vector<float> ranges(2 * m_min.size());
+	glBindTexture(GL_TEXTURE_3D, m_rangeTex->getTextureId());
+	glGetTexImage(GL_TEXTURE_3D, 0, GL_RG, GL_FLOAT, &ranges[0]);
+	glBindTexture(GL_TEXTURE_3D, 0);
+	for (size_t i = 0; i < m_min.size(); i++)
+	{
+		m_min[i] = ranges[2 * i];
+		m_max[i] = ranges[2 * i + 1];
+	}
+	GLError::glCheckError(__func__);
+}
+
+void GLMacroCellGrid::binRange(float lo, float hi, size_t& first, size_t& last) const
+{
+	//a linearly filtered lookup at s blends entries floor(s*res-0.5) and the next one.
+	float res = (float)m_opaque.size();
+	float a = std::floor(std::min(std::max(lo, 0.0f), 1.0f) * res - 0.5f);
+	float b = std::floor(std::min(std::max(hi, 0.0f), 1.0f) * res - 0.5f) + 1.0f;
+	first = (size_t)std::max(a, 0.0f);
+	last = (size_t)std::min(std::max(b, 0.0f), res - 1.0f);
+}
+
+size_t GLMacroCellGrid::classify(const std::vector<unsigned char>& rgba, size_t resolution)
+{
+	if (m_min.empty() || resolution == 0 || rgba.size() < 4 * resolution)
+	{
+		GLError::ErrorMessage(string(__func__) + ": build() the grid and pass resolution RGBA entries first.");
+		return 0;
+	}
+	std::vector<unsigned char> opaque(resolution);
+	for (size_t i = 0; i < resolution; i++)
+		opaque[i] = rgba[4 * i + 3] > 0;
+	bool full = opaque.size() != m_opaque.size() || !m_occupancyTex;
+	size_t changedLo = 0, changedHi = resolution - 1;
+	if (!full)
+	{
+		while (changedLo < resolution && opaque[changedLo] == m_opaque[changedLo]) changedLo++;
+		if (changedLo == resolution)
+			return 0;//no entry switched between transparent and opaque.
+		while (opaque[changedHi] == m_opaque[changedHi]) changedHi--;
+	}
+	m_opaque.swap(opaque);
+	m_opaquePrefix.resize(resolution + 1);
+	m_opaquePrefix[0] = 0;
+	for (size_t i = 0; i < resolution; i++)
+		m_opaquePrefix[i + 1] = m_opaquePrefix[i] + m_opaque[i];
+
+	size_t changed = 0;
+	int zLo = m_grid.z(), zHi = -1;
+	for (size_t i = 0; i < m_min.size(); i++)
+	{
+		size_t first, last;
+		binRange(m_min[i], m_max[i], first, last);
+		if (last < changedLo || first > changedHi)
+			continue;
+		unsigned char occupied = m_opaquePrefix[last + 1] > m_opaquePrefix[first];
+		if (occupied != m_occupied[i])
+		{
+			m_occupied[i] = occupied;
+			changed++;
+			int z = (int)(i / (size_t(m_grid.x()) * m_grid.y()));
+			zLo = std::min(zLo, z);
+			zHi = std::max(zHi, z);
+		}
+	}
+
+	if (!m_occupancyTex || (int)m_occupancyTex->getWidth() != m_grid.x() ||
+		(int)m_occupancyTex->getHeight() != m_grid.y() || (int)m_occupancyTex->getDepth() != m_grid.z())
+	{
+		m_occupancyTex = GLTexture3DRef(new GLTexture3d(m_grid.x(), m_grid.y(), m_grid.z(), GL_R8, GL_RED, GL_UNSIGNED_BYTE));
+		m_occupancyTex->setName("GLMacroCellGrid::m_occupancyTex");
+		glBindTexture(GL_TEXTURE_3D, m_occupancyTex->getTextureId());
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_3D, 0);
+		full = true;
+	}
+	if (full)
+		uploadSlabs(0, m_grid.z() - 1);
+	else if (changed)
+		uploadSlabs(zLo, zHi);
+	return changed;
+}
+
+size_t GLMacroCellGrid::classify(const GLTexture1DRef& transferFunc)
+{
+	if (!transferFunc)
+	{
+		GLError::ErrorMessage(string(__func__) + ": transfer function texture is NULL!");
+		return 0;
+	}
+	size_t res = transferFunc->getWidth();
+	std::vector<unsigned char> rgba(4 * res);
+	glBindTexture(GL_TEXTURE_1D, transferFunc->getTextureId());
+	glGetTexImage(GL_TEXTURE_1D, 0, GL_RGBA, GL_UNSIGNED_BYTE, &rgba[0]);
+	glBindTexture(GL_TEXTURE_1D, 0);
+	GLError::glCheckError(__func__);
+	return classify(rgba, res);
+}
+
+void GLMacroCellGrid::uploadSlabs(int zFirst, int zLast)
+{
+	GLint alignment = 4;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glBindTexture(GL_TEXTURE_3D, m_occupancyTex->getTextureId());
+	glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, zFirst, m_grid.x(), m_grid.y(), zLast - zFirst + 1,
+					GL_RED, GL_UNSIGNED_BYTE, &m_occupied[index(vec3i(0, 0, zFirst))]);
+	glBindTexture(GL_TEXTURE_3D, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+	GLError::glCheckError(__func__);
+}
+
+}
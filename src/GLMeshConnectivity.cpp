@@ -0,0 +1,238 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "GLMeshConnectivity.h"
+#include "GLParallel.h"
+
+namespace davinci{
+
+namespace{
+	typedef unsigned long long Key;
+
+	int bitsFor(size_t n)
+	{
+		int bits = 1;
+		while (bits < 64 && (size_t(1) << bits) < n) bits++;
+		return bits;
+	}
+}
+
+GLMeshConnectivity::GLMeshConnectivity()
+	:m_nThreads(1)
+{
+	std::fill(m_typeCounts, m_typeCounts + 4, 0);
+}
+
+void GLMeshConnectivity::build(const std::vector<vec3i>& triangleMesh, size_t vertexCount, int nThreads/*=0*/)
+{
+	m_nThreads = nThreads = resolveThreadCount(nThreads);
+	m_triangles = triangleMesh;
+	size_t nHalfEdges = 3 * m_triangles.size();
+	int vertexBits = bitsFor(vertexCount);
+	size_t nBlocks = std::max<size_t>(1, std::min<size_t>(nThreads, nHalfEdges / 65536));
+
+	//1. half-edges sorted by undirected edge key.
+	std::vector<Key> keys(nHalfEdges);
+	std::vector<unsigned> halfEdges(nHalfEdges);
+	parallelBlocks(m_triangles.size(), nBlocks, nThreads, [&](size_t, size_t begin, size_t end)
+	{
+		for (size_t t = begin; t < end; t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				Key a = (Key)m_triangles[t][k], b = (Key)m_triangles[t][(k + 1) % 3];
+				keys[3 * t + k] = a < b ? (a << vertexBits) | b : (b << vertexBits) | a;
+				halfEdges[3 * t + k] = (unsigned)(3 * t + k);
+			}
+		}
+	});
+	radixSortPairs(keys, halfEdges, 2 * vertexBits, nThreads);
+
+	//2. runs of equal keys are edges, numbered by a blocked prefix sum.
+	std::vector<size_t> blockEdges(nBlocks + 1, 0);
+	parallelBlocks(nHalfEdges, nBlocks, nThreads, [&](size_t b, size_t begin, size_t end)
+	{
+		size_t c = 0;
+		for (size_t i = begin; i < end; i++)
+			c += (i == 0 || keys[i] != keys[i - 1]);
+		blockEdges[b + 1] = c;
+	});
+	for (size_t b = 0; b < nBlocks; b++)
+		blockEdges[b + 1] += blockEdges[b];
+	size_t nEdges = blockEdges[nBlocks];
+	m_edges.resize(nEdges);
+	m_edgeTypes.resize(nEdges);
+	m_twin.assign(nHalfEdges, -1);
+	m_halfEdgeEdge.resize(nHalfEdges);
+	Key lowMask = (Key(1) << vertexBits) - 1;
+	parallelBlocks(nHalfEdges, nBlocks, nThreads, [&](size_t b, size_t begin, size_t end)
+	{
+		size_t e = blockEdges[b];
+		for (size_t i = begin; i < end; i++)
+		{
+			if (i != 0 && keys[i] == keys[i - 1]) continue;
+			size_t runEnd = i + 1;
+			while (runEnd < nHalfEdges && keys[runEnd] == keys[i]) runEnd++;
+			m_edges[e] = vec2i((int)(keys[i] >> vertexBits), (int)(keys[i] & lowMask));
+			for (size_t j = i; j < runEnd; j++)
+				m_halfEdgeEdge[halfEdges[j]] = (int)e;
+			unsigned char type = EDGE_NONMANIFOLD;
+			if (runEnd - i == 1)
+			{
+				type = EDGE_BOUNDARY;
+			}
+			else if (runEnd - i == 2)
+			{
+				int h0 = (int)halfEdges[i], h1 = (int)halfEdges[i + 1];
+				if (origin(h0) == target(h1))
+				{
+					type = EDGE_INTERIOR;
+					m_twin[h0] = h1;
+					m_twin[h1] = h0;
+				}
+				else
+				{
+					type = EDGE_FLIPPED;
+				}
+			}
+			m_edgeTypes[e++] = type;
+		}
+	});
+
+	std::fill(m_typeCounts, m_typeCounts + 4, 0);
+	m_vertexFlags.assign(vertexCount, 0);
+	for (size_t e = 0; e < nEdges; e++)
+	{
+		unsigned char type = m_edgeTypes[e];
+		m_typeCounts[type]++;
+		unsigned char flag = type == EDGE_BOUNDARY ? VERTEX_BOUNDARY :
+							 type == EDGE_NONMANIFOLD ? VERTEX_NONMANIFOLD : 0;
+		m_vertexFlags[m_edges[e].x()] |= flag;
+		m_vertexFlags[m_edges[e].y()] |= flag;
+	}
+
+	//3. corners sorted by vertex give the vertex -> corner CSR.
+	parallelBlocks(m_triangles.size(), nBlocks, nThreads, [&](size_t, size_t begin, size_t end)
+	{
+		for (size_t t = begin; t < end; t++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				keys[3 * t + k] = (Key)m_triangles[t][k];
+				halfEdges[3 * t + k] = (unsigned)(3 * t + k);
+			}
+		}
+	});
+	radixSortPairs(keys, halfEdges, vertexBits, nThreads);
+	m_corners.swap(halfEdges);
+	m_cornerOffsets.assign(vertexCount + 1, (unsigned)nHalfEdges);
+	parallelBlocks(nHalfEdges, nBlocks, nThreads, [&](size_t, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			Key first = i == 0 ? 0 : keys[i - 1] + 1;
+			if (i != 0 && keys[i] == keys[i - 1]) continue;
+			for (Key v = first; v <= keys[i]; v++)
+				m_cornerOffsets[v] = (unsigned)i;
+		}
+	});
+}
+
+void GLMeshConnectivity::computeNormals(const std::vector<vec3f>& vertexArrayUnique, NormalWeighting weighting,
+										std::vector<vec3f>& faceNormals, std::vector<vec3f>& vertexNormals,
+										int nThreads/*=0*/) const
+{
+	nThreads = nThreads > 0 ? nThreads : m_nThreads;
+	size_t nTriangles = m_triangles.size();
+	//unnormalized cross products first, their length is twice the area.
+	std::vector<vec3f> areaNormals(nTriangles);
+	faceNormals.resize(nTriangles);
+	size_t nBlocks = std::max<size_t>(1, std::min<size_t>(4 * nThreads, nTriangles / 4096));
+	parallelBlocks(nTriangles, nBlocks, nThreads, [&](size_t, size_t begin, size_t end)
+	{
+		for (size_t t = begin; t < end; t++)
+		{
+			const vec3i& tri = m_triangles[t];
+			const vec3f& p0 = vertexArrayUnique[tri[0]];
+			vec3f n = (vertexArrayUnique[tri[1]] - p0).cross(vertexArrayUnique[tri[2]] - p0);
+			areaNormals[t] = n;
+			float len = n.length();
+			faceNormals[t] = len > 0.0f ? n / len : vec3f(0.0f);
+		}
+	});
+
+	size_t nVertices = m_cornerOffsets.empty() ? 0 : m_cornerOffsets.size() - 1;
+	vertexNormals.resize(nVertices);
+	nBlocks = std::max<size_t>(1, std::min<size_t>(4 * nThreads, nVertices / 4096));
+	parallelBlocks(nVertices, nBlocks, nThreads, [&](size_t, size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; v++)
+		{
+			vec3f sum(0.0f);
+			for (unsigned i = m_cornerOffsets[v]; i < m_cornerOffsets[v + 1]; i++)
+			{
+				unsigned c = m_corners[i], t = c / 3, k = c % 3;
+				if (weighting == WEIGHT_AREA)
+				{
+					sum += areaNormals[t];
+					continue;
+				}
+				const vec3i& tri = m_triangles[t];
+				const vec3f& p = vertexArrayUnique[tri[k]];
+				vec3f e1 = vertexArrayUnique[tri[(k + 1) % 3]] - p;
+				vec3f e2 = vertexArrayUnique[tri[(k + 2) % 3]] - p;
+				float l = e1.length() * e2.length();
+				if (l <= 0.0f) continue;
+				float cosAngle = std::min(std::max(e1.dot(e2) / l, -1.0f), 1.0f);
+				sum += faceNormals[t] * std::acos(cosAngle);
+			}
+			float len = sum.length();
+			vertexNormals[v] = len > 0.0f ? sum / len : vec3f(0.0f);
+		}
+	});
+}
+
+void GLMeshConnectivity::toTriangles(const std::vector<vec3f>& vertexArrayUnique, const std::vector<vec3f>& faceNormals,
+									 const std::vector<vec3f>& vertexNormals, std::vector<GLTriangle>& triangles) const
+{
+	triangles.resize(m_triangles.size());
+	size_t nBlocks = std::max<size_t>(1, std::min<size_t>(4 * m_nThreads, m_triangles.size() / 4096));
+	parallelBlocks(m_triangles.size(), nBlocks, m_nThreads, [&](size_t, size_t begin, size_t end)
+	{
+		for (size_t t = begin; t < end; t++)
+		{
+			GLTriangle& tri = triangles[t];
+			for (int k = 0; k < 3; k++)
+			{
+				tri.v[k] = vertexArrayUnique[m_triangles[t][k]];
+				tri.vn[k] = vertexNormals[m_triangles[t][k]];
+			}
+			tri.normal = faceNormals[t];
+		}
+	});
+}
+
+}
@@ -0,0 +1,160 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cmath>
+#include <thread>
+#include <algorithm>
+#include "GLMeshDistance.h"
+
+namespace davinci{
+
+namespace{
+	//barycentric tolerance when deciding whether a closest point lies on
+	//a vertex, an edge or inside the face.
+	const float g_featureEps = 1e-5f;
+
+	vec3f normalized(const vec3f& v)
+	{
+		float len = v.length();
+		return len > 0.0f ? v / len : v;
+	}
+
+	float angleBetween(const vec3f& a, const vec3f& b)
+	{
+		float c = normalized(a).dot(normalized(b));
+		return acosf(std::max(-1.0f, std::min(1.0f, c)));
+	}
+}
+
+GLMeshDistance::GLMeshDistance()
+{
+}
+
+void GLMeshDistance::build(const std::vector<vec3f>& vertexArrayUnique,
+						   const std::vector<vec3i>& triangleMesh, int nThreads/*=0*/)
+{
+	m_bvh.build(vertexArrayUnique, triangleMesh, 4, nThreads);
+	m_triangles = triangleMesh;
+	size_t nTri = triangleMesh.size();
+
+	m_faceNormals.resize(nTri);
+	m_vertexNormals.assign(vertexArrayUnique.size(), vec3f(0.0f));
+	for (size_t t = 0; t < nTri; t++)
+	{
+		const vec3i& tri = triangleMesh[t];
+		const vec3f& a = vertexArrayUnique[tri[0]];
+		const vec3f& b = vertexArrayUnique[tri[1]];
+		const vec3f& c = vertexArrayUnique[tri[2]];
+		vec3f n = normalized((b - a).cross(c - a));
+		m_faceNormals[t] = n;
+		m_vertexNormals[tri[0]] = m_vertexNormals[tri[0]] + n * angleBetween(b - a, c - a);
+		m_vertexNormals[tri[1]] = m_vertexNormals[tri[1]] + n * angleBetween(c - b, a - b);
+		m_vertexNormals[tri[2]] = m_vertexNormals[tri[2]] + n * angleBetween(a - c, b - c);
+	}
+
+	//Edge pseudo normal: sum of the normals of the faces sharing the edge.
+	//Sorting (edge key, slot) pairs groups the slots of each edge.
+	std::vector<std::pair<unsigned long long, unsigned int> > edges(3 * nTri);
+	for (size_t t = 0; t < nTri; t++)
+	{
+		const vec3i& tri = triangleMesh[t];
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned long long i0 = (unsigned int)tri[k], i1 = (unsigned int)tri[(k + 1) % 3];
+			unsigned long long key = i0 < i1 ? (i0 << 32 | i1) : (i1 << 32 | i0);
+			edges[3 * t + k] = std::make_pair(key, (unsigned int)(3 * t + k));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	m_edgeNormals.resize(3 * nTri);
+	for (size_t first = 0; first < edges.size(); )
+	{
+		size_t last = first;
+		vec3f sum(0.0f);
+		for (; last < edges.size() && edges[last].first == edges[first].first; last++)
+			sum = sum + m_faceNormals[edges[last].second / 3];
+		for (size_t e = first; e < last; e++)
+			m_edgeNormals[edges[e].second] = sum;
+		first = last;
+	}
+}
+
+float GLMeshDistance::sideOf(const vec3f& p, const GLClosestPoint& cp) const
+{
+	const vec3i& tri = m_triangles[cp.triangle];
+	float u = cp.u, v = cp.v;
+	vec3f n;
+	if (u < g_featureEps && v < g_featureEps)  n = m_vertexNormals[tri[0]];
+	else if (u > 1.0f - g_featureEps)          n = m_vertexNormals[tri[1]];
+	else if (v > 1.0f - g_featureEps)          n = m_vertexNormals[tri[2]];
+	else if (v < g_featureEps)                 n = m_edgeNormals[3 * cp.triangle + 0];
+	else if (u + v > 1.0f - g_featureEps)      n = m_edgeNormals[3 * cp.triangle + 1];
+	else if (u < g_featureEps)                 n = m_edgeNormals[3 * cp.triangle + 2];
+	else                                       n = m_faceNormals[cp.triangle];
+	return (p - cp.point).dot(n) < 0.0f ? -1.0f : 1.0f;
+}
+
+float GLMeshDistance::signedDistance(const vec3f& p, float maxDistance/*=1e30f*/) const
+{
+	GLClosestPoint cp;
+	if (!m_bvh.closestPoint(p, cp, maxDistance))
+		return maxDistance;
+	return sideOf(p, cp) * cp.distance;
+}
+
+void GLMeshDistance::signedDistances(const std::vector<vec3f>& points, std::vector<float>& distances,
+									 float maxDistance/*=1e30f*/, int nThreads/*=0*/) const
+{
+	std::vector<GLClosestPoint> cps;
+	m_bvh.closestPoints(points, cps, maxDistance, nThreads);
+	distances.resize(points.size());
+	for (size_t i = 0; i < points.size(); i++)
+	{
+		distances[i] = cps[i].isValid() ? sideOf(points[i], cps[i]) * cps[i].distance : maxDistance;
+	}
+}
+
+void GLMeshDistance::bakeSDF(const BBox& box, int nx, int ny, int nz, std::vector<float>& grid,
+							 float maxDistance/*=1e30f*/, int nThreads/*=0*/) const
+{
+	grid.assign(size_t(std::max(nx, 0)) * std::max(ny, 0) * std::max(nz, 0), maxDistance);
+	if (grid.empty()) return;
+	vec3f cell = box.getDimension() / vec3f((float)nx, (float)ny, (float)nz);
+
+	//one z slice at a time keeps the query buffers small.
+	std::vector<vec3f> points(size_t(nx) * ny);
+	std::vector<float> slice;
+	for (int z = 0; z < nz; z++)
+	{
+		float pz = box.pMin.z() + (z + 0.5f) * cell.z();
+		for (int y = 0; y < ny; y++)
+		{
+			float py = box.pMin.y() + (y + 0.5f) * cell.y();
+			for (int x = 0; x < nx; x++)
+				points[size_t(y) * nx + x] = vec3f(box.pMin.x() + (x + 0.5f) * cell.x(), py, pz);
+		}
+		signedDistances(points, slice, maxDistance, nThreads);
+		std::copy(slice.begin(), slice.end(), grid.begin() + size_t(z) * nx * ny);
+	}
+}
+
+}
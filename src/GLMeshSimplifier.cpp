@@ -0,0 +1,599 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cmath>
+#include <cfloat>
+#include <queue>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "GLCamera.h"
+#include "GLMeshSimplifier.h"
+#include "GLParallel.h"
+
+namespace davinci{
+
+namespace{
+	const int    g_maxPasses = 16;
+	//below this many triangles a single partition is simplified serially.
+	const size_t g_minParallelTriangles = 20000;
+	//weight of the planes holding mesh borders in place.
+	const double g_boundaryWeight = 10.0;
+
+	//Symmetric 4x4 error quadric: E(p) = p^T A p + 2 b.p + c, accumulated
+	//with the area of the planes in w to express errors as distances.
+	struct Quadric
+	{
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2, c, w;
+
+		Quadric() :a00(0), a01(0), a02(0), a11(0), a12(0), a22(0),
+				   b0(0), b1(0), b2(0), c(0), w(0){}
+
+		//plane n.p + d = 0, n of unit length.
+		Quadric(double nx, double ny, double nz, double d, double weight)
+			:a00(weight*nx*nx), a01(weight*nx*ny), a02(weight*nx*nz),
+			 a11(weight*ny*ny), a12(weight*ny*nz), a22(weight*nz*nz),
+			 b0(weight*nx*d), b1(weight*ny*d), b2(weight*nz*d),
+			 c(weight*d*d), w(weight){}
+
+		Quadric& operator+=(const Quadric& q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02;
+			a11 += q.a11; a12 += q.a12; a22 += q.a22;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c; w += q.w;
+			return *this;
+		}
+
+		double eval(const vec3f& p) const
+		{
+			double x = p.x(), y = p.y(), z = p.z();
+			return x*(a00*x + a01*y + a02*z) + y*(a01*x + a11*y + a12*z) + z*(a02*x + a12*y + a22*z)
+				+ 2.0*(b0*x + b1*y + b2*z) + c;
+		}
+
+		//root mean square distance to the accumulated planes.
+		float error(const vec3f& p) const
+		{
+			return w > 0.0 ? (float)std::sqrt(std::max(eval(p), 0.0) / w) : 0.0f;
+		}
+
+		//Minimizer of E, false if A is close to singular.
+		bool optimum(vec3f& p) const
+		{
+			if (w <= 0.0) return false;
+			double s = 1.0 / w;
+			double m00 = a00*s, m01 = a01*s, m02 = a02*s, m11 = a11*s, m12 = a12*s, m22 = a22*s;
+			double c00 = m11*m22 - m12*m12, c01 = m02*m12 - m01*m22, c02 = m01*m12 - m02*m11;
+			double det = m00*c00 + m01*c01 + m02*c02;
+			if (std::fabs(det) < 1e-9) return false;
+			double c11 = m00*m22 - m02*m02, c12 = m01*m02 - m00*m12, c22 = m00*m11 - m01*m01;
+			double r0 = -b0*s, r1 = -b1*s, r2 = -b2*s, inv = 1.0 / det;
+			p = vec3f((float)((c00*r0 + c01*r1 + c02*r2)*inv),
+					  (float)((c01*r0 + c11*r1 + c12*r2)*inv),
+					  (float)((c02*r0 + c12*r1 + c22*r2)*inv));
+			return true;
+		}
+	};
+
+	//The mesh being simplified. Vertices are owned by exactly one
+	//partition in a pass, which is the only one reading or writing them.
+	struct WorkMesh
+	{
+		std::vector<vec3f>   vertices;
+		std::vector<Quadric> quadrics;
+		std::vector<vec3i>   triangles;
+	};
+
+	inline unsigned long long edgeKey(int a, int b)
+	{
+		if (a > b) std::swap(a, b);
+		return ((unsigned long long)(unsigned)a << 32) | (unsigned)b;
+	}
+
+	//Face quadrics weighted by area plus a perpendicular plane along every
+	//border edge, so the border can only slide along itself.
+	void initMesh(const std::vector<vec3f>& vertices, const std::vector<vec3i>& triangles, WorkMesh& mesh)
+	{
+		mesh.vertices = vertices;
+		mesh.quadrics.assign(vertices.size(), Quadric());
+		mesh.triangles.clear();
+		mesh.triangles.reserve(triangles.size());
+		for (size_t t = 0; t < triangles.size(); t++)
+		{
+			const vec3i& tri = triangles[t];
+			if (tri.x() != tri.y() && tri.y() != tri.z() && tri.z() != tri.x())
+				mesh.triangles.push_back(tri);
+		}
+
+		std::vector<unsigned long long> edges(3 * mesh.triangles.size());
+		for (size_t t = 0; t < mesh.triangles.size(); t++)
+		{
+			const vec3i& tri = mesh.triangles[t];
+			vec3f p0 = vertices[tri.x()], p1 = vertices[tri.y()], p2 = vertices[tri.z()];
+			vec3f n = (p1 - p0).cross(p2 - p0);
+			double len = n.length();
+			if (len > 0.0)
+			{
+				double nx = n.x() / len, ny = n.y() / len, nz = n.z() / len;
+				double d = -(nx*p0.x() + ny*p0.y() + nz*p0.z());
+				Quadric q(nx, ny, nz, d, 0.5*len);
+				for (int k = 0; k < 3; k++)
+					mesh.quadrics[tri[k]] += q;
+			}
+			for (int k = 0; k < 3; k++)
+				edges[3 * t + k] = edgeKey(tri[k], tri[(k + 1) % 3]);
+		}
+		std::sort(edges.begin(), edges.end());
+
+		for (size_t t = 0; t < mesh.triangles.size(); t++)
+		{
+			const vec3i& tri = mesh.triangles[t];
+			vec3f p0 = vertices[tri.x()], p1 = vertices[tri.y()], p2 = vertices[tri.z()];
+			vec3f n = (p1 - p0).cross(p2 - p0);
+			if (n.lengthSquared() <= 0.0f) continue;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned long long key = edgeKey(tri[k], tri[(k + 1) % 3]);
+				std::vector<unsigned long long>::iterator it = std::lower_bound(edges.begin(), edges.end(), key);
+				if (it + 1 != edges.end() && *(it + 1) == key) continue;//shared edge.
+				vec3f a = vertices[tri[k]], e = vertices[tri[(k + 1) % 3]] - a;
+				vec3f m = e.cross(n);
+				double len = m.length();
+				if (len <= 0.0) continue;
+				double mx = m.x() / len, my = m.y() / len, mz = m.z() / len;
+				double d = -(mx*a.x() + my*a.y() + mz*a.z());
+				Quadric q(mx, my, mz, d, g_boundaryWeight*e.lengthSquared());
+				q.w = 0.0;//a moving border must not dilute its own error.
+				mesh.quadrics[tri[k]] += q;
+				mesh.quadrics[tri[(k + 1) % 3]] += q;
+			}
+		}
+	}
+
+	//Drops unreferenced vertices, keeping the order of the rest.
+	void compactMesh(WorkMesh& mesh)
+	{
+		std::vector<int> remap(mesh.vertices.size(), -1);
+		for (size_t t = 0; t < mesh.triangles.size(); t++)
+			for (int k = 0; k < 3; k++)
+				remap[mesh.triangles[t][k]] = 0;
+		int n = 0;
+		for (size_t v = 0; v < remap.size(); v++)
+		{
+			if (remap[v] < 0) continue;
+			remap[v] = n;
+			mesh.vertices[n] = mesh.vertices[v];
+			mesh.quadrics[n] = mesh.quadrics[v];
+			n++;
+		}
+		mesh.vertices.resize(n);
+		mesh.quadrics.resize(n);
+		for (size_t t = 0; t < mesh.triangles.size(); t++)
+			for (int k = 0; k < 3; k++)
+				mesh.triangles[t][k] = remap[mesh.triangles[t][k]];
+	}
+
+	struct Collapse
+	{
+		float    error;
+		int      from, to;
+		unsigned fromStamp, toStamp;
+		vec3f    position;
+		bool operator<(const Collapse& c) const { return error > c.error; }
+	};
+
+	//Serial greedy collapse of the triangles of one partition, cheapest
+	//first, in place on the shared WorkMesh. localIndex is -1 for every
+	//vertex on entry and on exit. Returns the largest collapse error.
+	class PartitionSimplifier
+	{
+	public:
+		PartitionSimplifier(WorkMesh& mesh, const std::vector<unsigned char>& locked, std::vector<int>& localIndex)
+			:m_mesh(mesh), m_locked(locked), m_localIndex(localIndex){}
+
+		float run(const std::vector<vec3i>& triangles, size_t targetCount, float maxError,
+				  std::vector<vec3i>& survivors)
+		{
+			m_tris.resize(triangles.size());
+			for (size_t t = 0; t < triangles.size(); t++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					int v = triangles[t][k];
+					if (m_localIndex[v] < 0)
+					{
+						m_localIndex[v] = (int)m_global.size();
+						m_global.push_back(v);
+					}
+					m_tris[t][k] = m_localIndex[v];
+				}
+			}
+			size_t n = m_global.size();
+			m_vertexTris.assign(n, std::vector<int>());
+			m_stamp.assign(n, 0);
+			m_alive.assign(n, 1);
+			m_removed.assign(m_tris.size(), 0);
+			std::vector<unsigned long long> edges;
+			edges.reserve(3 * m_tris.size());
+			for (size_t t = 0; t < m_tris.size(); t++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					m_vertexTris[m_tris[t][k]].push_back((int)t);
+					edges.push_back(edgeKey(m_tris[t][k], m_tris[t][(k + 1) % 3]));
+				}
+			}
+			std::sort(edges.begin(), edges.end());
+			edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+			for (size_t e = 0; e < edges.size(); e++)
+				push((int)(edges[e] >> 32), (int)(edges[e] & 0xffffffffu));
+
+			size_t liveCount = m_tris.size();
+			float maxCollapseError = 0.0f;
+			while (liveCount > targetCount && !m_heap.empty())
+			{
+				Collapse c = m_heap.top();
+				if (c.error > maxError) break;
+				m_heap.pop();
+				if (!m_alive[c.from] || !m_alive[c.to] ||
+					m_stamp[c.from] != c.fromStamp || m_stamp[c.to] != c.toStamp)
+					continue;
+				if (!isValid(c)) continue;
+				liveCount -= collapse(c);
+				maxCollapseError = std::max(maxCollapseError, c.error);
+			}
+
+			for (size_t t = 0; t < m_tris.size(); t++)
+			{
+				if (m_removed[t]) continue;
+				const vec3i& tri = m_tris[t];
+				survivors.push_back(vec3i(m_global[tri.x()], m_global[tri.y()], m_global[tri.z()]));
+			}
+			for (size_t v = 0; v < m_global.size(); v++)
+				m_localIndex[m_global[v]] = -1;
+			return maxCollapseError;
+		}
+
+	private:
+		vec3f& position(int v) { return m_mesh.vertices[m_global[v]]; }
+		Quadric& quadric(int v) { return m_mesh.quadrics[m_global[v]]; }
+
+		void push(int a, int b)
+		{
+			if (m_locked[m_global[a]] || m_locked[m_global[b]]) return;
+			Quadric q = quadric(a);
+			q += quadric(b);
+			Collapse c;
+			c.from = a; c.to = b;
+			c.fromStamp = m_stamp[a]; c.toStamp = m_stamp[b];
+			vec3f pa = position(a), pb = position(b), mid = (pa + pb)*0.5f;
+			vec3f p;
+			//the optimum may shoot far away on nearly flat or
+			//cylindrical patches, then fall back to the best candidate.
+			float reach = (pb - pa).lengthSquared();
+			if (q.optimum(p) && (p - mid).lengthSquared() <= reach)
+			{
+				c.position = p;
+			}
+			else
+			{
+				double ea = q.eval(pa), eb = q.eval(pb), em = q.eval(mid);
+				c.position = ea < eb ? (ea < em ? pa : mid) : (eb < em ? pb : mid);
+			}
+			c.error = q.error(c.position);
+			m_heap.push(c);
+		}
+
+		void neighbors(int v, std::vector<int>& out) const
+		{
+			out.clear();
+			const std::vector<int>& tris = m_vertexTris[v];
+			for (size_t i = 0; i < tris.size(); i++)
+			{
+				if (m_removed[tris[i]]) continue;
+				for (int k = 0; k < 3; k++)
+					if (m_tris[tris[i]][k] != v) out.push_back(m_tris[tris[i]][k]);
+			}
+			std::sort(out.begin(), out.end());
+			out.erase(std::unique(out.begin(), out.end()), out.end());
+		}
+
+		bool contains(const vec3i& tri, int v) const
+		{
+			return tri.x() == v || tri.y() == v || tri.z() == v;
+		}
+
+		//Link condition(the edge keeps the mesh manifold) and no triangle
+		//around the edge folds over.
+		bool isValid(const Collapse& c)
+		{
+			neighbors(c.from, m_ringA);
+			neighbors(c.to, m_ringB);
+			size_t common = 0;
+			for (size_t i = 0, j = 0; i < m_ringA.size() && j < m_ringB.size();)
+			{
+				if (m_ringA[i] < m_ringB[j]) i++;
+				else if (m_ringB[j] < m_ringA[i]) j++;
+				else { common++; i++; j++; }
+			}
+			size_t shared = 0;
+			const std::vector<int>& trisA = m_vertexTris[c.from];
+			for (size_t i = 0; i < trisA.size(); i++)
+				if (!m_removed[trisA[i]] && contains(m_tris[trisA[i]], c.to)) shared++;
+			if (shared == 0 || common != shared) return false;
+
+			for (int side = 0; side < 2; side++)
+			{
+				const std::vector<int>& tris = m_vertexTris[side ? c.to : c.from];
+				for (size_t i = 0; i < tris.size(); i++)
+				{
+					if (m_removed[tris[i]]) continue;
+					const vec3i& tri = m_tris[tris[i]];
+					if (contains(tri, c.from) && contains(tri, c.to)) continue;
+					vec3f p[3], q[3];
+					for (int k = 0; k < 3; k++)
+					{
+						p[k] = position(tri[k]);
+						q[k] = (tri[k] == c.from || tri[k] == c.to) ? c.position : p[k];
+					}
+					vec3f n0 = (p[1] - p[0]).cross(p[2] - p[0]);
+					vec3f n1 = (q[1] - q[0]).cross(q[2] - q[0]);
+					float l0 = n0.lengthSquared(), l1 = n1.lengthSquared();
+					if (l0 <= 0.0f) continue;
+					if (l1 <= 0.0f) return false;
+					float d = n0.dot(n1);
+					if (d <= 0.0f || d*d < 0.0625f*l0*l1) return false;
+				}
+			}
+			return true;
+		}
+
+		//Merges c.from into c.to, returns the number of triangles removed.
+		size_t collapse(const Collapse& c)
+		{
+			size_t removed = 0;
+			std::vector<int>& trisA = m_vertexTris[c.from];
+			std::vector<int>& trisB = m_vertexTris[c.to];
+			for (size_t i = 0; i < trisA.size(); i++)
+			{
+				int t = trisA[i];
+				if (m_removed[t]) continue;
+				vec3i& tri = m_tris[t];
+				if (contains(tri, c.to))
+				{
+					m_removed[t] = 1;
+					removed++;
+					continue;
+				}
+				for (int k = 0; k < 3; k++)
+					if (tri[k] == c.from) tri[k] = c.to;
+				trisB.push_back(t);
+			}
+			std::vector<int>().swap(trisA);
+			size_t n = 0;
+			for (size_t i = 0; i < trisB.size(); i++)
+				if (!m_removed[trisB[i]]) trisB[n++] = trisB[i];
+			trisB.resize(n);
+
+			m_alive[c.from] = 0;
+			m_stamp[c.from]++;
+			m_stamp[c.to]++;
+			position(c.to) = c.position;
+			quadric(c.to) += quadric(c.from);
+
+			neighbors(c.to, m_ringB);
+			for (size_t i = 0; i < m_ringB.size(); i++)
+				push(c.to, m_ringB[i]);
+			return removed;
+		}
+
+		WorkMesh&                         m_mesh;
+		const std::vector<unsigned char>& m_locked;
+		std::vector<int>&                 m_localIndex;
+		std::vector<int>                  m_global;//local to global vertex index.
+		std::vector<vec3i>                m_tris;
+		std::vector<unsigned char>        m_removed;
+		std::vector<std::vector<int> >    m_vertexTris;
+		std::vector<unsigned>             m_stamp;
+		std::vector<unsigned char>        m_alive;
+		std::priority_queue<Collapse>     m_heap;
+		std::vector<int>                  m_ringA, m_ringB;
+	};
+
+	//Partitioned passes until targetCount triangles are left, maxError is
+	//reached or nothing moves anymore. Returns the largest collapse error.
+	float simplifyMesh(WorkMesh& mesh, size_t targetCount, float maxError, int nThreads)
+	{
+		BBox bounds;
+		for (size_t v = 0; v < mesh.vertices.size(); v++)
+			bounds << mesh.vertices[v];
+		int res = std::max(2, (int)std::ceil(std::cbrt(4.0*nThreads)));
+		vec3f cell = bounds.getDimension() / (float)res;
+		for (int a = 0; a < 3; a++)
+			cell[a] = std::max(cell[a], FLT_MIN);
+
+		std::vector<int> partitionOf(mesh.vertices.size());
+		std::vector<unsigned char> locked(mesh.vertices.size());
+		std::vector<int> localIndex(mesh.vertices.size(), -1);
+		float maxCollapseError = 0.0f;
+		int stalls = 0;
+		for (int pass = 0; pass < g_maxPasses && mesh.triangles.size() > targetCount && stalls < 2; pass++)
+		{
+			size_t before = mesh.triangles.size();
+			bool single = nThreads == 1 || before < g_minParallelTriangles;
+			int dim = single ? 1 : res + (pass & 1);
+			float shift = (pass & 1) ? 0.5f : 0.0f;
+			for (size_t v = 0; v < mesh.vertices.size(); v++)
+			{
+				int id = 0;
+				if (!single)
+				{
+					vec3f rel = (mesh.vertices[v] - bounds.pMin) / cell;
+					for (int a = 2; a >= 0; a--)
+						id = id*dim + std::min(std::max((int)std::floor(rel[a] + shift), 0), dim - 1);
+				}
+				partitionOf[v] = id;
+				locked[v] = 0;
+			}
+
+			size_t nPartitions = size_t(dim)*dim*dim;
+			std::vector<std::vector<vec3i> > parts(nPartitions);
+			std::vector<vec3i> crossing;
+			for (size_t t = 0; t < mesh.triangles.size(); t++)
+			{
+				const vec3i& tri = mesh.triangles[t];
+				int p = partitionOf[tri.x()];
+				if (partitionOf[tri.y()] == p && partitionOf[tri.z()] == p)
+				{
+					parts[p].push_back(tri);
+				}
+				else
+				{
+					crossing.push_back(tri);
+					locked[tri.x()] = locked[tri.y()] = locked[tri.z()] = 1;
+				}
+			}
+
+			//biggest partitions first for load balance.
+			std::vector<size_t> order;
+			for (size_t p = 0; p < nPartitions; p++)
+				if (!parts[p].empty()) order.push_back(p);
+			std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+			{
+				return parts[a].size() > parts[b].size();
+			});
+
+			double ratio = (double)targetCount / (double)before;
+			std::vector<std::vector<vec3i> > survivors(order.size());
+			std::vector<float> errors(order.size(), 0.0f);
+			parallelForEach(order.size(), nThreads, [&](size_t i)
+			{
+				std::vector<vec3i>& tris = parts[order[i]];
+				size_t target = (size_t)std::ceil(tris.size()*ratio);
+				PartitionSimplifier simplifier(mesh, locked, localIndex);
+				errors[i] = simplifier.run(tris, target, maxError, survivors[i]);
+				std::vector<vec3i>().swap(tris);
+			});
+
+			mesh.triangles.swap(crossing);
+			for (size_t i = 0; i < order.size(); i++)
+			{
+				mesh.triangles.insert(mesh.triangles.end(), survivors[i].begin(), survivors[i].end());
+				maxCollapseError = std::max(maxCollapseError, errors[i]);
+			}
+
+			if (mesh.triangles.size() == before)
+			{
+				if (single) break;
+				stalls++;
+			}
+			else
+			{
+				stalls = 0;
+			}
+		}
+		return maxCollapseError;
+	}
+}
+
+GLMeshSimplifier::GLMeshSimplifier()
+{
+}
+
+void GLMeshSimplifier::buildLODChain(const std::vector<vec3f>& vertexArrayUnique,
+									 const std::vector<vec3i>& triangleMesh,
+									 int maxLevels/*=8*/, float ratio/*=0.5f*/,
+									 size_t minTriangleCount/*=256*/, int nThreads/*=0*/)
+{
+	m_lods.clear();
+	m_bounds = BBox();
+	for (size_t v = 0; v < vertexArrayUnique.size(); v++)
+		m_bounds << vertexArrayUnique[v];
+	if (maxLevels <= 0) return;
+
+	m_lods.push_back(GLMeshLOD());
+	m_lods.back().vertexArrayUnique = vertexArrayUnique;
+	m_lods.back().triangleMesh = triangleMesh;
+
+	nThreads = resolveThreadCount(nThreads);
+	ratio = std::min(std::max(ratio, 0.01f), 0.99f);
+	WorkMesh mesh;
+	initMesh(vertexArrayUnique, triangleMesh, mesh);
+	float error = 0.0f;
+	for (int level = 1; level < maxLevels; level++)
+	{
+		size_t before = mesh.triangles.size();
+		size_t target = (size_t)(before*ratio);
+		if (target < minTriangleCount) break;
+		error = std::max(error, simplifyMesh(mesh, target, FLT_MAX, nThreads));
+		if (mesh.triangles.size() >= before) break;
+		compactMesh(mesh);
+
+		m_lods.push_back(GLMeshLOD());
+		m_lods.back().vertexArrayUnique = mesh.vertices;
+		m_lods.back().triangleMesh = mesh.triangles;
+		m_lods.back().error = error;
+	}
+}
+
+float GLMeshSimplifier::projectedError(const GLCamera& camera, const BBox& bounds,
+									   float error, int viewportHeight)
+{
+	mat4 proj = camera.getProjectionMatrix();
+	//proj(1,1) maps a unit(at unit distance for perspective) to NDC.
+	float scale = 0.5f*viewportHeight*proj.get(1, 1);
+	if (proj.get(3, 3) != 0.0f)//orthographic
+		return error*scale;
+	vec3f toEye = camera.getCurrentPosition() - bounds.Center();
+	float distance = toEye.length() - 0.5f*bounds.getDimension().length();
+	if (distance <= 0.0f) return FLT_MAX;
+	return error*scale / distance;
+}
+
+int GLMeshSimplifier::selectLOD(const GLCamera& camera, int viewportHeight, float maxPixelError/*=1.0f*/) const
+{
+	for (int level = (int)m_lods.size() - 1; level > 0; level--)
+	{
+		if (projectedError(camera, m_bounds, m_lods[level].error, viewportHeight) <= maxPixelError)
+			return level;
+	}
+	return 0;
+}
+
+float GLMeshSimplifier::simplify(const std::vector<vec3f>& vertexArrayUnique,
+								 const std::vector<vec3i>& triangleMesh,
+								 size_t targetTriangleCount, float maxError,
+								 std::vector<vec3f>& vertexArrayOut,
+								 std::vector<vec3i>& triangleMeshOut, int nThreads/*=0*/)
+{
+	WorkMesh mesh;
+	initMesh(vertexArrayUnique, triangleMesh, mesh);
+	float error = simplifyMesh(mesh, targetTriangleCount, maxError, resolveThreadCount(nThreads));
+	compactMesh(mesh);
+	vertexArrayOut.swap(mesh.vertices);
+	triangleMeshOut.swap(mesh.triangles);
+	return error;
+}
+
+}
@@ -0,0 +1,418 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "GLMeshlet.h"
+#include "GLParallel.h"
+
+namespace davinci{
+
+static_assert(sizeof(GLMeshletData) == 96, "GLMeshletData must match the std430 layout of six vec4s");
+
+namespace{
+	//triangles per independently built chunk of the Morton order.
+	const size_t g_chunkTriangles = 1 << 16;
+
+	//Sorted runs on each thread, then pairwise merges.
+	template<class T>
+	void parallelSort(std::vector<T>& data, int nThreads)
+	{
+		size_t nRuns = std::max<size_t>(1, std::min<size_t>(nThreads, data.size() / 4096));
+		std::vector<size_t> bounds(nRuns + 1);
+		for (size_t r = 0; r <= nRuns; r++)
+			bounds[r] = data.size() * r / nRuns;
+		parallelForEach(nRuns, nThreads, [&](size_t r)
+		{
+			std::sort(data.begin() + bounds[r], data.begin() + bounds[r + 1]);
+		});
+		for (size_t width = 1; width < nRuns; width *= 2)
+		{
+			size_t nMerges = (nRuns + 2 * width - 1) / (2 * width);
+			parallelForEach(nMerges, nThreads, [&](size_t m)
+			{
+				size_t lo = 2 * width * m, mid = std::min(lo + width, nRuns), hi = std::min(lo + 2 * width, nRuns);
+				if (mid < hi)
+					std::inplace_merge(data.begin() + bounds[lo], data.begin() + bounds[mid], data.begin() + bounds[hi]);
+			});
+		}
+	}
+
+	inline unsigned expandBits(unsigned v)
+	{
+		v = (v * 0x00010001u) & 0xFF0000FFu;
+		v = (v * 0x00000101u) & 0x0F00F00Fu;
+		v = (v * 0x00000011u) & 0xC30C30C3u;
+		v = (v * 0x00000005u) & 0x49249249u;
+		return v;
+	}
+
+	//Meshlets of one chunk, vertex and triangle offsets local to the chunk.
+	struct Chunk
+	{
+		std::vector<GLMeshletData> meshlets;
+		std::vector<GLuint>        vertices;
+		std::vector<GLuint>        triangles;
+	};
+
+	void computeBounds(const std::vector<vec3f>& positions, const GLuint* vertices,
+					   const GLuint* triangles, GLMeshletData& m)
+	{
+		BBox box;
+		for (GLuint i = 0; i < m.vertexCount; i++)
+			box << positions[vertices[i]];
+		vec3f center = box.Center();
+		float radius = 0.0f;
+		for (GLuint i = 0; i < m.vertexCount; i++)
+			radius = std::max(radius, (positions[vertices[i]] - center).length());
+
+		std::vector<vec3f> normals;
+		std::vector<vec3f> anchors;
+		vec3f axis(0.0f);
+		for (GLuint t = 0; t < m.triangleCount; t++)
+		{
+			GLuint packed = triangles[t];
+			vec3f p0 = positions[vertices[packed & 0xFF]];
+			vec3f p1 = positions[vertices[(packed >> 8) & 0xFF]];
+			vec3f p2 = positions[vertices[(packed >> 16) & 0xFF]];
+			vec3f n = (p1 - p0).cross(p2 - p0);
+			float len = n.length();
+			if (len <= 0.0f) continue;
+			n = n / len;
+			normals.push_back(n);
+			anchors.push_back(p0);
+			axis += n;
+		}
+		float axisLen = axis.length();
+		float minDot = 1.0f;
+		if (axisLen > 0.0f)
+		{
+			axis = axis / axisLen;
+			for (size_t t = 0; t < normals.size(); t++)
+				minDot = std::min(minDot, normals[t].dot(axis));
+		}
+
+		for (int k = 0; k < 3; k++)
+		{
+			m.center[k] = center[k];
+			m.bmin[k] = box.pMin[k];
+			m.bmax[k] = box.pMax[k];
+			m.coneAxis[k] = axis[k];
+			m.coneApex[k] = center[k];
+		}
+		m.radius = radius;
+		m.coneCutoff = 2.0f;
+		if (axisLen <= 0.0f || minDot <= 0.1f) return;
+
+		//move the apex back along the axis until every triangle plane has
+		//it on its back side.
+		float maxT = 0.0f;
+		for (size_t t = 0; t < normals.size(); t++)
+		{
+			float dc = (center - anchors[t]).dot(normals[t]);
+			float dn = axis.dot(normals[t]);
+			maxT = std::max(maxT, dc / dn);
+		}
+		for (int k = 0; k < 3; k++)
+			m.coneApex[k] = center[k] - axis[k] * maxT;
+		m.coneCutoff = std::sqrt(1.0f - minDot*minDot);
+	}
+
+	void buildChunk(const std::vector<vec3f>& positions, const std::vector<vec3i>& triangleMesh,
+					const GLuint* order, size_t count, float coneWeight, Chunk& out)
+	{
+		//chunk local vertex ids.
+		std::vector<GLuint> globalOf(3 * count);
+		for (size_t t = 0; t < count; t++)
+			for (int k = 0; k < 3; k++)
+				globalOf[3 * t + k] = (GLuint)triangleMesh[order[t]][k];
+		std::sort(globalOf.begin(), globalOf.end());
+		globalOf.erase(std::unique(globalOf.begin(), globalOf.end()), globalOf.end());
+		size_t nVertices = globalOf.size();
+		std::vector<vec3i> tris(count);
+		std::vector<vec3f> normals(count);
+		for (size_t t = 0; t < count; t++)
+		{
+			const vec3i& tri = triangleMesh[order[t]];
+			for (int k = 0; k < 3; k++)
+				tris[t][k] = (int)(std::lower_bound(globalOf.begin(), globalOf.end(), (GLuint)tri[k]) - globalOf.begin());
+			vec3f n = (positions[tri[1]] - positions[tri[0]]).cross(positions[tri[2]] - positions[tri[0]]);
+			float len = n.length();
+			normals[t] = len > 0.0f ? n / len : vec3f(0.0f);
+		}
+		std::vector<unsigned> offset(nVertices + 1, 0), adjacency(3 * count);
+		for (size_t t = 0; t < count; t++)
+			for (int k = 0; k < 3; k++)
+				offset[tris[t][k] + 1]++;
+		for (size_t v = 0; v < nVertices; v++)
+			offset[v + 1] += offset[v];
+		{
+			std::vector<unsigned> fill(offset.begin(), offset.end() - 1);
+			for (size_t t = 0; t < count; t++)
+				for (int k = 0; k < 3; k++)
+					adjacency[fill[tris[t][k]]++] = (unsigned)t;
+		}
+
+		std::vector<unsigned char> emitted(count, 0), listed(count, 0);
+		//unemitted triangles left around each vertex.
+		std::vector<int> live(nVertices);
+		for (size_t v = 0; v < nVertices; v++)
+			live[v] = (int)(offset[v + 1] - offset[v]);
+		std::vector<int> slot(nVertices, -1);//position in the open meshlet.
+		std::vector<int> meshletVertices;
+		std::vector<GLuint> meshletTriangles;
+		std::vector<unsigned> candidates;
+		vec3f normalSum(0.0f);
+		size_t cursor = 0;
+
+		auto newVertexCount = [&](unsigned t)
+		{
+			return (int)(slot[tris[t][0]] < 0) + (int)(slot[tris[t][1]] < 0) + (int)(slot[tris[t][2]] < 0);
+		};
+		auto flush = [&]()
+		{
+			if (meshletTriangles.empty()) return;
+			GLMeshletData m;
+			m.vertexOffset = (GLuint)out.vertices.size();
+			m.triangleOffset = (GLuint)out.triangles.size();
+			m.vertexCount = (GLuint)meshletVertices.size();
+			m.triangleCount = (GLuint)meshletTriangles.size();
+			m.padding[0] = m.padding[1] = m.padding[2] = 0;
+			for (size_t i = 0; i < meshletVertices.size(); i++)
+			{
+				out.vertices.push_back(globalOf[meshletVertices[i]]);
+				slot[meshletVertices[i]] = -1;
+			}
+			out.triangles.insert(out.triangles.end(), meshletTriangles.begin(), meshletTriangles.end());
+			computeBounds(positions, &out.vertices[m.vertexOffset], &out.triangles[m.triangleOffset], m);
+			out.meshlets.push_back(m);
+			meshletVertices.clear();
+			meshletTriangles.clear();
+			normalSum = vec3f(0.0f);
+		};
+		auto clearCandidates = [&]()
+		{
+			for (size_t i = 0; i < candidates.size(); i++)
+				listed[candidates[i]] = 0;
+			candidates.clear();
+		};
+		auto add = [&](unsigned t)
+		{
+			emitted[t] = 1;
+			GLuint packed = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				int v = tris[t][k];
+				live[v]--;
+				if (slot[v] < 0)
+				{
+					slot[v] = (int)meshletVertices.size();
+					meshletVertices.push_back(v);
+				}
+				packed |= (GLuint)slot[v] << (8 * k);
+				for (unsigned j = offset[v]; j < offset[v + 1]; j++)
+				{
+					unsigned n = adjacency[j];
+					if (!emitted[n] && !listed[n])
+					{
+						listed[n] = 1;
+						candidates.push_back(n);
+					}
+				}
+			}
+			meshletTriangles.push_back(packed);
+			normalSum += normals[t];
+		};
+
+		long seed = -1;
+		for (size_t done = 0; done < count; done++)
+		{
+			//best connected candidate: fewest new vertices, then the
+			//smallest deviation from the meshlet's mean normal, then the
+			//fewest triangles left around its vertices, so corners are
+			//not left behind as tiny meshlets.
+			long best = seed;
+			float bestScore = 1e30f;
+			float len = normalSum.length();
+			vec3f axis = len > 0.0f ? normalSum / len : vec3f(0.0f);
+			size_t kept = 0;
+			for (size_t i = 0; i < candidates.size() && seed < 0; i++)
+			{
+				unsigned t = candidates[i];
+				if (emitted[t])
+				{
+					listed[t] = 0;
+					continue;
+				}
+				candidates[kept++] = t;
+				int nv = newVertexCount(t);
+				if (meshletVertices.size() + nv > GLMeshletBuilder::MAX_VERTICES) continue;
+				int remaining = live[tris[t][0]] + live[tris[t][1]] + live[tris[t][2]];
+				float score = (float)nv + coneWeight*(1.0f - normals[t].dot(axis)) + 0.01f*remaining;
+				if (score < bestScore)
+				{
+					bestScore = score;
+					best = t;
+				}
+			}
+			if (seed < 0) candidates.resize(kept);
+			seed = -1;
+			if (best < 0)
+			{//next triangle along the Morton curve.
+				while (emitted[cursor]) cursor++;
+				best = (long)cursor;
+				if (meshletVertices.size() + newVertexCount((unsigned)best) > GLMeshletBuilder::MAX_VERTICES)
+				{
+					flush();
+					clearCandidates();
+				}
+			}
+			add((unsigned)best);
+			if (meshletTriangles.size() == GLMeshletBuilder::MAX_TRIANGLES ||
+				meshletVertices.size() == GLMeshletBuilder::MAX_VERTICES)
+			{
+				flush();
+				//the next meshlet starts at the frontier of this one, at the
+				//triangle with the fewest live neighbors.
+				int fewest = 1 << 30;
+				for (size_t i = 0; i < candidates.size(); i++)
+				{
+					unsigned t = candidates[i];
+					if (emitted[t]) continue;
+					int remaining = live[tris[t][0]] + live[tris[t][1]] + live[tris[t][2]];
+					if (remaining < fewest)
+					{
+						fewest = remaining;
+						seed = t;
+					}
+				}
+				clearCandidates();
+			}
+		}
+		flush();
+	}
+}
+
+GLMeshletBuilder::GLMeshletBuilder()
+{
+}
+
+void GLMeshletBuilder::build(const std::vector<vec3f>& vertexArrayUnique,
+							 const std::vector<vec3i>& triangleMesh,
+							 float coneWeight/*=0.25f*/, int nThreads/*=0*/)
+{
+	m_meshlets.clear();
+	m_vertices.clear();
+	m_triangles.clear();
+	nThreads = resolveThreadCount(nThreads);
+
+	std::vector<GLuint> valid;
+	valid.reserve(triangleMesh.size());
+	for (size_t t = 0; t < triangleMesh.size(); t++)
+	{
+		const vec3i& tri = triangleMesh[t];
+		if (tri.x() != tri.y() && tri.y() != tri.z() && tri.z() != tri.x())
+			valid.push_back((GLuint)t);
+	}
+	if (valid.empty()) return;
+
+	BBox box;
+	for (size_t v = 0; v < vertexArrayUnique.size(); v++)
+		box << vertexArrayUnique[v];
+	vec3f extent = box.getDimension();
+	for (int k = 0; k < 3; k++)
+		extent[k] = std::max(extent[k], 1e-30f);
+
+	//(Morton code of the centroid, triangle) pairs.
+	std::vector<unsigned long long> keys(valid.size());
+	parallelForEach((valid.size() + 65535) / 65536, nThreads, [&](size_t block)
+	{
+		size_t end = std::min(valid.size(), (block + 1) * 65536);
+		for (size_t i = block * 65536; i < end; i++)
+		{
+			const vec3i& tri = triangleMesh[valid[i]];
+			vec3f c = (vertexArrayUnique[tri[0]] + vertexArrayUnique[tri[1]] + vertexArrayUnique[tri[2]]) / 3.0f;
+			vec3f r = (c - box.pMin) / extent;
+			unsigned code = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned q = (unsigned)std::min(std::max(r[k] * 1024.0f, 0.0f), 1023.0f);
+				code |= expandBits(q) << k;
+			}
+			keys[i] = ((unsigned long long)code << 32) | valid[i];
+		}
+	});
+	parallelSort(keys, nThreads);
+	for (size_t i = 0; i < keys.size(); i++)
+		valid[i] = (GLuint)(keys[i] & 0xFFFFFFFFu);
+	std::vector<unsigned long long>().swap(keys);
+
+	size_t nChunks = (valid.size() + g_chunkTriangles - 1) / g_chunkTriangles;
+	std::vector<Chunk> chunks(nChunks);
+	parallelForEach(nChunks, nThreads, [&](size_t c)
+	{
+		size_t first = c * g_chunkTriangles;
+		size_t count = std::min(g_chunkTriangles, valid.size() - first);
+		buildChunk(vertexArrayUnique, triangleMesh, &valid[first], count, coneWeight, chunks[c]);
+	});
+
+	size_t nMeshlets = 0, nVertices = 0, nTriangles = 0;
+	for (size_t c = 0; c < nChunks; c++)
+	{
+		nMeshlets += chunks[c].meshlets.size();
+		nVertices += chunks[c].vertices.size();
+		nTriangles += chunks[c].triangles.size();
+	}
+	m_meshlets.reserve(nMeshlets);
+	m_vertices.reserve(nVertices);
+	m_triangles.reserve(nTriangles);
+	for (size_t c = 0; c < nChunks; c++)
+	{
+		Chunk& chunk = chunks[c];
+		for (size_t i = 0; i < chunk.meshlets.size(); i++)
+		{
+			GLMeshletData m = chunk.meshlets[i];
+			m.vertexOffset += (GLuint)m_vertices.size();
+			m.triangleOffset += (GLuint)m_triangles.size();
+			m_meshlets.push_back(m);
+		}
+		m_vertices.insert(m_vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+		m_triangles.insert(m_triangles.end(), chunk.triangles.begin(), chunk.triangles.end());
+		std::vector<GLMeshletData>().swap(chunk.meshlets);
+		std::vector<GLuint>().swap(chunk.vertices);
+		std::vector<GLuint>().swap(chunk.triangles);
+	}
+}
+
+bool GLMeshletBuilder::isBackfacing(const GLMeshletData& meshlet, const vec3f& eye)
+{
+	vec3f apex(meshlet.coneApex[0], meshlet.coneApex[1], meshlet.coneApex[2]);
+	vec3f axis(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+	vec3f toApex = apex - eye;
+	float len = toApex.length();
+	if (len <= 0.0f) return false;
+	return toApex.dot(axis) >= meshlet.coneCutoff * len;
+}
+
+}
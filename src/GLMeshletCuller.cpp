@@ -0,0 +1,291 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <GL/glew.h>
+#include "GLError.h"
+#include "GLDrawCuller.h"
+#include "GLMeshletCuller.h"
+#include "GLHiZShader.h"
+
+namespace davinci{
+
+//GLMeshletData as six vec4s, GLuint members are read back with floatBitsToUint().
+#define MESHLET_STRUCT_SRC \
+"struct Meshlet { vec4 sphere; vec4 bmin; vec4 bmax; vec4 apex; vec4 axis; uvec4 counts; };\n" \
+"layout(std430) readonly buffer Meshlets { Meshlet meshlets[]; };\n"
+
+static const char* g_cullShaderSrc =
+"#version 430\n"
+"layout(local_size_x = 64) in;\n"
+MESHLET_STRUCT_SRC
+"layout(std430) writeonly buffer Visible { uvec2 visible[]; };\n"
+"layout(std430) buffer Commands\n"
+"{\n"
+"	uint indexCount; uint instanceCount; uint firstIndex; int baseVertex; uint baseInstance;\n"
+"	uint groupsX; uint groupsY; uint groupsZ;\n"
+"};\n"
+"uniform mat4  viewProj;\n"
+"uniform vec3  eye;\n"
+"uniform uint  meshletFirst;\n"
+"uniform uint  meshletCount;\n"
+"uniform int   cullMode;\n"
+HIZ_TEST_SHADER_SRC
+"bool sphereInFrustum(vec3 c, float r)\n"
+"{\n"
+"	vec4 row3 = vec4(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);\n"
+"	for (int i = 0; i < 3; i++)\n"
+"	{\n"
+"		vec4 row = vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);\n"
+"		vec4 lo = row3 + row, hi = row3 - row;\n"
+"		if (dot(lo.xyz, c) + lo.w < -r*length(lo.xyz)) return false;\n"
+"		if (dot(hi.xyz, c) + hi.w < -r*length(hi.xyz)) return false;\n"
+"	}\n"
+"	return true;\n"
+"}\n"
+"void main()\n"
+"{\n"
+"	if (gl_GlobalInvocationID.x >= meshletCount) return;\n"
+"	uint id = meshletFirst + gl_GlobalInvocationID.x;\n"
+"	Meshlet m = meshlets[id];\n"
+"	if ((cullMode & 1) != 0 && !sphereInFrustum(m.sphere.xyz, m.sphere.w)) return;\n"
+"	if ((cullMode & 2) != 0)\n"
+"	{\n"
+"		vec3 toApex = m.apex.xyz - eye;\n"
+"		if (dot(toApex, m.axis.xyz) >= m.axis.w*length(toApex)) return;\n"
+"	}\n"
+"	if ((cullMode & 4) != 0 && hizLevels > 0 && !notOccluded(m.bmin.xyz, m.bmax.xyz)) return;\n"
+"	uint slot = atomicAdd(groupsX, 1u);\n"
+"	visible[slot] = uvec2(id, atomicAdd(indexCount, 3u*m.counts.x));\n"
+"}\n";
+
+static const char* g_emitShaderSrc =
+"#version 430\n"
+"layout(local_size_x = 128) in;\n"
+MESHLET_STRUCT_SRC
+"layout(std430) readonly  buffer Visible { uvec2 visible[]; };\n"
+"layout(std430) readonly  buffer MeshletVertices { uint meshletVertices[]; };\n"
+"layout(std430) readonly  buffer MeshletTriangles { uint meshletTriangles[]; };\n"
+"layout(std430) writeonly buffer Indices { uint indices[]; };\n"
+"void main()\n"
+"{\n"
+"	uvec2 v = visible[gl_WorkGroupID.x];\n"
+"	Meshlet m = meshlets[v.x];\n"
+"	uint t = gl_LocalInvocationID.x;\n"
+"	if (t >= m.counts.x) return;\n"
+"	uint vertexOffset = floatBitsToUint(m.bmin.w);\n"
+"	uint packed = meshletTriangles[floatBitsToUint(m.bmax.w) + t];\n"
+"	uint dst = v.y + 3u*t;\n"
+"	indices[dst]      = meshletVertices[vertexOffset + (packed & 0xFFu)];\n"
+"	indices[dst + 1u] = meshletVertices[vertexOffset + ((packed >> 8) & 0xFFu)];\n"
+"	indices[dst + 2u] = meshletVertices[vertexOffset + ((packed >> 16) & 0xFFu)];\n"
+"}\n";
+
+#undef MESHLET_STRUCT_SRC
+
+//glDispatchComputeIndirect() needs at most this many groups per batch.
+static const size_t g_maxBatchMeshlets = 65535;
+
+GLMeshletCuller::GLMeshletCuller()
+	:m_indexBudget(size_t(12) << 20), m_maxBatchIndices(0), m_cullMode(CULL_ALL)
+{
+	m_meshlets = GLShaderStorageBufferObjectRef(
+		new GLShaderStorageBufferObject("GLMeshletCuller meshlets", GL_STATIC_DRAW));
+	m_meshletVertices = GLShaderStorageBufferObjectRef(
+		new GLShaderStorageBufferObject("GLMeshletCuller meshlet vertices", GL_STATIC_DRAW));
+	m_meshletTriangles = GLShaderStorageBufferObjectRef(
+		new GLShaderStorageBufferObject("GLMeshletCuller meshlet triangles", GL_STATIC_DRAW));
+	m_visible = GLShaderStorageBufferObjectRef(
+		new GLShaderStorageBufferObject("GLMeshletCuller visible meshlets", GL_DYNAMIC_COPY));
+	m_indices = GLShaderStorageBufferObjectRef(
+		new GLShaderStorageBufferObject("GLMeshletCuller indices", GL_DYNAMIC_COPY));
+	m_commands = GLShaderStorageBufferObjectRef(
+		new GLShaderStorageBufferObject("GLMeshletCuller commands", GL_DYNAMIC_COPY));
+	m_noHiZ = GLShaderStorageBufferObjectRef(
+		new GLShaderStorageBufferObject("GLMeshletCuller empty Hi-Z", GL_STATIC_DRAW));
+	GLuint commands[8] = { 0, 1, 0, 0, 0, 0, 1, 1 };
+	m_commands->upload(sizeof(commands), commands);
+	float farDepth = 1.0f;
+	m_noHiZ->upload(sizeof(farDepth), &farDepth);
+}
+
+GLMeshletCuller::~GLMeshletCuller()
+{
+}
+
+void GLMeshletCuller::createShaders()
+{
+	std::string src(g_cullShaderSrc);
+	m_cullShader = GLComputeShaderRef(new GLComputeShader("GLMeshletCuller cull"));
+	m_cullShader->setComputeShaderStr(src);
+	m_cullShader->CreateShaders();
+
+	src = g_emitShaderSrc;
+	m_emitShader = GLComputeShaderRef(new GLComputeShader("GLMeshletCuller emit"));
+	m_emitShader->setComputeShaderStr(src);
+	m_emitShader->CreateShaders();
+}
+
+void GLMeshletCuller::setMeshlets(const GLMeshletBuilder& builder)
+{
+	const std::vector<GLMeshletData>& meshlets = builder.getMeshlets();
+	m_triangleCounts.resize(meshlets.size());
+	for (size_t i = 0; i < meshlets.size(); i++)
+		m_triangleCounts[i] = meshlets[i].triangleCount;
+	if (!meshlets.empty())
+	{
+		m_meshlets->upload(meshlets.size()*sizeof(GLMeshletData), meshlets.data());
+		m_meshletVertices->upload(builder.getMeshletVertices().size()*sizeof(GLuint),
+								  builder.getMeshletVertices().data());
+		m_meshletTriangles->upload(builder.getMeshletTriangles().size()*sizeof(GLuint),
+								   builder.getMeshletTriangles().data());
+	}
+	setIndexBudget(m_indexBudget);
+	GLError::glCheckError(__func__);
+}
+
+void GLMeshletCuller::setIndexBudget(size_t maxIndices)
+{
+	m_indexBudget = std::max(maxIndices, size_t(3 * GLMeshletBuilder::MAX_TRIANGLES));
+	//greedy batches: as many meshlets as fit both the index budget and the
+	//dispatch limit, assuming all of them are visible.
+	m_batchFirst.assign(1, 0);
+	m_maxBatchIndices = 0;
+	size_t indices = 0, first = 0;
+	for (size_t i = 0; i < m_triangleCounts.size(); i++)
+	{
+		size_t n = 3 * size_t(m_triangleCounts[i]);
+		if (indices + n > m_indexBudget || i - first == g_maxBatchMeshlets)
+		{
+			m_batchFirst.push_back(i);
+			m_maxBatchIndices = std::max(m_maxBatchIndices, indices);
+			indices = 0;
+			first = i;
+		}
+		indices += n;
+	}
+	if (!m_triangleCounts.empty())
+	{
+		m_batchFirst.push_back(m_triangleCounts.size());
+		m_maxBatchIndices = std::max(m_maxBatchIndices, indices);
+	}
+}
+
+void GLMeshletCuller::reserveIndices(size_t count)
+{
+	if (m_indices->getSizeInBytes() < count*sizeof(GLuint))
+	{
+		m_indices->upload(count*sizeof(GLuint), NULL);
+	}
+	size_t visibleBytes = std::min(m_triangleCounts.size(), g_maxBatchMeshlets) * 2 * sizeof(GLuint);
+	if (m_visible->getSizeInBytes() < visibleBytes)
+	{
+		m_visible->upload(visibleBytes, NULL);
+	}
+}
+
+void GLMeshletCuller::cull(size_t batch, const mat4& viewProj, const vec3f& eye,
+						   const GLDrawCuller* hiz/*=NULL*/)
+{
+	if (batch >= getBatchCount()) return;
+	if (!m_cullShader)
+	{
+		createShaders();
+	}
+	reserveIndices(m_maxBatchIndices);
+	GLuint commands[8] = { 0, 1, 0, 0, 0, 0, 1, 1 };
+	m_commands->upload(sizeof(commands), commands);
+
+	size_t first = m_batchFirst[batch], count = m_batchFirst[batch + 1] - first;
+	int hizLevels = (hiz && (m_cullMode & CULL_OCCLUSION)) ? hiz->getHiZLevels() : 0;
+	m_cullShader->SetShaderStorageBlockUniform("Meshlets", m_meshlets);
+	m_cullShader->SetShaderStorageBlockUniform("Visible", m_visible);
+	m_cullShader->SetShaderStorageBlockUniform("Commands", m_commands);
+	m_cullShader->SetShaderStorageBlockUniform("HiZ", hizLevels > 0 ? hiz->getHiZBuffer() : m_noHiZ);
+	m_cullShader->SetMatrixUniform("viewProj", viewProj);
+	m_cullShader->SetMatrixUniform("hizViewProj", hizLevels > 0 ? hiz->getHiZViewProj() : viewProj);
+	m_cullShader->SetFloat3Uniform("eye", eye);
+	m_cullShader->SetUintUniform("meshletFirst", (GLuint)first);
+	m_cullShader->SetUintUniform("meshletCount", (GLuint)count);
+	m_cullShader->SetIntUniform("cullMode", m_cullMode);
+	m_cullShader->SetInt2Uniform("hizSize", hizLevels > 0 ?
+		vec2i(std::max(hiz->getHiZWidth(), 1), std::max(hiz->getHiZHeight(), 1)) : vec2i(1, 1));
+	m_cullShader->SetIntUniform("hizLevels", hizLevels);
+	m_cullShader->UseShaders((GLuint)((count + 63) / 64), 1, 1);
+	m_cullShader->ReleaseShader();
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+	//one group per visible meshlet, the group count was written by the cull pass.
+	m_emitShader->SetShaderStorageBlockUniform("Meshlets", m_meshlets);
+	m_emitShader->SetShaderStorageBlockUniform("Visible", m_visible);
+	m_emitShader->SetShaderStorageBlockUniform("MeshletVertices", m_meshletVertices);
+	m_emitShader->SetShaderStorageBlockUniform("MeshletTriangles", m_meshletTriangles);
+	m_emitShader->SetShaderStorageBlockUniform("Indices", m_indices);
+	m_emitShader->UseShadersIndirect(*m_commands, 5 * sizeof(GLuint));
+	m_emitShader->ReleaseShader();
+	glMemoryBarrier(GL_ELEMENT_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	GLError::glCheckError(__func__);
+}
+
+void GLMeshletCuller::drawCulled(const GLVertexArrayObjectRef& vao)
+{
+	if (!vao->isEnabled())
+		vao->enable();
+	glBindVertexArray(*vao->getArrayId());
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indices->getId());
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commands->getId());
+	glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+	if (vao->isEnabled() && !vao->isImmutable())
+		vao->disable();
+	GLError::glCheckError(__func__);
+}
+
+void GLMeshletCuller::draw(const GLVertexArrayObjectRef& vao, const mat4& viewProj, const vec3f& eye,
+						   const GLDrawCuller* hiz/*=NULL*/)
+{
+	for (size_t batch = 0; batch < getBatchCount(); batch++)
+	{
+		cull(batch, viewProj, eye, hiz);
+		drawCulled(vao);
+	}
+}
+
+void GLMeshletCuller::draw(const GLVertexArrayObjectRef& vao, const GLCamera& camera,
+						   const GLDrawCuller* hiz/*=NULL*/)
+{
+	draw(vao, camera.getProjectionMatrix() * camera.getViewingMatrix(),
+		 camera.getCurrentPosition(), hiz);
+}
+
+void GLMeshletCuller::readVisibleCounts(GLuint& meshlets, GLuint& triangles)
+{
+	GLuint commands[8] = { 0 };
+	m_commands->bindBufferObject();
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(commands), commands);
+	m_commands->unbindBufferObject();
+	meshlets = commands[5];
+	triangles = commands[0] / 3;
+}
+
+}
@@ -0,0 +1,141 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+//AUTHOR: Jinrong Xie (stonexjr at gmail.com)
+//CREATED: 2026-10-19
+//UPDATED: 2026-10-19
+
+
+#ifndef _GL_PARALLEL_H_
+#define _GL_PARALLEL_H_
+
+//Thread helpers shared by the CPU geometry builders. Internal, not installed.
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+namespace davinci{
+
+	//nThreads <= 0 means one thread per hardware thread.
+	inline int resolveThreadCount(int nThreads)
+	{
+		if (nThreads <= 0)
+			nThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+		return nThreads;
+	}
+
+	//Runs fn(begin,end) over [0,n) split into nThreads contiguous pieces.
+	template<class Fn>
+	void parallelFor(size_t n, int nThreads, Fn fn)
+	{
+		if (nThreads <= 1 || n < 2)
+		{
+			fn((size_t)0, n);
+			return;
+		}
+		size_t chunk = (n + nThreads - 1) / nThreads;
+		std::vector<std::thread> threads;
+		for (int t = 1; t < nThreads; t++)
+		{
+			size_t b = std::min(n, t * chunk), e = std::min(n, b + chunk);
+			if (b < e) threads.push_back(std::thread(fn, b, e));
+		}
+		fn((size_t)0, std::min(n, chunk));
+		for (size_t t = 0; t < threads.size(); t++)
+			threads[t].join();
+	}
+
+	//Runs fn(i) for i in [0,n) on nThreads threads pulling indices.
+	template<class Fn>
+	void parallelForEach(size_t n, int nThreads, Fn fn)
+	{
+		std::atomic<size_t> next(0);
+		auto worker = [&]()
+		{
+			for (size_t i = next++; i < n; i = next++)
+				fn(i);
+		};
+		std::vector<std::thread> threads;
+		for (int t = 1; t < (int)std::min<size_t>(nThreads, n); t++)
+			threads.push_back(std::thread(worker));
+		worker();
+		for (size_t t = 0; t < threads.size(); t++)
+			threads[t].join();
+	}
+
+	//Splits [0,n) into nBlocks contiguous ranges, fn(block, begin, end).
+	template<class Fn>
+	void parallelBlocks(size_t n, size_t nBlocks, int nThreads, Fn fn)
+	{
+		parallelForEach(nBlocks, nThreads, [&](size_t b)
+		{
+			fn(b, n * b / nBlocks, n * (b + 1) / nBlocks);
+		});
+	}
+
+	//Stable LSD radix sort of (key, value) pairs on the low keyBits bits,
+	//8 bits per pass. Every pass counts digits per block in parallel and
+	//scatters each block to its own, precomputed, output ranges.
+	inline void radixSortPairs(std::vector<unsigned long long>& keys, std::vector<unsigned>& values, int keyBits, int nThreads)
+	{
+		size_t n = keys.size();
+		size_t nBlocks = std::max<size_t>(1, std::min<size_t>(nThreads, n / 65536));
+		std::vector<unsigned long long> keysOut(n);
+		std::vector<unsigned> valuesOut(n);
+		std::vector<size_t> counts(nBlocks * 256);
+		for (int shift = 0; shift < keyBits; shift += 8)
+		{
+			std::fill(counts.begin(), counts.end(), 0);
+			parallelBlocks(n, nBlocks, nThreads, [&](size_t b, size_t begin, size_t end)
+			{
+				size_t* c = &counts[b * 256];
+				for (size_t i = begin; i < end; i++)
+					c[(keys[i] >> shift) & 0xFF]++;
+			});
+			size_t sum = 0;
+			for (int d = 0; d < 256; d++)
+			{
+				for (size_t b = 0; b < nBlocks; b++)
+				{
+					size_t c = counts[b * 256 + d];
+					counts[b * 256 + d] = sum;
+					sum += c;
+				}
+			}
+			parallelBlocks(n, nBlocks, nThreads, [&](size_t b, size_t begin, size_t end)
+			{
+				size_t* c = &counts[b * 256];
+				for (size_t i = begin; i < end; i++)
+				{
+					size_t dst = c[(keys[i] >> shift) & 0xFF]++;
+					keysOut[dst] = keys[i];
+					valuesOut[dst] = values[i];
+				}
+			});
+			keys.swap(keysOut);
+			values.swap(valuesOut);
+		}
+	}
+}
+
+#endif
@@ -166,7 +166,7 @@ void GLPixelBufferObject::bindBufferObject(GLenum target)
 
 void* GLPixelBufferObject::getMappedAddress( GLenum target, GLenum access )
 {
-    if (target!= GL_PIXEL_PACK_BUFFER || target != GL_PIXEL_UNPACK_BUFFER)
+    if (target!= GL_PIXEL_PACK_BUFFER && target != GL_PIXEL_UNPACK_BUFFER)
     {
         GLError::ErrorMessage(string(__func__)+
             string(": target parameter expects GL_PIXEL_PACK_BUFFER or GL_PIXEL_UNPACK_BUFFER."));
@@ -182,12 +182,16 @@ GLboolean GLPixelBufferObject::unMappedAddress(GLenum target)
 
 void GLPixelBufferObject::copyTo( void* pCPUDest )
 {
-    void* pSrc = getMappedAddress(GL_PIXEL_UNPACK_BUFFER, GL_READ_ONLY);
+    //pixels were packed into the PBO, read them back through the same target.
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_id);
+    void* pSrc = getMappedAddress(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
     if (!pSrc)
     {
         GLError::ErrorMessage(string(__func__)+string("pSrc==NULL!"));
     }
     memcpy(pCPUDest, pSrc, getBufferSize());
+    unMappedAddress(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
 }
 
 
@@ -0,0 +1,312 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cmath>
+#include <algorithm>
+#include <GL/glew.h>
+#include "vec2i.h"
+#include "GLError.h"
+#include "GLProgressiveVolumeRenderer.h"
+#include "GLRenderTargetPool.h"
+
+namespace davinci{
+
+static const char* g_marchShaderSrc =
+"#version 430\n"
+"layout(local_size_x = 8, local_size_y = 8) in;\n"
+"layout(rgba32f) writeonly uniform image2D stateImg;\n"
+"uniform sampler3D volumeTex;\n"
+"uniform sampler1D transferFunc;\n"
+"uniform mat4  invViewProj;\n"
+"uniform vec3  boxMin;\n"
+"uniform vec3  boxMax;\n"
+"uniform ivec2 size;\n"
+"uniform ivec2 gridSize;\n"
+"uniform ivec2 offset;\n"
+"uniform int   spacing;\n"
+"uniform int   footprint;\n"
+"uniform float stepSize;\n"
+"uniform float opacityExponent;//stepSize over the full quality step.\n"
+"//rayBoxIntersection() of shader/common.glsl\n"
+"vec3 rayBoxIntersection(vec3 rayStart, vec3 rayDir, vec3 bottomLeft, vec3 topRight)\n"
+"{\n"
+"	vec3 txyzMin = (bottomLeft - rayStart) / rayDir;\n"
+"	vec3 txyzMax = (topRight - rayStart) / rayDir;\n"
+"	vec3 txyzEntry = min(txyzMin, txyzMax);\n"
+"	vec3 txyzExit = max(txyzMin, txyzMax);\n"
+"	float tentry = max(max(txyzEntry.x, txyzEntry.y), txyzEntry.z);\n"
+"	float texit = min(min(txyzExit.x, txyzExit.y), txyzExit.z);\n"
+"	return vec3(tentry, texit, texit < tentry ? 0.0 : 1.0);\n"
+"}\n"
+"void main()\n"
+"{\n"
+"	ivec2 g = ivec2(gl_GlobalInvocationID.xy);\n"
+"	if (any(greaterThanEqual(g, gridSize))) return;\n"
+"	ivec2 p = g * spacing + offset;\n"
+"	if (any(greaterThanEqual(p, size))) return;\n"
+"	vec2 ndc = (vec2(p) + 0.5 * float(footprint)) / vec2(size) * 2.0 - 1.0;\n"
+"	vec4 nearPos = invViewProj * vec4(ndc, -1.0, 1.0);\n"
+"	vec4 farPos  = invViewProj * vec4(ndc,  1.0, 1.0);\n"
+"	vec3 ro = nearPos.xyz / nearPos.w;\n"
+"	vec3 rd = normalize(farPos.xyz / farPos.w - ro);\n"
+"	vec3 hit = rayBoxIntersection(ro, rd, boxMin, boxMax);\n"
+"	vec4 acc = vec4(0.0);\n"
+"	if (hit.z > 0.5 && hit.y > 0.0)\n"
+"	{\n"
+"		vec3 invExtent = 1.0 / (boxMax - boxMin);\n"
+"		for (float t = max(hit.x, 0.0) + 0.5 * stepSize; t < hit.y && acc.a < 0.995; t += stepSize)\n"
+"		{\n"
+"			vec3 tc = (ro + rd * t - boxMin) * invExtent;\n"
+"			vec4 c = texture(transferFunc, texture(volumeTex, tc).r);\n"
+"			float a = 1.0 - pow(1.0 - clamp(c.a, 0.0, 1.0), opacityExponent);\n"
+"			acc.rgb += (1.0 - acc.a) * a * c.rgb;\n"
+"			acc.a += (1.0 - acc.a) * a;\n"
+"		}\n"
+"	}\n"
+"	for (int j = 0; j < footprint; j++)\n"
+"		for (int i = 0; i < footprint; i++)\n"
+"		{\n"
+"			ivec2 q = p + ivec2(i, j);\n"
+"			if (all(lessThan(q, size))) imageStore(stateImg, q, acc);\n"
+"		}\n"
+"}\n";
+
+static const char* g_resolveShaderSrc =
+"#version 430\n"
+"layout(local_size_x = 8, local_size_y = 8) in;\n"
+"layout(rgba32f) readonly  uniform image2D stateImg;\n"
+"layout(rgba8)   writeonly uniform image2D resolvedImg;\n"
+"uniform ivec2 size;\n"
+"uniform vec4  background;\n"
+"void main()\n"
+"{\n"
+"	ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+"	if (any(greaterThanEqual(p, size))) return;\n"
+"	vec4 c = imageLoad(stateImg, p);\n"
+"	imageStore(resolvedImg, p, clamp(c + (1.0 - c.a) * background, 0.0, 1.0));\n"
+"}\n";
+
+GLProgressiveVolumeRenderer::GLProgressiveVolumeRenderer(int nLevels/*=3*/)
+	:m_nLevels(std::max(nLevels, 1)), m_pass(0), m_stepSize(0.0f),
+	 m_background(0.0f, 0.0f, 0.0f, 1.0f)
+{
+	m_viewport[0] = m_viewport[1] = m_viewport[2] = m_viewport[3] = 0;
+	buildPasses();
+}
+
+GLProgressiveVolumeRenderer::~GLProgressiveVolumeRenderer()
+{
+}
+
+void GLProgressiveVolumeRenderer::setLevels(int nLevels)
+{
+	m_nLevels = std::max(nLevels, 1);
+	buildPasses();
+	reset();
+}
+
+void GLProgressiveVolumeRenderer::buildPasses()
+{
+	m_passes.clear();
+	for (int l = 0; l < m_nLevels - 1; l++)
+	{
+		int b = 1 << (m_nLevels - 1 - l);
+		Pass pass = { b, b, 0, 0, b };
+		m_passes.push_back(pass);
+	}
+	if (m_passes.empty())
+	{//the first pass has to cover every pixel.
+		Pass pass = { 1, 1, 0, 0, 1 };
+		m_passes.push_back(pass);
+		return;
+	}
+	//diagonal first, so the second pass already halves the error both ways.
+	static const int order[4][2] = { { 0, 0 }, { 1, 1 }, { 1, 0 }, { 0, 1 } };
+	for (int k = 0; k < 4; k++)
+	{
+		Pass pass = { 2, 1, order[k][0], order[k][1], 1 };
+		m_passes.push_back(pass);
+	}
+}
+
+void GLProgressiveVolumeRenderer::setVolume(const GLTexture3DRef& volume, const vec3f& bottomLeft, const vec3f& topRight)
+{
+	m_volume = volume;
+	m_bottomLeft = bottomLeft;
+	m_topRight = topRight;
+	if (volume)
+	{
+		vec3f extent = topRight - bottomLeft;
+		m_stepSize = std::min(std::min(fabsf(extent.x()) / std::max(1u, volume->getWidth()),
+									   fabsf(extent.y()) / std::max(1u, volume->getHeight())),
+							  fabsf(extent.z()) / std::max(1u, volume->getDepth()));
+	}
+	reset();
+}
+
+void GLProgressiveVolumeRenderer::setTransferFunction(const GLTexture1DRef& transferFunc)
+{
+	m_transferFunc = transferFunc;
+	reset();
+}
+
+void GLProgressiveVolumeRenderer::setStepSize(float step)
+{
+	m_stepSize = step;
+	reset();
+}
+
+void GLProgressiveVolumeRenderer::createShaders()
+{
+	std::string src = g_marchShaderSrc;
+	m_marchShader = GLComputeShaderRef(new GLComputeShader("GLProgressiveVolumeRenderer march"));
+	m_marchShader->setComputeShaderStr(src);
+	m_marchShader->CreateShaders();
+
+	src = g_resolveShaderSrc;
+	m_resolveShader = GLComputeShaderRef(new GLComputeShader("GLProgressiveVolumeRenderer resolve"));
+	m_resolveShader->setComputeShaderStr(src);
+	m_resolveShader->CreateShaders();
+}
+
+bool GLProgressiveVolumeRenderer::prepare(const mat4& viewMtx, const mat4& projMtx)
+{
+	if (!m_volume || !m_transferFunc || m_stepSize <= 0.0f)
+	{
+		GLError::ErrorMessage(string(__func__) + ": set the volume, transfer function and a positive step first.");
+		return false;
+	}
+	if (!m_marchShader)
+	{
+		createShaders();
+	}
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if (viewport[2] != m_viewport[2] || viewport[3] != m_viewport[3] || !m_stateTex)
+	{
+		GLRenderTargetPoolRef pool = GLRenderTargetPool::getDefault();
+		pool->release(m_stateTex);
+		pool->release(m_resolvedTex);
+		m_stateTex = pool->acquireTexture(viewport[2], viewport[3], GL_RGBA32F);
+		m_stateTex->setName("GLProgressiveVolumeRenderer::m_stateTex");
+		m_resolvedTex = pool->acquireTexture(viewport[2], viewport[3], GL_RGBA8);
+		m_resolvedTex->setName("GLProgressiveVolumeRenderer::m_resolvedTex");
+		m_resolveFbo = GLFrameBufferObjectRef(new GLFrameBufferObject(GL_READ_FRAMEBUFFER));
+		m_resolveFbo->bind();
+		m_resolveFbo->attachColorBuffer(0, m_resolvedTex);
+		m_resolveFbo->unbind();
+		reset();
+	}
+	std::copy(viewport, viewport + 4, m_viewport);
+	if (viewMtx != m_viewMtx || projMtx != m_projMtx)
+	{
+		m_viewMtx = viewMtx;
+		m_projMtx = projMtx;
+		reset();
+	}
+	return true;
+}
+
+void GLProgressiveVolumeRenderer::runPass(const Pass& pass)
+{
+	int w = m_viewport[2], h = m_viewport[3];
+	int gridW = (w - pass.offsetX + pass.spacing - 1) / pass.spacing;
+	int gridH = (h - pass.offsetY + pass.spacing - 1) / pass.spacing;
+	mat4 invViewProj = m_projMtx * m_viewMtx;
+	invViewProj.invertGeneral();
+	m_stateTex->setImageAccess(GL_WRITE_ONLY);
+	m_marchShader->SetImageUniform("stateImg", m_stateTex.get());
+	m_marchShader->SetSamplerUniform("volumeTex", m_volume.get());
+	m_marchShader->SetSamplerUniform("transferFunc", m_transferFunc.get());
+	m_marchShader->SetMatrixUniform("invViewProj", invViewProj);
+	m_marchShader->SetFloat3Uniform("boxMin", m_bottomLeft);
+	m_marchShader->SetFloat3Uniform("boxMax", m_topRight);
+	m_marchShader->SetInt2Uniform("size", vec2i(w, h));
+	m_marchShader->SetInt2Uniform("gridSize", vec2i(gridW, gridH));
+	m_marchShader->SetInt2Uniform("offset", vec2i(pass.offsetX, pass.offsetY));
+	m_marchShader->SetIntUniform("spacing", pass.spacing);
+	m_marchShader->SetIntUniform("footprint", pass.footprint);
+	m_marchShader->SetFloatUniform("stepSize", m_stepSize * pass.stepScale);
+	m_marchShader->SetFloatUniform("opacityExponent", float(pass.stepScale));
+	m_marchShader->UseShaders((gridW + 7) / 8, (gridH + 7) / 8, 1);
+	m_marchShader->ReleaseShader();
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+void GLProgressiveVolumeRenderer::resolve()
+{
+	int w = m_viewport[2], h = m_viewport[3];
+	m_stateTex->setImageAccess(GL_READ_ONLY);
+	m_resolvedTex->setImageAccess(GL_WRITE_ONLY);
+	m_resolveShader->SetImageUniform("stateImg", m_stateTex.get());
+	m_resolveShader->SetImageUniform("resolvedImg", m_resolvedTex.get());
+	m_resolveShader->SetInt2Uniform("size", vec2i(w, h));
+	m_resolveShader->SetFloat4Uniform("background", m_background);
+	m_resolveShader->UseShaders((w + 7) / 8, (h + 7) / 8, 1);
+	m_resolveShader->ReleaseShader();
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+}
+
+void GLProgressiveVolumeRenderer::blit()
+{
+	int w = m_viewport[2], h = m_viewport[3];
+	GLint prevRead = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prevRead);
+	m_resolveFbo->bind();
+	glBlitFramebuffer(0, 0, w, h, m_viewport[0], m_viewport[1], m_viewport[0] + w, m_viewport[1] + h,
+					  GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, prevRead);
+	GLError::glCheckError(__func__);
+}
+
+bool GLProgressiveVolumeRenderer::render(const mat4& viewMtx, const mat4& projMtx)
+{
+	if (!prepare(viewMtx, projMtx))
+		return false;
+	//once converged the resolved image is just shown again.
+	if (!isConverged())
+	{
+		runPass(m_passes[m_pass]);
+		m_pass++;
+		resolve();
+	}
+	blit();
+	return isConverged();
+}
+
+bool GLProgressiveVolumeRenderer::render(const GLCamera& camera)
+{
+	return render(camera.getViewingMatrix(), camera.getProjectionMatrix());
+}
+
+void GLProgressiveVolumeRenderer::renderFullQuality(const mat4& viewMtx, const mat4& projMtx)
+{
+	if (!prepare(viewMtx, projMtx))
+		return;
+	Pass full = { 1, 1, 0, 0, 1 };
+	runPass(full);
+	m_pass = (int)m_passes.size();
+	resolve();
+	blit();
+}
+
+}
@@ -26,19 +26,32 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 using namespace davinci;
 
 GLRenderbufferObject::GLRenderbufferObject(void)
-    :m_width(10), m_height(10)
+    :m_width(10), m_height(10), m_internalformat(GL_DEPTH_COMPONENT), m_samples(0)
 {
     glGenRenderbuffersEXT(1, &m_rboId);
-    bind();
-    glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, GL_DEPTH_COMPONENT, m_width, m_height);
-    unbind();
+    allocateStorage();
 }
 GLRenderbufferObject::GLRenderbufferObject(GLsizei width, GLsizei height)
-    :m_width(width), m_height(height)
+    :m_width(width), m_height(height), m_internalformat(GL_DEPTH_COMPONENT), m_samples(0)
+{
+    glGenRenderbuffersEXT(1, &m_rboId);
+    allocateStorage();
+}
+GLRenderbufferObject::GLRenderbufferObject(GLsizei width, GLsizei height,
+                                           GLenum internalformat, GLsizei samples/*=0*/)
+    :m_width(width), m_height(height), m_internalformat(internalformat), m_samples(samples)
 {
     glGenRenderbuffersEXT(1, &m_rboId);
+    allocateStorage();
+}
+
+void GLRenderbufferObject::allocateStorage()
+{
     bind();
-    glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, GL_DEPTH_COMPONENT, m_width, m_height);
+    if (m_samples > 0)
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, m_samples, m_internalformat, m_width, m_height);
+    else
+        glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, m_internalformat, m_width, m_height);
     unbind();
 }
 
@@ -54,9 +67,7 @@ void GLRenderbufferObject::resize( GLsizei width, GLsizei height )
     m_width = width;
     m_height= height;
     glGenRenderbuffersEXT(1, &m_rboId);
-    bind();
-    glRenderbufferStorageEXT(GL_RENDERBUFFER_EXT, GL_DEPTH_COMPONENT, m_width, m_height);
-    unbind();
+    allocateStorage();
 }
 
 void GLRenderbufferObject::bind()
@@ -0,0 +1,339 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <GL/glew.h>
+#include "GLError.h"
+#include "GLRenderTargetPool.h"
+
+namespace davinci{
+
+namespace{
+	GLRenderTargetPoolRef g_defaultPool;
+
+	template<class Ref>
+	bool isFree(const Ref& resource)
+	{
+		//the pool's own reference is the only one left.
+		return resource.use_count() == 1;
+	}
+
+	//Removes free entries accepted by evict(entry).
+	template<class E, class Pred>
+	void removeFree(std::vector<E>& entries, Pred evict)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (isFree(entries[i].resource) && evict(entries[i]))
+				continue;
+			if (kept != i) entries[kept] = entries[i];
+			kept++;
+		}
+		entries.resize(kept);
+	}
+
+	template<class E, class Ref>
+	void releaseEntry(std::vector<E>& entries, Ref& resource)
+	{
+		if (!resource) return;
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].resource != resource) continue;
+			resource.reset();
+			if (isFree(entries[i].resource))
+				entries.erase(entries.begin() + i);
+			return;
+		}
+		resource.reset();//not pooled, just drop it.
+	}
+}
+
+GLRenderTargetPool::GLRenderTargetPool(int maxIdleFrames/*=2*/, size_t byteBudget/*=512MB*/)
+	:m_maxIdleFrames(maxIdleFrames), m_byteBudget(byteBudget), m_frame(0), m_clock(0),
+	 m_hits(0), m_misses(0)
+{
+}
+
+GLRenderTargetPool::~GLRenderTargetPool()
+{
+}
+
+size_t GLRenderTargetPool::getBytesPerPixel(GLint internalformat)
+{
+	switch (internalformat)
+	{
+	case GL_R8: case GL_R8I: case GL_R8UI: case GL_STENCIL_INDEX8:
+		return 1;
+	case GL_RG8: case GL_R16: case GL_R16F: case GL_R16I: case GL_R16UI: case GL_DEPTH_COMPONENT16:
+		return 2;
+	case GL_RGBA16: case GL_RGBA16F: case GL_RGBA16I: case GL_RGBA16UI: case GL_RGB16F:
+	case GL_RG32F: case GL_RG32I: case GL_RG32UI: case GL_DEPTH32F_STENCIL8:
+		return 8;
+	case GL_RGB32F: case GL_RGB32I: case GL_RGB32UI:
+		return 12;
+	case GL_RGBA32F: case GL_RGBA32I: case GL_RGBA32UI:
+		return 16;
+	default:
+		//RGBA8, RGB8 (padded), RG16, R32*, RGB10_A2, R11F_G11F_B10F and 24/32 bit depth.
+		return 4;
+	}
+}
+
+void GLRenderTargetPool::getTransferFormat(GLint internalformat, GLint& format, GLint& type)
+{
+	switch (internalformat)
+	{
+	case GL_DEPTH_COMPONENT: case GL_DEPTH_COMPONENT16: case GL_DEPTH_COMPONENT24:
+	case GL_DEPTH_COMPONENT32: case GL_DEPTH_COMPONENT32F:
+		format = GL_DEPTH_COMPONENT; type = GL_FLOAT; return;
+	case GL_DEPTH24_STENCIL8:
+		format = GL_DEPTH_STENCIL; type = GL_UNSIGNED_INT_24_8; return;
+	case GL_DEPTH32F_STENCIL8:
+		format = GL_DEPTH_STENCIL; type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV; return;
+	case GL_R8I: case GL_R16I: case GL_R32I:
+		format = GL_RED_INTEGER; type = GL_INT; return;
+	case GL_R8UI: case GL_R16UI: case GL_R32UI:
+		format = GL_RED_INTEGER; type = GL_UNSIGNED_INT; return;
+	case GL_RG32I:
+		format = GL_RG_INTEGER; type = GL_INT; return;
+	case GL_RG32UI:
+		format = GL_RG_INTEGER; type = GL_UNSIGNED_INT; return;
+	case GL_RGBA16I: case GL_RGBA32I:
+		format = GL_RGBA_INTEGER; type = GL_INT; return;
+	case GL_RGBA16UI: case GL_RGBA32UI:
+		format = GL_RGBA_INTEGER; type = GL_UNSIGNED_INT; return;
+	case GL_R8: case GL_R16: case GL_R16F: case GL_R32F:
+		format = GL_RED; type = GL_FLOAT; return;
+	case GL_RG8: case GL_RG16: case GL_RG16F: case GL_RG32F:
+		format = GL_RG; type = GL_FLOAT; return;
+	case GL_RGB8: case GL_RGB16F: case GL_RGB32F: case GL_R11F_G11F_B10F:
+		format = GL_RGB; type = GL_FLOAT; return;
+	default:
+		format = GL_RGBA; type = GL_UNSIGNED_BYTE; return;
+	}
+}
+
+GLTexture2DRef GLRenderTargetPool::acquireTexture(int width, int height, GLint internalformat,
+												  GLint minFilter/*=GL_NEAREST*/, GLint magFilter/*=GL_NEAREST*/)
+{
+	//filters are few small enums, packed where renderbuffers keep samples.
+	int filters = (minFilter & 0xFFFF) | ((magFilter & 0xFFFF) << 16);
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		Entry<GLTexture2DRef>& e = m_textures[i];
+		if (e.width == width && e.height == height && e.format == internalformat &&
+			e.samples == filters && isFree(e.resource))
+		{
+			m_hits++;
+			e.lastUsed = tick();
+			e.lastFrame = m_frame;
+			return e.resource;
+		}
+	}
+	m_misses++;
+	GLint format, type;
+	getTransferFormat(internalformat, format, type);
+	Entry<GLTexture2DRef> e;
+	e.resource = GLTexture2DRef(new GLTexture2d(width, height, internalformat, format, type,
+												minFilter, magFilter));
+	e.resource->setName("GLRenderTargetPool texture");
+	e.width = width;
+	e.height = height;
+	e.format = internalformat;
+	e.samples = filters;
+	e.bytes = size_t(width) * height * getBytesPerPixel(internalformat);
+	e.lastUsed = tick();
+	e.lastFrame = m_frame;
+	m_textures.push_back(e);
+	enforceBudget();
+	GLError::glCheckError(__func__);
+	return e.resource;
+}
+
+GLRenderbufferObjectRef GLRenderTargetPool::acquireRenderbuffer(int width, int height, GLenum internalformat,
+																int samples/*=0*/)
+{
+	for (size_t i = 0; i < m_renderbuffers.size(); i++)
+	{
+		Entry<GLRenderbufferObjectRef>& e = m_renderbuffers[i];
+		if (e.width == width && e.height == height && e.format == (GLint)internalformat &&
+			e.samples == samples && isFree(e.resource))
+		{
+			m_hits++;
+			e.lastUsed = tick();
+			e.lastFrame = m_frame;
+			return e.resource;
+		}
+	}
+	m_misses++;
+	Entry<GLRenderbufferObjectRef> e;
+	e.resource = GLRenderbufferObjectRef(new GLRenderbufferObject(width, height, internalformat, samples));
+	e.width = width;
+	e.height = height;
+	e.format = internalformat;
+	e.samples = samples;
+	e.bytes = size_t(width) * height * getBytesPerPixel(internalformat) * std::max(samples, 1);
+	e.lastUsed = tick();
+	e.lastFrame = m_frame;
+	m_renderbuffers.push_back(e);
+	enforceBudget();
+	GLError::glCheckError(__func__);
+	return e.resource;
+}
+
+GLFrameBufferObjectRef GLRenderTargetPool::acquireFramebuffer(GLenum target/*=GL_FRAMEBUFFER*/)
+{
+	for (size_t i = 0; i < m_framebuffers.size(); i++)
+	{
+		Entry<GLFrameBufferObjectRef>& e = m_framebuffers[i];
+		if (e.format == (GLint)target && isFree(e.resource))
+		{
+			m_hits++;
+			e.lastUsed = tick();
+			e.lastFrame = m_frame;
+			return e.resource;
+		}
+	}
+	m_misses++;
+	Entry<GLFrameBufferObjectRef> e;
+	e.resource = GLFrameBufferObjectRef(new GLFrameBufferObject(target));
+	e.width = e.height = 0;
+	e.format = target;
+	e.samples = 0;
+	e.bytes = 0;
+	e.lastUsed = tick();
+	e.lastFrame = m_frame;
+	m_framebuffers.push_back(e);
+	return e.resource;
+}
+
+void GLRenderTargetPool::beginFrame()
+{
+	//resources still held count as used in the frame that just ended.
+	for (size_t i = 0; i < m_textures.size(); i++)
+		if (!isFree(m_textures[i].resource)) m_textures[i].lastFrame = m_frame;
+	for (size_t i = 0; i < m_renderbuffers.size(); i++)
+		if (!isFree(m_renderbuffers[i].resource)) m_renderbuffers[i].lastFrame = m_frame;
+	for (size_t i = 0; i < m_framebuffers.size(); i++)
+		if (!isFree(m_framebuffers[i].resource)) m_framebuffers[i].lastFrame = m_frame;
+	m_frame++;
+	unsigned long long frame = m_frame;
+	unsigned long long maxIdle = (unsigned long long)std::max(m_maxIdleFrames, 0);
+	removeFree(m_textures, [&](const Entry<GLTexture2DRef>& e) { return frame - e.lastFrame > maxIdle; });
+	removeFree(m_renderbuffers, [&](const Entry<GLRenderbufferObjectRef>& e) { return frame - e.lastFrame > maxIdle; });
+	removeFree(m_framebuffers, [&](const Entry<GLFrameBufferObjectRef>& e) { return frame - e.lastFrame > maxIdle; });
+}
+
+void GLRenderTargetPool::trim()
+{
+	removeFree(m_textures, [](const Entry<GLTexture2DRef>&) { return true; });
+	removeFree(m_renderbuffers, [](const Entry<GLRenderbufferObjectRef>&) { return true; });
+	removeFree(m_framebuffers, [](const Entry<GLFrameBufferObjectRef>&) { return true; });
+}
+
+void GLRenderTargetPool::release(GLTexture2DRef& texture)
+{
+	releaseEntry(m_textures, texture);
+}
+
+void GLRenderTargetPool::release(GLRenderbufferObjectRef& renderbuffer)
+{
+	releaseEntry(m_renderbuffers, renderbuffer);
+}
+
+void GLRenderTargetPool::enforceBudget()
+{
+	GLRenderTargetPoolStats stats = getStats();
+	size_t resident = stats.residentBytes;
+	while (resident > m_byteBudget)
+	{
+		//least recently acquired free texture or renderbuffer.
+		int kind = -1;
+		size_t index = 0;
+		unsigned long long oldest = ~0ULL;
+		for (size_t i = 0; i < m_textures.size(); i++)
+		{
+			if (isFree(m_textures[i].resource) && m_textures[i].lastUsed < oldest)
+			{
+				kind = 0; index = i; oldest = m_textures[i].lastUsed;
+			}
+		}
+		for (size_t i = 0; i < m_renderbuffers.size(); i++)
+		{
+			if (isFree(m_renderbuffers[i].resource) && m_renderbuffers[i].lastUsed < oldest)
+			{
+				kind = 1; index = i; oldest = m_renderbuffers[i].lastUsed;
+			}
+		}
+		if (kind < 0) break;//everything left is in use.
+		if (kind == 0)
+		{
+			resident -= m_textures[index].bytes;
+			m_textures.erase(m_textures.begin() + index);
+		}
+		else
+		{
+			resident -= m_renderbuffers[index].bytes;
+			m_renderbuffers.erase(m_renderbuffers.begin() + index);
+		}
+	}
+}
+
+GLRenderTargetPoolStats GLRenderTargetPool::getStats() const
+{
+	GLRenderTargetPoolStats stats;
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.hitRate = m_hits + m_misses ? double(m_hits) / double(m_hits + m_misses) : 0.0;
+	stats.residentBytes = stats.inUseBytes = 0;
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		stats.residentBytes += m_textures[i].bytes;
+		if (!isFree(m_textures[i].resource)) stats.inUseBytes += m_textures[i].bytes;
+	}
+	for (size_t i = 0; i < m_renderbuffers.size(); i++)
+	{
+		stats.residentBytes += m_renderbuffers[i].bytes;
+		if (!isFree(m_renderbuffers[i].resource)) stats.inUseBytes += m_renderbuffers[i].bytes;
+	}
+	stats.textureCount = m_textures.size();
+	stats.renderbufferCount = m_renderbuffers.size();
+	stats.framebufferCount = m_framebuffers.size();
+	return stats;
+}
+
+GLRenderTargetPoolRef GLRenderTargetPool::getDefault()
+{
+	if (!g_defaultPool)
+	{
+		g_defaultPool = GLRenderTargetPoolRef(new GLRenderTargetPool());
+	}
+	return g_defaultPool;
+}
+
+void GLRenderTargetPool::releaseDefault()
+{
+	g_defaultPool.reset();
+}
+
+}
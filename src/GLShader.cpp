@@ -476,7 +476,7 @@ GLint GLShader::getUniformLocation(const char* name )
 	return location;
 }
 
-void GLShader::SetFloatUniform( char* name, GLfloat val){
+void GLShader::SetFloatUniform( const char* name, GLfloat val){
     if (m_uniforms.find(name) == m_uniforms.end())
     {
         m_uniforms[name] = new GLUniform1f(-1, name, val);
@@ -486,7 +486,7 @@ void GLShader::SetFloatUniform( char* name, GLfloat val){
     }
 }
 
-void GLShader::SetFloat2Uniform( char* name,const vec2f& val)
+void GLShader::SetFloat2Uniform( const char* name,const vec2f& val)
 {
     if (m_uniforms.find(name) == m_uniforms.end())
     {
@@ -497,7 +497,7 @@ void GLShader::SetFloat2Uniform( char* name,const vec2f& val)
     }
 }
 
-void GLShader::SetFloat3Uniform( char* name, const vec3f& val )
+void GLShader::SetFloat3Uniform( const char* name, const vec3f& val )
 {
     if (m_uniforms.find(name) == m_uniforms.end())
     {
@@ -508,7 +508,7 @@ void GLShader::SetFloat3Uniform( char* name, const vec3f& val )
     }
 }
 
-void GLShader::SetFloat4Uniform( char* name, const vec4f& val )
+void GLShader::SetFloat4Uniform( const char* name, const vec4f& val )
 {
     if (m_uniforms.find(name) == m_uniforms.end())
     {
@@ -519,7 +519,7 @@ void GLShader::SetFloat4Uniform( char* name, const vec4f& val )
     }
 }
 
-void GLShader::SetDoubleUniform( char* name, GLdouble val)
+void GLShader::SetDoubleUniform( const char* name, GLdouble val)
 {
     if (m_uniforms.find(name) == m_uniforms.end())
     {
@@ -531,7 +531,7 @@ void GLShader::SetDoubleUniform( char* name, GLdouble val)
 }
 
 /*TODO: will be available once vec4d is ready.
-void GLShader::SetDouble2Uniform( char* name,const vec2d& val )
+void GLShader::SetDouble2Uniform( const char* name,const vec2d& val )
 {
 	GLint location = getUniformLocation(name);
 	if (location != -1)
@@ -541,7 +541,7 @@ void GLShader::SetDouble2Uniform( char* name,const vec2d& val )
 }
 */
 
-void GLShader::SetDouble3Uniform( char* name, const vec3d& val )
+void GLShader::SetDouble3Uniform( const char* name, const vec3d& val )
 {
     if (m_uniforms.find(name) == m_uniforms.end())
     {
@@ -552,7 +552,7 @@ void GLShader::SetDouble3Uniform( char* name, const vec3d& val )
     }
 }
 /*TODO: will be available once vec4d is ready.
-void GLShader::SetDouble4Uniform( char* name, const vec4f& val )
+void GLShader::SetDouble4Uniform( const char* name, const vec4f& val )
 {
 	GLint location = getUniformLocation(name);
 	if (location != -1)
@@ -562,7 +562,7 @@ void GLShader::SetDouble4Uniform( char* name, const vec4f& val )
 }
 */
 
-void GLShader::SetUintUniform( char* name, GLuint val){
+void GLShader::SetUintUniform( const char* name, GLuint val){
     if (m_uniforms.find(name) == m_uniforms.end())
     {
         m_uniforms[name] = new GLUniform1u(-1, name, val);
@@ -572,7 +572,7 @@ void GLShader::SetUintUniform( char* name, GLuint val){
     }
 }
 
-void GLShader::SetBoolUniform( char* name, bool val){
+void GLShader::SetBoolUniform( const char* name, bool val){
     if (m_uniforms.find(name) == m_uniforms.end())
     {
         m_uniforms[name] = new GLUniform1i(-1, name, val);
@@ -582,7 +582,7 @@ void GLShader::SetBoolUniform( char* name, bool val){
     }
 }
 
-void GLShader::SetIntUniform( char* name, GLint val){
+void GLShader::SetIntUniform( const char* name, GLint val){
     if (m_uniforms.find(name) == m_uniforms.end())
     {
         m_uniforms[name] = new GLUniform1i(-1, name, val);
@@ -592,7 +592,7 @@ void GLShader::SetIntUniform( char* name, GLint val){
     }
 }
 
-void GLShader::SetInt2Uniform(char* name, const vec2i& val)
+void GLShader::SetInt2Uniform( const char* name, const vec2i& val)
 {
     if (m_uniforms.find(name) == m_uniforms.end())
     {
@@ -603,7 +603,7 @@ void GLShader::SetInt2Uniform(char* name, const vec2i& val)
     }
 }
 
-void GLShader::SetInt3Uniform(char* name, const vec3i& val)
+void GLShader::SetInt3Uniform( const char* name, const vec3i& val)
 {
     if (m_uniforms.find(name) == m_uniforms.end())
     {
@@ -614,7 +614,7 @@ void GLShader::SetInt3Uniform(char* name, const vec3i& val)
     }
 }
 
-void GLShader::SetMatrixUniform( char* name, GLfloat mat[16], bool isRowMajor/*=true*/){
+void GLShader::SetMatrixUniform( const char* name, GLfloat mat[16], bool isRowMajor/*=true*/){
     if (m_uniforms.find(name) == m_uniforms.end())
     {
         m_uniforms[name] = new GLUniformMat4(-1, name, mat4(mat), isRowMajor);
@@ -624,7 +624,7 @@ void GLShader::SetMatrixUniform( char* name, GLfloat mat[16], bool isRowMajor/*=
     }
 }
 
-void GLShader::SetMatrixUniform( char* name, const mat4& mat, bool isRowMajor /*= true*/ )
+void GLShader::SetMatrixUniform( const char* name, const mat4& mat, bool isRowMajor /*= true*/ )
 {
     if (m_uniforms.find(name) == m_uniforms.end()){
         m_uniforms[name] = new GLUniformMat4(-1, name, mat, isRowMajor);
@@ -634,7 +634,7 @@ void GLShader::SetMatrixUniform( char* name, const mat4& mat, bool isRowMajor /*
     }
 }
 
-void GLShader::SetMatrixUniform( char* name, const mat3& mat, bool isRowMajor /*= true*/ )
+void GLShader::SetMatrixUniform( const char* name, const mat3& mat, bool isRowMajor /*= true*/ )
 {
     if (m_uniforms.find(name) == m_uniforms.end())
     {
@@ -645,7 +645,7 @@ void GLShader::SetMatrixUniform( char* name, const mat3& mat, bool isRowMajor /*
     }
 }
 
-void GLShader::SetSamplerUniform( char* name, GLuint textUnitId/*=0*/)
+void GLShader::SetSamplerUniform( const char* name, GLuint textUnitId/*=0*/)
 {
     if (m_uniforms.find(name) == m_uniforms.end())
     {
@@ -656,7 +656,7 @@ void GLShader::SetSamplerUniform( char* name, GLuint textUnitId/*=0*/)
     }
 }
 
-void GLShader::SetSamplerUniform( char* name,  GLTextureAbstract* tex )
+void GLShader::SetSamplerUniform( const char* name,  GLTextureAbstract* tex )
 {
     if (m_uniforms.find(name) == m_uniforms.end())
     {
@@ -667,7 +667,7 @@ void GLShader::SetSamplerUniform( char* name,  GLTextureAbstract* tex )
     }
 }
 
-void GLShader::SetImageUniform( char* name,  GLTextureAbstract* tex )
+void GLShader::SetImageUniform( const char* name,  GLTextureAbstract* tex )
 {
     if (m_uniforms.find(name) == m_uniforms.end())
     {
@@ -678,7 +678,7 @@ void GLShader::SetImageUniform( char* name,  GLTextureAbstract* tex )
     }
 }
 
-void GLShader::SetBlockUniform(char* name, GLUniformBlockBufferObjectRef bbo)
+void GLShader::SetBlockUniform( const char* name, GLUniformBlockBufferObjectRef bbo)
 {
     if (m_uniforms.find(name) == m_uniforms.end())
     {
@@ -689,7 +689,7 @@ void GLShader::SetBlockUniform(char* name, GLUniformBlockBufferObjectRef bbo)
     }
 }
 
-void GLShader::SetAtomicCounterUniform(char* name, GLAtomicCounterRef aco)
+void GLShader::SetAtomicCounterUniform( const char* name, GLAtomicCounterRef aco)
 {
     if (m_uniforms.find(name) == m_uniforms.end())
     {
@@ -700,7 +700,7 @@ void GLShader::SetAtomicCounterUniform(char* name, GLAtomicCounterRef aco)
     }
 }
 
-void GLShader::SetShaderStorageBlockUniform(char* name, GLShaderStorageBufferObjectRef ssbo)
+void GLShader::SetShaderStorageBlockUniform( const char* name, GLShaderStorageBufferObjectRef ssbo)
 {
     if (m_uniforms.find(name) == m_uniforms.end())
     {
@@ -21,7 +21,7 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 //AUTHOR: Jinrong Xie (stonexjr at gmail.com)
-//UPDATED: 2017-10-15
+//UPDATED: 2026-10-19
 #if defined(__APPLE__) || defined(MACOSX)
 #include <OpenGL/gl3.h>
 #else
@@ -33,13 +33,14 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 #include "constant.h"
 #include "GLError.h"
 #include "mathtool.h"
+#include <cstring>
 
 namespace davinci{
 
 	GLStereoCamera::GLStereoCamera(void)
 		:GLCamera()
 		, m_IPD(0.02f), m_focalDistance(10.0f)
-		, m_frustumMode(OFFAXIS)
+		, m_frustumMode(OFFAXIS), m_singlePassMode(SIDE_BY_SIDE)
 	{
 	}
 
@@ -95,6 +96,8 @@ namespace davinci{
 		m_up.normalize();
 
 		m_centerFocalPos = (m_backward * (-m_focalDistance) + position);
+		m_curLeftEyePos  = position - (m_right*(m_IPD*0.5f));
+		m_curRightEyePos = position + (m_right*(m_IPD*0.5f));
 
 		vec3f leftFocalPos, rightFocalPos;
 		if (m_frustumMode == TOEIN)
@@ -106,9 +109,6 @@ namespace davinci{
 			rightFocalPos = m_curRightEyePos + (m_backward * (-m_focalDistance));
 		}
 
-		m_curLeftEyePos  = position - (m_right*(m_IPD*0.5f));
-		m_curRightEyePos = position + (m_right*(m_IPD*0.5f));
-
 		m_leftCamera.setLookAt(m_curLeftEyePos,   leftFocalPos, m_up);
 		m_rightCamera.setLookAt(m_curRightEyePos, rightFocalPos, m_up);
 
@@ -131,6 +131,83 @@ namespace davinci{
 		}
 	}
 
+	davinci::mat4 GLStereoCamera::getProjectionMatrix(EyeMode eyemode) const
+	{
+		mat4 projMtx = m_projMtx;
+		if (m_frustumMode == OFFAXIS && eyemode != MIDDLE_EYE && projMtx[3][3] == 0.0f)
+		{//Shift the near plane window by IPD/2*n/focal toward the other eye,
+		 //i.e. (r+l)/(r-l) changes by 2n/(r-l)*IPD/(2*focal).
+			float shift = projMtx[0][0] * m_IPD * 0.5f / m_focalDistance;
+			projMtx[0][2] += (eyemode == LEFT_EYE) ? shift : -shift;
+		}
+		return projMtx;
+	}
+
+	davinci::mat4 GLStereoCamera::getViewProjectionMatrix(EyeMode eyemode)
+	{
+		return getProjectionMatrix(eyemode) * getViewingMatrix(eyemode);
+	}
+
+	bool GLStereoCamera::isLayeredSupported()
+	{
+#if defined(__APPLE__) || defined(MACOSX)
+		return false;
+#else
+		return glewIsSupported("GL_ARB_shader_viewport_layer_array") ||
+			   glewIsSupported("GL_AMD_vertex_shader_layer");
+#endif
+	}
+
+	GLUniformBlockBufferObjectRef GLStereoCamera::updateStereoBlock()
+	{
+		//std140 layout of StereoMatrices in shader/stereo.glsl, declared
+		//row_major to match mat4.
+		float block[2 * 16 + 2 * 16 + 4];
+		EyeMode eyes[2] = { LEFT_EYE, RIGHT_EYE };
+		for (int i = 0; i < 2; i++)
+		{
+			mat4 viewProj = getViewProjectionMatrix(eyes[i]);
+			mat4 view = getViewingMatrix(eyes[i]);
+			memcpy(block + i * 16, viewProj.get(), sizeof(float) * 16);
+			memcpy(block + 32 + i * 16, view.get(), sizeof(float) * 16);
+		}
+		int params[4] = { (int)m_singlePassMode, 0, 0, 0 };
+		memcpy(block + 64, params, sizeof(params));
+		if (!m_stereoBlock)
+		{
+			m_stereoBlock = GLUniformBlockBufferObjectRef(
+				new GLUniformBlockBufferObject("StereoMatrices", GL_DYNAMIC_DRAW));
+		}
+		m_stereoBlock->upload(sizeof(block), block);
+		return m_stereoBlock;
+	}
+
+	void GLStereoCamera::beginSinglePass(int x, int y, int eyeWidth, int eyeHeight)
+	{
+		if (m_singlePassMode == LAYERED)
+		{
+			if (!isLayeredSupported())
+			{
+				GLError::ErrorMessage(string(__func__) + ": LAYERED mode needs GL_ARB_shader_viewport_layer_array"
+									  " or GL_AMD_vertex_shader_layer, use SIDE_BY_SIDE instead.");
+			}
+			glViewport(x, y, eyeWidth, eyeHeight);
+		}else{
+			glViewport(x, y, 2 * eyeWidth, eyeHeight);
+			glEnable(GL_CLIP_DISTANCE0);
+		}
+		updateStereoBlock();
+		GLError::glCheckError(__func__);
+	}
+
+	void GLStereoCamera::endSinglePass()
+	{
+		if (m_singlePassMode == SIDE_BY_SIDE)
+		{
+			glDisable(GL_CLIP_DISTANCE0);
+		}
+	}
+
 	/*
 	void GLStereoCamera::setLookAtOffAxis(const vec3f& position,
 		const vec3f& target, const vec3f& up)
@@ -0,0 +1,237 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cmath>
+#include <GL/glew.h>
+#include "vec2i.h"
+#include "vec3f.h"
+#include "GLError.h"
+#include "GLContext.h"
+#include "GLSupersampler.h"
+#include "GLRenderTargetPool.h"
+
+namespace davinci{
+
+static const char* g_accumShaderSrc =
+"#version 430\n"
+"layout(local_size_x = 8, local_size_y = 8) in;\n"
+"layout(rgba32f) uniform image2D accumImg;\n"
+"uniform sampler2D sceneTex;\n"
+"uniform ivec2 size;\n"
+"uniform float weight;\n"
+"uniform int   first;\n"
+"void main()\n"
+"{\n"
+"	ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+"	if (any(greaterThanEqual(p, size))) return;\n"
+"	vec4 c = weight*texelFetch(sceneTex, p, 0);\n"
+"	//the first sample overwrites, so no clear is needed.\n"
+"	if (first == 0) c += imageLoad(accumImg, p);\n"
+"	imageStore(accumImg, p, c);\n"
+"}\n";
+
+static const char* g_resolveShaderSrc =
+"#version 430\n"
+"layout(local_size_x = 8, local_size_y = 8) in;\n"
+"layout(rgba32f) readonly  uniform image2D accumImg;\n"
+"layout(rgba8)   writeonly uniform image2D resolvedImg;\n"
+"uniform ivec2 size;\n"
+"uniform float invWeightSum;\n"
+"void main()\n"
+"{\n"
+"	ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n"
+"	if (any(greaterThanEqual(p, size))) return;\n"
+"	imageStore(resolvedImg, p, clamp(imageLoad(accumImg, p)*invWeightSum, 0.0, 1.0));\n"
+"}\n";
+
+namespace{
+	float radicalInverse(int i, int base)
+	{
+		float inv = 1.0f / base, f = inv, r = 0.0f;
+		for (; i > 0; i /= base, f *= inv)
+			r += f * (i % base);
+		return r;
+	}
+}
+
+GLSupersampler::GLSupersampler(FilterType filter/*=FILTER_BOX*/)
+	:m_filter(filter), m_width(0), m_height(0), m_sampleCount(0), m_weightSum(0.0f)
+{
+}
+
+GLSupersampler::~GLSupersampler()
+{
+}
+
+void GLSupersampler::createShaders()
+{
+	std::string src = g_accumShaderSrc;
+	m_accumShader = GLComputeShaderRef(new GLComputeShader("GLSupersampler accumulate"));
+	m_accumShader->setComputeShaderStr(src);
+	m_accumShader->CreateShaders();
+
+	src = g_resolveShaderSrc;
+	m_resolveShader = GLComputeShaderRef(new GLComputeShader("GLSupersampler resolve"));
+	m_resolveShader->setComputeShaderStr(src);
+	m_resolveShader->CreateShaders();
+}
+
+void GLSupersampler::resize(int width, int height)
+{
+	if (width == m_width && height == m_height && m_sceneFbo)
+		return;
+	m_width = width;
+	m_height = height;
+	GLRenderTargetPoolRef pool = GLRenderTargetPool::getDefault();
+	pool->release(m_sceneTex);
+	pool->release(m_sceneDepth);
+	pool->release(m_accumTex);
+	pool->release(m_resolvedTex);
+	m_sceneTex = pool->acquireTexture(width, height, GL_RGBA16F);
+	m_sceneTex->setName("GLSupersampler::m_sceneTex");
+	m_sceneDepth = pool->acquireRenderbuffer(width, height, GL_DEPTH_COMPONENT);
+	m_accumTex = pool->acquireTexture(width, height, GL_RGBA32F);
+	m_accumTex->setName("GLSupersampler::m_accumTex");
+	m_resolvedTex = pool->acquireTexture(width, height, GL_RGBA8);
+	m_resolvedTex->setName("GLSupersampler::m_resolvedTex");
+
+	m_sceneFbo = GLFrameBufferObjectRef(new GLFrameBufferObject(GL_DRAW_FRAMEBUFFER));
+	m_sceneFbo->bind();
+	m_sceneFbo->attachColorBuffer(0, m_sceneTex);
+	m_sceneFbo->attachDepthBuffer(m_sceneDepth);
+	m_sceneFbo->unbind();
+
+	m_resolveFbo = GLFrameBufferObjectRef(new GLFrameBufferObject(GL_READ_FRAMEBUFFER));
+	m_resolveFbo->bind();
+	m_resolveFbo->attachColorBuffer(0, m_resolvedTex);
+	m_resolveFbo->unbind();
+	GLError::glCheckError(__func__);
+	reset();
+}
+
+void GLSupersampler::reset()
+{
+	m_sampleCount = 0;
+	m_weightSum = 0.0f;
+}
+
+vec2f GLSupersampler::getJitter(int sampleIndex)
+{
+	//index 0 of Halton is the origin, start at 1 so every sample is new.
+	return vec2f(radicalInverse(sampleIndex + 1, 2) - 0.5f, radicalInverse(sampleIndex + 1, 3) - 0.5f);
+}
+
+mat4 GLSupersampler::jitterProjection(const mat4& proj, const vec2f& jitterPixels, int width, int height)
+{
+	//a pixel spans 2/width in NDC.
+	mat4 shift;
+	shift.identity();
+	shift.translate(vec3f(2.0f * jitterPixels.x() / width, 2.0f * jitterPixels.y() / height, 0.0f));
+	return shift * proj;
+}
+
+int GLSupersampler::accumulate(drawCallBack renderCallBack, void* params, int nSamples/*=1*/)
+{
+	if (!m_sceneFbo)
+	{
+		GLError::ErrorMessage(string(__func__) + ": call resize() before accumulating samples.");
+		return 0;
+	}
+	if (!m_accumShader)
+	{
+		createShaders();
+	}
+	GLint prevFbo = 0, viewport[4];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFbo);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	mat4 oldPjM = GLContext::g_PjM;
+	m_accumTex->setImageAccess(GL_READ_WRITE);
+
+	for (int s = 0; s < nSamples; s++)
+	{
+		vec2f jitter = getJitter(m_sampleCount);
+		float weight = 1.0f;
+		if (m_filter == FILTER_GAUSSIAN)
+		{
+			jitter = jitter * 2.0f;
+			weight = expf(-2.0f * jitter.dot(jitter));
+		}
+		GLContext::g_PjM = jitterProjection(oldPjM, jitter, m_width, m_height);
+		m_sceneFbo->bind();
+		glViewport(0, 0, m_width, m_height);
+		renderCallBack(params);
+		m_sceneFbo->unbind();
+
+		m_accumShader->SetSamplerUniform("sceneTex", m_sceneTex.get());
+		m_accumShader->SetImageUniform("accumImg", m_accumTex.get());
+		m_accumShader->SetInt2Uniform("size", vec2i(m_width, m_height));
+		m_accumShader->SetFloatUniform("weight", weight);
+		m_accumShader->SetIntUniform("first", m_sampleCount == 0 ? 1 : 0);
+		m_accumShader->UseShaders((m_width + 7) / 8, (m_height + 7) / 8, 1);
+		m_accumShader->ReleaseShader();
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		m_weightSum += weight;
+		m_sampleCount++;
+	}
+
+	GLContext::g_PjM = oldPjM;
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prevFbo);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	GLError::glCheckError(__func__);
+	return m_sampleCount;
+}
+
+GLTexture2DRef GLSupersampler::resolve()
+{
+	if (m_sampleCount == 0)
+	{
+		GLError::ErrorMessage(string(__func__) + ": no sample has been accumulated.");
+		return m_resolvedTex;
+	}
+	m_accumTex->setImageAccess(GL_READ_ONLY);
+	m_resolvedTex->setImageAccess(GL_WRITE_ONLY);
+	m_resolveShader->SetImageUniform("accumImg", m_accumTex.get());
+	m_resolveShader->SetImageUniform("resolvedImg", m_resolvedTex.get());
+	m_resolveShader->SetInt2Uniform("size", vec2i(m_width, m_height));
+	m_resolveShader->SetFloatUniform("invWeightSum", 1.0f / m_weightSum);
+	m_resolveShader->UseShaders((m_width + 7) / 8, (m_height + 7) / 8, 1);
+	m_resolveShader->ReleaseShader();
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	GLError::glCheckError(__func__);
+	return m_resolvedTex;
+}
+
+void GLSupersampler::present(GLuint drawFramebuffer, int x/*=0*/, int y/*=0*/)
+{
+	GLint prevRead = 0, prevDraw = 0;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &prevRead);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevDraw);
+	m_resolveFbo->bind();
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer);
+	glBlitFramebuffer(0, 0, m_width, m_height, x, y, x + m_width, y + m_height,
+					  GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, prevRead);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prevDraw);
+	GLError::glCheckError(__func__);
+}
+
+}
@@ -0,0 +1,390 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cmath>
+#include <algorithm>
+#include <GL/glew.h>
+#include "constant.h"
+#include "GLError.h"
+#include "GLContext.h"
+#include "GLRenderTargetPool.h"
+#include "GLTiledRenderer.h"
+
+namespace davinci{
+
+namespace{
+	//BigTIFF field types.
+	const unsigned short TIFF_SHORT = 3;
+	const unsigned short TIFF_LONG  = 4;
+	const unsigned short TIFF_LONG8 = 16;
+
+	void put16(std::vector<unsigned char>& out, unsigned long long v)
+	{
+		for (int i = 0; i < 2; i++) out.push_back((unsigned char)(v >> (8 * i)));
+	}
+	void put64(std::vector<unsigned char>& out, unsigned long long v)
+	{
+		for (int i = 0; i < 8; i++) out.push_back((unsigned char)(v >> (8 * i)));
+	}
+
+	struct TiffField{
+		unsigned short tag, type;
+		unsigned long long count;
+		std::vector<unsigned char> data;//little endian values.
+	};
+}
+
+GLTiledImageWriter::GLTiledImageWriter()
+	:m_width(0), m_height(0), m_tileWidth(0), m_tileHeight(0), m_channels(0), m_dataOffset(0)
+{
+}
+
+GLTiledImageWriter::~GLTiledImageWriter()
+{
+	close();
+}
+
+bool GLTiledImageWriter::open(const std::string& fileName, int width, int height,
+							  int tileWidth, int tileHeight, int channels)
+{
+	close();
+	if (width <= 0 || height <= 0 || tileWidth <= 0 || tileHeight <= 0 ||
+		tileWidth % 16 || tileHeight % 16 || (channels != 3 && channels != 4))
+	{
+		GLError::ErrorMessage(std::string(__func__) + ": invalid image or tile size.");
+		return false;
+	}
+	m_width = width;
+	m_height = height;
+	m_tileWidth = tileWidth;
+	m_tileHeight = tileHeight;
+	m_channels = channels;
+	m_file.open(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!m_file.is_open())
+	{
+		GLError::ErrorMessage(std::string(__func__) + ": cannot open " + fileName);
+		return false;
+	}
+
+	unsigned long long nTiles = (unsigned long long)getTilesAcross() * getTilesDown();
+	std::vector<TiffField> fields;
+	TiffField fd;
+	fd.tag = 256; fd.type = TIFF_LONG; fd.count = 1; fd.data.clear(); put64(fd.data, width); fd.data.resize(4); fields.push_back(fd);
+	fd.tag = 257; fd.data.clear(); put64(fd.data, height); fd.data.resize(4); fields.push_back(fd);
+	fd.tag = 258; fd.type = TIFF_SHORT; fd.count = channels; fd.data.clear();
+	for (int c = 0; c < channels; c++) put16(fd.data, 8);
+	fields.push_back(fd);
+	fd.count = 1;
+	fd.tag = 259; fd.data.clear(); put16(fd.data, 1); fields.push_back(fd);//no compression
+	fd.tag = 262; fd.data.clear(); put16(fd.data, 2); fields.push_back(fd);//RGB
+	fd.tag = 277; fd.data.clear(); put16(fd.data, channels); fields.push_back(fd);
+	fd.tag = 284; fd.data.clear(); put16(fd.data, 1); fields.push_back(fd);//interleaved
+	fd.tag = 322; fd.type = TIFF_LONG; fd.data.clear(); put64(fd.data, tileWidth); fd.data.resize(4); fields.push_back(fd);
+	fd.tag = 323; fd.data.clear(); put64(fd.data, tileHeight); fd.data.resize(4); fields.push_back(fd);
+	size_t offsetsField = fields.size();
+	fd.tag = 324; fd.type = TIFF_LONG8; fd.count = nTiles; fd.data.clear(); fields.push_back(fd);
+	fd.tag = 325; fd.data.clear();
+	for (unsigned long long i = 0; i < nTiles; i++) put64(fd.data, getTileBytes());
+	fields.push_back(fd);
+	if (channels == 4)
+	{
+		fd.tag = 338; fd.type = TIFF_SHORT; fd.count = 1; fd.data.clear(); put16(fd.data, 2); fields.push_back(fd);//unassociated alpha
+	}
+
+	//header, IFD, out-of-line values, then the tiles.
+	const unsigned long long ifdOffset = 16;
+	unsigned long long extOffset = ifdOffset + 8 + 20 * fields.size() + 8;
+	unsigned long long extBytes = 0;
+	for (size_t i = 0; i < fields.size(); i++)
+	{
+		size_t bytes = i == offsetsField ? size_t(nTiles * 8) : fields[i].data.size();
+		if (bytes > 8) extBytes += bytes;
+	}
+	m_dataOffset = (extOffset + extBytes + 15) & ~15ULL;
+	for (unsigned long long i = 0; i < nTiles; i++)
+		put64(fields[offsetsField].data, m_dataOffset + i * getTileBytes());
+
+	std::vector<unsigned char> head, ext;
+	head.push_back('I'); head.push_back('I');
+	put16(head, 43); put16(head, 8); put16(head, 0);
+	put64(head, ifdOffset);
+	put64(head, fields.size());
+	for (size_t i = 0; i < fields.size(); i++)
+	{
+		put16(head, fields[i].tag);
+		put16(head, fields[i].type);
+		put64(head, fields[i].count);
+		if (fields[i].data.size() <= 8)
+		{
+			std::vector<unsigned char> inl = fields[i].data;
+			inl.resize(8, 0);
+			head.insert(head.end(), inl.begin(), inl.end());
+		}
+		else
+		{
+			put64(head, extOffset + ext.size());
+			ext.insert(ext.end(), fields[i].data.begin(), fields[i].data.end());
+		}
+	}
+	put64(head, 0);//no next IFD
+	head.insert(head.end(), ext.begin(), ext.end());
+	head.resize(size_t(m_dataOffset), 0);
+	m_file.write((const char*)&head[0], head.size());
+	return m_file.good();
+}
+
+bool GLTiledImageWriter::writeTile(int tileX, int tileY, const unsigned char* pixels)
+{
+	if (!m_file.is_open() || tileX < 0 || tileY < 0 || tileX >= getTilesAcross() || tileY >= getTilesDown())
+		return false;
+	unsigned long long index = (unsigned long long)tileY * getTilesAcross() + tileX;
+	m_file.seekp(std::streamoff(m_dataOffset + index * getTileBytes()));
+	m_file.write((const char*)pixels, std::streamsize(getTileBytes()));
+	return m_file.good();
+}
+
+bool GLTiledImageWriter::close()
+{
+	if (!m_file.is_open())
+		return true;
+	m_file.flush();
+	bool ok = m_file.good();
+	m_file.close();
+	return ok;
+}
+
+GLTiledRenderer::GLTiledRenderer(int tileWidth/*=2048*/, int tileHeight/*=2048*/, int maxQueuedTiles/*=4*/)
+	:m_tileWidth(tileWidth), m_tileHeight(tileHeight), m_maxQueuedTiles(std::max(maxQueuedTiles, 1)),
+	 m_left(-1), m_right(1), m_bottom(-1), m_top(1), m_near(1), m_far(100),
+	 m_tilesRendered(0), m_tilesAcross(0), m_done(true), m_writeFailed(false)
+{
+}
+
+GLTiledRenderer::~GLTiledRenderer()
+{
+}
+
+void GLTiledRenderer::setFrustum(float l, float r, float b, float t, float n, float f)
+{
+	m_left = l; m_right = r; m_bottom = b; m_top = t; m_near = n; m_far = f;
+}
+
+void GLTiledRenderer::setFrustum(float fovY, float aspect, float n, float f)
+{
+	float halfHeight = n * tanf(fovY * 0.5f * DEG2RAD);
+	float halfWidth = halfHeight * aspect;
+	setFrustum(-halfWidth, halfWidth, -halfHeight, halfHeight, n, f);
+}
+
+void GLTiledRenderer::getTileFrustum(float l, float r, float b, float t, int width, int height,
+									 int x0, int y0, int tileWidth, int tileHeight,
+									 float& tl, float& tr, float& tb, float& tt)
+{
+	//edge tiles keep the full tile size, their frustum runs past the poster.
+	double sx = (double(r) - l) / width, sy = (double(t) - b) / height;
+	tl = float(l + sx * x0);
+	tr = float(l + sx * (x0 + tileWidth));
+	tt = float(t - sy * y0);
+	tb = float(t - sy * (y0 + tileHeight));
+}
+
+void GLTiledRenderer::clampTileSize()
+{
+	GLint maxRenderbuffer = 0, maxTexture = 0, maxViewport[2] = { 0, 0 };
+	glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbuffer);
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexture);
+	glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+	int maxWidth = std::min(maxRenderbuffer, std::min(maxTexture, (int)maxViewport[0]));
+	int maxHeight = std::min(maxRenderbuffer, std::min(maxTexture, (int)maxViewport[1]));
+	if (maxWidth > 0)  m_tileWidth = std::min(m_tileWidth, maxWidth);
+	if (maxHeight > 0) m_tileHeight = std::min(m_tileHeight, maxHeight);
+	m_tileWidth = std::max(16, m_tileWidth & ~15);
+	m_tileHeight = std::max(16, m_tileHeight & ~15);
+}
+
+void GLTiledRenderer::readback(int slot)
+{
+	int index = m_pending[slot];
+	Tile tile;
+	tile.tileX = index % m_tilesAcross;
+	tile.tileY = index / m_tilesAcross;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (!m_spare.empty())
+		{
+			tile.rgba.swap(m_spare.back());
+			m_spare.pop_back();
+		}
+	}
+	tile.rgba.resize(size_t(m_tileWidth) * m_tileHeight * 4);
+	//maps the PBO filled a ring length ago, its transfer has long finished.
+	m_pbos[slot]->copyTo(&tile.rgba[0]);
+	m_pending[slot] = -1;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_cond.wait(lock, [this]{ return (int)m_queue.size() < m_maxQueuedTiles || m_writeFailed; });
+	m_queue.push_back(Tile());
+	m_queue.back().tileX = tile.tileX;
+	m_queue.back().tileY = tile.tileY;
+	m_queue.back().rgba.swap(tile.rgba);
+	m_cond.notify_all();
+}
+
+void GLTiledRenderer::writerLoop()
+{
+	int channels = (int)(m_writer.getTileBytes() / (size_t(m_tileWidth) * m_tileHeight));
+	std::vector<unsigned char> pixels(m_writer.getTileBytes());
+	for (;;)
+	{
+		Tile tile;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait(lock, [this]{ return !m_queue.empty() || m_done; });
+			if (m_queue.empty())
+				break;
+			tile.tileX = m_queue.front().tileX;
+			tile.tileY = m_queue.front().tileY;
+			tile.rgba.swap(m_queue.front().rgba);
+			m_queue.pop_front();
+			m_cond.notify_all();
+		}
+		//GL rows are bottom up, TIFF rows top down.
+		for (int y = 0; y < m_tileHeight; y++)
+		{
+			const unsigned char* src = &tile.rgba[size_t(m_tileHeight - 1 - y) * m_tileWidth * 4];
+			unsigned char* dst = &pixels[size_t(y) * m_tileWidth * channels];
+			for (int x = 0; x < m_tileWidth; x++, src += 4, dst += channels)
+			{
+				for (int c = 0; c < channels; c++) dst[c] = src[c];
+			}
+		}
+		bool ok = m_writer.writeTile(tile.tileX, tile.tileY, &pixels[0]);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (!ok) m_writeFailed = true;
+		m_spare.push_back(std::vector<unsigned char>());
+		m_spare.back().swap(tile.rgba);
+		m_cond.notify_all();
+	}
+}
+
+bool GLTiledRenderer::render(GLCamera& camera, int width, int height, const std::string& fileName,
+							 drawCallBack renderCallBack, void* params, bool alpha/*=false*/)
+{
+	clampTileSize();
+	if (!m_writer.open(fileName, width, height, m_tileWidth, m_tileHeight, alpha ? 4 : 3))
+		return false;
+	m_tilesAcross = m_writer.getTilesAcross();
+	int nTiles = m_tilesAcross * m_writer.getTilesDown();
+	m_tilesRendered = 0;
+
+	GLint prevFbo = 0, viewport[4];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFbo);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	mat4 oldPjM = GLContext::g_PjM;
+	mat4 oldCameraPjM = camera.getProjectionMatrix();
+
+	GLRenderTargetPoolRef pool = GLRenderTargetPool::getDefault();
+	GLTexture2DRef color = pool->acquireTexture(m_tileWidth, m_tileHeight, GL_RGBA8);
+	GLRenderbufferObjectRef depth = pool->acquireRenderbuffer(m_tileWidth, m_tileHeight, GL_DEPTH_COMPONENT24);
+	GLFrameBufferObjectRef fbo = pool->acquireFramebuffer(GL_FRAMEBUFFER);
+	fbo->bind();
+	fbo->attachColorBuffer(0, color);
+	fbo->attachDepthBuffer(depth);
+	fbo->checkFramebufferStatus();
+	fbo->unbind();
+
+	//two PBOs: tile i is read back while tile i+1 renders.
+	const int ring = 2;
+	if ((int)m_pbos.size() != ring)
+		m_pbos.resize(ring);
+	for (int i = 0; i < ring; i++)
+	{
+		if (!m_pbos[i])
+			m_pbos[i] = GLPixelBufferObjectRef(new GLPixelBufferObject(m_tileWidth, m_tileHeight,
+											   GL_RGBA, GL_UNSIGNED_BYTE, GL_STREAM_READ));
+		else if (m_pbos[i]->getWidth() != m_tileWidth || m_pbos[i]->getHeight() != m_tileHeight)
+			m_pbos[i]->resize(m_tileWidth, m_tileHeight);
+	}
+	m_pending.assign(ring, -1);
+
+	m_done = false;
+	m_writeFailed = false;
+	m_writerThread = std::thread(&GLTiledRenderer::writerLoop, this);
+
+	for (int i = 0; i < nTiles; i++)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (m_writeFailed) break;
+		}
+		int x0 = (i % m_tilesAcross) * m_tileWidth;
+		int y0 = (i / m_tilesAcross) * m_tileHeight;
+		float tl, tr, tb, tt;
+		getTileFrustum(m_left, m_right, m_bottom, m_top, width, height,
+					   x0, y0, m_tileWidth, m_tileHeight, tl, tr, tb, tt);
+		camera.setFrustum(tl, tr, tb, tt, m_near, m_far);
+		GLContext::g_PjM = camera.getProjectionMatrix();
+
+		fbo->bind();
+		glViewport(0, 0, m_tileWidth, m_tileHeight);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		renderCallBack(params);
+
+		int slot = i % ring;
+		if (m_pending[slot] >= 0)
+			readback(slot);
+		m_pbos[slot]->copyFrom(*fbo, 0);
+		m_pending[slot] = i;
+		m_tilesRendered++;
+	}
+	//drain the ring oldest first.
+	for (int k = 0; k < ring; k++)
+	{
+		int slot = (m_tilesRendered + k) % ring;
+		if (m_pending[slot] >= 0)
+			readback(slot);
+	}
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_done = true;
+		m_cond.notify_all();
+	}
+	m_writerThread.join();
+	m_queue.clear();
+	m_spare.clear();
+	bool ok = m_writer.close() && !m_writeFailed && m_tilesRendered == nTiles;
+
+	//posters are rare, do not keep tile sized targets resident.
+	pool->release(color);
+	pool->release(depth);
+	camera.setProjectionMatrix(oldCameraPjM);
+	GLContext::g_PjM = oldPjM;
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prevFbo);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	GLError::glCheckError(__func__);
+	if (!ok)
+		GLError::ErrorMessage(std::string(__func__) + ": failed to write " + fileName);
+	return ok;
+}
+
+}
@@ -0,0 +1,892 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cmath>
+#include <cfloat>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "GLCamera.h"
+#include "GLTriangleBVH.h"
+#include "GLParallel.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define GLBVH_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GLBVH_SSE
+#endif
+
+namespace davinci{
+
+static_assert(sizeof(GLBVHNode) == 32, "GLBVHNode is expected to be 32 bytes");
+
+namespace{
+	const int   g_binCount = 16;
+	const int   g_maxDepth = 120;//traversal stack is sized after this.
+	const int   g_maxLeafSize = 32;//SAH may not create leaves bigger than this.
+	const unsigned int g_minTaskSize = 1 << 12;//subtrees smaller than this are built by one thread.
+	const unsigned int g_minParallelBinning = 1 << 16;
+	const size_t g_minRaysPerThread = 1 << 10;//also used for closest point queries.
+
+	struct Aabb
+	{
+		float mn[3], mx[3];
+		Aabb(){ reset(); }
+		void reset()
+		{
+			mn[0] = mn[1] = mn[2] = FLT_MAX;
+			mx[0] = mx[1] = mx[2] = -FLT_MAX;
+		}
+		void grow(const Aabb& b)
+		{
+			for (int a = 0; a < 3; a++)
+			{
+				mn[a] = std::min(mn[a], b.mn[a]);
+				mx[a] = std::max(mx[a], b.mx[a]);
+			}
+		}
+		void grow(const float p[3])
+		{
+			for (int a = 0; a < 3; a++)
+			{
+				mn[a] = std::min(mn[a], p[a]);
+				mx[a] = std::max(mx[a], p[a]);
+			}
+		}
+		float area() const
+		{
+			if (mn[0] > mx[0]) return 0.0f;
+			float dx = mx[0] - mn[0], dy = mx[1] - mn[1], dz = mx[2] - mn[2];
+			return dx*dy + dy*dz + dz*dx;
+		}
+	};
+
+	struct Bin
+	{
+		Aabb box;
+		unsigned int count;
+		Bin() :count(0){}
+	};
+
+	struct BuildRange
+	{
+		unsigned int node;
+		unsigned int begin, end;
+		int depth;
+	};
+
+	//Top-down binned SAH builder. Triangle bounds and centroids are
+	//computed once, then index ranges of m_indices are partitioned in place.
+	class Builder
+	{
+	public:
+		Builder(std::vector<unsigned int>& indices, int maxLeafSize)
+			:m_indices(indices), m_maxLeafSize(maxLeafSize){}
+
+		std::vector<Aabb>  m_boxes;
+		std::vector<float> m_centroids;//3 per triangle.
+
+		//Sets the bounds of r.node and either turns it into a leaf or
+		//appends its two children to nodes. Returns true if it was split.
+		bool subdivide(std::vector<GLBVHNode>& nodes, const BuildRange& r,
+					   BuildRange children[2], int nThreads) const
+		{
+			Aabb bounds, cbounds;
+			computeBounds(r.begin, r.end, bounds, cbounds, nThreads);
+			GLBVHNode& node = nodes[r.node];
+			for (int a = 0; a < 3; a++)
+			{
+				node.bmin[a] = bounds.mn[a];
+				node.bmax[a] = bounds.mx[a];
+			}
+			node.leftFirst = r.begin;
+			node.count = r.end - r.begin;
+
+			unsigned int mid;
+			if (!findSplit(r, bounds, cbounds, mid, nThreads))
+				return false;
+
+			unsigned int left = (unsigned int)nodes.size();
+			nodes[r.node].leftFirst = left;
+			nodes[r.node].count = 0;
+			nodes.resize(nodes.size() + 2);
+			BuildRange lr = { left,     r.begin, mid,   r.depth + 1 };
+			BuildRange rr = { left + 1, mid,     r.end, r.depth + 1 };
+			children[0] = lr;
+			children[1] = rr;
+			return true;
+		}
+
+		//Builds the whole subtree of r serially, returns its depth.
+		int buildSerial(std::vector<GLBVHNode>& nodes, const BuildRange& r) const
+		{
+			int depth = r.depth;
+			std::vector<BuildRange> stack(1, r);
+			while (!stack.empty())
+			{
+				BuildRange cur = stack.back();
+				stack.pop_back();
+				depth = std::max(depth, cur.depth);
+				BuildRange children[2];
+				if (subdivide(nodes, cur, children, 1))
+				{
+					stack.push_back(children[1]);
+					stack.push_back(children[0]);
+				}
+			}
+			return depth;
+		}
+
+	private:
+		void computeBounds(unsigned int begin, unsigned int end, Aabb& bounds, Aabb& cbounds, int nThreads) const
+		{
+			unsigned int n = end - begin;
+			int nt = n >= g_minParallelBinning ? nThreads : 1;
+			std::vector<Aabb> b(nt), c(nt);
+			size_t chunk = (n + nt - 1) / nt;
+			parallelFor(n, nt, [&](size_t s, size_t e)
+			{
+				int t = (int)(s / chunk);
+				for (size_t i = s; i < e; i++)
+				{
+					unsigned int tri = m_indices[begin + i];
+					b[t].grow(m_boxes[tri]);
+					c[t].grow(&m_centroids[3 * tri]);
+				}
+			});
+			for (int t = 0; t < nt; t++)
+			{
+				bounds.grow(b[t]);
+				cbounds.grow(c[t]);
+			}
+		}
+
+		inline int binOf(unsigned int tri, int axis, float cmin, float scale) const
+		{
+			int b = (int)((m_centroids[3 * tri + axis] - cmin) * scale);
+			return std::min(g_binCount - 1, std::max(0, b));
+		}
+
+		bool findSplit(const BuildRange& r, const Aabb& bounds, const Aabb& cbounds,
+					   unsigned int& mid, int nThreads) const
+		{
+			unsigned int n = r.end - r.begin;
+			if (n <= (unsigned int)m_maxLeafSize)
+				return false;
+
+			bool forceSplit = n > (unsigned int)g_maxLeafSize;
+			if (r.depth >= g_maxDepth)
+				return false;
+
+			//bin[axis][b] of every axis, merged from the per thread bins.
+			int nt = n >= g_minParallelBinning ? nThreads : 1;
+			std::vector<Bin> bins(nt * 3 * g_binCount);
+			float scale[3];
+			for (int a = 0; a < 3; a++)
+			{
+				float extent = cbounds.mx[a] - cbounds.mn[a];
+				scale[a] = extent > 0.0f ? g_binCount / extent : 0.0f;
+			}
+			size_t chunk = (n + nt - 1) / nt;
+			parallelFor(n, nt, [&](size_t s, size_t e)
+			{
+				Bin* local = &bins[(s / chunk) * 3 * g_binCount];
+				for (size_t i = s; i < e; i++)
+				{
+					unsigned int tri = m_indices[r.begin + i];
+					for (int a = 0; a < 3; a++)
+					{
+						Bin& bin = local[a * g_binCount + binOf(tri, a, cbounds.mn[a], scale[a])];
+						bin.count++;
+						bin.box.grow(m_boxes[tri]);
+					}
+				}
+			});
+			for (int t = 1; t < nt; t++)
+			{
+				for (int i = 0; i < 3 * g_binCount; i++)
+				{
+					bins[i].count += bins[t * 3 * g_binCount + i].count;
+					bins[i].box.grow(bins[t * 3 * g_binCount + i].box);
+				}
+			}
+
+			//Sweep the planes between bins, cost relative to traversal cost 1.
+			float bestCost = FLT_MAX;
+			int   bestAxis = -1, bestPlane = -1;
+			for (int a = 0; a < 3; a++)
+			{
+				if (scale[a] == 0.0f) continue;
+				const Bin* axisBins = &bins[a * g_binCount];
+				float leftArea[g_binCount - 1];
+				unsigned int leftCount[g_binCount - 1];
+				Aabb acc;
+				unsigned int cnt = 0;
+				for (int p = 0; p < g_binCount - 1; p++)
+				{
+					acc.grow(axisBins[p].box);
+					cnt += axisBins[p].count;
+					leftArea[p] = acc.area();
+					leftCount[p] = cnt;
+				}
+				acc.reset();
+				cnt = 0;
+				for (int p = g_binCount - 1; p > 0; p--)
+				{
+					acc.grow(axisBins[p].box);
+					cnt += axisBins[p].count;
+					if (leftCount[p - 1] == 0 || cnt == 0) continue;
+					float cost = leftArea[p - 1] * leftCount[p - 1] + acc.area() * cnt;
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = a;
+						bestPlane = p;
+					}
+				}
+			}
+
+			float parentArea = bounds.area();
+			float splitCost = 1.0f + (parentArea > 0.0f ? bestCost / parentArea : FLT_MAX);
+			if (bestAxis < 0 || splitCost >= (float)n)
+			{
+				if (!forceSplit)
+					return false;
+				//SAH found nothing useful(e.g. coincident centroids), split
+				//in the middle of the largest axis by count instead.
+				int axis = 0;
+				for (int a = 1; a < 3; a++)
+					if (cbounds.mx[a] - cbounds.mn[a] > cbounds.mx[axis] - cbounds.mn[axis]) axis = a;
+				mid = r.begin + n / 2;
+				const std::vector<float>& cen = m_centroids;
+				std::nth_element(m_indices.begin() + r.begin, m_indices.begin() + mid, m_indices.begin() + r.end,
+					[&](unsigned int x, unsigned int y){ return cen[3 * x + axis] < cen[3 * y + axis]; });
+				return true;
+			}
+
+			float cmin = cbounds.mn[bestAxis], s = scale[bestAxis];
+			std::vector<unsigned int>::iterator it = std::partition(
+				m_indices.begin() + r.begin, m_indices.begin() + r.end,
+				[&](unsigned int tri){ return binOf(tri, bestAxis, cmin, s) < bestPlane; });
+			mid = (unsigned int)(it - m_indices.begin());
+			return mid != r.begin && mid != r.end;
+		}
+
+		std::vector<unsigned int>& m_indices;
+		int m_maxLeafSize;
+	};
+
+	///////////////////////////////////////////////////////////////////////////
+	// SIMD wrappers used by the packet tracer. The packet width is fixed at
+	// compile time: 8 lanes with AVX, 4 with SSE2, 1 otherwise.
+	///////////////////////////////////////////////////////////////////////////
+	struct SimdScalar
+	{
+		enum { W = 1 };
+		typedef float F;
+		typedef bool  M;
+		static F set1(float a) { return a; }
+		static F load(const float* p) { return *p; }
+		static void store(float* p, F a) { *p = a; }
+		static F add(F a, F b) { return a + b; }
+		static F sub(F a, F b) { return a - b; }
+		static F mul(F a, F b) { return a * b; }
+		static F div(F a, F b) { return a / b; }
+		static F min(F a, F b) { return a < b ? a : b; }
+		static F max(F a, F b) { return a > b ? a : b; }
+		static F abs(F a) { return fabsf(a); }
+		static M lt(F a, F b) { return a < b; }
+		static M le(F a, F b) { return a <= b; }
+		static M gt(F a, F b) { return a > b; }
+		static M ge(F a, F b) { return a >= b; }
+		static M mand(M a, M b) { return a && b; }
+		static int mask(M a) { return a ? 1 : 0; }
+		static F select(M m, F a, F b) { return m ? a : b; }
+	};
+
+#if defined(GLBVH_AVX)
+	struct SimdAVX
+	{
+		enum { W = 8 };
+		typedef __m256 F;
+		typedef __m256 M;
+		static F set1(float a) { return _mm256_set1_ps(a); }
+		static F load(const float* p) { return _mm256_loadu_ps(p); }
+		static void store(float* p, F a) { _mm256_storeu_ps(p, a); }
+		static F add(F a, F b) { return _mm256_add_ps(a, b); }
+		static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+		static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+		static F div(F a, F b) { return _mm256_div_ps(a, b); }
+		static F min(F a, F b) { return _mm256_min_ps(a, b); }
+		static F max(F a, F b) { return _mm256_max_ps(a, b); }
+		static F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+		static M lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static M le(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+		static M gt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		static M ge(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+		static M mand(M a, M b) { return _mm256_and_ps(a, b); }
+		static int mask(M a) { return _mm256_movemask_ps(a); }
+		static F select(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); }
+	};
+	typedef SimdAVX SimdPacket;
+#elif defined(GLBVH_SSE)
+	struct SimdSSE
+	{
+		enum { W = 4 };
+		typedef __m128 F;
+		typedef __m128 M;
+		static F set1(float a) { return _mm_set1_ps(a); }
+		static F load(const float* p) { return _mm_loadu_ps(p); }
+		static void store(float* p, F a) { _mm_storeu_ps(p, a); }
+		static F add(F a, F b) { return _mm_add_ps(a, b); }
+		static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+		static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+		static F div(F a, F b) { return _mm_div_ps(a, b); }
+		static F min(F a, F b) { return _mm_min_ps(a, b); }
+		static F max(F a, F b) { return _mm_max_ps(a, b); }
+		static F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+		static M lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+		static M le(F a, F b) { return _mm_cmple_ps(a, b); }
+		static M gt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+		static M ge(F a, F b) { return _mm_cmpge_ps(a, b); }
+		static M mand(M a, M b) { return _mm_and_ps(a, b); }
+		static int mask(M a) { return _mm_movemask_ps(a); }
+		static F select(M m, F a, F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+	};
+	typedef SimdSSE SimdPacket;
+#else
+	typedef SimdScalar SimdPacket;
+#endif
+
+	//Traces up to S::W rays together. A node is visited if any ray of the
+	//packet hits its box before that ray's current closest hit.
+	template<class S>
+	void tracePacket(const GLBVHNode* nodes, const float* tris, const unsigned int* triIds,
+					 const GLRay* rays, int count, GLRayHit* hits)
+	{
+		typedef typename S::F F;
+		typedef typename S::M M;
+		float o[3][S::W], d[3][S::W], id[3][S::W], t0[S::W], t1[S::W];
+		for (int l = 0; l < S::W; l++)
+		{
+			bool valid = l < count;
+			for (int a = 0; a < 3; a++)
+			{
+				o[a][l] = valid ? rays[l].origin[a] : 0.0f;
+				d[a][l] = valid ? rays[l].direction[a] : 1.0f;
+				//avoid 0*inf=NaN in the slab test for axis parallel rays.
+				float da = fabsf(d[a][l]) < 1e-20f ? (d[a][l] < 0.0f ? -1e-20f : 1e-20f) : d[a][l];
+				id[a][l] = 1.0f / da;
+			}
+			t0[l] = valid ? rays[l].tMin : 0.0f;
+			t1[l] = valid ? rays[l].tMax : -1.0f;//padding lanes never hit.
+		}
+		F O[3], D[3], ID[3];
+		for (int a = 0; a < 3; a++)
+		{
+			O[a] = S::load(o[a]);
+			D[a] = S::load(d[a]);
+			ID[a] = S::load(id[a]);
+		}
+		F tmin = S::load(t0), tmax = S::load(t1);
+		F U = S::set1(0.0f), V = S::set1(0.0f);
+		int triHit[S::W];
+		for (int l = 0; l < S::W; l++)
+			triHit[l] = -1;
+
+		const F zero = S::set1(0.0f), one = S::set1(1.0f), eps = S::set1(1e-12f);
+		unsigned int stack[g_maxDepth + 2];
+		int sp = 0;
+		stack[sp++] = 0;
+		while (sp > 0)
+		{
+			const GLBVHNode& node = nodes[stack[--sp]];
+			F tn = tmin, tf = tmax;
+			for (int a = 0; a < 3; a++)
+			{
+				F ta = S::mul(S::sub(S::set1(node.bmin[a]), O[a]), ID[a]);
+				F tb = S::mul(S::sub(S::set1(node.bmax[a]), O[a]), ID[a]);
+				tn = S::max(tn, S::min(ta, tb));
+				tf = S::min(tf, S::max(ta, tb));
+			}
+			if (!S::mask(S::le(tn, tf)))
+				continue;
+
+			if (!node.isLeaf())
+			{//visit the child closer to the first ray's origin first.
+				const GLBVHNode& l = nodes[node.leftFirst];
+				const GLBVHNode& r = nodes[node.leftFirst + 1];
+				float dist = 0.0f;
+				for (int a = 0; a < 3; a++)
+					dist += (l.bmin[a] + l.bmax[a] - r.bmin[a] - r.bmax[a]) * d[a][0];
+				if (dist > 0.0f)
+				{
+					stack[sp++] = node.leftFirst;
+					stack[sp++] = node.leftFirst + 1;
+				}
+				else
+				{
+					stack[sp++] = node.leftFirst + 1;
+					stack[sp++] = node.leftFirst;
+				}
+				continue;
+			}
+
+			for (unsigned int i = node.leftFirst; i < node.leftFirst + node.count; i++)
+			{//Moller-Trumbore against every ray of the packet.
+				const float* tri = tris + 9 * i;
+				F e1x = S::set1(tri[3]), e1y = S::set1(tri[4]), e1z = S::set1(tri[5]);
+				F e2x = S::set1(tri[6]), e2y = S::set1(tri[7]), e2z = S::set1(tri[8]);
+				F px = S::sub(S::mul(D[1], e2z), S::mul(D[2], e2y));
+				F py = S::sub(S::mul(D[2], e2x), S::mul(D[0], e2z));
+				F pz = S::sub(S::mul(D[0], e2y), S::mul(D[1], e2x));
+				F det = S::add(S::add(S::mul(e1x, px), S::mul(e1y, py)), S::mul(e1z, pz));
+				F invDet = S::div(one, det);
+				F tx = S::sub(O[0], S::set1(tri[0]));
+				F ty = S::sub(O[1], S::set1(tri[1]));
+				F tz = S::sub(O[2], S::set1(tri[2]));
+				F u = S::mul(S::add(S::add(S::mul(tx, px), S::mul(ty, py)), S::mul(tz, pz)), invDet);
+				F qx = S::sub(S::mul(ty, e1z), S::mul(tz, e1y));
+				F qy = S::sub(S::mul(tz, e1x), S::mul(tx, e1z));
+				F qz = S::sub(S::mul(tx, e1y), S::mul(ty, e1x));
+				F v = S::mul(S::add(S::add(S::mul(D[0], qx), S::mul(D[1], qy)), S::mul(D[2], qz)), invDet);
+				F t = S::mul(S::add(S::add(S::mul(e2x, qx), S::mul(e2y, qy)), S::mul(e2z, qz)), invDet);
+				M hit = S::mand(S::gt(S::abs(det), eps), S::mand(S::ge(u, zero), S::ge(v, zero)));
+				hit = S::mand(hit, S::mand(S::le(S::add(u, v), one), S::mand(S::ge(t, tmin), S::lt(t, tmax))));
+				int bits = S::mask(hit);
+				if (!bits) continue;
+				tmax = S::select(hit, t, tmax);
+				U = S::select(hit, u, U);
+				V = S::select(hit, v, V);
+				for (int l = 0; l < S::W; l++)
+					if (bits & (1 << l)) triHit[l] = (int)triIds[i];
+			}
+		}
+
+		float ts[S::W], us[S::W], vs[S::W];
+		S::store(ts, tmax);
+		S::store(us, U);
+		S::store(vs, V);
+		for (int l = 0; l < count; l++)
+		{
+			hits[l].triangle = triHit[l];
+			if (triHit[l] >= 0)
+			{
+				hits[l].t = ts[l];
+				hits[l].u = us[l];
+				hits[l].v = vs[l];
+			}
+			else
+			{
+				hits[l] = GLRayHit();
+			}
+		}
+	}
+
+	//Closest points of up to S::W query points. A node is visited if it is
+	//closer to any point of the packet than that point's best candidate.
+	//Per triangle the best of the plane projection(when it falls inside)
+	//and the closest points on the three edges is kept, which avoids the
+	//branchy region tests of the scalar Voronoi region method.
+	template<class S>
+	void closestPacket(const GLBVHNode* nodes, const float* tris, const unsigned int* triIds,
+					   const vec3f* points, int count, float maxDist2, GLClosestPoint* results)
+	{
+		typedef typename S::F F;
+		typedef typename S::M M;
+		float p[3][S::W], b0[S::W];
+		for (int l = 0; l < S::W; l++)
+		{
+			for (int a = 0; a < 3; a++)
+				p[a][l] = l < count ? points[l][a] : 0.0f;
+			b0[l] = l < count ? maxDist2 : -1.0f;//padding lanes never visit.
+		}
+		F P[3] = { S::load(p[0]), S::load(p[1]), S::load(p[2]) };
+		F best = S::load(b0);
+		F U = S::set1(0.0f), V = S::set1(0.0f);
+		int triHit[S::W];
+		for (int l = 0; l < S::W; l++)
+			triHit[l] = -1;
+
+		const F zero = S::set1(0.0f), one = S::set1(1.0f), two = S::set1(2.0f);
+		const float nan = std::numeric_limits<float>::quiet_NaN();
+		unsigned int stack[g_maxDepth + 2];
+		int sp = 0;
+		stack[sp++] = 0;
+		while (sp > 0)
+		{
+			const GLBVHNode& node = nodes[stack[--sp]];
+			F d2 = zero;
+			for (int a = 0; a < 3; a++)
+			{
+				F da = S::max(S::max(S::sub(S::set1(node.bmin[a]), P[a]),
+									 S::sub(P[a], S::set1(node.bmax[a]))), zero);
+				d2 = S::add(d2, S::mul(da, da));
+			}
+			if (!S::mask(S::lt(d2, best)))
+				continue;
+
+			if (!node.isLeaf())
+			{//visit the child whose center is closer to the first point first.
+				const GLBVHNode& l = nodes[node.leftFirst];
+				const GLBVHNode& r = nodes[node.leftFirst + 1];
+				float dl = 0.0f, dr = 0.0f;
+				for (int a = 0; a < 3; a++)
+				{
+					float cl = 0.5f*(l.bmin[a] + l.bmax[a]) - p[a][0];
+					float cr = 0.5f*(r.bmin[a] + r.bmax[a]) - p[a][0];
+					dl += cl*cl;
+					dr += cr*cr;
+				}
+				if (dl > dr)
+				{
+					stack[sp++] = node.leftFirst;
+					stack[sp++] = node.leftFirst + 1;
+				}
+				else
+				{
+					stack[sp++] = node.leftFirst + 1;
+					stack[sp++] = node.leftFirst;
+				}
+				continue;
+			}
+
+			for (unsigned int i = node.leftFirst; i < node.leftFirst + node.count; i++)
+			{
+				const float* tri = tris + 9 * i;
+				const float* e1 = tri + 3;
+				const float* e2 = tri + 6;
+				float d11 = e1[0]*e1[0] + e1[1]*e1[1] + e1[2]*e1[2];
+				float d12 = e1[0]*e2[0] + e1[1]*e2[1] + e1[2]*e2[2];
+				float d22 = e2[0]*e2[0] + e2[1]*e2[1] + e2[2]*e2[2];
+				float d33 = d11 - 2.0f*d12 + d22;//|v2-v1|^2
+				float n[3] = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+				float nn = n[0]*n[0] + n[1]*n[1] + n[2]*n[2];
+				//|e1 x e2|^2 = d11*d22-d12^2. Slivers only get their edges tested,
+				//their plane projection is too inaccurate and the edges are
+				//within rounding of the face anyway.
+				bool hasFace = nn > 1e-7f * d11 * d22;
+				F invDenom = S::set1(hasFace ? 1.0f / nn : nan);
+				F invNN  = S::set1(hasFace ? 1.0f / nn : 0.0f);
+				F inv11 = S::set1(d11 > 0.0f ? 1.0f / d11 : 0.0f);
+				F inv22 = S::set1(d22 > 0.0f ? 1.0f / d22 : 0.0f);
+				F inv33 = S::set1(d33 > 0.0f ? 1.0f / d33 : 0.0f);
+				F D11 = S::set1(d11), D12 = S::set1(d12), D22 = S::set1(d22), D33 = S::set1(d33);
+
+				F wx = S::sub(P[0], S::set1(tri[0]));
+				F wy = S::sub(P[1], S::set1(tri[1]));
+				F wz = S::sub(P[2], S::set1(tri[2]));
+				F ww = S::add(S::add(S::mul(wx, wx), S::mul(wy, wy)), S::mul(wz, wz));
+				F b1 = S::add(S::add(S::mul(wx, S::set1(e1[0])), S::mul(wy, S::set1(e1[1]))), S::mul(wz, S::set1(e1[2])));
+				F b2 = S::add(S::add(S::mul(wx, S::set1(e2[0])), S::mul(wy, S::set1(e2[1]))), S::mul(wz, S::set1(e2[2])));
+				F wn = S::add(S::add(S::mul(wx, S::set1(n[0])), S::mul(wy, S::set1(n[1]))), S::mul(wz, S::set1(n[2])));
+
+				//projection onto the plane.
+				F s = S::mul(S::sub(S::mul(D22, b1), S::mul(D12, b2)), invDenom);
+				F t = S::mul(S::sub(S::mul(D11, b2), S::mul(D12, b1)), invDenom);
+				M inside = S::mand(S::mand(S::ge(s, zero), S::ge(t, zero)), S::le(S::add(s, t), one));
+				F dFace = S::mul(S::mul(wn, wn), invNN);
+
+				//edge v0v1: |w-t0*e1|^2 = ww + t0*(t0*d11 - 2*b1)
+				F t0 = S::min(S::max(S::mul(b1, inv11), zero), one);
+				F dE0 = S::add(ww, S::mul(t0, S::sub(S::mul(t0, D11), S::mul(two, b1))));
+				//edge v0v2
+				F t2 = S::min(S::max(S::mul(b2, inv22), zero), one);
+				F dE2 = S::add(ww, S::mul(t2, S::sub(S::mul(t2, D22), S::mul(two, b2))));
+				//edge v1v2 with w1=w-e1: w1.(e2-e1) = b2-b1-d12+d11, |w1|^2 = ww-2*b1+d11
+				F b3 = S::add(S::sub(S::sub(b2, b1), D12), D11);
+				F ww1 = S::add(S::sub(ww, S::mul(two, b1)), D11);
+				F t1 = S::min(S::max(S::mul(b3, inv33), zero), one);
+				F dE1 = S::add(ww1, S::mul(t1, S::sub(S::mul(t1, D33), S::mul(two, b3))));
+
+				F d = dE0, u = t0, v = zero;
+				M m = S::lt(dE2, d);
+				d = S::select(m, dE2, d); u = S::select(m, zero, u); v = S::select(m, t2, v);
+				m = S::lt(dE1, d);
+				d = S::select(m, dE1, d); u = S::select(m, S::sub(one, t1), u); v = S::select(m, t1, v);
+				d = S::select(inside, dFace, d); u = S::select(inside, s, u); v = S::select(inside, t, v);
+
+				M closer = S::lt(d, best);
+				int bits = S::mask(closer);
+				if (!bits) continue;
+				best = S::select(closer, d, best);
+				U = S::select(closer, u, U);
+				V = S::select(closer, v, V);
+				for (int l = 0; l < S::W; l++)
+					if (bits & (1 << l)) triHit[l] = (int)i;
+			}
+		}
+
+		float bs[S::W], us[S::W], vs[S::W];
+		S::store(bs, best);
+		S::store(us, U);
+		S::store(vs, V);
+		for (int l = 0; l < count; l++)
+		{
+			GLClosestPoint& r = results[l];
+			r = GLClosestPoint();
+			if (triHit[l] < 0) continue;
+			const float* tri = tris + 9 * triHit[l];
+			r.triangle = (int)triIds[triHit[l]];
+			r.distance = sqrtf(std::max(bs[l], 0.0f));
+			r.u = us[l];
+			r.v = vs[l];
+			r.point = vec3f(tri[0] + r.u*tri[3] + r.v*tri[6],
+							tri[1] + r.u*tri[4] + r.v*tri[7],
+							tri[2] + r.u*tri[5] + r.v*tri[8]);
+		}
+	}
+}
+
+GLTriangleBVH::GLTriangleBVH()
+	:m_depth(0)
+{
+}
+
+void GLTriangleBVH::clear()
+{
+	m_nodes.clear();
+	m_triIndices.clear();
+	m_triangles.clear();
+	m_depth = 0;
+}
+
+void GLTriangleBVH::build(const std::vector<vec3f>& vertexArrayUnique,
+						  const std::vector<vec3i>& triangleMesh,
+						  int maxLeafSize/*=4*/, int nThreads/*=0*/)
+{
+	clear();
+	unsigned int n = (unsigned int)triangleMesh.size();
+	if (n == 0) return;
+	nThreads = resolveThreadCount(nThreads);
+	maxLeafSize = std::max(1, std::min(maxLeafSize, g_maxLeafSize));
+
+	m_triIndices.resize(n);
+	Builder builder(m_triIndices, maxLeafSize);
+	builder.m_boxes.resize(n);
+	builder.m_centroids.resize(3 * n);
+	parallelFor(n, nThreads, [&](size_t b, size_t e)
+	{
+		for (size_t i = b; i < e; i++)
+		{
+			const vec3i& tri = triangleMesh[i];
+			Aabb& box = builder.m_boxes[i];
+			box.reset();
+			for (int k = 0; k < 3; k++)
+			{
+				const vec3f& p = vertexArrayUnique[tri[k]];
+				float pf[3] = { p.x(), p.y(), p.z() };
+				box.grow(pf);
+			}
+			for (int a = 0; a < 3; a++)
+				builder.m_centroids[3 * i + a] = 0.5f * (box.mn[a] + box.mx[a]);
+			m_triIndices[i] = (unsigned int)i;
+		}
+	});
+
+	m_nodes.reserve(2 * n);
+	m_nodes.resize(1);
+	BuildRange root = { 0, 0, n, 0 };
+
+	//Split the top levels here, with threaded binning for the big nodes,
+	//until there are enough independent subtrees to keep every thread busy.
+	std::vector<BuildRange> tasks, frontier(1, root);
+	while (!frontier.empty())
+	{
+		std::vector<BuildRange> next;
+		for (size_t i = 0; i < frontier.size(); i++)
+		{
+			const BuildRange& r = frontier[i];
+			m_depth = std::max(m_depth, r.depth);
+			if (nThreads == 1 || r.end - r.begin < g_minTaskSize ||
+				tasks.size() + next.size() + frontier.size() >= (size_t)nThreads * 4)
+			{
+				tasks.push_back(r);
+				continue;
+			}
+			BuildRange children[2];
+			if (builder.subdivide(m_nodes, r, children, nThreads))
+			{
+				next.push_back(children[0]);
+				next.push_back(children[1]);
+			}
+		}
+		frontier.swap(next);
+	}
+
+	//Each task builds its subtree into a private node array rooted at
+	//index 0, which is spliced into m_nodes afterwards.
+	std::vector<std::vector<GLBVHNode> > subtrees(tasks.size());
+	std::vector<int> depths(tasks.size(), 0);
+	std::atomic<size_t> nextTask(0);
+	auto worker = [&]()
+	{
+		for (size_t t = nextTask++; t < tasks.size(); t = nextTask++)
+		{
+			BuildRange local = tasks[t];
+			local.node = 0;
+			subtrees[t].resize(1);
+			subtrees[t].reserve(2 * (local.end - local.begin));
+			depths[t] = builder.buildSerial(subtrees[t], local);
+		}
+	};
+	std::vector<std::thread> threads;
+	for (int t = 1; t < std::min(nThreads, (int)tasks.size()); t++)
+		threads.push_back(std::thread(worker));
+	worker();
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+
+	for (size_t t = 0; t < tasks.size(); t++)
+	{
+		const std::vector<GLBVHNode>& sub = subtrees[t];
+		//local index k>=1 goes to base+k-1.
+		unsigned int base = (unsigned int)m_nodes.size();
+		for (size_t k = 0; k < sub.size(); k++)
+		{
+			GLBVHNode node = sub[k];
+			if (!node.isLeaf())
+				node.leftFirst += base - 1;
+			if (k == 0)
+				m_nodes[tasks[t].node] = node;
+			else
+				m_nodes.push_back(node);
+		}
+		m_depth = std::max(m_depth, depths[t]);
+	}
+
+	//Triangles in leaf order as v0,e1,e2 so leaves read contiguous memory.
+	m_triangles.resize(9 * (size_t)n);
+	parallelFor(n, nThreads, [&](size_t b, size_t e)
+	{
+		for (size_t i = b; i < e; i++)
+		{
+			const vec3i& tri = triangleMesh[m_triIndices[i]];
+			const vec3f& v0 = vertexArrayUnique[tri[0]];
+			vec3f e1 = vertexArrayUnique[tri[1]] - v0;
+			vec3f e2 = vertexArrayUnique[tri[2]] - v0;
+			float* dst = &m_triangles[9 * i];
+			for (int a = 0; a < 3; a++)
+			{
+				dst[a] = v0[a];
+				dst[3 + a] = e1[a];
+				dst[6 + a] = e2[a];
+			}
+		}
+	});
+}
+
+bool GLTriangleBVH::intersect(const GLRay& ray, GLRayHit& hit) const
+{
+	hit = GLRayHit();
+	if (m_nodes.empty()) return false;
+	tracePacket<SimdScalar>(m_nodes.data(), m_triangles.data(), m_triIndices.data(), &ray, 1, &hit);
+	return hit.isHit();
+}
+
+void GLTriangleBVH::intersect(const std::vector<GLRay>& rays, std::vector<GLRayHit>& hits, int nThreads/*=0*/) const
+{
+	hits.assign(rays.size(), GLRayHit());
+	if (m_nodes.empty() || rays.empty()) return;
+
+	const int W = SimdPacket::W;
+	size_t nPackets = (rays.size() + W - 1) / W;
+	nThreads = resolveThreadCount(nThreads);
+	nThreads = (int)std::min<size_t>(nThreads, std::max<size_t>(1, rays.size() / g_minRaysPerThread));
+	parallelFor(nPackets, nThreads, [&](size_t b, size_t e)
+	{
+		for (size_t p = b; p < e; p++)
+		{
+			size_t first = p * W;
+			int count = (int)std::min<size_t>(W, rays.size() - first);
+			tracePacket<SimdPacket>(m_nodes.data(), m_triangles.data(), m_triIndices.data(),
+									&rays[first], count, &hits[first]);
+		}
+	});
+}
+
+bool GLTriangleBVH::closestPoint(const vec3f& p, GLClosestPoint& result, float maxDistance/*=1e30f*/) const
+{
+	result = GLClosestPoint();
+	if (m_nodes.empty()) return false;
+	closestPacket<SimdScalar>(m_nodes.data(), m_triangles.data(), m_triIndices.data(),
+							  &p, 1, maxDistance*maxDistance, &result);
+	return result.isValid();
+}
+
+void GLTriangleBVH::closestPoints(const std::vector<vec3f>& points, std::vector<GLClosestPoint>& results,
+								  float maxDistance/*=1e30f*/, int nThreads/*=0*/) const
+{
+	results.assign(points.size(), GLClosestPoint());
+	if (m_nodes.empty() || points.empty()) return;
+
+	const int W = SimdPacket::W;
+	size_t nPackets = (points.size() + W - 1) / W;
+	nThreads = resolveThreadCount(nThreads);
+	nThreads = (int)std::min<size_t>(nThreads, std::max<size_t>(1, points.size() / g_minRaysPerThread));
+	float maxDist2 = maxDistance*maxDistance;
+	parallelFor(nPackets, nThreads, [&](size_t b, size_t e)
+	{
+		for (size_t p = b; p < e; p++)
+		{
+			size_t first = p * W;
+			int count = (int)std::min<size_t>(W, points.size() - first);
+			closestPacket<SimdPacket>(m_nodes.data(), m_triangles.data(), m_triIndices.data(),
+									  &points[first], count, maxDist2, &results[first]);
+		}
+	});
+}
+
+GLRay GLTriangleBVH::createPickRay(const mat4& viewProj, float ndcX, float ndcY)
+{
+	mat4 inv = viewProj;
+	inv.inverse();
+	vec4f pn = inv * vec4f(ndcX, ndcY, -1.0f, 1.0f);
+	vec4f pf = inv * vec4f(ndcX, ndcY, 1.0f, 1.0f);
+	vec3f nearPt = pn.xyz() / pn.w();
+	vec3f farPt = pf.xyz() / pf.w();
+	return GLRay(nearPt, farPt - nearPt, 0.0f, 1.0f);
+}
+
+GLRay GLTriangleBVH::createPickRay(const GLCamera& camera, int x, int y, int width, int height)
+{
+	float ndcX = 2.0f * (x + 0.5f) / width - 1.0f;
+	float ndcY = 1.0f - 2.0f * (y + 0.5f) / height;
+	return createPickRay(camera.getProjectionMatrix() * camera.getViewingMatrix(), ndcX, ndcY);
+}
+
+BBox GLTriangleBVH::getBounds() const
+{
+	if (m_nodes.empty()) return BBox();
+	const GLBVHNode& root = m_nodes[0];
+	return BBox(vec3f(root.bmin), vec3f(root.bmax));
+}
+
+int GLTriangleBVH::getPacketWidth()
+{
+	return SimdPacket::W;
+}
+
+}
@@ -21,3 +21,172 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include "GLTriangleCleaner.h"
+#include "GLParallel.h"
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+namespace davinci{
+
+namespace{
+	typedef unsigned long long Key;
+
+	//Rotates the smallest index to the front, which keeps the winding, or
+	//sorts the indices when winding does not matter.
+	vec3i canonicalTriangle(const vec3i& t, bool ignoreWinding)
+	{
+		int a = t[0], b = t[1], c = t[2];
+		if (ignoreWinding)
+		{
+			if (a > b) std::swap(a, b);
+			if (b > c) std::swap(b, c);
+			if (a > b) std::swap(a, b);
+			return vec3i(a, b, c);
+		}
+		//lexicographically smallest rotation, so repeated indices tie-break too.
+		vec3i r(a, b, c);
+		if (b < r[0] || (b == r[0] && vec3i(b, c, a) < r)) r = vec3i(b, c, a);
+		if (c < r[0] || (c == r[0] && vec3i(c, a, b) < r)) r = vec3i(c, a, b);
+		return r;
+	}
+
+	bool isDegenerate(const vec3i& t)
+	{
+		return t[0] == t[1] || t[1] == t[2] || t[0] == t[2];
+	}
+
+	Key mixKey(Key x)
+	{
+		x ^= x >> 31; x *= 0x7fb5d329728ea185ULL;
+		x ^= x >> 27; x *= 0x81dadef4bc2dd44dULL;
+		x ^= x >> 33;
+		return x;
+	}
+}
+
+size_t removeDuplicateTriangles(std::vector<vec3i> &triangleMesh, std::vector<int>* remap,
+	unsigned flags/*=TRIANGLE_DEDUP_DEFAULT*/, int nThreads/*=0*/)
+{
+	nThreads = resolveThreadCount(nThreads);
+	bool ignoreWinding = (flags & TRIANGLE_DEDUP_IGNORE_WINDING) != 0;
+	bool removeDegenerate = (flags & TRIANGLE_DEDUP_REMOVE_DEGENERATE) != 0;
+	size_t n = triangleMesh.size();
+	size_t nBlocks = std::max<size_t>(1, std::min<size_t>(4 * nThreads, n / 65536));
+
+	//1. canonical triangles and the widest vertex index.
+	std::vector<vec3i> canonical(n);
+	std::vector<int> blockMax(nBlocks, 0);
+	parallelBlocks(n, nBlocks, nThreads, [&](size_t b, size_t begin, size_t end)
+	{
+		int m = 0;
+		for (size_t i = begin; i < end; i++)
+		{
+			canonical[i] = canonicalTriangle(triangleMesh[i], ignoreWinding);
+			m = std::max(m, std::max(canonical[i][0], std::max(canonical[i][1], canonical[i][2])));
+		}
+		blockMax[b] = m;
+	});
+	int bits = 1;
+	int maxIndex = *std::max_element(blockMax.begin(), blockMax.end());
+	while (bits < 31 && (1 << bits) <= maxIndex) bits++;
+	//up to 2^21 vertices the triple itself is the sort key, beyond that a
+	//64 bit hash of it is sorted and equal hashes are told apart afterwards.
+	bool exactKey = 3 * bits <= 64;
+
+	std::vector<Key> keys(n);
+	std::vector<unsigned> order(n);
+	parallelBlocks(n, nBlocks, nThreads, [&](size_t, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			const vec3i& t = canonical[i];
+			Key k = ((Key)(unsigned)t[0] << (2 * bits)) | ((Key)(unsigned)t[1] << bits) | (Key)(unsigned)t[2];
+			if (!exactKey)
+				k = mixKey(mixKey(mixKey((Key)(unsigned)t[0]) ^ (Key)(unsigned)t[1]) ^ (Key)(unsigned)t[2]);
+			keys[i] = k;
+			order[i] = (unsigned)i;
+		}
+	});
+	radixSortPairs(keys, order, exactKey ? 3 * bits : 64, nThreads);
+
+	//2. every triangle points at the first occurrence of its canonical form.
+	//The sort is stable, so the first entry of a run of equal keys is it.
+	std::vector<unsigned> representative(n);
+	parallelBlocks(n, nBlocks, nThreads, [&](size_t, size_t begin, size_t end)
+	{
+		size_t i = begin;
+		//runs are owned by the block they start in.
+		while (i < end && i != 0 && keys[i] == keys[i - 1]) i++;
+		while (i < end)
+		{
+			size_t runEnd = i + 1;
+			while (runEnd < n && keys[runEnd] == keys[i]) runEnd++;
+			if (!exactKey && runEnd - i > 1)
+			{
+				std::sort(order.begin() + i, order.begin() + runEnd, [&](unsigned a, unsigned b)
+				{
+					const vec3i& ta = canonical[a];
+					const vec3i& tb = canonical[b];
+					if (ta[0] != tb[0]) return ta[0] < tb[0];
+					if (ta[1] != tb[1]) return ta[1] < tb[1];
+					if (ta[2] != tb[2]) return ta[2] < tb[2];
+					return a < b;
+				});
+			}
+			unsigned first = order[i];
+			for (size_t j = i; j < runEnd; j++)
+			{
+				if (canonical[order[j]] != canonical[first])
+					first = order[j];
+				representative[order[j]] = first;
+			}
+			i = runEnd;
+		}
+	});
+	std::vector<Key>().swap(keys);
+	std::vector<unsigned>().swap(order);
+	std::vector<vec3i>().swap(canonical);
+
+	//3. compact survivors in place, in their original order.
+	auto survives = [&](size_t i)
+	{
+		return representative[i] == i && !(removeDegenerate && isDegenerate(triangleMesh[i]));
+	};
+	std::vector<size_t> blockOffset(nBlocks + 1, 0);
+	parallelBlocks(n, nBlocks, nThreads, [&](size_t b, size_t begin, size_t end)
+	{
+		size_t c = 0;
+		for (size_t i = begin; i < end; i++)
+			c += survives(i);
+		blockOffset[b + 1] = c;
+	});
+	for (size_t b = 0; b < nBlocks; b++)
+		blockOffset[b + 1] += blockOffset[b];
+	size_t nKept = blockOffset[nBlocks];
+
+	std::vector<int> newIndex(n, -1);
+	std::vector<vec3i> kept(nKept);
+	parallelBlocks(n, nBlocks, nThreads, [&](size_t b, size_t begin, size_t end)
+	{
+		size_t dst = blockOffset[b];
+		for (size_t i = begin; i < end; i++)
+		{
+			if (!survives(i)) continue;
+			newIndex[i] = (int)dst;
+			kept[dst++] = triangleMesh[i];
+		}
+	});
+	if (remap)
+	{
+		remap->resize(n);
+		parallelBlocks(n, nBlocks, nThreads, [&](size_t, size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				(*remap)[i] = newIndex[representative[i]];
+		});
+	}
+	triangleMesh.swap(kept);
+	return n - nKept;
+}
+
+}
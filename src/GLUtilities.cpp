@@ -32,6 +32,9 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 //#include "GLFont.h"
 #include "GLError.h"
 #include "GLContext.h"
+#include "GLSupersampler.h"
+#include "GLRenderTargetPool.h"
+#include "GLFrameCapture.h"
 
 using namespace davinci;
 
@@ -401,51 +404,69 @@ QImage GLUtilities::grabFrameBuffer( int x, int y, int width, int height,
 }
 #endif
 
-//http://en.wikibooks.org/wiki/OpenGL_Programming/Supersampling
-//
+//Jittered sub-frames are accumulated by GLSupersampler in float render
+//targets and the average is blitted into the framebuffer bound on entry,
+//replacing the legacy glAccum buffer.
+static GLSupersamplerRef g_supersampler;
+
 void GLUtilities::glSupersampling(drawCallBack renderCallBack, void* param, int qualityLevel/*=1*/)
 {
-	//Prepare accumulate buffer for oversampling.
 	vec4i viewport;
 	GLUtilities::glGetViewPort(viewport);
-	float w = (float)viewport[2];
-	float h = (float)viewport[3];
-	GLContext::glMatrixMode(GLContext::GL_ProjectionMatrix);
-	GLContext::glPushMatrix();
-	mat4 oldPjM = GLContext::g_PjM;
-	int nLoop = 1;
-	int kernelWidth = qualityLevel;
-	//Prepare accumulate buffer for oversampling.
-	switch(qualityLevel) 
+	GLint targetFbo = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFbo);
+	if (qualityLevel < 1 || qualityLevel > 8) qualityLevel = 1;
+	int nLoop = qualityLevel * qualityLevel;
+	if (nLoop == 1)
 	{
-		case 1: nLoop = 1; break;
-		case 2: nLoop = 4; break;
-		case 3: nLoop = 9; break;
-		case 4: nLoop = 16; break;
-		case 5: nLoop = 25; break;
-		case 6: nLoop = 36; break;
-		case 7: nLoop = 49; break;
-		case 8: nLoop = 64; break;
-		default:nLoop = 1;
-	}
-	float weight = 1.0f/float(nLoop);
-	for(int i = 0; i < nLoop; i++) {
-		davinci::vec3f shift = davinci::vec3f((i % kernelWidth) * 0.5 / w, (i / kernelWidth) * 0.5 / h, 0);
-		mat4 aa;
-		aa.identity();
-		aa.translate(shift);
-		davinci::GLContext::g_PjM = aa * oldPjM;
-		//=================================================================================
 		renderCallBack(param);
-		//*********************************************************************************
-		glAccum(i ? GL_ACCUM : GL_LOAD, weight);
+		return;
 	}
-
-	glAccum(GL_RETURN, 1);
-	GLContext::glPopMatrix();
+	if (!g_supersampler)
+	{
+		g_supersampler = GLSupersamplerRef(new GLSupersampler());
+	}
+	g_supersampler->resize(viewport[2], viewport[3]);
+	g_supersampler->reset();
+	g_supersampler->accumulate(renderCallBack, param, nLoop);
+	g_supersampler->resolve();
+	g_supersampler->present((GLuint)targetFbo, viewport[0], viewport[1]);
 	GLError::glCheckError(string(__func__)+" End supersmmpling().");
 }
 
+static GLFrameCaptureRef g_frameCapture;
+
+bool GLUtilities::grabFrameBufferAsync(int x, int y, int width, int height,
+				const std::string& fileName, GLenum whichBuffer/*=GL_BACK*/)
+{
+	if (!g_frameCapture)
+	{
+		g_frameCapture = GLFrameCaptureRef(new GLFrameCapture());
+	}
+	return g_frameCapture->capture(x, y, width, height, fileName,
+								   GLFrameCapture::FORMAT_PNG, false, whichBuffer);
+}
+
+void GLUtilities::pollFrameBufferAsync()
+{
+	if (g_frameCapture)
+		g_frameCapture->poll();
+}
+
+void GLUtilities::flushFrameBufferAsync()
+{
+	if (g_frameCapture)
+		g_frameCapture->flush();
+}
+
+//Release GL resources held by the utilities while the context is current.
+void GLUtilities::freeResource()
+{
+	g_supersampler.reset();
+	g_frameCapture.reset();//flushes pending captures first.
+	GLRenderTargetPool::releaseDefault();
+}
+
 void GLUtilities::glGetViewPort( vec4i& viewport )
 { 
 	glGetIntegerv(GL_VIEWPORT, &viewport[0]);
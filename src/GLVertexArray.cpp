@@ -21,8 +21,10 @@ OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include <iostream>
+#include <algorithm>
 #include <GL/glew.h>
 #include "GLVertexArray.h"
+#include "GLIndexBufferObject.h"
 
 namespace davinci{
 
@@ -35,6 +37,7 @@ GLVertexArrayObject::GLVertexArrayObject(GLenum geotype,std::shared_ptr<GLenum>
 		  m_colorOffsetInBytes(0), m_normalType(0), m_normalOffsetInBytes(0),
 		  m_attribsSizeInBytes(0), m_enableWarning(warning)
 		,m_GLVersion(3.3f),m_enabled(false)
+		,m_immutable(false), m_immutableVertexCount(0), m_immutableIndexCount(0)
 {
 
 	GLint maxTexImgUnits;
@@ -79,6 +82,8 @@ void davinci::GLVertexArrayObject::setShaderProgId( GLuint progId )
 
 void GLVertexArrayObject::enable()
 {
+	if (m_immutable) return;//layout is already baked into the VAO.
+
 	glBindVertexArray(*m_arrayId);
 	GLError::glCheckError("GLVertexArrayObject::enable(): glBindVertexBuffer() failed.");
 	if (m_vboDefault)// && m_GLVersion>4.4)
@@ -112,6 +117,11 @@ void GLVertexArrayObject::enable()
 
 void GLVertexArrayObject::disable()
 {
+	if (m_immutable)
+	{
+		disableImmutable();
+		return;
+	}
 	glBindVertexArray(*m_arrayId);
 	if (m_vboDefault)// && m_GLVersion>4.4)
 	{
@@ -303,6 +313,13 @@ void GLVertexArrayObject::disableGLClientState()
 
 void GLVertexArrayObject::draw(GLuint first/*=0*/, size_t count/*=0*/)
 {
+	if (m_immutable)
+	{
+		glBindVertexArray(*m_arrayId);
+		glDrawArrays(m_geotype, first, count ? count : m_immutableVertexCount);
+		glBindVertexArray(0);
+		return;
+	}
 	checkEnable(count);
 
 	glBindVertexArray(*m_arrayId);
@@ -316,6 +333,13 @@ void GLVertexArrayObject::draw(GLuint first/*=0*/, size_t count/*=0*/)
 
 void GLVertexArrayObject::drawInstanced(size_t primcount, GLuint first/*=0*/, size_t count/*=0*/)
 {
+	if (m_immutable)
+	{
+		glBindVertexArray(*m_arrayId);
+		glDrawArraysInstanced(m_geotype, first, count ? count : m_immutableVertexCount, primcount);
+		glBindVertexArray(0);
+		return;
+	}
 	checkEnable(count);
 	glBindVertexArray(*m_arrayId);
 	GLError::glCheckError("GLVertexArrayObject::drawInstanced(): glBindVertexArray() failed!");
@@ -328,6 +352,14 @@ void GLVertexArrayObject::drawInstanced(size_t primcount, GLuint first/*=0*/, si
 
 void GLVertexArrayObject::drawInstancedBaseInstance(size_t primcount, size_t baseInst, GLuint first/*=0*/, size_t count/*=0*/)
 {
+	if (m_immutable)
+	{
+		glBindVertexArray(*m_arrayId);
+		glDrawArraysInstancedBaseInstance(m_geotype, first, count ? count : m_immutableVertexCount,
+										  primcount, baseInst);
+		glBindVertexArray(0);
+		return;
+	}
 	checkEnable(count);
 	glBindVertexArray(*m_arrayId);
 	GLError::glCheckError("GLVertexArrayObject::drawInstancedBaseInstance(): glBindVertexArray() failed!");
@@ -436,6 +468,10 @@ void GLVertexArrayObject::addAttribute(
 
 void GLVertexArrayObject::addAttribute( const GLAttributeRef attrib )
 {
+	if (m_immutable)
+	{
+		GLError::ErrorMessage(string(__func__)+": the VAO is immutable, call disable() before adding attributes.");
+	}
 	GLenum type = attrib->getType();
 	if ( g_GLTypeSizeInBytes.find(type)==g_GLTypeSizeInBytes.end())
 	{
@@ -461,6 +497,19 @@ GLAttributeRef GLVertexArrayObject::getAttribute( const std::string& name )
 		return GLAttributeRef((GLAttribute*)NULL);
 }
 
+void GLVertexArrayObject::retargetAttributes(const GLVertexBufferObjectRef& oldVbo,
+											 const GLVertexBufferObjectRef& newVbo)
+{
+	for (std::unordered_map<string, GLAttributeRef>::iterator it = m_attribs.begin();
+		 it != m_attribs.end() ; ++it)
+	{
+		if (it->second->getAttachedVBO() == oldVbo)
+			it->second->attach(newVbo);
+	}
+	if (m_vboDefault == oldVbo)
+		m_vboDefault = newVbo;
+}
+
 //TODO: deprecated
 GLuint GLVertexArrayObject::computeStride(){
 	stringstream ss;
@@ -549,6 +598,222 @@ void GLVertexArrayObject::checkEnable(size_t &count)
 	}
 }
 
+void GLVertexArrayObject::enableImmutable()
+{
+#if defined(__APPLE__) || defined(MACOSX)
+	//sorry, mac user don't have Direct State Access(GL 4.5).
+	GLError::ErrorMessage(string(__func__)+": Direct State Access requires OpenGL 4.5, which is not available on Mac OS.");
+#else
+	if (m_immutable)
+	{
+		disableImmutable();
+	}
+	bool hasTexture = false;
+	for (size_t i = 0; i < m_hasTextures.size(); i++)
+		hasTexture = hasTexture || m_hasTextures[i];
+
+	if (m_hasVertex || m_hasColor || m_hasNormal || hasTexture)
+	{
+		GLError::ErrorMessage(string(__func__)+": compatibility client states(vertex/color/normal/texture) cannot be baked, use addAttribute() instead.");
+	}
+	if (m_attribs.empty())
+	{
+		GLError::ErrorMessage(string(__func__)+": no attribute is added to the VAO.");
+	}
+	//A name returned by glGenVertexArrays() only becomes a vertex array
+	//object once it is bound, DSA calls on it before that are invalid.
+	glBindVertexArray(*m_arrayId);
+	glBindVertexArray(0);
+	GLError::purgePreviousGLError();
+
+	GLuint vao = *m_arrayId;
+	for (std::unordered_map<string, GLAttributeRef>::iterator it = m_attribs.begin();
+		 it != m_attribs.end() ; ++it)
+	{
+		GLAttributeRef attrib = it->second;
+		if (!attrib->isActive()) continue;
+
+		GLVertexBufferObjectRef vbo = attrib->getAttachedVBO();
+		GLint bindIdx = getImmutableBindingIndex(vbo);
+		if (bindIdx == -1)
+		{//first attribute sourced from this VBO.
+			bindIdx = (GLint)m_immutableBindings.size();
+			m_immutableBindings.push_back(vbo);
+			m_immutableStrides.push_back(attrib->getStride());
+			m_immutableDivisors.push_back(attrib->getDivisor());
+		}
+		else if (m_immutableStrides[bindIdx] != (GLsizei)attrib->getStride() ||
+				 m_immutableDivisors[bindIdx] != attrib->getDivisor())
+		{//stride and divisor are states of the binding, not of the attribute.
+			std::stringstream ss;
+			ss << __func__ << ": attribute " << attrib->getName()
+			   << " shares its VBO with another attribute but differs in stride or divisor.";
+			GLError::ErrorMessage(ss.str());
+		}
+		m_immutableLocations.push_back(attrib->enableImmutable(vao, bindIdx));
+	}
+
+	for (size_t i = 0; i < m_immutableBindings.size(); i++)
+	{
+		glVertexArrayVertexBuffer(vao, i, m_immutableBindings[i]->getId(), 0, m_immutableStrides[i]);
+		glVertexArrayBindingDivisor(vao, i, m_immutableDivisors[i]);
+	}
+	GLError::glCheckError(__func__);
+
+	m_immutable = true;
+	m_enabled   = true;
+	updateImmutableVertexCount();
+#endif
+}
+
+void GLVertexArrayObject::disableImmutable()
+{
+#if !defined(__APPLE__) && !defined(MACOSX)
+	GLuint vao = *m_arrayId;
+	for (size_t i = 0; i < m_immutableLocations.size(); i++)
+	{
+		glDisableVertexArrayAttrib(vao, m_immutableLocations[i]);
+	}
+	for (size_t i = 0; i < m_immutableBindings.size(); i++)
+	{
+		glVertexArrayVertexBuffer(vao, i, 0, 0, 0);
+	}
+	glVertexArrayElementBuffer(vao, 0);
+	GLError::glCheckError(__func__);
+#endif
+	m_immutableBindings.clear();
+	m_immutableStrides.clear();
+	m_immutableDivisors.clear();
+	m_immutableLocations.clear();
+	m_immutableIBO.reset();
+	m_immutableVertexCount = 0;
+	m_immutableIndexCount  = 0;
+	m_immutable = false;
+	m_enabled   = false;
+}
+
+void GLVertexArrayObject::checkImmutable(const char* caller)
+{
+	if (!m_immutable)
+	{
+		GLError::ErrorMessage(string(caller)+": the VAO is not immutable, call enableImmutable() first.");
+	}
+}
+
+void GLVertexArrayObject::updateImmutableVertexCount()
+{
+	//Vertices available to a non-instanced draw are bounded by the
+	//smallest per-vertex(divisor 0) buffer.
+	m_immutableVertexCount = 0;
+	bool first = true;
+	for (size_t i = 0; i < m_immutableBindings.size(); i++)
+	{
+		if (m_immutableDivisors[i] != 0) continue;
+		size_t n = m_immutableBindings[i]->getVertexCount();
+		m_immutableVertexCount = first ? n : std::min(m_immutableVertexCount, n);
+		first = false;
+	}
+}
+
+GLint GLVertexArrayObject::getImmutableBindingIndex(const GLVertexBufferObjectRef& vbo) const
+{
+	for (size_t i = 0; i < m_immutableBindings.size(); i++)
+	{
+		if (m_immutableBindings[i] == vbo)
+			return (GLint)i;
+	}
+	return -1;
+}
+
+void GLVertexArrayObject::setVertexBuffer(GLuint bindingIndex, const GLVertexBufferObjectRef& vbo,
+										  GLintptr offset/*=0*/, GLsizei stride/*=0*/)
+{
+	checkImmutable(__func__);
+	if (bindingIndex >= m_immutableBindings.size() || !vbo)
+	{
+		std::stringstream ss;
+		ss << __func__ << ": invalid binding index " << bindingIndex << " or NULL VBO. The VAO has "
+		   << m_immutableBindings.size() << " binding(s).";
+		GLError::ErrorMessage(ss.str());
+	}
+#if !defined(__APPLE__) && !defined(MACOSX)
+	if (stride != 0)
+	{
+		m_immutableStrides[bindingIndex] = stride;
+	}
+	glVertexArrayVertexBuffer(*m_arrayId, bindingIndex, vbo->getId(), offset,
+							  m_immutableStrides[bindingIndex]);
+#endif
+	m_immutableBindings[bindingIndex] = vbo;
+	updateImmutableVertexCount();
+}
+
+void GLVertexArrayObject::setElementBuffer(const std::shared_ptr<GLIndexBufferObject>& ibo)
+{
+	checkImmutable(__func__);
+	//push pending CPU indices, if any, to the GPU.
+	ibo->upload();
+#if !defined(__APPLE__) && !defined(MACOSX)
+	glVertexArrayElementBuffer(*m_arrayId, ibo->getId());
+	GLError::glCheckError(__func__);
+#endif
+	m_immutableIBO = ibo;
+	m_immutableIndexCount = ibo->m_indexDataSize;
+}
+
+void GLVertexArrayObject::drawElements(size_t count/*=0*/, size_t firstIndex/*=0*/, GLint baseVertex/*=0*/)
+{
+	checkImmutable(__func__);
+	glBindVertexArray(*m_arrayId);
+	glDrawElementsBaseVertex(m_geotype, count ? count : m_immutableIndexCount, m_immutableIBO->getIndexType(),
+							 reinterpret_cast<const GLvoid*>(firstIndex*m_immutableIBO->getIndexSize()), baseVertex);
+	glBindVertexArray(0);
+}
+
+void GLVertexArrayObject::drawElementsInstanced(size_t primcount, size_t count/*=0*/, size_t firstIndex/*=0*/,
+												GLint baseVertex/*=0*/, GLuint baseInst/*=0*/)
+{
+	checkImmutable(__func__);
+	glBindVertexArray(*m_arrayId);
+	glDrawElementsInstancedBaseVertexBaseInstance(m_geotype, count ? count : m_immutableIndexCount, m_immutableIBO->getIndexType(),
+							 reinterpret_cast<const GLvoid*>(firstIndex*m_immutableIBO->getIndexSize()),
+							 primcount, baseVertex, baseInst);
+	glBindVertexArray(0);
+}
+
+void GLVertexArrayObject::multiDrawElementsIndirect(const GLBufferObject& indirect, GLsizei drawCount,
+													GLintptr offset/*=0*/, GLsizei stride/*=0*/)
+{
+	checkImmutable(__func__);
+#if !defined(__APPLE__) && !defined(MACOSX)
+	glBindVertexArray(*m_arrayId);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect.getId());
+	glMultiDrawElementsIndirect(m_geotype, m_immutableIBO->getIndexType(),
+								reinterpret_cast<const GLvoid*>(offset), drawCount, stride);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+#endif
+}
+
+void GLVertexArrayObject::multiDrawElementsIndirectCount(const GLBufferObject& indirect,
+														 const GLBufferObject& parameter,
+														 GLsizei maxDrawCount, GLintptr offset/*=0*/,
+														 GLintptr drawCountOffset/*=0*/, GLsizei stride/*=0*/)
+{
+	checkImmutable(__func__);
+#if !defined(__APPLE__) && !defined(MACOSX)
+	glBindVertexArray(*m_arrayId);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect.getId());
+	glBindBuffer(GL_PARAMETER_BUFFER_ARB, parameter.getId());
+	glMultiDrawElementsIndirectCountARB(m_geotype, m_immutableIBO->getIndexType(),
+										reinterpret_cast<const GLvoid*>(offset),
+										drawCountOffset, maxDrawCount, stride);
+	glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+#endif
+}
+
 GLint GLVertexArrayObject::g_maxAttrib = 0;
 
 }
@@ -0,0 +1,281 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <thread>
+#include <sstream>
+#include <atomic>
+#include <algorithm>
+#include "GLError.h"
+#include "GLVertexCacheOptimizer.h"
+#include "GLParallel.h"
+
+namespace davinci{
+
+namespace{
+	//below this many triangles the whole mesh is one slab.
+	const size_t g_minParallelTriangles = 1 << 17;
+
+	//Tipsify on indices referencing vertices [0,vertexCount), appends the
+	//reordered triangles to out.
+	void tipsify(const std::vector<GLuint>& indices, size_t vertexCount, int cacheSize,
+				 std::vector<GLuint>& out)
+	{
+		size_t nTriangles = indices.size() / 3;
+		std::vector<unsigned> offset(vertexCount + 1, 0);
+		for (size_t i = 0; i < 3 * nTriangles; i++)
+			offset[indices[i] + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			offset[v + 1] += offset[v];
+		std::vector<unsigned> adjacency(3 * nTriangles);
+		std::vector<int> live(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+			live[v] = (int)(offset[v + 1] - offset[v]);
+		{
+			std::vector<unsigned> fill(offset.begin(), offset.end() - 1);
+			for (size_t i = 0; i < 3 * nTriangles; i++)
+				adjacency[fill[indices[i]]++] = (unsigned)(i / 3);
+		}
+
+		std::vector<unsigned> cacheTime(vertexCount, 0);
+		std::vector<unsigned char> emitted(nTriangles, 0);
+		std::vector<GLuint> deadEnd, candidates;
+		unsigned time = cacheSize + 1;
+		size_t cursor = 0;
+		long fanning = vertexCount ? 0 : -1;
+		while (fanning >= 0)
+		{
+			candidates.clear();
+			for (unsigned j = offset[fanning]; j < offset[fanning + 1]; j++)
+			{
+				unsigned t = adjacency[j];
+				if (emitted[t]) continue;
+				emitted[t] = 1;
+				for (int k = 0; k < 3; k++)
+				{
+					GLuint v = indices[3 * t + k];
+					out.push_back(v);
+					deadEnd.push_back(v);
+					candidates.push_back(v);
+					live[v]--;
+					if (time - cacheTime[v] > (unsigned)cacheSize)
+						cacheTime[v] = time++;
+				}
+			}
+
+			//prefer the oldest candidate still in cache after fanning it.
+			long next = -1;
+			int best = -1;
+			for (size_t i = 0; i < candidates.size(); i++)
+			{
+				GLuint v = candidates[i];
+				if (live[v] <= 0) continue;
+				int priority = 0;
+				if (time - cacheTime[v] + 2 * live[v] <= (unsigned)cacheSize)
+					priority = (int)(time - cacheTime[v]);
+				if (priority > best)
+				{
+					best = priority;
+					next = v;
+				}
+			}
+			if (next < 0)
+			{
+				while (!deadEnd.empty() && next < 0)
+				{
+					GLuint v = deadEnd.back();
+					deadEnd.pop_back();
+					if (live[v] > 0) next = v;
+				}
+				while (next < 0 && cursor < vertexCount)
+				{
+					if (live[cursor] > 0) next = (long)cursor;
+					cursor++;
+				}
+			}
+			fanning = next;
+		}
+	}
+}
+
+void GLVertexCacheOptimizer::analyze(const std::vector<GLuint>& indices, size_t vertexCount,
+									 float& acmr, float& atvr, int cacheSize/*=16*/)
+{
+	std::vector<unsigned> cacheTime(vertexCount, 0);
+	std::vector<unsigned char> used(vertexCount, 0);
+	unsigned time = cacheSize + 1;
+	size_t misses = 0, referenced = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		GLuint v = indices[i];
+		if (v >= vertexCount) continue;
+		if (!used[v])
+		{
+			used[v] = 1;
+			referenced++;
+		}
+		if (time - cacheTime[v] > (unsigned)cacheSize)
+		{
+			cacheTime[v] = time++;
+			misses++;
+		}
+	}
+	size_t nTriangles = indices.size() / 3;
+	acmr = nTriangles ? (float)misses / nTriangles : 0.0f;
+	atvr = referenced ? (float)misses / referenced : 0.0f;
+}
+
+void GLVertexCacheOptimizer::optimizeTriangleOrder(std::vector<GLuint>& indices, size_t vertexCount,
+												   int cacheSize/*=16*/, int nThreads/*=0*/)
+{
+	size_t nTriangles = indices.size() / 3;
+	if (nTriangles == 0 || vertexCount == 0) return;
+	//tipsify() indexes its per vertex arrays with these directly.
+	for (size_t i = 0; i < 3 * nTriangles; i++)
+	{
+		if (indices[i] >= vertexCount)
+		{
+			std::stringstream ss;
+			ss << __func__ << ": index " << indices[i] << " at " << i << " is out of range of "
+			   << vertexCount << " vertices.";
+			GLError::ErrorMessage(ss.str());
+			return;
+		}
+	}
+	nThreads = resolveThreadCount(nThreads);
+	size_t nSlabs = (nThreads == 1 || nTriangles < g_minParallelTriangles) ? 1 : size_t(4) * nThreads;
+	if (nSlabs > 1)
+	{//slabs only keep neighbors together if vertex ids are spatially coherent.
+		double span = 0.0;
+		for (size_t t = 0; t < nTriangles; t++)
+		{
+			GLuint a = indices[3 * t], b = indices[3 * t + 1], c = indices[3 * t + 2];
+			span += std::max(a, std::max(b, c)) - std::min(a, std::min(b, c));
+		}
+		if (span / nTriangles * nSlabs * 8 > vertexCount)
+			nSlabs = 1;
+	}
+	if (nSlabs == 1)
+	{
+		std::vector<GLuint> ordered;
+		ordered.reserve(indices.size());
+		tipsify(indices, vertexCount, cacheSize, ordered);
+		indices.swap(ordered);
+		return;
+	}
+
+	//a triangle goes to the slab of its smallest vertex id, input order is
+	//kept inside a slab.
+	std::vector<size_t> slabStart(nSlabs + 1, 0);
+	std::vector<unsigned> slabOf(nTriangles);
+	for (size_t t = 0; t < nTriangles; t++)
+	{
+		GLuint v = std::min(indices[3 * t], std::min(indices[3 * t + 1], indices[3 * t + 2]));
+		slabOf[t] = (unsigned)std::min(nSlabs - 1, (size_t)((double)v * nSlabs / vertexCount));
+		slabStart[slabOf[t] + 1]++;
+	}
+	for (size_t s = 0; s < nSlabs; s++)
+		slabStart[s + 1] += slabStart[s];
+	std::vector<GLuint> grouped(3 * nTriangles);
+	{
+		std::vector<size_t> fill(slabStart.begin(), slabStart.end() - 1);
+		for (size_t t = 0; t < nTriangles; t++)
+		{
+			size_t dst = 3 * fill[slabOf[t]]++;
+			for (int k = 0; k < 3; k++)
+				grouped[dst + k] = indices[3 * t + k];
+		}
+	}
+
+	parallelForEach(nSlabs, nThreads, [&](size_t s)
+	{
+		std::vector<GLuint> local(grouped.begin() + 3 * slabStart[s], grouped.begin() + 3 * slabStart[s + 1]);
+		if (local.empty()) return;
+		//slab vertices renumbered so the work arrays stay small: by an
+		//offset if their ids are compact, densely otherwise.
+		GLuint lo = *std::min_element(local.begin(), local.end());
+		GLuint hi = *std::max_element(local.begin(), local.end());
+		std::vector<GLuint> vertices;
+		size_t localCount = size_t(hi - lo) + 1;
+		if (localCount <= 4 * local.size())
+		{
+			for (size_t i = 0; i < local.size(); i++)
+				local[i] -= lo;
+		}
+		else
+		{
+			vertices = local;
+			std::sort(vertices.begin(), vertices.end());
+			vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+			for (size_t i = 0; i < local.size(); i++)
+				local[i] = (GLuint)(std::lower_bound(vertices.begin(), vertices.end(), local[i]) - vertices.begin());
+			localCount = vertices.size();
+		}
+		std::vector<GLuint> ordered;
+		ordered.reserve(local.size());
+		tipsify(local, localCount, cacheSize, ordered);
+		GLuint* dst = &indices[3 * slabStart[s]];
+		for (size_t i = 0; i < ordered.size(); i++)
+			dst[i] = vertices.empty() ? ordered[i] + lo : vertices[ordered[i]];
+	});
+}
+
+size_t GLVertexCacheOptimizer::optimizeVertexFetch(std::vector<GLuint>& indices, size_t vertexCount,
+												   std::vector<GLuint>& remap)
+{
+	remap.assign(vertexCount, GL_INVALID_INDEX);
+	GLuint next = 0;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		GLuint& v = indices[i];
+		if (v >= vertexCount) continue;
+		if (remap[v] == GL_INVALID_INDEX)
+			remap[v] = next++;
+		v = remap[v];
+	}
+	return next;
+}
+
+GLVertexCacheReport GLVertexCacheOptimizer::optimize(std::vector<GLuint>& indices, size_t vertexCount,
+													 std::vector<GLuint>& remap, int cacheSize/*=16*/,
+													 int nThreads/*=0*/)
+{
+	GLVertexCacheReport report;
+	analyze(indices, vertexCount, report.acmrBefore, report.atvrBefore, cacheSize);
+	optimizeTriangleOrder(indices, vertexCount, cacheSize, nThreads);
+	report.vertexCount = optimizeVertexFetch(indices, vertexCount, remap);
+	analyze(indices, report.vertexCount, report.acmrAfter, report.atvrAfter, cacheSize);
+	report.shortIndices = fitsShortIndices(indices);
+	return report;
+}
+
+bool GLVertexCacheOptimizer::fitsShortIndices(const std::vector<GLuint>& indices,
+											  bool useRestart/*=false*/, GLuint restartIndex/*=0*/)
+{
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		if (useRestart && indices[i] == restartIndex) continue;
+		if (indices[i] >= 0xFFFF) return false;
+	}
+	return true;
+}
+
+}
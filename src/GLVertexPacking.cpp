@@ -0,0 +1,426 @@
+/*
+Copyright (c) 2013-2017 Jinrong Xie (jrxie at ucdavis dot edu)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE
+OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "GLError.h"
+#include "GLVertexPacking.h"
+#include "GLParallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GLPACK_SSE
+#endif
+
+namespace davinci{
+
+namespace{
+	const size_t g_chunkSize = 4096;//vertices converted per task.
+
+	//The conversion kernels below take n floats already laid out in output
+	//component order and write n output components.
+
+	//round(clamp(v,lo,hi)*scale) into 32 bit integers.
+	void quantize(const float* src, int* dst, size_t n, float lo, float hi, float scale)
+	{
+		size_t i = 0;
+#ifdef GLPACK_SSE
+		__m128 vlo = _mm_set1_ps(lo), vhi = _mm_set1_ps(hi), vs = _mm_set1_ps(scale);
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), vlo), vhi);
+			_mm_storeu_si128((__m128i*)(dst + i), _mm_cvtps_epi32(_mm_mul_ps(v, vs)));
+		}
+#endif
+		for (; i < n; i++)
+		{
+			float v = std::min(std::max(src[i], lo), hi);
+			dst[i] = (int)std::nearbyint(v * scale);
+		}
+	}
+
+	void toUnorm16(const float* src, GLushort* dst, size_t n)
+	{
+		int tmp[g_chunkSize];
+		for (size_t b = 0; b < n; b += g_chunkSize)
+		{
+			size_t m = std::min(g_chunkSize, n - b);
+			quantize(src + b, tmp, m, 0.0f, 1.0f, 65535.0f);
+			for (size_t i = 0; i < m; i++)
+				dst[b + i] = (GLushort)tmp[i];
+		}
+	}
+
+	void toSnorm16(const float* src, GLshort* dst, size_t n)
+	{
+		int tmp[g_chunkSize];
+		for (size_t b = 0; b < n; b += g_chunkSize)
+		{
+			size_t m = std::min(g_chunkSize, n - b);
+			quantize(src + b, tmp, m, -1.0f, 1.0f, 32767.0f);
+			for (size_t i = 0; i < m; i++)
+				dst[b + i] = (GLshort)tmp[i];
+		}
+	}
+
+	void toUnorm8(const float* src, GLubyte* dst, size_t n)
+	{
+		int tmp[g_chunkSize];
+		for (size_t b = 0; b < n; b += g_chunkSize)
+		{
+			size_t m = std::min(g_chunkSize, n - b);
+			quantize(src + b, tmp, m, 0.0f, 1.0f, 255.0f);
+			for (size_t i = 0; i < m; i++)
+				dst[b + i] = (GLubyte)tmp[i];
+		}
+	}
+
+#ifdef GLPACK_SSE
+	//4 floats to 4 halves (in the low 16 bits of each lane), round to nearest
+	//even, same results as GLVertexPacking::floatToHalf().
+	__m128i floatToHalf4(__m128 f)
+	{
+		const __m128i signMask = _mm_set1_epi32((int)0x80000000u);
+		const __m128i f16Max = _mm_set1_epi32((127 + 16) << 23);//>= this is inf.
+		const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+		const __m128i subnormMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+		const __m128i normalBias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+		__m128 sign = _mm_and_ps(_mm_castsi128_ps(signMask), f);
+		__m128 absf = _mm_xor_ps(f, sign);
+		__m128i absi = _mm_castps_si128(absf);
+		__m128i isNan = _mm_castps_si128(_mm_cmpunord_ps(absf, absf));
+		__m128i isRegular = _mm_cmpgt_epi32(f16Max, absi);
+		__m128i special = _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7c00));
+		__m128i isSub = _mm_cmpgt_epi32(minNormal, absi);
+		//subnormal results: let the float adder round the mantissa.
+		__m128i sub = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absf, _mm_castsi128_ps(subnormMagic))), subnormMagic);
+		//normal results: rebias the exponent and round the mantissa.
+		__m128i odd = _mm_srai_epi32(_mm_slli_epi32(absi, 31 - 13), 31);
+		__m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absi, normalBias), odd), 13);
+		__m128i regular = _mm_or_si128(_mm_and_si128(isSub, sub), _mm_andnot_si128(isSub, normal));
+		__m128i joined = _mm_or_si128(_mm_and_si128(isRegular, regular), _mm_andnot_si128(isRegular, special));
+		return _mm_or_si128(joined, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+	}
+#endif
+
+	void toHalf(const float* src, GLushort* dst, size_t n)
+	{
+		size_t i = 0;
+#ifdef GLPACK_SSE
+		for (; i + 4 <= n; i += 4)
+		{
+			int h[4];
+			_mm_storeu_si128((__m128i*)h, floatToHalf4(_mm_loadu_ps(src + i)));
+			dst[i] = (GLushort)h[0]; dst[i + 1] = (GLushort)h[1];
+			dst[i + 2] = (GLushort)h[2]; dst[i + 3] = (GLushort)h[3];
+		}
+#endif
+		for (; i < n; i++)
+			dst[i] = GLVertexPacking::floatToHalf(src[i]);
+	}
+
+	//Runs stage(begin, end, floats) per chunk, which lays out the chunk's
+	//components, then convert(floats, dst, count) into the chunk's part of dst.
+	template<class Out, class Stage, class Convert>
+	void packChunks(size_t nVertices, GLuint nOut, std::vector<unsigned char>& dst,
+					int nThreads, Stage stage, Convert convert)
+	{
+		dst.resize(nVertices * nOut * sizeof(Out));
+		Out* out = (Out*)dst.data();
+		size_t nChunks = (nVertices + g_chunkSize - 1) / g_chunkSize;
+		parallelForEach(nChunks, resolveThreadCount(nThreads), [&](size_t c)
+		{
+			size_t begin = c * g_chunkSize, end = std::min(nVertices, begin + g_chunkSize);
+			std::vector<float> floats((end - begin) * nOut);
+			stage(begin, end, floats.data());
+			convert(floats.data(), out + begin * nOut, floats.size());
+		});
+	}
+
+	void formatError(const char* func, GLVertexPacking::Format format)
+	{
+		GLError::ErrorMessage(string(func) + ": format " + std::to_string((int)format) + " does not apply to this attribute.");
+	}
+}
+
+GLuint GLVertexPacking::getStride(Format format)
+{
+	switch (format)
+	{
+	case PACK_FLOAT3:            return 12;
+	case PACK_POSITION_HALF:
+	case PACK_POSITION_UNORM16:
+	case PACK_COLOR_UNORM16:     return 8;
+	default:                     return 4;
+	}
+}
+
+GLenum GLVertexPacking::getType(Format format)
+{
+	switch (format)
+	{
+	case PACK_FLOAT3:            return GL_FLOAT;
+	case PACK_POSITION_HALF:
+	case PACK_TEXCOORD_HALF:     return GL_HALF_FLOAT;
+	case PACK_NORMAL_2_10_10_10: return GL_INT_2_10_10_10_REV;
+	case PACK_NORMAL_OCT16:      return GL_SHORT;
+	case PACK_COLOR_UNORM8:      return GL_UNSIGNED_BYTE;
+	default:                     return GL_UNSIGNED_SHORT;
+	}
+}
+
+GLuint GLVertexPacking::getComponents(Format format)
+{
+	switch (format)
+	{
+	case PACK_NORMAL_OCT16:
+	case PACK_TEXCOORD_UNORM16:
+	case PACK_TEXCOORD_HALF:     return 2;
+	//packed 10:10:10:2 requires all 4 components.
+	case PACK_NORMAL_2_10_10_10:
+	case PACK_COLOR_UNORM8:
+	case PACK_COLOR_UNORM16:     return 4;
+	default:                     return 3;
+	}
+}
+
+bool GLVertexPacking::isNormalized(Format format)
+{
+	return format != PACK_FLOAT3 && format != PACK_POSITION_HALF && format != PACK_TEXCOORD_HALF;
+}
+
+void GLVertexPacking::getPositionDecode(const BBox& box, Format format, vec3f& scale, vec3f& bias)
+{
+	if (format == PACK_POSITION_HALF)
+	{
+		scale = box.getDimension() * 0.5f;
+		bias = box.Center();
+	}
+	else if (format == PACK_POSITION_UNORM16)
+	{
+		scale = box.getDimension();
+		bias = box.pMin;
+	}
+	else
+	{
+		scale = vec3f(1.0f);
+		bias = vec3f(0.0f);
+	}
+}
+
+void GLVertexPacking::packPositions(const std::vector<vec3f>& src, const BBox& box, Format format,
+								   std::vector<unsigned char>& dst, int nThreads/*=0*/)
+{
+	if (format == PACK_FLOAT3)
+	{
+		dst.resize(src.size() * sizeof(vec3f));
+		if (!src.empty()) memcpy(dst.data(), src.data(), dst.size());
+		return;
+	}
+	if (format != PACK_POSITION_HALF && format != PACK_POSITION_UNORM16)
+	{
+		formatError(__func__, format);
+		return;
+	}
+	vec3f scale, bias;
+	getPositionDecode(box, format, scale, bias);
+	//flat boxes would divide by 0, any scale restores those axes.
+	vec3f invScale;
+	for (int a = 0; a < 3; a++)
+		invScale[a] = scale[a] > 0.0f ? 1.0f / scale[a] : 0.0f;
+	auto stage = [&](size_t begin, size_t end, float* f)
+	{
+		for (size_t i = begin; i < end; i++, f += 4)
+		{
+			for (int a = 0; a < 3; a++)
+				f[a] = (src[i][a] - bias[a]) * invScale[a];
+			f[3] = 0.0f;
+		}
+	};
+	if (format == PACK_POSITION_HALF)
+		packChunks<GLushort>(src.size(), 4, dst, nThreads, stage, toHalf);
+	else
+		packChunks<GLushort>(src.size(), 4, dst, nThreads, stage, toUnorm16);
+}
+
+void GLVertexPacking::packNormals(const std::vector<vec3f>& src, Format format,
+								 std::vector<unsigned char>& dst, int nThreads/*=0*/)
+{
+	if (format == PACK_FLOAT3)
+	{
+		dst.resize(src.size() * sizeof(vec3f));
+		if (!src.empty()) memcpy(dst.data(), src.data(), dst.size());
+	}
+	else if (format == PACK_NORMAL_2_10_10_10)
+	{
+		auto stage = [&](size_t begin, size_t end, float* f)
+		{
+			for (size_t i = begin; i < end; i++, f += 4)
+			{
+				f[0] = src[i][0]; f[1] = src[i][1]; f[2] = src[i][2];
+				f[3] = 0.0f;
+			}
+		};
+		//snorm: c = round(clamp(v,-1,1)*511), 10 bits each, x in the low bits.
+		auto convert = [](const float* f, GLuint* out, size_t n)
+		{
+			int q[4 * 256];
+			for (size_t b = 0; b < n; b += 4 * 256)
+			{
+				size_t m = std::min<size_t>(4 * 256, n - b);
+				quantize(f + b, q, m, -1.0f, 1.0f, 511.0f);
+				for (size_t i = 0; i < m; i += 4)
+					*out++ = (GLuint)(q[i] & 0x3FF) | ((GLuint)(q[i + 1] & 0x3FF) << 10) | ((GLuint)(q[i + 2] & 0x3FF) << 20);
+			}
+		};
+		//4 staged floats make one 32 bit word.
+		dst.resize(src.size() * sizeof(GLuint));
+		GLuint* out = (GLuint*)dst.data();
+		size_t nChunks = (src.size() + g_chunkSize - 1) / g_chunkSize;
+		parallelForEach(nChunks, resolveThreadCount(nThreads), [&](size_t c)
+		{
+			size_t begin = c * g_chunkSize, end = std::min(src.size(), begin + g_chunkSize);
+			std::vector<float> floats((end - begin) * 4);
+			stage(begin, end, floats.data());
+			convert(floats.data(), out + begin, floats.size());
+		});
+	}
+	else if (format == PACK_NORMAL_OCT16)
+	{
+		//fold the octahedron |x|+|y|+|z|=1 onto the [-1,1]^2 square.
+		auto stage = [&](size_t begin, size_t end, float* f)
+		{
+			for (size_t i = begin; i < end; i++, f += 2)
+			{
+				const vec3f& n = src[i];
+				float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+				float x = l1 > 0.0f ? n[0] / l1 : 0.0f;
+				float y = l1 > 0.0f ? n[1] / l1 : 0.0f;
+				if (n[2] < 0.0f)
+				{
+					float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+					float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+					x = fx; y = fy;
+				}
+				f[0] = x; f[1] = y;
+			}
+		};
+		packChunks<GLshort>(src.size(), 2, dst, nThreads, stage, toSnorm16);
+	}
+	else
+	{
+		formatError(__func__, format);
+	}
+}
+
+void GLVertexPacking::packColors(const std::vector<vec4f>& src, Format format,
+								std::vector<unsigned char>& dst, int nThreads/*=0*/)
+{
+	auto stage = [&](size_t begin, size_t end, float* f)
+	{
+		for (size_t i = begin; i < end; i++, f += 4)
+			for (int a = 0; a < 4; a++)
+				f[a] = src[i][a];
+	};
+	if (format == PACK_COLOR_UNORM8)
+		packChunks<GLubyte>(src.size(), 4, dst, nThreads, stage, toUnorm8);
+	else if (format == PACK_COLOR_UNORM16)
+		packChunks<GLushort>(src.size(), 4, dst, nThreads, stage, toUnorm16);
+	else
+		formatError(__func__, format);
+}
+
+void GLVertexPacking::packTexCoords(const std::vector<vec2f>& src, Format format,
+								   std::vector<unsigned char>& dst, int nThreads/*=0*/)
+{
+	auto stage = [&](size_t begin, size_t end, float* f)
+	{
+		for (size_t i = begin; i < end; i++, f += 2)
+		{
+			f[0] = src[i][0];
+			f[1] = src[i][1];
+		}
+	};
+	if (format == PACK_TEXCOORD_UNORM16)
+		packChunks<GLushort>(src.size(), 2, dst, nThreads, stage, toUnorm16);
+	else if (format == PACK_TEXCOORD_HALF)
+		packChunks<GLushort>(src.size(), 2, dst, nThreads, stage, toHalf);
+	else
+		formatError(__func__, format);
+}
+
+const char* GLVertexPacking::getDecodeGLSL()
+{
+	return
+		"vec3 decodeOctahedral(vec2 e)\n"
+		"{\n"
+		"	vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));\n"
+		"	float t = max(-n.z, 0.0);\n"
+		"	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);\n"
+		"	return normalize(n);\n"
+		"}\n";
+}
+
+GLushort GLVertexPacking::floatToHalf(float f)
+{
+	unsigned int x;
+	memcpy(&x, &f, sizeof(x));
+	unsigned int sign = (x >> 16) & 0x8000;
+	unsigned int absx = x & 0x7FFFFFFF;
+	if (absx > 0x7F800000)//NaN
+		return (GLushort)(sign | 0x7E00);
+	if (absx >= ((127 + 16) << 23))//overflow and inf
+		return (GLushort)(sign | 0x7C00);
+	if (absx < ((127 - 14) << 23))//subnormal or zero
+	{
+		float a;
+		memcpy(&a, &absx, sizeof(a));
+		//2^24 scales the smallest subnormal to 1, nearbyint rounds to even.
+		return (GLushort)(sign | (unsigned int)std::nearbyint(a * 16777216.0f));
+	}
+	unsigned int odd = (absx >> 13) & 1;
+	return (GLushort)(sign | ((absx + 0xFFF + odd - ((127 - 15) << 23)) >> 13));
+}
+
+float GLVertexPacking::halfToFloat(GLushort h)
+{
+	unsigned int sign = (unsigned int)(h & 0x8000) << 16;
+	unsigned int e = (h >> 10) & 0x1F, m = h & 0x3FF;
+	float f;
+	if (e == 0)
+	{
+		f = ldexpf((float)m, -24);
+		unsigned int x;
+		memcpy(&x, &f, sizeof(x));
+		x |= sign;
+		memcpy(&f, &x, sizeof(f));
+		return f;
+	}
+	unsigned int x = sign | (e == 31 ? (0xFFu << 23) | (m << 13) : ((e + 127 - 15) << 23) | (m << 13));
+	memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+}